@@ -1,7 +1,5 @@
 #include "applet.h"
 
-#define _GNU_SOURCE
-
 enum {
 	PROP_UUID = 1,
 	LAST_PROP
@@ -18,33 +16,41 @@ struct _TrashAppletPrivate {
 
 	GtkWidget *popover;
 	GtkWidget *icon_button;
+	TrashIcon *icon;
+
+	TrashFileQueue *file_queue;
+	TrashStatsService *stats_service;
 };
 
 G_DEFINE_DYNAMIC_TYPE_EXTENDED(TrashApplet, trash_applet, BUDGIE_TYPE_APPLET, 0, G_ADD_PRIVATE_DYNAMIC(TrashApplet))
 
-static void trash_empty_cb(TrashPopover *source, gpointer user_data) {
-	(void) source;
-	TrashApplet *self = user_data;
-	GtkWidget *image;
-
-	image = gtk_image_new_from_icon_name("user-trash-symbolic", GTK_ICON_SIZE_MENU);
+/**
+ * Pass the new totals on to the panel icon. This runs for every item that
+ * comes or goes, so it only hands over the counts; the icon applies them
+ * once per frame.
+ */
+static void items_changed(TrashManager *manager, gpointer item, TrashApplet *self) {
+	(void) item;
+	TrashManagerCounters counters;
 
-	gtk_button_set_image(GTK_BUTTON(self->priv->icon_button), image);
+	trash_manager_get_counters(manager, &counters);
+	trash_icon_set_counts(self->priv->icon, counters.items, counters.total_bytes);
 }
 
-static void trash_filled_cb(TrashPopover *source, gpointer user_data) {
-	(void) source;
-	TrashApplet *self = user_data;
-	GtkWidget *image;
+static void badge_settings_changed(GSettings *settings, const gchar *key, TrashApplet *self) {
+	(void) key;
+	guint gigabytes;
 
-	image = gtk_image_new_from_icon_name("user-trash-full-symbolic", GTK_ICON_SIZE_MENU);
+	gigabytes = g_settings_get_uint(settings, TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE);
 
-	gtk_button_set_image(GTK_BUTTON(self->priv->icon_button), image);
+	trash_icon_set_badge_mode(self->priv->icon, (TrashBadgeMode) g_settings_get_enum(settings, TRASH_SETTINGS_KEY_BADGE));
+	trash_icon_set_capacity(self->priv->icon, (guint64) gigabytes * 1000 * 1000 * 1000);
 }
 
 static void trash_applet_constructed(GObject *object) {
 	TrashApplet *self = TRASH_APPLET(object);
 	TrashPopover *popover_body;
+	TrashManager *trash_manager;
 
 	// Set our settings schema and prefix
 	g_object_set(self,
@@ -58,8 +64,23 @@ static void trash_applet_constructed(GObject *object) {
 	popover_body = trash_popover_new(self->settings);
 	gtk_container_add(GTK_CONTAINER(self->priv->popover), GTK_WIDGET(popover_body));
 
-	g_signal_connect(popover_body, "trash-empty", G_CALLBACK(trash_empty_cb), self);
-	g_signal_connect(popover_body, "trash-filled", G_CALLBACK(trash_filled_cb), self);
+	// Keep the panel icon in step with the trash bin
+	trash_manager = trash_popover_get_manager(popover_body);
+	g_signal_connect_object(trash_manager, "trash-added", G_CALLBACK(items_changed), self, 0);
+	g_signal_connect_object(trash_manager, "trash-removed", G_CALLBACK(items_changed), self, 0);
+	items_changed(trash_manager, NULL, self);
+
+	g_signal_connect_object(self->settings, "changed::" TRASH_SETTINGS_KEY_BADGE, G_CALLBACK(badge_settings_changed), self, 0);
+	g_signal_connect_object(self->settings, "changed::" TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE, G_CALLBACK(badge_settings_changed), self, 0);
+	badge_settings_changed(self->settings, NULL, self);
+
+	self->priv->stats_service = trash_stats_service_new(
+		self->priv->uuid,
+		trash_popover_get_manager(popover_body),
+		trash_popover_get_purge_scheduler(popover_body),
+		self->priv->file_queue);
+
+	trash_watchdog_start();
 
 	G_OBJECT_CLASS(trash_applet_parent_class)->constructed(object);
 }
@@ -75,6 +96,9 @@ static void trash_applet_finalize(GObject *object) {
 	priv = trash_applet_get_instance_private(self);
 
 	g_free(priv->uuid);
+	g_clear_object(&priv->stats_service);
+	trash_watchdog_stop();
+	g_clear_object(&priv->file_queue);
 
 	if (self->settings) {
 		g_object_unref(self->settings);
@@ -175,6 +199,7 @@ static void trash_applet_class_init(TrashAppletClass *klass) {
  * Handle cleanup of the applet class.
  */
 static void trash_applet_class_finalize(__budgie_unused__ TrashAppletClass *klass) {
+	trash_notify_shutdown();
 	notify_uninit();
 }
 
@@ -187,7 +212,7 @@ static void toggle_popover(__budgie_unused__ GtkButton *sender, TrashApplet *sel
 }
 
 static void drag_data_received(
-	__budgie_unused__ TrashApplet *self,
+	TrashApplet *self,
 	GdkDragContext *context,
 	__budgie_unused__ gint x,
 	__budgie_unused__ gint y,
@@ -196,26 +221,51 @@ static void drag_data_received(
 	guint time) {
 	g_return_if_fail(info == 0);
 
-	g_autofree gchar *uri = g_strdup((gchar *) gtk_selection_data_get_data(data));
-	g_autofree gchar *unescaped = NULL;
-	g_autoptr(GFile) file = NULL;
-	g_autoptr(GError) err = NULL;
+	g_auto(GStrv) uris = NULL;
+	GFile *file;
+	guint i;
+
+	uris = gtk_selection_data_get_uris(data);
+
+	if (!uris) {
+		gtk_drag_finish(context, FALSE, FALSE, time);
+		return;
+	}
 
-	if (g_str_has_prefix(uri, "file://")) {
-		unescaped = g_uri_unescape_string(uri, NULL);
-		g_strstrip(unescaped); // Make sure there's nothing silly like a trailing newline
-		file = g_file_new_for_uri(unescaped);
+	trash_watchdog_enter("drop");
 
-		if (!g_file_trash(file, NULL, &err)) {
-			trash_notify_try_send("Error Trashing File", err->message, "dialog-error-symbolic");
-			g_critical("%s:%d: Error moving file to trash: %s", __BASE_FILE__, __LINE__, err->message);
-			return;
+	for (i = 0; uris[i] != NULL; i++) {
+		if (!g_str_has_prefix(uris[i], "file://")) {
+			continue;
 		}
+
+		file = g_file_new_for_uri(uris[i]);
+		trash_file_queue_trash(self->priv->file_queue, file);
+		g_object_unref(file);
 	}
 
+	trash_watchdog_leave();
+
+	// Everything is queued up; don't make the drag source wait for the moves
 	gtk_drag_finish(context, TRUE, TRUE, time);
 }
 
+static void file_queue_progress(TrashFileQueue *source, guint done, guint total, TrashApplet *self) {
+	(void) source;
+	g_autofree gchar *text = NULL;
+
+	text = g_strdup_printf("Moving items to the trash (%u of %u)", done, total);
+	gtk_widget_set_tooltip_text(self->priv->icon_button, text);
+}
+
+static void file_queue_finished(TrashFileQueue *source, guint succeeded, guint failed, TrashApplet *self) {
+	(void) source;
+	(void) succeeded;
+	(void) failed;
+
+	gtk_widget_set_tooltip_text(self->priv->icon_button, "Trash");
+}
+
 /**
  * Initialization of basic UI elements and loads our CSS
  * style stuff.
@@ -227,7 +277,9 @@ static void trash_applet_init(TrashApplet *self) {
 	self->priv = trash_applet_get_instance_private(self);
 
 	// Create our panel widget
-	self->priv->icon_button = gtk_button_new_from_icon_name("user-trash-symbolic", GTK_ICON_SIZE_MENU);
+	self->priv->icon = trash_icon_new();
+	self->priv->icon_button = gtk_button_new();
+	gtk_button_set_image(GTK_BUTTON(self->priv->icon_button), GTK_WIDGET(self->priv->icon));
 	gtk_widget_set_tooltip_text(self->priv->icon_button, "Trash");
 
 	g_signal_connect(self->priv->icon_button, "clicked", G_CALLBACK(toggle_popover), self);
@@ -251,6 +303,11 @@ static void trash_applet_init(TrashApplet *self) {
 		GDK_ACTION_COPY);
 
 	g_signal_connect_object(self, "drag-data-received", G_CALLBACK(drag_data_received), self, 0);
+
+	self->priv->file_queue = trash_file_queue_new(TRASH_FILE_QUEUE_DEFAULT_MAX_IN_FLIGHT);
+
+	g_signal_connect_object(self->priv->file_queue, "progress", G_CALLBACK(file_queue_progress), self, 0);
+	g_signal_connect_object(self->priv->file_queue, "finished", G_CALLBACK(file_queue_finished), self, 0);
 }
 
 /**
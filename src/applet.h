@@ -1,8 +1,12 @@
 #pragma once
 
 #include "notify.h"
+#include "trash_file_queue.h"
+#include "trash_icon.h"
 #include "trash_popover.h"
 #include "trash_settings.h"
+#include "trash_stats_service.h"
+#include "trash_watchdog.h"
 #include <budgie-desktop/applet.h>
 #include <gtk/gtk.h>
 #include <libnotify/notify.h>
@@ -1,21 +1,184 @@
 #include "notify.h"
 
-static gpointer notify_send(gpointer data) {
-	NotifyNotification *noti = data;
-	gboolean success;
+/**
+ * How long, in microseconds, to wait for more notifications to arrive so
+ * that they can be shown together.
+ */
+#define TRASH_NOTIFY_AGGREGATE_WINDOW (500 * G_TIME_SPAN_MILLISECOND)
+
+/**
+ * The minimum time, in microseconds, between two notifications.
+ */
+#define TRASH_NOTIFY_MIN_INTERVAL (3 * G_TIME_SPAN_SECOND)
+
+typedef struct {
+	gchar *summary;
+	gchar *body;
+	gchar *icon_name;
+	gchar *action;
+	guint count;
+} NotifyMessage;
+
+static GMutex notify_lock;
+static GAsyncQueue *notify_queue = NULL;
+static GThread *notify_thread = NULL;
+
+/**
+ * Pushed onto the queue to tell the worker thread to exit.
+ */
+static NotifyMessage shutdown_message;
+
+static void notify_message_free(gpointer data) {
+	NotifyMessage *message = data;
+
+	if (message == &shutdown_message) {
+		return;
+	}
+
+	g_free(message->summary);
+	g_free(message->body);
+	g_free(message->icon_name);
+	g_free(message->action);
+	g_slice_free(NotifyMessage, message);
+}
+
+/**
+ * Fold a message into the batch, merging it with an earlier message of
+ * the same kind if there is one.
+ */
+static void batch_add(GPtrArray *batch, NotifyMessage *message) {
+	NotifyMessage *existing;
+	guint i;
+
+	for (i = 0; i < batch->len; i++) {
+		existing = g_ptr_array_index(batch, i);
+
+		if (g_strcmp0(existing->summary, message->summary) == 0 && g_strcmp0(existing->action, message->action) == 0) {
+			existing->count++;
+			notify_message_free(message);
+			return;
+		}
+	}
+
+	g_ptr_array_add(batch, message);
+}
+
+static void show_message(NotifyMessage *message) {
+	NotifyNotification *notification;
 	g_autoptr(GError) error = NULL;
+	g_autofree gchar *body = NULL;
+
+	if (message->count == 1) {
+		body = g_strdup(message->body);
+	} else if (message->action) {
+		body = g_strdup_printf("Unable to %s %'u items. The first error was: %s", message->action, message->count, message->body);
+	} else {
+		body = g_strdup_printf("%s (and %'u more)", message->body, message->count - 1);
+	}
 
-	success = notify_notification_show(noti, &error);
+	notification = notify_notification_new(message->summary, body, message->icon_name);
+	notify_notification_set_app_name(notification, "Budgie Trash Applet");
+	notify_notification_set_urgency(notification, NOTIFY_URGENCY_NORMAL);
+	notify_notification_set_timeout(notification, 5000);
 
-	if (!success) {
+	if (!notify_notification_show(notification, &error)) {
 		g_critical("Error sending notification: %s", error->message);
 	}
 
-	g_object_unref(noti);
+	g_object_unref(notification);
+}
+
+/**
+ * The notification worker. It waits for a message, gathers up everything
+ * else that arrives shortly after it, and shows the lot as few
+ * notifications as possible. Showing a notification is a blocking D-Bus
+ * call, which is why this lives on its own thread.
+ */
+static gpointer notify_worker(gpointer data) {
+	GAsyncQueue *queue = data;
+	g_autoptr(GPtrArray) batch = NULL;
+	NotifyMessage *message;
+	gint64 last_sent = 0;
+	gint64 deadline;
+	gint64 now;
+	gboolean running = TRUE;
+	guint i;
+
+	batch = g_ptr_array_new_with_free_func(notify_message_free);
+
+	while (running) {
+		message = g_async_queue_pop(queue);
+
+		if (message == &shutdown_message) {
+			break;
+		}
+
+		batch_add(batch, message);
+
+		// Wait out the aggregation window, and the rate limit if we just
+		// showed something, collecting whatever else comes in.
+		deadline = MAX(g_get_monotonic_time() + TRASH_NOTIFY_AGGREGATE_WINDOW, last_sent + TRASH_NOTIFY_MIN_INTERVAL);
+
+		while ((now = g_get_monotonic_time()) < deadline) {
+			message = g_async_queue_timeout_pop(queue, (guint64) (deadline - now));
+
+			if (!message) {
+				break;
+			}
+
+			if (message == &shutdown_message) {
+				running = FALSE;
+				break;
+			}
+
+			batch_add(batch, message);
+		}
+
+		for (i = 0; i < batch->len; i++) {
+			show_message(g_ptr_array_index(batch, i));
+		}
+
+		g_ptr_array_set_size(batch, 0);
+		last_sent = g_get_monotonic_time();
+	}
+
+	g_async_queue_unref(queue);
 
 	return NULL;
 }
 
+static void push_message(const gchar *summary, const gchar *body, const gchar *icon_name, const gchar *action) {
+	NotifyMessage *message;
+	g_autoptr(GError) error = NULL;
+
+	message = g_slice_new0(NotifyMessage);
+	message->summary = g_strdup(summary);
+	message->body = g_strdup(body);
+	message->icon_name = g_strdup(icon_name ? icon_name : "user-trash-symbolic");
+	message->action = g_strdup(action);
+	message->count = 1;
+
+	g_mutex_lock(&notify_lock);
+
+	if (!notify_thread) {
+		notify_queue = g_async_queue_new();
+		notify_thread = g_thread_try_new("trash-notify-thread", notify_worker, g_async_queue_ref(notify_queue), &error);
+
+		if (!notify_thread) {
+			g_critical("Failed to spawn thread for sending notifications: %s", error->message);
+			g_async_queue_unref(notify_queue); // The reference meant for the worker
+			g_clear_pointer(&notify_queue, g_async_queue_unref);
+			g_mutex_unlock(&notify_lock);
+			notify_message_free(message);
+			return;
+		}
+	}
+
+	g_async_queue_push(notify_queue, message);
+
+	g_mutex_unlock(&notify_lock);
+}
+
 /**
  * trash_notify_try_send:
  * @summary: (transfer none): the notification summary
@@ -27,26 +190,51 @@ static gpointer notify_send(gpointer data) {
  * If no @icon_name is passed to the function, a default icon
  * will be used.
  *
- * A thread will be spawned so that the notification will actually
- * be shown by Budgie without timing out (and locking up the system)
- * until it times out.
+ * Notifications are shown from a single worker thread so that Budgie
+ * can show them without locking up the panel. Notifications with the
+ * same summary that are sent close together are combined into one, and
+ * notifications are rate-limited.
  */
-void trash_notify_try_send(gchar *summary, gchar *body, gchar *icon_name) {
-	NotifyNotification *notification;
+void trash_notify_try_send(const gchar *summary, const gchar *body, const gchar *icon_name) {
+	push_message(summary, body, icon_name, NULL);
+}
+
+/**
+ * trash_notify_try_send_failure:
+ * @summary: (transfer none): the notification summary
+ * @body: (transfer none): the notification body
+ * @icon_name: (transfer none): the icon to use for the notification
+ * @action: (transfer none): the action that failed, e.g. "delete"
+ *
+ * Like trash_notify_try_send(), but for a failed file operation. When many
+ * failures for the same @action arrive together, they are summed up in one
+ * notification such as "Unable to delete 1,873 items".
+ */
+void trash_notify_try_send_failure(const gchar *summary, const gchar *body, const gchar *icon_name, const gchar *action) {
+	push_message(summary, body, icon_name, action);
+}
+
+/**
+ * trash_notify_shutdown:
+ *
+ * Stops the notification worker thread, waiting for it to show anything
+ * that it was already holding on to.
+ */
+void trash_notify_shutdown(void) {
 	GThread *thread;
-	g_autoptr(GError) error = NULL;
 
-	notification = notify_notification_new(summary, body, icon_name ? icon_name : "user-trash-symbolic");
-	notify_notification_set_app_name(notification, "Budgie Trash Applet");
-	notify_notification_set_urgency(notification, NOTIFY_URGENCY_NORMAL);
-	notify_notification_set_timeout(notification, 5000);
+	g_mutex_lock(&notify_lock);
 
-	thread = g_thread_try_new("trash-notify-thread", notify_send, notification, &error);
+	thread = g_steal_pointer(&notify_thread);
 
-	if (!thread) {
-		g_critical("Failed to spawn thread for sending a notification: %s", error->message);
-		return;
+	if (thread) {
+		g_async_queue_push(notify_queue, &shutdown_message);
+		g_clear_pointer(&notify_queue, g_async_queue_unref);
 	}
 
-	g_thread_unref(thread);
+	g_mutex_unlock(&notify_lock);
+
+	if (thread) {
+		g_thread_join(thread);
+	}
 }
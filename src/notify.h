@@ -4,6 +4,10 @@
 
 G_BEGIN_DECLS
 
-void trash_notify_try_send(gchar *summary, gchar *body, gchar *icon_name);
+void trash_notify_try_send(const gchar *summary, const gchar *body, const gchar *icon_name);
+
+void trash_notify_try_send_failure(const gchar *summary, const gchar *body, const gchar *icon_name, const gchar *action);
+
+void trash_notify_shutdown(void);
 
 G_END_DECLS
@@ -0,0 +1,717 @@
+/**
+ * SECTION:trashbackend
+ * @Short_description: Where trashed items come from
+ * @Title: TrashBackend
+ *
+ * A #TrashBackend is the source of trashed items for a #TrashManager. It
+ * lists and looks up items, tells the manager when items come and go, and
+ * performs the file operations on them.
+ *
+ * There are three implementations:
+ *
+ * - #TrashGvfsBackend goes through the `trash://` GIO backend, and sees the
+ *   trash bins on every mounted volume. This is the default.
+ * - #TrashXdgBackend reads the user's trash bin directly from disk as laid
+ *   out by the FreeDesktop.org trash spec, without needing gvfs.
+ * - #TrashFakeBackend keeps everything in memory, so that scanning and event
+ *   handling can be exercised with any number of synthetic items.
+ *
+ * The backend used by default can be overridden with the
+ * `BUDGIE_TRASH_BACKEND` environment variable, set to either `gvfs` or
+ * `xdg`.
+ */
+
+#include "trash_backend.h"
+#include "trash_backend_gvfs.h"
+#include "trash_backend_xdg.h"
+#include "trash_trace.h"
+
+enum {
+	ITEM_ADDED,
+	ITEM_REMOVED,
+	RESYNC,
+	OPERATIONS_CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+G_DEFINE_INTERFACE(TrashBackend, trash_backend, G_TYPE_OBJECT)
+
+static void trash_backend_default_init(TrashBackendInterface *iface) {
+	/**
+	 * TrashBackend::item-added:
+	 * @self: a #TrashBackend
+	 * @name: the name of the item in the trash bin
+	 *
+	 * Emitted when an item may have been added to the trash bin. The item
+	 * still has to be looked up, and may already be gone by then.
+	 */
+	signals[ITEM_ADDED] = g_signal_new("item-added",
+		G_TYPE_FROM_INTERFACE(iface),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		1,
+		G_TYPE_STRING);
+
+	/**
+	 * TrashBackend::item-removed:
+	 * @self: a #TrashBackend
+	 * @name: the name of the item in the trash bin
+	 *
+	 * Emitted when an item has been removed from the trash bin.
+	 */
+	signals[ITEM_REMOVED] = g_signal_new("item-removed",
+		G_TYPE_FROM_INTERFACE(iface),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		1,
+		G_TYPE_STRING);
+
+	/**
+	 * TrashBackend::resync:
+	 * @self: a #TrashBackend
+	 *
+	 * Emitted when the backend may have missed changes, e.g. because the
+	 * kernel dropped events, and the trash bin should be listed again.
+	 */
+	signals[RESYNC] = g_signal_new("resync",
+		G_TYPE_FROM_INTERFACE(iface),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		0);
+
+	/**
+	 * TrashBackend::operations-changed:
+	 * @self: a #TrashBackend
+	 *
+	 * Emitted on the main context when an asynchronous delete or restore
+	 * on @self starts or finishes, changing the number returned by
+	 * trash_backend_get_pending_operations().
+	 */
+	signals[OPERATIONS_CHANGED] = g_signal_new("operations-changed",
+		G_TYPE_FROM_INTERFACE(iface),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		0);
+}
+
+/**
+ * trash_backend_new_default:
+ *
+ * Creates the backend that the applet should use.
+ *
+ * Returns: (transfer full): a new #TrashBackend
+ */
+TrashBackend *trash_backend_new_default(void) {
+	const gchar *name;
+
+	name = g_getenv("BUDGIE_TRASH_BACKEND");
+
+	if (g_strcmp0(name, "xdg") == 0) {
+		return TRASH_BACKEND(trash_xdg_backend_new());
+	}
+
+	if (name && g_strcmp0(name, "gvfs") != 0) {
+		g_warning("Unknown trash backend '%s', using gvfs", name);
+	}
+
+	return TRASH_BACKEND(trash_gvfs_backend_new());
+}
+
+/**
+ * trash_backend_enumerate_async:
+ * @self: a #TrashBackend
+ * @attributes: the file attributes to query for each item
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the enumerator is ready
+ * @user_data: data to pass to @callback
+ *
+ * Starts listing the items in the trash bin.
+ */
+void trash_backend_enumerate_async(TrashBackend *self, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_return_if_fail(TRASH_IS_BACKEND(self));
+
+	TRASH_BACKEND_GET_IFACE(self)->enumerate_async(self, attributes, io_priority, cancellable, callback, user_data);
+}
+
+/**
+ * trash_backend_enumerate_finish:
+ * @self: a #TrashBackend
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes listing the items in the trash bin.
+ *
+ * Returns: (transfer full) (nullable): an enumerator over the trashed items
+ */
+GFileEnumerator *trash_backend_enumerate_finish(TrashBackend *self, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(TRASH_IS_BACKEND(self), NULL);
+
+	return TRASH_BACKEND_GET_IFACE(self)->enumerate_finish(self, result, error);
+}
+
+/**
+ * trash_backend_query_info_async:
+ * @self: a #TrashBackend
+ * @name: the name of the item in the trash bin
+ * @attributes: the file attributes to query
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the info is ready
+ * @user_data: data to pass to @callback
+ *
+ * Starts looking up a single trashed item.
+ */
+void trash_backend_query_info_async(TrashBackend *self, const gchar *name, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_return_if_fail(TRASH_IS_BACKEND(self));
+	g_return_if_fail(name != NULL);
+
+	TRASH_BACKEND_GET_IFACE(self)->query_info_async(self, name, attributes, io_priority, cancellable, callback, user_data);
+}
+
+/**
+ * trash_backend_query_info_finish:
+ * @self: a #TrashBackend
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes looking up a trashed item. If the item is no longer in the
+ * trash bin, %G_IO_ERROR_NOT_FOUND is set.
+ *
+ * Returns: (transfer full) (nullable): the info for the item
+ */
+GFileInfo *trash_backend_query_info_finish(TrashBackend *self, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(TRASH_IS_BACKEND(self), NULL);
+
+	return TRASH_BACKEND_GET_IFACE(self)->query_info_finish(self, result, error);
+}
+
+/**
+ * trash_backend_delete_item:
+ * @self: a #TrashBackend
+ * @name: the name of the item in the trash bin
+ * @bytes_freed: (out) (optional): return location for the number of bytes
+ *   freed, or 0 if the backend can't tell
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Permanently deletes a trashed item. This blocks, so it should only be
+ * called from a worker thread.
+ *
+ * Returns: %TRUE if the item was deleted
+ */
+gboolean trash_backend_delete_item(TrashBackend *self, const gchar *name, guint64 *bytes_freed, GCancellable *cancellable, GError **error) {
+	guint64 freed = 0;
+	gboolean ret;
+	gint64 trace_start;
+
+	g_return_val_if_fail(TRASH_IS_BACKEND(self), FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+
+	trace_start = TRASH_TRACE_NOW();
+	TRASH_TRACE_PROBE1(delete__start, name);
+
+	ret = TRASH_BACKEND_GET_IFACE(self)->delete_item(self, name, &freed, cancellable, error);
+
+	TRASH_TRACE_MARK(trace_start, "delete-item", "%s: %" G_GUINT64_FORMAT " bytes", name, freed);
+	TRASH_TRACE_PROBE2(delete__finish, name, ret);
+
+	if (bytes_freed) {
+		*bytes_freed = freed;
+	}
+
+	return ret;
+}
+
+/**
+ * trash_backend_restore_item:
+ * @self: a #TrashBackend
+ * @name: the name of the item in the trash bin
+ * @restore_path: where to put the item
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Moves a trashed item back out of the trash bin. This blocks, so it
+ * should only be called from a worker thread.
+ *
+ * Returns: %TRUE if the item was restored
+ */
+gboolean trash_backend_restore_item(TrashBackend *self, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GError **error) {
+	gboolean ret;
+	gint64 trace_start;
+
+	g_return_val_if_fail(TRASH_IS_BACKEND(self), FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(restore_path != NULL, FALSE);
+
+	trace_start = TRASH_TRACE_NOW();
+	TRASH_TRACE_PROBE1(restore__start, name);
+
+	ret = TRASH_BACKEND_GET_IFACE(self)->restore_item(self, name, restore_path, cancellable, error);
+
+	TRASH_TRACE_MARK(trace_start, "restore-item", "%s to %s", name, restore_path);
+	TRASH_TRACE_PROBE2(restore__finish, name, ret);
+
+	return ret;
+}
+
+typedef struct {
+	TrashBackend *backend;
+	gchar *name;
+	gchar *restore_path;
+} OperationData;
+
+/* Asynchronous file operations that haven't finished yet, for every backend */
+static gint pending_operations = 0;
+
+static gboolean emit_operations_changed(gpointer user_data) {
+	g_signal_emit(user_data, signals[OPERATIONS_CHANGED], 0);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Tell listeners that an operation on @self started or finished. The last
+ * reference to a task can be dropped on its worker thread, so this may be
+ * called from there.
+ */
+static void operations_changed(TrashBackend *self) {
+	g_main_context_invoke_full(NULL, G_PRIORITY_DEFAULT, emit_operations_changed, g_object_ref(self), g_object_unref);
+}
+
+static OperationData *operation_data_new(TrashBackend *self, const gchar *name, const gchar *restore_path) {
+	OperationData *op;
+
+	op = g_slice_new0(OperationData);
+	op->backend = g_object_ref(self);
+	op->name = g_strdup(name);
+	op->restore_path = g_strdup(restore_path);
+
+	g_atomic_int_inc(&pending_operations);
+	operations_changed(self);
+
+	return op;
+}
+
+static void operation_data_free(gpointer data) {
+	OperationData *op = data;
+
+	(void) g_atomic_int_dec_and_test(&pending_operations);
+	operations_changed(op->backend);
+
+	g_object_unref(op->backend);
+	g_free(op->name);
+	g_free(op->restore_path);
+	g_slice_free(OperationData, op);
+}
+
+static void delete_item_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	OperationData *op = task_data;
+	GError *error = NULL;
+
+	if (!trash_backend_delete_item(TRASH_BACKEND(source_object), op->name, NULL, cancellable, &error)) {
+		g_task_return_error(task, error);
+		return;
+	}
+
+	g_task_return_boolean(task, TRUE);
+}
+
+static void restore_item_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	OperationData *op = task_data;
+	GError *error = NULL;
+
+	if (!trash_backend_restore_item(TRASH_BACKEND(source_object), op->name, op->restore_path, cancellable, &error)) {
+		g_task_return_error(task, error);
+		return;
+	}
+
+	g_task_return_boolean(task, TRUE);
+}
+
+/**
+ * trash_backend_delete_item_async:
+ * @self: a #TrashBackend
+ * @name: the name of the item in the trash bin
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the item has been deleted
+ * @user_data: data to pass to @callback
+ *
+ * Permanently deletes a trashed item on a worker thread.
+ */
+void trash_backend_delete_item_async(TrashBackend *self, const gchar *name, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_autoptr(GTask) task = NULL;
+	OperationData *op;
+
+	g_return_if_fail(TRASH_IS_BACKEND(self));
+	g_return_if_fail(name != NULL);
+
+	op = operation_data_new(self, name, NULL);
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_backend_delete_item_async);
+	g_task_set_task_data(task, op, operation_data_free);
+	g_task_run_in_thread(task, delete_item_thread);
+}
+
+/**
+ * trash_backend_delete_item_finish:
+ * @self: a #TrashBackend
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes deleting a trashed item.
+ *
+ * Returns: %TRUE if the item was deleted
+ */
+gboolean trash_backend_delete_item_finish(TrashBackend *self, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+
+	return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+/**
+ * trash_backend_restore_item_async:
+ * @self: a #TrashBackend
+ * @name: the name of the item in the trash bin
+ * @restore_path: where to put the item
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the item has been restored
+ * @user_data: data to pass to @callback
+ *
+ * Moves a trashed item back out of the trash bin on a worker thread.
+ */
+void trash_backend_restore_item_async(TrashBackend *self, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_autoptr(GTask) task = NULL;
+	OperationData *op;
+
+	g_return_if_fail(TRASH_IS_BACKEND(self));
+	g_return_if_fail(name != NULL);
+	g_return_if_fail(restore_path != NULL);
+
+	op = operation_data_new(self, name, restore_path);
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_backend_restore_item_async);
+	g_task_set_task_data(task, op, operation_data_free);
+	g_task_run_in_thread(task, restore_item_thread);
+}
+
+/**
+ * trash_backend_restore_item_finish:
+ * @self: a #TrashBackend
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes restoring a trashed item.
+ *
+ * Returns: %TRUE if the item was restored
+ */
+gboolean trash_backend_restore_item_finish(TrashBackend *self, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+
+	return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+typedef struct {
+	TrashBackend *backend;
+	GStrv names;
+	GStrv restore_paths;
+	guint failed;
+} BatchData;
+
+static BatchData *batch_data_new(TrashBackend *self, const gchar *const *names, const gchar *const *restore_paths) {
+	BatchData *batch;
+
+	batch = g_slice_new0(BatchData);
+	batch->backend = g_object_ref(self);
+	batch->names = g_strdupv((gchar **) names);
+	batch->restore_paths = g_strdupv((gchar **) restore_paths);
+
+	g_atomic_int_inc(&pending_operations);
+	operations_changed(self);
+
+	return batch;
+}
+
+static void batch_data_free(gpointer data) {
+	BatchData *batch = data;
+
+	(void) g_atomic_int_dec_and_test(&pending_operations);
+	operations_changed(batch->backend);
+
+	g_object_unref(batch->backend);
+	g_strfreev(batch->names);
+	g_strfreev(batch->restore_paths);
+	g_slice_free(BatchData, batch);
+}
+
+/**
+ * Work through every item in a batch, carrying on past failures. The
+ * first error is what the task returns.
+ */
+static void batch_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	BatchData *batch = task_data;
+	TrashBackend *backend = TRASH_BACKEND(source_object);
+	GError *first_error = NULL;
+	GError *error = NULL;
+	gboolean ok;
+	guint i;
+
+	for (i = 0; batch->names[i]; i++) {
+		if (g_cancellable_set_error_if_cancelled(cancellable, &error)) {
+			ok = FALSE;
+		} else if (batch->restore_paths) {
+			ok = trash_backend_restore_item(backend, batch->names[i], batch->restore_paths[i], cancellable, &error);
+		} else {
+			ok = trash_backend_delete_item(backend, batch->names[i], NULL, cancellable, &error);
+		}
+
+		if (ok) {
+			continue;
+		}
+
+		batch->failed++;
+
+		if (!first_error) {
+			first_error = error;
+		} else {
+			g_error_free(error);
+		}
+
+		error = NULL;
+	}
+
+	if (first_error) {
+		g_task_return_error(task, first_error);
+		return;
+	}
+
+	g_task_return_boolean(task, TRUE);
+}
+
+static gboolean batch_finish(TrashBackend *self, GAsyncResult *result, guint *n_failed, GError **error) {
+	BatchData *batch;
+
+	g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+
+	batch = g_task_get_task_data(G_TASK(result));
+
+	if (n_failed) {
+		*n_failed = batch->failed;
+	}
+
+	return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+/**
+ * trash_backend_delete_items_async:
+ * @self: a #TrashBackend
+ * @names: (array zero-terminated=1): the names of the items in the trash bin
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when every item has been dealt with
+ * @user_data: data to pass to @callback
+ *
+ * Permanently deletes several trashed items, one after another, on a
+ * single worker thread. Items that can't be deleted don't stop the rest.
+ */
+void trash_backend_delete_items_async(TrashBackend *self, const gchar *const *names, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail(TRASH_IS_BACKEND(self));
+	g_return_if_fail(names != NULL);
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_backend_delete_items_async);
+	g_task_set_task_data(task, batch_data_new(self, names, NULL), batch_data_free);
+	g_task_run_in_thread(task, batch_thread);
+}
+
+/**
+ * trash_backend_delete_items_finish:
+ * @self: a #TrashBackend
+ * @result: a #GAsyncResult
+ * @n_failed: (out) (optional): return location for the number of items
+ *   that couldn't be deleted
+ * @error: return location for the first #GError
+ *
+ * Finishes deleting several trashed items.
+ *
+ * Returns: %TRUE if every item was deleted
+ */
+gboolean trash_backend_delete_items_finish(TrashBackend *self, GAsyncResult *result, guint *n_failed, GError **error) {
+	return batch_finish(self, result, n_failed, error);
+}
+
+/**
+ * trash_backend_restore_items_async:
+ * @self: a #TrashBackend
+ * @names: (array zero-terminated=1): the names of the items in the trash bin
+ * @restore_paths: (array zero-terminated=1): where to put each item
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when every item has been dealt with
+ * @user_data: data to pass to @callback
+ *
+ * Moves several trashed items back out of the trash bin, one after
+ * another, on a single worker thread. Items that can't be restored don't
+ * stop the rest.
+ */
+void trash_backend_restore_items_async(TrashBackend *self, const gchar *const *names, const gchar *const *restore_paths, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail(TRASH_IS_BACKEND(self));
+	g_return_if_fail(names != NULL);
+	g_return_if_fail(restore_paths != NULL);
+	g_return_if_fail(g_strv_length((gchar **) names) == g_strv_length((gchar **) restore_paths));
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_backend_restore_items_async);
+	g_task_set_task_data(task, batch_data_new(self, names, restore_paths), batch_data_free);
+	g_task_run_in_thread(task, batch_thread);
+}
+
+/**
+ * trash_backend_restore_items_finish:
+ * @self: a #TrashBackend
+ * @result: a #GAsyncResult
+ * @n_failed: (out) (optional): return location for the number of items
+ *   that couldn't be restored
+ * @error: return location for the first #GError
+ *
+ * Finishes restoring several trashed items.
+ *
+ * Returns: %TRUE if every item was restored
+ */
+gboolean trash_backend_restore_items_finish(TrashBackend *self, GAsyncResult *result, guint *n_failed, GError **error) {
+	return batch_finish(self, result, n_failed, error);
+}
+
+/* For backend implementations */
+
+/**
+ * trash_backend_get_pending_operations:
+ *
+ * Gets the number of asynchronous deletes and restores, across every
+ * backend, that haven't finished yet. A batch counts as one.
+ *
+ * Returns: the number of pending file operations
+ */
+guint trash_backend_get_pending_operations(void) {
+	return (guint) g_atomic_int_get(&pending_operations);
+}
+
+/**
+ * trash_backend_emit_item_added:
+ * @self: a #TrashBackend
+ * @name: the name of the item in the trash bin
+ *
+ * Emits the #TrashBackend::item-added signal. Must be called on the main
+ * thread.
+ */
+void trash_backend_emit_item_added(TrashBackend *self, const gchar *name) {
+	TRASH_TRACE_MARK(TRASH_TRACE_NOW(), "monitor-event", "added %s", name);
+	TRASH_TRACE_PROBE1(monitor__added, name);
+
+	g_signal_emit(self, signals[ITEM_ADDED], 0, name);
+}
+
+/**
+ * trash_backend_emit_item_removed:
+ * @self: a #TrashBackend
+ * @name: the name of the item in the trash bin
+ *
+ * Emits the #TrashBackend::item-removed signal. Must be called on the main
+ * thread.
+ */
+void trash_backend_emit_item_removed(TrashBackend *self, const gchar *name) {
+	TRASH_TRACE_MARK(TRASH_TRACE_NOW(), "monitor-event", "removed %s", name);
+	TRASH_TRACE_PROBE1(monitor__removed, name);
+
+	g_signal_emit(self, signals[ITEM_REMOVED], 0, name);
+}
+
+/**
+ * trash_backend_emit_resync:
+ * @self: a #TrashBackend
+ *
+ * Emits the #TrashBackend::resync signal. Must be called on the main
+ * thread.
+ */
+void trash_backend_emit_resync(TrashBackend *self) {
+	TRASH_TRACE_MARK(TRASH_TRACE_NOW(), "monitor-event", "resync");
+	TRASH_TRACE_PROBE(monitor__resync);
+
+	g_signal_emit(self, signals[RESYNC], 0);
+}
+
+/**
+ * trash_backend_delete_recursive:
+ * @file: the file or directory to delete
+ * @bytes_freed: (inout): incremented by the number of bytes freed
+ * @cancellable: (nullable): a #GCancellable
+ * @error: return location for a #GError
+ *
+ * Deletes a file or directory and everything in it, adding up the number
+ * of bytes that it took up on disk. This blocks.
+ *
+ * Returns: %TRUE if everything was deleted
+ */
+gboolean trash_backend_delete_recursive(GFile *file, guint64 *bytes_freed, GCancellable *cancellable, GError **error) {
+	g_autoptr(GFileInfo) info = NULL;
+	g_autoptr(GFileEnumerator) enumerator = NULL;
+	GFileInfo *child_info;
+	GFile *child;
+	gboolean ok;
+
+	info = g_file_query_info(file,
+		G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE,
+		G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		cancellable,
+		error);
+
+	if (!info) {
+		return FALSE;
+	}
+
+	if (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY) {
+		enumerator = g_file_enumerate_children(file, G_FILE_ATTRIBUTE_STANDARD_NAME, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, error);
+
+		if (!enumerator) {
+			return FALSE;
+		}
+
+		while ((child_info = g_file_enumerator_next_file(enumerator, cancellable, error)) != NULL) {
+			child = g_file_enumerator_get_child(enumerator, child_info);
+			ok = trash_backend_delete_recursive(child, bytes_freed, cancellable, error);
+
+			g_object_unref(child);
+			g_object_unref(child_info);
+
+			if (!ok) {
+				return FALSE;
+			}
+		}
+
+		if (error && *error) {
+			return FALSE;
+		}
+	}
+
+	if (g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE)) {
+		*bytes_freed += g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE);
+	} else {
+		*bytes_freed += (guint64) g_file_info_get_size(info);
+	}
+
+	return g_file_delete(file, cancellable, error);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_BACKEND (trash_backend_get_type())
+
+G_DECLARE_INTERFACE(TrashBackend, trash_backend, TRASH, BACKEND, GObject)
+
+/**
+ * TrashBackendInterface:
+ * @parent_iface: the parent interface
+ * @enumerate_async: start listing the items in the trash bin
+ * @enumerate_finish: finish listing the items in the trash bin
+ * @query_info_async: start looking up a single trashed item by name
+ * @query_info_finish: finish looking up a single trashed item
+ * @delete_item: permanently delete a trashed item; called from a worker thread
+ * @restore_item: move a trashed item back to where it came from; called
+ *   from a worker thread
+ *
+ * The operations that a trash bin implementation has to provide. The
+ * #GFileInfo objects that a backend hands out must carry the attributes
+ * that were asked for, using the same attributes that the `trash://` GIO
+ * backend uses.
+ */
+struct _TrashBackendInterface {
+	GTypeInterface parent_iface;
+
+	void (*enumerate_async)(TrashBackend *self, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+	GFileEnumerator *(*enumerate_finish)(TrashBackend *self, GAsyncResult *result, GError **error);
+
+	void (*query_info_async)(TrashBackend *self, const gchar *name, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+	GFileInfo *(*query_info_finish)(TrashBackend *self, GAsyncResult *result, GError **error);
+
+	gboolean (*delete_item)(TrashBackend *self, const gchar *name, guint64 *bytes_freed, GCancellable *cancellable, GError **error);
+	gboolean (*restore_item)(TrashBackend *self, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GError **error);
+};
+
+TrashBackend *trash_backend_new_default(void);
+
+void trash_backend_enumerate_async(TrashBackend *self, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+
+GFileEnumerator *trash_backend_enumerate_finish(TrashBackend *self, GAsyncResult *result, GError **error);
+
+void trash_backend_query_info_async(TrashBackend *self, const gchar *name, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+
+GFileInfo *trash_backend_query_info_finish(TrashBackend *self, GAsyncResult *result, GError **error);
+
+gboolean trash_backend_delete_item(TrashBackend *self, const gchar *name, guint64 *bytes_freed, GCancellable *cancellable, GError **error);
+
+void trash_backend_delete_item_async(TrashBackend *self, const gchar *name, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+
+gboolean trash_backend_delete_item_finish(TrashBackend *self, GAsyncResult *result, GError **error);
+
+gboolean trash_backend_restore_item(TrashBackend *self, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GError **error);
+
+void trash_backend_restore_item_async(TrashBackend *self, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+
+gboolean trash_backend_restore_item_finish(TrashBackend *self, GAsyncResult *result, GError **error);
+
+void trash_backend_delete_items_async(TrashBackend *self, const gchar *const *names, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+
+gboolean trash_backend_delete_items_finish(TrashBackend *self, GAsyncResult *result, guint *n_failed, GError **error);
+
+void trash_backend_restore_items_async(TrashBackend *self, const gchar *const *names, const gchar *const *restore_paths, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+
+gboolean trash_backend_restore_items_finish(TrashBackend *self, GAsyncResult *result, guint *n_failed, GError **error);
+
+guint trash_backend_get_pending_operations(void);
+
+/* For backend implementations */
+
+void trash_backend_emit_item_added(TrashBackend *self, const gchar *name);
+
+void trash_backend_emit_item_removed(TrashBackend *self, const gchar *name);
+
+void trash_backend_emit_resync(TrashBackend *self);
+
+gboolean trash_backend_delete_recursive(GFile *file, guint64 *bytes_freed, GCancellable *cancellable, GError **error);
+
+G_END_DECLS
@@ -0,0 +1,540 @@
+/**
+ * SECTION:trashfakebackend
+ * @Short_description: An in-memory trash backend
+ * @Title: TrashFakeBackend
+ *
+ * The #TrashFakeBackend is a trash bin that only exists in memory. Items are
+ * added and removed by calling its functions, which emit the same events
+ * that a real trash bin would, in the same order every time. Events can be
+ * turned off to simulate them being dropped.
+ *
+ * This makes it possible to run a #TrashManager against any number of
+ * synthetic items, or a storm of changes, without touching the disk.
+ *
+ * Items can be deleted and restored from worker threads like with any
+ * other backend; the events for those are emitted on the main context of
+ * the thread that created the backend. Items can be locked, so that those
+ * file operations fail on them.
+ */
+
+#include "trash_backend_fake.h"
+#include <string.h>
+
+struct _TrashFakeBackend {
+	GObject parent_instance;
+
+	GMutex lock;
+	GHashTable *items;
+	GHashTable *locked;
+	gint64 clock;
+
+	gboolean emit_events;
+	GMainContext *context;
+
+	GIcon *file_icon;
+	GIcon *folder_icon;
+};
+
+static void trash_fake_backend_iface_init(TrashBackendInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(TrashFakeBackend, trash_fake_backend, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE(TRASH_TYPE_BACKEND, trash_fake_backend_iface_init))
+
+/* Enumerator */
+
+#define TRASH_TYPE_FAKE_ENUMERATOR (trash_fake_enumerator_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashFakeEnumerator, trash_fake_enumerator, TRASH, FAKE_ENUMERATOR, GFileEnumerator)
+
+/**
+ * Walks over a snapshot of the items in the trash bin, in name order.
+ */
+struct _TrashFakeEnumerator {
+	GFileEnumerator parent_instance;
+
+	GPtrArray *infos;
+	guint index;
+};
+
+G_DEFINE_FINAL_TYPE(TrashFakeEnumerator, trash_fake_enumerator, G_TYPE_FILE_ENUMERATOR)
+
+static GFileInfo *trash_fake_enumerator_next_file(GFileEnumerator *enumerator, GCancellable *cancellable, GError **error) {
+	TrashFakeEnumerator *self = TRASH_FAKE_ENUMERATOR(enumerator);
+
+	if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+		return NULL;
+	}
+
+	if (self->index >= self->infos->len) {
+		return NULL;
+	}
+
+	return g_object_ref(g_ptr_array_index(self->infos, self->index++));
+}
+
+static gboolean trash_fake_enumerator_close(GFileEnumerator *enumerator, GCancellable *cancellable, GError **error) {
+	(void) enumerator;
+	(void) cancellable;
+	(void) error;
+
+	return TRUE;
+}
+
+static void trash_fake_enumerator_finalize(GObject *object) {
+	TrashFakeEnumerator *self = TRASH_FAKE_ENUMERATOR(object);
+
+	g_clear_pointer(&self->infos, g_ptr_array_unref);
+
+	G_OBJECT_CLASS(trash_fake_enumerator_parent_class)->finalize(object);
+}
+
+static void trash_fake_enumerator_class_init(TrashFakeEnumeratorClass *klass) {
+	GObjectClass *class = G_OBJECT_CLASS(klass);
+	GFileEnumeratorClass *enumerator_class = G_FILE_ENUMERATOR_CLASS(klass);
+
+	class->finalize = trash_fake_enumerator_finalize;
+	enumerator_class->next_file = trash_fake_enumerator_next_file;
+	enumerator_class->close_fn = trash_fake_enumerator_close;
+}
+
+static void trash_fake_enumerator_init(TrashFakeEnumerator *self) {
+	(void) self;
+}
+
+/* Backend */
+
+static void trash_fake_backend_finalize(GObject *object) {
+	TrashFakeBackend *self;
+
+	self = TRASH_FAKE_BACKEND(object);
+
+	g_hash_table_unref(self->locked);
+	g_hash_table_unref(self->items);
+	g_main_context_unref(self->context);
+	g_object_unref(self->file_icon);
+	g_object_unref(self->folder_icon);
+	g_mutex_clear(&self->lock);
+
+	G_OBJECT_CLASS(trash_fake_backend_parent_class)->finalize(object);
+}
+
+static void trash_fake_backend_class_init(TrashFakeBackendClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->finalize = trash_fake_backend_finalize;
+}
+
+static void trash_fake_backend_init(TrashFakeBackend *self) {
+	g_mutex_init(&self->lock);
+	self->items = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+	self->locked = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	self->emit_events = TRUE;
+	self->context = g_main_context_ref_thread_default();
+	self->file_icon = g_themed_icon_new("text-x-generic");
+	self->folder_icon = g_themed_icon_new("folder");
+}
+
+/**
+ * trash_fake_backend_new:
+ *
+ * Creates a new, empty #TrashFakeBackend.
+ *
+ * Returns: a new #TrashFakeBackend
+ */
+TrashFakeBackend *trash_fake_backend_new(void) {
+	return g_object_new(TRASH_TYPE_FAKE_BACKEND, NULL);
+}
+
+/**
+ * Build the info for a fake item, with everything the trash:// backend
+ * would report. The modification time comes from a counter so that a
+ * replaced item always looks different from the one it replaced.
+ */
+static GFileInfo *make_info(TrashFakeBackend *self, const gchar *name, const gchar *restore_path, goffset size, gboolean is_directory, gint64 deletion_time) {
+	g_autoptr(GDateTime) date = NULL;
+	g_autofree gchar *deletion_date = NULL;
+	g_autofree gchar *target_uri = NULL;
+	GFileInfo *info;
+	gint64 modified_time;
+
+	date = g_date_time_new_from_unix_local(deletion_time);
+	deletion_date = g_date_time_format(date, "%Y-%m-%dT%H:%M:%S");
+	target_uri = g_strdup_printf("file:///fake-trash/%s", name);
+	modified_time = ++self->clock;
+
+	info = g_file_info_new();
+	g_file_info_set_name(info, name);
+	g_file_info_set_display_name(info, name);
+	g_file_info_set_attribute_string(info, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI, target_uri);
+	g_file_info_set_icon(info, is_directory ? self->folder_icon : self->file_icon);
+	g_file_info_set_size(info, size);
+	g_file_info_set_file_type(info, is_directory ? G_FILE_TYPE_DIRECTORY : G_FILE_TYPE_REGULAR);
+	g_file_info_set_attribute_string(info, G_FILE_ATTRIBUTE_TRASH_DELETION_DATE, deletion_date);
+	g_file_info_set_attribute_byte_string(info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH, restore_path);
+	g_file_info_set_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED, (guint64) (modified_time / G_USEC_PER_SEC));
+	g_file_info_set_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, (guint32) (modified_time % G_USEC_PER_SEC));
+
+	return info;
+}
+
+/**
+ * trash_fake_backend_add_item:
+ * @self: a #TrashFakeBackend
+ * @name: the name of the item in the trash bin
+ * @restore_path: where the item came from
+ * @size: the size of the item in bytes
+ * @is_directory: whether the item is a directory
+ * @deletion_time: when the item was trashed, in seconds since the epoch
+ *
+ * Puts an item in the fake trash bin, replacing any item with the same
+ * name, and emits #TrashBackend::item-added unless events are turned off.
+ */
+void trash_fake_backend_add_item(TrashFakeBackend *self, const gchar *name, const gchar *restore_path, goffset size, gboolean is_directory, gint64 deletion_time) {
+	GFileInfo *info;
+
+	g_return_if_fail(TRASH_IS_FAKE_BACKEND(self));
+	g_return_if_fail(name != NULL);
+
+	g_mutex_lock(&self->lock);
+	info = make_info(self, name, restore_path, size, is_directory, deletion_time);
+	g_hash_table_replace(self->items, g_strdup(name), info);
+	g_mutex_unlock(&self->lock);
+
+	if (self->emit_events) {
+		trash_backend_emit_item_added(TRASH_BACKEND(self), name);
+	}
+}
+
+/**
+ * trash_fake_backend_remove_item:
+ * @self: a #TrashFakeBackend
+ * @name: the name of the item in the trash bin
+ *
+ * Takes an item out of the fake trash bin, and emits
+ * #TrashBackend::item-removed unless events are turned off.
+ *
+ * Returns: %TRUE if there was such an item
+ */
+gboolean trash_fake_backend_remove_item(TrashFakeBackend *self, const gchar *name) {
+	gboolean removed;
+
+	g_return_val_if_fail(TRASH_IS_FAKE_BACKEND(self), FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+
+	g_mutex_lock(&self->lock);
+	removed = g_hash_table_remove(self->items, name);
+	g_mutex_unlock(&self->lock);
+
+	if (removed && self->emit_events) {
+		trash_backend_emit_item_removed(TRASH_BACKEND(self), name);
+	}
+
+	return removed;
+}
+
+/**
+ * trash_fake_backend_touch_item:
+ * @self: a #TrashFakeBackend
+ * @name: the name of the item in the trash bin
+ *
+ * Replaces an item with a new one of the same name, as happens when a file
+ * is trashed again after the first one was removed behind our back. The
+ * events for the removal and the addition are emitted unless events are
+ * turned off.
+ */
+void trash_fake_backend_touch_item(TrashFakeBackend *self, const gchar *name) {
+	GFileInfo *old_info;
+	GFileInfo *info = NULL;
+	g_autoptr(GDateTime) deletion_date = NULL;
+
+	g_return_if_fail(TRASH_IS_FAKE_BACKEND(self));
+	g_return_if_fail(name != NULL);
+
+	g_mutex_lock(&self->lock);
+
+	old_info = g_hash_table_lookup(self->items, name);
+
+	if (old_info) {
+		deletion_date = g_file_info_get_deletion_date(old_info);
+		info = make_info(self,
+			name,
+			g_file_info_get_attribute_byte_string(old_info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH),
+			g_file_info_get_size(old_info),
+			g_file_info_get_file_type(old_info) == G_FILE_TYPE_DIRECTORY,
+			deletion_date ? g_date_time_to_unix(deletion_date) : 0);
+		g_hash_table_replace(self->items, g_strdup(name), info);
+	}
+
+	g_mutex_unlock(&self->lock);
+
+	if (info && self->emit_events) {
+		trash_backend_emit_item_removed(TRASH_BACKEND(self), name);
+		trash_backend_emit_item_added(TRASH_BACKEND(self), name);
+	}
+}
+
+/**
+ * trash_fake_backend_set_item_locked:
+ * @self: a #TrashFakeBackend
+ * @name: the name of the item in the trash bin
+ * @locked: whether deleting and restoring the item should fail
+ *
+ * Makes deleting and restoring an item fail with
+ * %G_IO_ERROR_PERMISSION_DENIED, as if it belonged to someone else.
+ */
+void trash_fake_backend_set_item_locked(TrashFakeBackend *self, const gchar *name, gboolean locked) {
+	g_return_if_fail(TRASH_IS_FAKE_BACKEND(self));
+	g_return_if_fail(name != NULL);
+
+	g_mutex_lock(&self->lock);
+
+	if (locked) {
+		g_hash_table_add(self->locked, g_strdup(name));
+	} else {
+		g_hash_table_remove(self->locked, name);
+	}
+
+	g_mutex_unlock(&self->lock);
+}
+
+/**
+ * trash_fake_backend_set_emit_events:
+ * @self: a #TrashFakeBackend
+ * @emit_events: whether to emit events
+ *
+ * Sets whether changes to the fake trash bin emit events. Turning events
+ * off simulates changes that the manager never hears about.
+ */
+void trash_fake_backend_set_emit_events(TrashFakeBackend *self, gboolean emit_events) {
+	g_return_if_fail(TRASH_IS_FAKE_BACKEND(self));
+
+	self->emit_events = emit_events;
+}
+
+/**
+ * trash_fake_backend_overflow:
+ * @self: a #TrashFakeBackend
+ *
+ * Simulates the event queue overflowing by emitting #TrashBackend::resync.
+ */
+void trash_fake_backend_overflow(TrashFakeBackend *self) {
+	g_return_if_fail(TRASH_IS_FAKE_BACKEND(self));
+
+	trash_backend_emit_resync(TRASH_BACKEND(self));
+}
+
+/**
+ * trash_fake_backend_has_item:
+ * @self: a #TrashFakeBackend
+ * @name: the name of the item in the trash bin
+ *
+ * Checks whether an item is in the fake trash bin.
+ *
+ * Returns: %TRUE if there is an item called @name
+ */
+gboolean trash_fake_backend_has_item(TrashFakeBackend *self, const gchar *name) {
+	gboolean found;
+
+	g_return_val_if_fail(TRASH_IS_FAKE_BACKEND(self), FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+
+	g_mutex_lock(&self->lock);
+	found = g_hash_table_contains(self->items, name);
+	g_mutex_unlock(&self->lock);
+
+	return found;
+}
+
+/**
+ * trash_fake_backend_get_item_count:
+ * @self: a #TrashFakeBackend
+ *
+ * Gets the number of items in the fake trash bin.
+ *
+ * Returns: the number of items
+ */
+guint trash_fake_backend_get_item_count(TrashFakeBackend *self) {
+	guint count;
+
+	g_return_val_if_fail(TRASH_IS_FAKE_BACKEND(self), 0);
+
+	g_mutex_lock(&self->lock);
+	count = g_hash_table_size(self->items);
+	g_mutex_unlock(&self->lock);
+
+	return count;
+}
+
+/* TrashBackend implementation */
+
+static gint compare_info_names(gconstpointer a, gconstpointer b) {
+	GFileInfo *info_a = *(GFileInfo **) a;
+	GFileInfo *info_b = *(GFileInfo **) b;
+
+	return strcmp(g_file_info_get_name(info_a), g_file_info_get_name(info_b));
+}
+
+static void trash_fake_backend_enumerate_async(TrashBackend *backend, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	TrashFakeBackend *self = TRASH_FAKE_BACKEND(backend);
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GFile) container = NULL;
+	TrashFakeEnumerator *enumerator;
+	GHashTableIter iter;
+	gpointer value;
+
+	(void) attributes;
+	(void) io_priority;
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_fake_backend_enumerate_async);
+
+	container = g_file_new_for_uri("trash:///");
+	enumerator = g_object_new(TRASH_TYPE_FAKE_ENUMERATOR, "container", container, NULL);
+
+	g_mutex_lock(&self->lock);
+
+	enumerator->infos = g_ptr_array_new_full(g_hash_table_size(self->items), g_object_unref);
+
+	g_hash_table_iter_init(&iter, self->items);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		g_ptr_array_add(enumerator->infos, g_object_ref(value));
+	}
+
+	g_mutex_unlock(&self->lock);
+
+	// Always hand items out in the same order
+	g_ptr_array_sort(enumerator->infos, compare_info_names);
+
+	g_task_return_pointer(task, enumerator, g_object_unref);
+}
+
+static GFileEnumerator *trash_fake_backend_enumerate_finish(TrashBackend *backend, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, backend), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+static void trash_fake_backend_query_info_async(TrashBackend *backend, const gchar *name, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	TrashFakeBackend *self = TRASH_FAKE_BACKEND(backend);
+	g_autoptr(GTask) task = NULL;
+	GFileInfo *info;
+
+	(void) attributes;
+	(void) io_priority;
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_fake_backend_query_info_async);
+
+	g_mutex_lock(&self->lock);
+	info = g_hash_table_lookup(self->items, name);
+	if (info) {
+		g_object_ref(info);
+	}
+	g_mutex_unlock(&self->lock);
+
+	if (!info) {
+		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No item named '%s' in the trash", name);
+		return;
+	}
+
+	g_task_return_pointer(task, info, g_object_unref);
+}
+
+static GFileInfo *trash_fake_backend_query_info_finish(TrashBackend *backend, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, backend), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+typedef struct {
+	TrashFakeBackend *self;
+	gchar *name;
+} RemovedEvent;
+
+static gboolean emit_removed_cb(gpointer user_data) {
+	RemovedEvent *event = user_data;
+
+	if (event->self->emit_events) {
+		trash_backend_emit_item_removed(TRASH_BACKEND(event->self), event->name);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void removed_event_free(gpointer data) {
+	RemovedEvent *event = data;
+
+	g_object_unref(event->self);
+	g_free(event->name);
+	g_slice_free(RemovedEvent, event);
+}
+
+/**
+ * Take an item out of the trash bin on behalf of a file operation, which
+ * may be running on any thread.
+ */
+static gboolean take_item(TrashFakeBackend *self, const gchar *name, guint64 *bytes_freed, GError **error) {
+	RemovedEvent *event;
+	GFileInfo *info;
+
+	g_mutex_lock(&self->lock);
+
+	if (g_hash_table_contains(self->locked, name)) {
+		g_mutex_unlock(&self->lock);
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED, "The item named '%s' is locked", name);
+		return FALSE;
+	}
+
+	info = g_hash_table_lookup(self->items, name);
+
+	if (info && bytes_freed) {
+		*bytes_freed = (guint64) g_file_info_get_size(info);
+	}
+
+	if (info) {
+		g_hash_table_remove(self->items, name);
+	}
+
+	g_mutex_unlock(&self->lock);
+
+	if (!info) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No item named '%s' in the trash", name);
+		return FALSE;
+	}
+
+	event = g_slice_new(RemovedEvent);
+	event->self = g_object_ref(self);
+	event->name = g_strdup(name);
+
+	g_main_context_invoke_full(self->context, G_PRIORITY_DEFAULT, emit_removed_cb, event, removed_event_free);
+
+	return TRUE;
+}
+
+static gboolean trash_fake_backend_delete_item(TrashBackend *backend, const gchar *name, guint64 *bytes_freed, GCancellable *cancellable, GError **error) {
+	if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+		return FALSE;
+	}
+
+	return take_item(TRASH_FAKE_BACKEND(backend), name, bytes_freed, error);
+}
+
+static gboolean trash_fake_backend_restore_item(TrashBackend *backend, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GError **error) {
+	(void) restore_path;
+
+	if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+		return FALSE;
+	}
+
+	return take_item(TRASH_FAKE_BACKEND(backend), name, NULL, error);
+}
+
+static void trash_fake_backend_iface_init(TrashBackendInterface *iface) {
+	iface->enumerate_async = trash_fake_backend_enumerate_async;
+	iface->enumerate_finish = trash_fake_backend_enumerate_finish;
+	iface->query_info_async = trash_fake_backend_query_info_async;
+	iface->query_info_finish = trash_fake_backend_query_info_finish;
+	iface->delete_item = trash_fake_backend_delete_item;
+	iface->restore_item = trash_fake_backend_restore_item;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "trash_backend.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_FAKE_BACKEND (trash_fake_backend_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashFakeBackend, trash_fake_backend, TRASH, FAKE_BACKEND, GObject)
+
+TrashFakeBackend *trash_fake_backend_new(void);
+
+void trash_fake_backend_add_item(TrashFakeBackend *self, const gchar *name, const gchar *restore_path, goffset size, gboolean is_directory, gint64 deletion_time);
+
+gboolean trash_fake_backend_remove_item(TrashFakeBackend *self, const gchar *name);
+
+void trash_fake_backend_touch_item(TrashFakeBackend *self, const gchar *name);
+
+void trash_fake_backend_set_item_locked(TrashFakeBackend *self, const gchar *name, gboolean locked);
+
+void trash_fake_backend_set_emit_events(TrashFakeBackend *self, gboolean emit_events);
+
+void trash_fake_backend_overflow(TrashFakeBackend *self);
+
+gboolean trash_fake_backend_has_item(TrashFakeBackend *self, const gchar *name);
+
+guint trash_fake_backend_get_item_count(TrashFakeBackend *self);
+
+G_END_DECLS
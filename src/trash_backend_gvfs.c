@@ -0,0 +1,569 @@
+/**
+ * SECTION:trashgvfsbackend
+ * @Short_description: Trash backend using the trash:// GIO backend
+ * @Title: TrashGvfsBackend
+ *
+ * The #TrashGvfsBackend lists trashed items through `trash:///`, so it
+ * sees the trash bins on every mounted volume.
+ *
+ * Changes to the user's own trash bin are watched with inotify where it is
+ * available, because the `trash:///` monitor is slow to report changes and
+ * silently drops them under load. The `trash:///` monitor keeps gvfs polling
+ * and waking us up, so it is only used while another mounted volume has a
+ * trash bin, and for everything when inotify isn't available.
+ */
+
+#include "trash_backend_gvfs.h"
+#include <gio/gunixmounts.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_INOTIFY
+#include <errno.h>
+#include <glib-unix.h>
+#include <sys/inotify.h>
+
+/**
+ * The events we care about in the `info` and `files` directories of the
+ * user's trash bin.
+ */
+#define TRASH_INOTIFY_MASK (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+
+/**
+ * Size of the buffer used to read inotify events. This is big enough
+ * to drain a few hundred events with a single read() call.
+ */
+#define TRASH_INOTIFY_BUFFER_SIZE (64 * 1024)
+#endif
+
+struct _TrashGvfsBackend {
+	GObject parent_instance;
+
+	GFile *trash_root;
+	GFileMonitor *trash_monitor;
+	GUnixMountMonitor *mount_monitor;
+
+	gint inotify_fd;
+	guint inotify_source_id;
+	gint info_wd;
+	gint files_wd;
+};
+
+static void trash_gvfs_backend_iface_init(TrashBackendInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(TrashGvfsBackend, trash_gvfs_backend, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE(TRASH_TYPE_BACKEND, trash_gvfs_backend_iface_init))
+
+static void trash_gvfs_backend_dispose(GObject *object) {
+	TrashGvfsBackend *self;
+
+	self = TRASH_GVFS_BACKEND(object);
+
+#ifdef HAVE_INOTIFY
+	if (self->inotify_source_id != 0) {
+		g_source_remove(self->inotify_source_id);
+		self->inotify_source_id = 0;
+	}
+
+	if (self->inotify_fd >= 0) {
+		close(self->inotify_fd);
+		self->inotify_fd = -1;
+	}
+#endif
+
+	if (self->mount_monitor) {
+		g_signal_handlers_disconnect_by_data(self->mount_monitor, self);
+		g_clear_object(&self->mount_monitor);
+	}
+
+	g_clear_object(&self->trash_monitor);
+
+	G_OBJECT_CLASS(trash_gvfs_backend_parent_class)->dispose(object);
+}
+
+static void trash_gvfs_backend_finalize(GObject *object) {
+	TrashGvfsBackend *self;
+
+	self = TRASH_GVFS_BACKEND(object);
+
+	g_object_unref(self->trash_root);
+
+	G_OBJECT_CLASS(trash_gvfs_backend_parent_class)->finalize(object);
+}
+
+static void trash_gvfs_backend_class_init(TrashGvfsBackendClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_gvfs_backend_dispose;
+	class->finalize = trash_gvfs_backend_finalize;
+}
+
+/**
+ * Whether a `trash:///` item is in the user's own trash bin. gvfs names
+ * items from the trash bins on other volumes after their path there, with
+ * a leading backslash.
+ */
+static gboolean is_home_item(const gchar *name) {
+	return name[0] != '\\';
+}
+
+/**
+ * Get the name on disk of an item in the user's own trash bin from its
+ * `trash:///` name, undoing home_item_name().
+ */
+static const gchar *home_file_name(const gchar *name) {
+	return name[0] == '`' ? name + 1 : name;
+}
+
+static void file_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event, TrashGvfsBackend *self) {
+	(void) monitor;
+	(void) other_file;
+
+	g_autofree gchar *file_name = NULL;
+
+	file_name = g_file_get_basename(file);
+
+	// inotify already told us about these, and sooner
+	if (self->inotify_fd >= 0 && is_home_item(file_name)) {
+		return;
+	}
+
+	switch (event) {
+		case G_FILE_MONITOR_EVENT_MOVED_IN:
+		case G_FILE_MONITOR_EVENT_CREATED:
+			trash_backend_emit_item_added(TRASH_BACKEND(self), file_name);
+			break;
+		case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		case G_FILE_MONITOR_EVENT_DELETED:
+			trash_backend_emit_item_removed(TRASH_BACKEND(self), file_name);
+			break;
+		default:
+			break;
+	}
+}
+
+#ifdef HAVE_INOTIFY
+
+/**
+ * Add inotify watches on the `info` and `files` directories of the
+ * user's trash bin. Adding a watch that already exists is harmless.
+ *
+ * Returns: TRUE if the watches were set up successfully
+ */
+static gboolean watch_trash_dirs(TrashGvfsBackend *self) {
+	g_autofree gchar *trash_path = NULL;
+	g_autofree gchar *info_path = NULL;
+	g_autofree gchar *files_path = NULL;
+
+	trash_path = g_build_filename(g_get_user_data_dir(), "Trash", NULL);
+	info_path = g_build_filename(trash_path, "info", NULL);
+	files_path = g_build_filename(trash_path, "files", NULL);
+
+	// The trash directories may not exist yet if nothing has ever been trashed.
+	// Create them like GIO would when trashing something so we can watch them.
+	if (g_mkdir_with_parents(info_path, 0700) != 0 || g_mkdir_with_parents(files_path, 0700) != 0) {
+		g_warning("Unable to create trash directories in '%s': %s", trash_path, g_strerror(errno));
+		return FALSE;
+	}
+
+	self->info_wd = inotify_add_watch(self->inotify_fd, info_path, TRASH_INOTIFY_MASK);
+	self->files_wd = inotify_add_watch(self->inotify_fd, files_path, TRASH_INOTIFY_MASK);
+
+	if (self->info_wd < 0 || self->files_wd < 0) {
+		g_warning("Unable to watch trash directory '%s': %s", trash_path, g_strerror(errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Get the `trash:///` name of an item in the user's own trash bin from its
+ * name on disk. gvfs escapes a name that starts with a backslash, which
+ * would otherwise look like an item on another volume, or with the
+ * backtick used for escaping, by putting a backtick in front.
+ */
+static gchar *home_item_name(const gchar *file_name) {
+	if (file_name[0] == '\\' || file_name[0] == '`') {
+		return g_strconcat("`", file_name, NULL);
+	}
+
+	return g_strdup(file_name);
+}
+
+/**
+ * Handle a single decoded inotify event.
+ */
+static void handle_inotify_event(TrashGvfsBackend *self, const struct inotify_event *event) {
+	TrashBackend *backend = TRASH_BACKEND(self);
+	g_autofree gchar *file_name = NULL;
+	g_autofree gchar *name = NULL;
+
+	if (event->mask & IN_Q_OVERFLOW) {
+		g_warning("Trash inotify queue overflowed, reconciling the trash bin");
+		trash_backend_emit_resync(backend);
+		return;
+	}
+
+	if (event->mask & IN_MOVE_SELF) {
+		// Our watch now points somewhere other than the trash; drop it so
+		// that we get IN_IGNORED and watch the real path again.
+		inotify_rm_watch(self->inotify_fd, event->wd);
+		return;
+	}
+
+	if (event->mask & IN_IGNORED) {
+		// Somebody removed the trash directory out from under us. Watch the
+		// new one, and resync to find out what is left.
+		if (event->wd == self->info_wd || event->wd == self->files_wd) {
+			watch_trash_dirs(self);
+			trash_backend_emit_resync(backend);
+		}
+		return;
+	}
+
+	if (event->len == 0) {
+		return;
+	}
+
+	if (event->wd == self->info_wd) {
+		if (!g_str_has_suffix(event->name, ".trashinfo")) {
+			return;
+		}
+
+		file_name = g_strndup(event->name, strlen(event->name) - strlen(".trashinfo"));
+		name = home_item_name(file_name);
+
+		if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+			trash_backend_emit_item_removed(backend, name);
+		} else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+			// The info file is usually written before the file is moved into
+			// the trash. If the file isn't there yet, the lookup will fail and
+			// the `files` event will pick it up instead.
+			trash_backend_emit_item_added(backend, name);
+		}
+	} else if (event->wd == self->files_wd) {
+		name = home_item_name(event->name);
+
+		if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+			trash_backend_emit_item_removed(backend, name);
+		} else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+			trash_backend_emit_item_added(backend, name);
+		}
+	}
+}
+
+static gboolean inotify_readable_cb(gint fd, GIOCondition condition, gpointer user_data) {
+	TrashGvfsBackend *self = user_data;
+	gchar buffer[TRASH_INOTIFY_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	gssize len;
+	gssize offset;
+
+	(void) condition;
+
+	// Drain everything that is queued up, decoding as many events as
+	// fit into the buffer with each read.
+	for (;;) {
+		len = read(fd, buffer, sizeof(buffer));
+
+		if (len < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			if (errno != EAGAIN) {
+				g_critical("Error reading trash inotify events: %s", g_strerror(errno));
+			}
+
+			break;
+		}
+
+		if (len == 0) {
+			break;
+		}
+
+		offset = 0;
+		while (offset < len) {
+			event = (const struct inotify_event *) (buffer + offset);
+			handle_inotify_event(self, event);
+			offset += sizeof(struct inotify_event) + event->len;
+		}
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Set up an inotify instance watching the user's trash bin.
+ *
+ * Returns: TRUE if inotify is being used to watch the trash
+ */
+static gboolean setup_inotify(TrashGvfsBackend *self) {
+	self->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (self->inotify_fd < 0) {
+		g_warning("Unable to initialize inotify: %s", g_strerror(errno));
+		return FALSE;
+	}
+
+	if (!watch_trash_dirs(self)) {
+		close(self->inotify_fd);
+		self->inotify_fd = -1;
+		return FALSE;
+	}
+
+	self->inotify_source_id = g_unix_fd_add(self->inotify_fd, G_IO_IN, inotify_readable_cb, self);
+
+	return TRUE;
+}
+
+#endif
+
+/**
+ * Whether any mounted volume has a trash bin of its own, as laid out by
+ * the FreeDesktop.org trash spec.
+ */
+static gboolean have_volume_trash_bins(void) {
+	g_autofree gchar *shared_name = NULL;
+	g_autofree gchar *user_name = NULL;
+	GList *mounts, *l;
+	gboolean found = FALSE;
+
+	shared_name = g_strdup_printf(".Trash" G_DIR_SEPARATOR_S "%u", (guint) getuid());
+	user_name = g_strdup_printf(".Trash-%u", (guint) getuid());
+	mounts = g_unix_mounts_get(NULL);
+
+	for (l = mounts; l && !found; l = l->next) {
+		GUnixMountEntry *mount = l->data;
+		g_autofree gchar *shared_path = NULL;
+		g_autofree gchar *user_path = NULL;
+
+		if (g_unix_mount_is_system_internal(mount)) {
+			continue;
+		}
+
+		shared_path = g_build_filename(g_unix_mount_get_mount_path(mount), shared_name, NULL);
+		user_path = g_build_filename(g_unix_mount_get_mount_path(mount), user_name, NULL);
+
+		found = g_file_test(shared_path, G_FILE_TEST_IS_DIR) || g_file_test(user_path, G_FILE_TEST_IS_DIR);
+	}
+
+	g_list_free_full(mounts, (GDestroyNotify) g_unix_mount_free);
+
+	return found;
+}
+
+/**
+ * Start or stop the `trash:///` monitor, depending on whether there is
+ * anything that inotify can't watch for us.
+ *
+ * Returns: TRUE if the monitor was started or stopped
+ */
+static gboolean update_trash_monitor(TrashGvfsBackend *self) {
+	g_autoptr(GError) error = NULL;
+	gboolean needed;
+
+	needed = self->inotify_fd < 0 || have_volume_trash_bins();
+
+	if (!needed && self->trash_monitor) {
+		g_signal_handlers_disconnect_by_data(self->trash_monitor, self);
+		g_clear_object(&self->trash_monitor);
+		return TRUE;
+	}
+
+	if (!needed || self->trash_monitor) {
+		return FALSE;
+	}
+
+	self->trash_monitor = g_file_monitor(self->trash_root, 0, NULL, &error);
+
+	if (!self->trash_monitor) {
+		g_critical("Unable to monitor the trash bin: %s", error->message);
+		return FALSE;
+	}
+
+	g_signal_connect(self->trash_monitor, "changed", G_CALLBACK(file_changed), self);
+
+	return TRUE;
+}
+
+static void mounts_changed(GUnixMountMonitor *monitor, TrashGvfsBackend *self) {
+	(void) monitor;
+
+	// Items on the volumes that came or went weren't reported by a monitor
+	if (update_trash_monitor(self)) {
+		trash_backend_emit_resync(TRASH_BACKEND(self));
+	}
+}
+
+static void trash_gvfs_backend_init(TrashGvfsBackend *self) {
+	self->trash_root = g_file_new_for_uri("trash:///");
+	self->inotify_fd = -1;
+	self->info_wd = -1;
+	self->files_wd = -1;
+
+#ifdef HAVE_INOTIFY
+	setup_inotify(self);
+#endif
+
+	// Without inotify the monitor is always needed, so there's no point
+	// watching for volumes with a trash bin
+	if (self->inotify_fd >= 0) {
+		self->mount_monitor = g_unix_mount_monitor_get();
+		g_signal_connect(self->mount_monitor, "mounts-changed", G_CALLBACK(mounts_changed), self);
+	}
+
+	update_trash_monitor(self);
+}
+
+/**
+ * trash_gvfs_backend_new:
+ *
+ * Creates a new #TrashGvfsBackend, and starts watching the trash bin.
+ *
+ * Returns: a new #TrashGvfsBackend
+ */
+TrashGvfsBackend *trash_gvfs_backend_new(void) {
+	return g_object_new(TRASH_TYPE_GVFS_BACKEND, NULL);
+}
+
+/* TrashBackend implementation */
+
+static void enumerate_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	g_autoptr(GTask) task = user_data;
+	GFileEnumerator *enumerator;
+	GError *error = NULL;
+
+	enumerator = g_file_enumerate_children_finish(G_FILE(source), result, &error);
+
+	if (!enumerator) {
+		g_task_return_error(task, error);
+		return;
+	}
+
+	g_task_return_pointer(task, enumerator, g_object_unref);
+}
+
+static void trash_gvfs_backend_enumerate_async(TrashBackend *backend, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	TrashGvfsBackend *self = TRASH_GVFS_BACKEND(backend);
+	GTask *task;
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_gvfs_backend_enumerate_async);
+
+	g_file_enumerate_children_async(
+		self->trash_root,
+		attributes,
+		G_FILE_QUERY_INFO_NONE,
+		io_priority,
+		cancellable,
+		enumerate_cb,
+		task);
+}
+
+static GFileEnumerator *trash_gvfs_backend_enumerate_finish(TrashBackend *backend, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, backend), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+static void query_info_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	g_autoptr(GTask) task = user_data;
+	GFileInfo *info;
+	GError *error = NULL;
+
+	info = g_file_query_info_finish(G_FILE(source), result, &error);
+
+	if (!info) {
+		g_task_return_error(task, error);
+		return;
+	}
+
+	g_task_return_pointer(task, info, g_object_unref);
+}
+
+static void trash_gvfs_backend_query_info_async(TrashBackend *backend, const gchar *name, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	TrashGvfsBackend *self = TRASH_GVFS_BACKEND(backend);
+	g_autoptr(GFile) file = NULL;
+	GTask *task;
+
+	task = g_task_new(self, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_gvfs_backend_query_info_async);
+
+	file = g_file_get_child(self->trash_root, name);
+
+	g_file_query_info_async(
+		file,
+		attributes,
+		G_FILE_QUERY_INFO_NONE,
+		io_priority,
+		cancellable,
+		query_info_cb,
+		task);
+}
+
+static GFileInfo *trash_gvfs_backend_query_info_finish(TrashBackend *backend, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, backend), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+/**
+ * Delete a trashed item. Items in the user's own trash bin are deleted
+ * directly so the I/O happens on the calling thread; anything else goes
+ * through gvfs.
+ */
+static gboolean trash_gvfs_backend_delete_item(TrashBackend *backend, const gchar *name, guint64 *bytes_freed, GCancellable *cancellable, GError **error) {
+	TrashGvfsBackend *self = TRASH_GVFS_BACKEND(backend);
+	g_autofree gchar *trash_path = NULL;
+	g_autofree gchar *info_name = NULL;
+	g_autofree gchar *info_path = NULL;
+	g_autofree gchar *files_path = NULL;
+	g_autoptr(GFile) info_file = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	trash_path = g_build_filename(g_get_user_data_dir(), "Trash", NULL);
+	info_name = g_strconcat(home_file_name(name), ".trashinfo", NULL);
+	info_path = g_build_filename(trash_path, "info", info_name, NULL);
+
+	if (!is_home_item(name) || !g_file_test(info_path, G_FILE_TEST_EXISTS)) {
+		file = g_file_get_child(self->trash_root, name);
+
+		return g_file_delete(file, cancellable, error);
+	}
+
+	files_path = g_build_filename(trash_path, "files", home_file_name(name), NULL);
+	file = g_file_new_for_path(files_path);
+
+	// The spec says to remove the file before its info file
+	if (!trash_backend_delete_recursive(file, bytes_freed, cancellable, &local_error) && !g_error_matches(local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+		g_propagate_error(error, g_steal_pointer(&local_error));
+		return FALSE;
+	}
+
+	info_file = g_file_new_for_path(info_path);
+
+	return g_file_delete(info_file, cancellable, error);
+}
+
+static gboolean trash_gvfs_backend_restore_item(TrashBackend *backend, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GError **error) {
+	TrashGvfsBackend *self = TRASH_GVFS_BACKEND(backend);
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFile) restored_file = NULL;
+
+	file = g_file_get_child(self->trash_root, name);
+	restored_file = g_file_new_for_path(restore_path);
+
+	return g_file_move(file, restored_file, G_FILE_COPY_ALL_METADATA, cancellable, NULL, NULL, error);
+}
+
+static void trash_gvfs_backend_iface_init(TrashBackendInterface *iface) {
+	iface->enumerate_async = trash_gvfs_backend_enumerate_async;
+	iface->enumerate_finish = trash_gvfs_backend_enumerate_finish;
+	iface->query_info_async = trash_gvfs_backend_query_info_async;
+	iface->query_info_finish = trash_gvfs_backend_query_info_finish;
+	iface->delete_item = trash_gvfs_backend_delete_item;
+	iface->restore_item = trash_gvfs_backend_restore_item;
+}
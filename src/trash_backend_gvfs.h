@@ -0,0 +1,14 @@
+#pragma once
+
+#include "trash_backend.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_GVFS_BACKEND (trash_gvfs_backend_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashGvfsBackend, trash_gvfs_backend, TRASH, GVFS_BACKEND, GObject)
+
+TrashGvfsBackend *trash_gvfs_backend_new(void);
+
+G_END_DECLS
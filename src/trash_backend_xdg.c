@@ -0,0 +1,536 @@
+/**
+ * SECTION:trashxdgbackend
+ * @Short_description: Trash backend reading the trash bin from disk
+ * @Title: TrashXdgBackend
+ *
+ * The #TrashXdgBackend reads a trash bin directly from disk, following the
+ * FreeDesktop.org trash specification: trashed files live in the `files`
+ * directory, and each has a matching `.trashinfo` file in the `info`
+ * directory that records where it came from and when it was trashed.
+ *
+ * Only a single trash bin is handled, by default the user's own. Items
+ * without an info file are not listed, as the spec asks.
+ */
+
+#include "trash_backend_xdg.h"
+#include <errno.h>
+#include <string.h>
+
+#define TRASH_INFO_GROUP "Trash Info"
+
+struct _TrashXdgBackend {
+	GObject parent_instance;
+
+	gchar *trash_path;
+	GFile *files_dir;
+	GFile *info_dir;
+
+	GFileMonitor *files_monitor;
+	GFileMonitor *info_monitor;
+};
+
+static void trash_xdg_backend_iface_init(TrashBackendInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE(TrashXdgBackend, trash_xdg_backend, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE(TRASH_TYPE_BACKEND, trash_xdg_backend_iface_init))
+
+/**
+ * Fill in the trash attributes of @info for the item called @name from its
+ * `.trashinfo` file.
+ *
+ * Returns: FALSE if the item has no valid info file
+ */
+static gboolean read_trash_info(TrashXdgBackend *self, const gchar *name, GFileInfo *info, GFileAttributeMatcher *matcher, GError **error) {
+	g_autoptr(GKeyFile) key_file = NULL;
+	g_autofree gchar *info_name = NULL;
+	g_autofree gchar *info_path = NULL;
+	g_autofree gchar *escaped_path = NULL;
+	g_autofree gchar *restore_path = NULL;
+	g_autofree gchar *deletion_date = NULL;
+	g_autofree gchar *files_path = NULL;
+	g_autofree gchar *target_uri = NULL;
+
+	info_name = g_strconcat(name, ".trashinfo", NULL);
+	info_path = g_build_filename(self->trash_path, "info", info_name, NULL);
+
+	key_file = g_key_file_new();
+
+	if (!g_key_file_load_from_file(key_file, info_path, G_KEY_FILE_NONE, NULL)) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No trash info for '%s'", name);
+		return FALSE;
+	}
+
+	escaped_path = g_key_file_get_string(key_file, TRASH_INFO_GROUP, "Path", NULL);
+	restore_path = escaped_path ? g_uri_unescape_string(escaped_path, NULL) : NULL;
+
+	if (!restore_path) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "Invalid trash info for '%s'", name);
+		return FALSE;
+	}
+
+	if (g_file_attribute_matcher_matches(matcher, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH)) {
+		g_file_info_set_attribute_byte_string(info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH, restore_path);
+	}
+
+	if (g_file_attribute_matcher_matches(matcher, G_FILE_ATTRIBUTE_TRASH_DELETION_DATE)) {
+		deletion_date = g_key_file_get_string(key_file, TRASH_INFO_GROUP, "DeletionDate", NULL);
+
+		if (deletion_date) {
+			g_file_info_set_attribute_string(info, G_FILE_ATTRIBUTE_TRASH_DELETION_DATE, deletion_date);
+		}
+	}
+
+	if (g_file_attribute_matcher_matches(matcher, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI)) {
+		files_path = g_build_filename(self->trash_path, "files", name, NULL);
+		target_uri = g_filename_to_uri(files_path, NULL, NULL);
+		g_file_info_set_attribute_string(info, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI, target_uri);
+	}
+
+	return TRUE;
+}
+
+/* Enumerator */
+
+#define TRASH_TYPE_XDG_ENUMERATOR (trash_xdg_enumerator_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashXdgEnumerator, trash_xdg_enumerator, TRASH, XDG_ENUMERATOR, GFileEnumerator)
+
+/**
+ * Lists the `files` directory, and adds the information from the matching
+ * info file to each item. When none of that information was asked for,
+ * the info files are only checked for by name.
+ */
+struct _TrashXdgEnumerator {
+	GFileEnumerator parent_instance;
+
+	TrashXdgBackend *backend;
+	GFileEnumerator *files;
+	GFileAttributeMatcher *matcher;
+	gboolean needs_info;
+	GHashTable *info_names;
+};
+
+G_DEFINE_FINAL_TYPE(TrashXdgEnumerator, trash_xdg_enumerator, G_TYPE_FILE_ENUMERATOR)
+
+static GFileInfo *trash_xdg_enumerator_next_file(GFileEnumerator *enumerator, GCancellable *cancellable, GError **error) {
+	TrashXdgEnumerator *self = TRASH_XDG_ENUMERATOR(enumerator);
+	GFileInfo *info;
+
+	while ((info = g_file_enumerator_next_file(self->files, cancellable, error)) != NULL) {
+		if (self->needs_info ? read_trash_info(self->backend, g_file_info_get_name(info), info, self->matcher, NULL) : g_hash_table_contains(self->info_names, g_file_info_get_name(info))) {
+			return info;
+		}
+
+		// Not a (complete) trashed item yet, or left over from a crash
+		g_object_unref(info);
+	}
+
+	return NULL;
+}
+
+static gboolean trash_xdg_enumerator_close(GFileEnumerator *enumerator, GCancellable *cancellable, GError **error) {
+	TrashXdgEnumerator *self = TRASH_XDG_ENUMERATOR(enumerator);
+
+	return g_file_enumerator_close(self->files, cancellable, error);
+}
+
+static void trash_xdg_enumerator_finalize(GObject *object) {
+	TrashXdgEnumerator *self = TRASH_XDG_ENUMERATOR(object);
+
+	g_clear_object(&self->files);
+	g_clear_object(&self->backend);
+	g_clear_pointer(&self->matcher, g_file_attribute_matcher_unref);
+	g_clear_pointer(&self->info_names, g_hash_table_unref);
+
+	G_OBJECT_CLASS(trash_xdg_enumerator_parent_class)->finalize(object);
+}
+
+static void trash_xdg_enumerator_class_init(TrashXdgEnumeratorClass *klass) {
+	GObjectClass *class = G_OBJECT_CLASS(klass);
+	GFileEnumeratorClass *enumerator_class = G_FILE_ENUMERATOR_CLASS(klass);
+
+	class->finalize = trash_xdg_enumerator_finalize;
+	enumerator_class->next_file = trash_xdg_enumerator_next_file;
+	enumerator_class->close_fn = trash_xdg_enumerator_close;
+}
+
+static void trash_xdg_enumerator_init(TrashXdgEnumerator *self) {
+	(void) self;
+}
+
+/* Backend */
+
+static void trash_xdg_backend_dispose(GObject *object) {
+	TrashXdgBackend *self;
+
+	self = TRASH_XDG_BACKEND(object);
+
+	g_clear_object(&self->files_monitor);
+	g_clear_object(&self->info_monitor);
+
+	G_OBJECT_CLASS(trash_xdg_backend_parent_class)->dispose(object);
+}
+
+static void trash_xdg_backend_finalize(GObject *object) {
+	TrashXdgBackend *self;
+
+	self = TRASH_XDG_BACKEND(object);
+
+	g_clear_object(&self->files_dir);
+	g_clear_object(&self->info_dir);
+	g_free(self->trash_path);
+
+	G_OBJECT_CLASS(trash_xdg_backend_parent_class)->finalize(object);
+}
+
+static void trash_xdg_backend_class_init(TrashXdgBackendClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_xdg_backend_dispose;
+	class->finalize = trash_xdg_backend_finalize;
+}
+
+static void trash_xdg_backend_init(TrashXdgBackend *self) {
+	(void) self;
+}
+
+/**
+ * Strip the `.trashinfo` suffix off of an info file name, in place.
+ *
+ * Returns: (nullable): @name, or %NULL if it isn't an info file
+ */
+static gchar *info_name_to_item_name(gchar *name) {
+	if (!name || !g_str_has_suffix(name, ".trashinfo")) {
+		return NULL;
+	}
+
+	name[strlen(name) - strlen(".trashinfo")] = '\0';
+
+	return name;
+}
+
+/**
+ * Turn a file monitor event in either directory into an item event. An
+ * item shows up when either its file or its info file does, and goes away
+ * when either of them goes away.
+ */
+static void dir_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event, TrashXdgBackend *self) {
+	TrashBackend *backend = TRASH_BACKEND(self);
+	g_autofree gchar *file_name = NULL;
+	g_autofree gchar *other_name = NULL;
+	const gchar *name;
+	const gchar *other;
+
+	file_name = g_file_get_basename(file);
+	other_name = other_file ? g_file_get_basename(other_file) : NULL;
+
+	if (monitor == self->info_monitor) {
+		name = info_name_to_item_name(file_name);
+		other = info_name_to_item_name(other_name);
+	} else {
+		name = file_name;
+		other = other_name;
+	}
+
+	switch (event) {
+		case G_FILE_MONITOR_EVENT_MOVED_IN:
+		case G_FILE_MONITOR_EVENT_CREATED:
+		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+			if (name) {
+				trash_backend_emit_item_added(backend, name);
+			}
+			break;
+		case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		case G_FILE_MONITOR_EVENT_DELETED:
+			if (name) {
+				trash_backend_emit_item_removed(backend, name);
+			}
+			break;
+		case G_FILE_MONITOR_EVENT_RENAMED:
+			if (name) {
+				trash_backend_emit_item_removed(backend, name);
+			}
+			if (other) {
+				trash_backend_emit_item_added(backend, other);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+static GFileMonitor *monitor_dir(TrashXdgBackend *self, GFile *dir) {
+	GFileMonitor *monitor;
+	g_autoptr(GError) error = NULL;
+
+	monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+
+	if (!monitor) {
+		g_critical("Unable to monitor the trash bin: %s", error->message);
+		return NULL;
+	}
+
+	g_signal_connect(monitor, "changed", G_CALLBACK(dir_changed), self);
+
+	return monitor;
+}
+
+/**
+ * trash_xdg_backend_new:
+ *
+ * Creates a new #TrashXdgBackend for the user's own trash bin, and starts
+ * watching it.
+ *
+ * Returns: a new #TrashXdgBackend
+ */
+TrashXdgBackend *trash_xdg_backend_new(void) {
+	g_autofree gchar *trash_path = NULL;
+
+	trash_path = g_build_filename(g_get_user_data_dir(), "Trash", NULL);
+
+	return trash_xdg_backend_new_for_path(trash_path);
+}
+
+/**
+ * trash_xdg_backend_new_for_path:
+ * @trash_path: the path to a trash bin directory
+ *
+ * Creates a new #TrashXdgBackend for the trash bin at @trash_path, and
+ * starts watching it. The directory is created if it does not exist yet.
+ *
+ * Returns: a new #TrashXdgBackend
+ */
+TrashXdgBackend *trash_xdg_backend_new_for_path(const gchar *trash_path) {
+	TrashXdgBackend *self;
+	g_autofree gchar *files_path = NULL;
+	g_autofree gchar *info_path = NULL;
+
+	g_return_val_if_fail(trash_path != NULL, NULL);
+
+	self = g_object_new(TRASH_TYPE_XDG_BACKEND, NULL);
+	self->trash_path = g_strdup(trash_path);
+
+	files_path = g_build_filename(trash_path, "files", NULL);
+	info_path = g_build_filename(trash_path, "info", NULL);
+
+	// Create the directories like GIO would when trashing something, so
+	// that we can watch them.
+	if (g_mkdir_with_parents(files_path, 0700) != 0 || g_mkdir_with_parents(info_path, 0700) != 0) {
+		g_warning("Unable to create trash directories in '%s': %s", trash_path, g_strerror(errno));
+	}
+
+	self->files_dir = g_file_new_for_path(files_path);
+	self->info_dir = g_file_new_for_path(info_path);
+	self->files_monitor = monitor_dir(self, self->files_dir);
+	self->info_monitor = monitor_dir(self, self->info_dir);
+
+	return self;
+}
+
+/* TrashBackend implementation */
+
+/**
+ * List the names of the items that have an info file, without reading
+ * the info files themselves.
+ *
+ * Returns: (transfer full): a set of item names, or NULL on error
+ */
+static GHashTable *read_info_names(TrashXdgBackend *self, GError **error) {
+	g_autofree gchar *info_path = NULL;
+	g_autoptr(GDir) dir = NULL;
+	GHashTable *names;
+	const gchar *name;
+
+	info_path = g_build_filename(self->trash_path, "info", NULL);
+	dir = g_dir_open(info_path, 0, error);
+
+	if (!dir) {
+		return NULL;
+	}
+
+	names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	while ((name = g_dir_read_name(dir))) {
+		if (g_str_has_suffix(name, ".trashinfo")) {
+			g_hash_table_add(names, g_strndup(name, strlen(name) - strlen(".trashinfo")));
+		}
+	}
+
+	return names;
+}
+
+static void enumerate_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	TrashXdgBackend *self = TRASH_XDG_BACKEND(source_object);
+	const gchar *attributes = task_data;
+	TrashXdgEnumerator *enumerator;
+	g_autoptr(GFileAttributeMatcher) matcher = NULL;
+	g_autoptr(GHashTable) info_names = NULL;
+	GFileEnumerator *files;
+	GError *error = NULL;
+	gboolean needs_info;
+
+	matcher = g_file_attribute_matcher_new(attributes);
+	needs_info = g_file_attribute_matcher_enumerate_namespace(matcher, "trash") ||
+		g_file_attribute_matcher_matches(matcher, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI);
+
+	// Items without an info file are skipped either way, so that a snapshot
+	// lists the same items as a full scan
+	if (!needs_info) {
+		info_names = read_info_names(self, &error);
+
+		if (!info_names) {
+			g_task_return_error(task, error);
+			return;
+		}
+	}
+
+	files = g_file_enumerate_children(self->files_dir, attributes, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, &error);
+
+	if (!files) {
+		g_task_return_error(task, error);
+		return;
+	}
+
+	enumerator = g_object_new(TRASH_TYPE_XDG_ENUMERATOR, "container", self->files_dir, NULL);
+	enumerator->backend = g_object_ref(self);
+	enumerator->files = files;
+	enumerator->matcher = g_steal_pointer(&matcher);
+	enumerator->needs_info = needs_info;
+	enumerator->info_names = g_steal_pointer(&info_names);
+
+	g_task_return_pointer(task, enumerator, g_object_unref);
+}
+
+static void trash_xdg_backend_enumerate_async(TrashBackend *backend, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_autoptr(GTask) task = NULL;
+
+	task = g_task_new(backend, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_xdg_backend_enumerate_async);
+	g_task_set_priority(task, io_priority);
+	g_task_set_task_data(task, g_strdup(attributes), g_free);
+	g_task_run_in_thread(task, enumerate_thread);
+}
+
+static GFileEnumerator *trash_xdg_backend_enumerate_finish(TrashBackend *backend, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, backend), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+typedef struct {
+	gchar *name;
+	gchar *attributes;
+} QueryData;
+
+static void query_data_free(gpointer data) {
+	QueryData *query = data;
+
+	g_free(query->name);
+	g_free(query->attributes);
+	g_slice_free(QueryData, query);
+}
+
+static void query_info_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	TrashXdgBackend *self = TRASH_XDG_BACKEND(source_object);
+	QueryData *query = task_data;
+	g_autoptr(GFileAttributeMatcher) matcher = NULL;
+	g_autoptr(GFile) file = NULL;
+	GFileInfo *info;
+	GError *error = NULL;
+
+	file = g_file_get_child(self->files_dir, query->name);
+	info = g_file_query_info(file, query->attributes, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, &error);
+
+	if (!info) {
+		g_task_return_error(task, error);
+		return;
+	}
+
+	matcher = g_file_attribute_matcher_new(query->attributes);
+
+	if (!read_trash_info(self, query->name, info, matcher, &error)) {
+		g_object_unref(info);
+		g_task_return_error(task, error);
+		return;
+	}
+
+	g_task_return_pointer(task, info, g_object_unref);
+}
+
+static void trash_xdg_backend_query_info_async(TrashBackend *backend, const gchar *name, const gchar *attributes, gint io_priority, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_autoptr(GTask) task = NULL;
+	QueryData *query;
+
+	query = g_slice_new(QueryData);
+	query->name = g_strdup(name);
+	query->attributes = g_strdup(attributes);
+
+	task = g_task_new(backend, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_xdg_backend_query_info_async);
+	g_task_set_priority(task, io_priority);
+	g_task_set_task_data(task, query, query_data_free);
+	g_task_run_in_thread(task, query_info_thread);
+}
+
+static GFileInfo *trash_xdg_backend_query_info_finish(TrashBackend *backend, GAsyncResult *result, GError **error) {
+	g_return_val_if_fail(g_task_is_valid(result, backend), NULL);
+
+	return g_task_propagate_pointer(G_TASK(result), error);
+}
+
+static gboolean delete_info_file(TrashXdgBackend *self, const gchar *name, GCancellable *cancellable, GError **error) {
+	g_autofree gchar *info_name = NULL;
+	g_autoptr(GFile) info_file = NULL;
+
+	info_name = g_strconcat(name, ".trashinfo", NULL);
+	info_file = g_file_get_child(self->info_dir, info_name);
+
+	return g_file_delete(info_file, cancellable, error);
+}
+
+static gboolean trash_xdg_backend_delete_item(TrashBackend *backend, const gchar *name, guint64 *bytes_freed, GCancellable *cancellable, GError **error) {
+	TrashXdgBackend *self = TRASH_XDG_BACKEND(backend);
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	file = g_file_get_child(self->files_dir, name);
+
+	// The spec says to remove the file before its info file
+	if (!trash_backend_delete_recursive(file, bytes_freed, cancellable, &local_error) && !g_error_matches(local_error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+		g_propagate_error(error, g_steal_pointer(&local_error));
+		return FALSE;
+	}
+
+	return delete_info_file(self, name, cancellable, error);
+}
+
+static gboolean trash_xdg_backend_restore_item(TrashBackend *backend, const gchar *name, const gchar *restore_path, GCancellable *cancellable, GError **error) {
+	TrashXdgBackend *self = TRASH_XDG_BACKEND(backend);
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFile) restored_file = NULL;
+	g_autoptr(GError) local_error = NULL;
+
+	file = g_file_get_child(self->files_dir, name);
+	restored_file = g_file_new_for_path(restore_path);
+
+	if (!g_file_move(file, restored_file, G_FILE_COPY_ALL_METADATA | G_FILE_COPY_NOFOLLOW_SYMLINKS, cancellable, NULL, NULL, error)) {
+		return FALSE;
+	}
+
+	// The item is out of the trash either way, so only warn about this
+	if (!delete_info_file(self, name, cancellable, &local_error)) {
+		g_warning("Unable to remove trash info for restored item '%s': %s", name, local_error->message);
+	}
+
+	return TRUE;
+}
+
+static void trash_xdg_backend_iface_init(TrashBackendInterface *iface) {
+	iface->enumerate_async = trash_xdg_backend_enumerate_async;
+	iface->enumerate_finish = trash_xdg_backend_enumerate_finish;
+	iface->query_info_async = trash_xdg_backend_query_info_async;
+	iface->query_info_finish = trash_xdg_backend_query_info_finish;
+	iface->delete_item = trash_xdg_backend_delete_item;
+	iface->restore_item = trash_xdg_backend_restore_item;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "trash_backend.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_XDG_BACKEND (trash_xdg_backend_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashXdgBackend, trash_xdg_backend, TRASH, XDG_BACKEND, GObject)
+
+TrashXdgBackend *trash_xdg_backend_new(void);
+
+TrashXdgBackend *trash_xdg_backend_new_for_path(const gchar *trash_path);
+
+G_END_DECLS
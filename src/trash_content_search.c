@@ -0,0 +1,465 @@
+/**
+ * SECTION:trashcontentsearch
+ * @Short_description: Looks for text inside trashed files
+ * @Title: TrashContentSearch
+ *
+ * A #TrashContentSearch reads trashed regular files looking for a string,
+ * for when the user remembers what was in a file but not what it was
+ * called. Directories, files that aren't stored on a local disk, and
+ * files that look binary are skipped.
+ *
+ * The match is exact, byte for byte, so unlike the name filter it is
+ * case-sensitive: folding case properly would mean decoding every file,
+ * and their encoding isn't known.
+ *
+ * Files are read in chunks and searched with memmem() on a shared pool
+ * of worker threads. A search reads at most
+ * %TRASH_CONTENT_SEARCH_MAX_BYTES in total, and at most
+ * %TRASH_CONTENT_SEARCH_MAX_FILE_BYTES from the start of each file.
+ *
+ * Each file that matches is reported with #TrashContentSearch::match as
+ * soon as it is found. Starting a new search cancels the one before it.
+ */
+
+#define _GNU_SOURCE
+
+#include "trash_content_search.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * How much of the start of a file to look at for NUL bytes when deciding
+ * whether it is binary, the same as git and grep do.
+ */
+#define TRASH_CONTENT_SEARCH_SNIFF_BYTES 8000
+
+/**
+ * How much of a file to read at a time. The first chunk has to hold
+ * everything that is sniffed.
+ */
+#define TRASH_CONTENT_SEARCH_CHUNK_BYTES (64 * 1024)
+
+/**
+ * The most worker threads used for searching, however many processors
+ * there are.
+ */
+#define TRASH_CONTENT_SEARCH_MAX_THREADS 4
+
+enum {
+	MATCH,
+	FINISHED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+/**
+ * One search, shared between the files being searched for it.
+ */
+typedef struct {
+	gint ref_count;
+	GWeakRef owner;
+	GMainContext *context;
+	GCancellable *cancellable;
+	gchar *needle;
+	gsize needle_length;
+
+	gint remaining;
+	gssize bytes_reserved;
+} SearchRun;
+
+typedef struct {
+	SearchRun *run;
+	TrashInfo *info;
+} SearchJob;
+
+struct _TrashContentSearch {
+	GObject parent_instance;
+
+	TrashManager *manager;
+	SearchRun *run;
+};
+
+G_DEFINE_FINAL_TYPE(TrashContentSearch, trash_content_search, G_TYPE_OBJECT)
+
+static GThreadPool *search_pool = NULL;
+
+static SearchRun *search_run_ref(SearchRun *run) {
+	g_atomic_int_inc(&run->ref_count);
+
+	return run;
+}
+
+static void search_run_unref(SearchRun *run) {
+	if (!g_atomic_int_dec_and_test(&run->ref_count)) {
+		return;
+	}
+
+	g_weak_ref_clear(&run->owner);
+	g_main_context_unref(run->context);
+	g_object_unref(run->cancellable);
+	g_free(run->needle);
+	g_slice_free(SearchRun, run);
+}
+
+static void search_job_free(SearchJob *job) {
+	search_run_unref(job->run);
+	g_object_unref(job->info);
+	g_slice_free(SearchJob, job);
+}
+
+/**
+ * Get the search that @run belongs to on the main thread, if it hasn't
+ * been cancelled or replaced since.
+ */
+static TrashContentSearch *dup_owner(SearchRun *run) {
+	TrashContentSearch *self;
+
+	if (g_cancellable_is_cancelled(run->cancellable)) {
+		return NULL;
+	}
+
+	self = g_weak_ref_get(&run->owner);
+
+	if (self && self->run != run) {
+		g_clear_object(&self);
+	}
+
+	return self;
+}
+
+static gboolean report_match(gpointer data) {
+	SearchJob *job = data;
+	g_autoptr(TrashContentSearch) self = NULL;
+
+	self = dup_owner(job->run);
+
+	if (self) {
+		g_signal_emit(self, signals[MATCH], 0, job->info);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean report_finished(gpointer data) {
+	SearchRun *run = data;
+	g_autoptr(TrashContentSearch) self = NULL;
+
+	self = dup_owner(run);
+
+	if (!self) {
+		return G_SOURCE_REMOVE;
+	}
+
+	g_clear_pointer(&self->run, search_run_unref);
+	g_signal_emit(self, signals[FINISHED], 0);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean looks_binary(const gchar *data, gsize length) {
+	return memchr(data, '\0', MIN(length, TRASH_CONTENT_SEARCH_SNIFF_BYTES)) != NULL;
+}
+
+/**
+ * Search one file. Returns whether it contains the needle.
+ *
+ * The file is read in chunks rather than mapped, so that a file that
+ * shrinks while we read it ends the search early instead of faulting.
+ * The end of each chunk is carried over to the next, so that a match
+ * across the boundary is still found.
+ */
+static gboolean search_file(SearchRun *run, const gchar *path) {
+	g_autofree gchar *buffer = NULL;
+	struct stat st;
+	gsize length;
+	gsize offset = 0;
+	gsize kept = 0;
+	gsize filled;
+	gssize reserved;
+	gssize n;
+	gboolean found = FALSE;
+	int fd;
+
+	// Non-blocking, so that a trashed FIFO can't hang the worker
+	fd = open(path, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+
+	if (fd < 0) {
+		return FALSE;
+	}
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+		close(fd);
+		return FALSE;
+	}
+
+	length = (gsize) MIN(st.st_size, TRASH_CONTENT_SEARCH_MAX_FILE_BYTES);
+
+	if (length < run->needle_length) {
+		close(fd);
+		return FALSE;
+	}
+
+	reserved = g_atomic_pointer_add(&run->bytes_reserved, (gssize) length);
+
+	if (reserved + (gssize) length > TRASH_CONTENT_SEARCH_MAX_BYTES) {
+		// Leave the budget to files that still fit in it
+		g_atomic_pointer_add(&run->bytes_reserved, -(gssize) length);
+		close(fd);
+		return FALSE;
+	}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, (off_t) length, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	buffer = g_malloc(TRASH_CONTENT_SEARCH_CHUNK_BYTES + run->needle_length - 1);
+
+	while (offset < length && !g_cancellable_is_cancelled(run->cancellable)) {
+		n = pread(fd, buffer + kept, MIN(TRASH_CONTENT_SEARCH_CHUNK_BYTES, length - offset), (off_t) offset);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		// An error, or the file was truncated since we looked at it
+		if (n <= 0) {
+			break;
+		}
+
+		if (offset == 0 && looks_binary(buffer, (gsize) n)) {
+			break;
+		}
+
+		offset += (gsize) n;
+		filled = kept + (gsize) n;
+
+		if (memmem(buffer, filled, run->needle, run->needle_length)) {
+			found = TRUE;
+			break;
+		}
+
+		kept = MIN(filled, run->needle_length - 1);
+		memmove(buffer, buffer + filled - kept, kept);
+	}
+
+	close(fd);
+
+	// Give back what we didn't read
+	if (offset < length) {
+		g_atomic_pointer_add(&run->bytes_reserved, -(gssize) (length - offset));
+	}
+
+	return found;
+}
+
+static void search_job_func(gpointer data, gpointer user_data) {
+	(void) user_data;
+	SearchJob *job = data;
+	SearchRun *run = job->run;
+
+	if (!g_cancellable_is_cancelled(run->cancellable) && search_file(run, trash_info_peek_target_path(job->info))) {
+		g_main_context_invoke_full(run->context, G_PRIORITY_DEFAULT, report_match, job, (GDestroyNotify) search_job_free);
+		job = NULL;
+	}
+
+	if (g_atomic_int_dec_and_test(&run->remaining)) {
+		g_main_context_invoke_full(run->context, G_PRIORITY_DEFAULT, report_finished, search_run_ref(run), (GDestroyNotify) search_run_unref);
+	}
+
+	if (job) {
+		search_job_free(job);
+	}
+}
+
+static gpointer create_pool(gpointer data) {
+	(void) data;
+	gint threads;
+
+	threads = CLAMP((gint) g_get_num_processors(), 1, TRASH_CONTENT_SEARCH_MAX_THREADS);
+
+	return g_thread_pool_new(search_job_func, NULL, threads, FALSE, NULL);
+}
+
+static void trash_content_search_dispose(GObject *object) {
+	TrashContentSearch *self;
+
+	self = TRASH_CONTENT_SEARCH(object);
+
+	trash_content_search_cancel(self);
+
+	G_OBJECT_CLASS(trash_content_search_parent_class)->dispose(object);
+}
+
+static void trash_content_search_finalize(GObject *object) {
+	TrashContentSearch *self;
+
+	self = TRASH_CONTENT_SEARCH(object);
+
+	g_object_unref(self->manager);
+
+	G_OBJECT_CLASS(trash_content_search_parent_class)->finalize(object);
+}
+
+static void trash_content_search_class_init(TrashContentSearchClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_content_search_dispose;
+	class->finalize = trash_content_search_finalize;
+
+	// Signals
+
+	/**
+	 * TrashContentSearch::match:
+	 * @self: a #TrashContentSearch
+	 * @info: the #TrashInfo of a file that contains the text
+	 *
+	 * Emitted on the main thread for each file that matches, as it is found.
+	 */
+	signals[MATCH] = g_signal_new(
+		"match",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		1,
+		G_TYPE_POINTER);
+
+	/**
+	 * TrashContentSearch::finished:
+	 * @self: a #TrashContentSearch
+	 *
+	 * Emitted when every file has been searched. Not emitted for a search
+	 * that was cancelled.
+	 */
+	signals[FINISHED] = g_signal_new(
+		"finished",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		0);
+}
+
+static void trash_content_search_init(TrashContentSearch *self) {
+	(void) self;
+}
+
+/**
+ * trash_content_search_new:
+ * @manager: the #TrashManager with the items to search
+ *
+ * Creates a new #TrashContentSearch.
+ *
+ * Returns: (transfer full): a new #TrashContentSearch
+ */
+TrashContentSearch *trash_content_search_new(TrashManager *manager) {
+	TrashContentSearch *self;
+
+	g_return_val_if_fail(TRASH_IS_MANAGER(manager), NULL);
+
+	self = g_object_new(TRASH_TYPE_CONTENT_SEARCH, NULL);
+	self->manager = g_object_ref(manager);
+
+	return self;
+}
+
+static void add_searchable(gpointer data, gpointer user_data) {
+	TrashInfo *info = data;
+
+	if (trash_info_is_directory(info) || !trash_info_peek_target_path(info)) {
+		return;
+	}
+
+	g_ptr_array_add(user_data, g_object_ref(info));
+}
+
+/**
+ * trash_content_search_start:
+ * @self: a #TrashContentSearch
+ * @text: the text to look for
+ *
+ * Starts searching every trashed file for @text, cancelling any search
+ * that is still running. #TrashContentSearch::finished is emitted when it
+ * is done, which may be right away if there is nothing to search.
+ */
+void trash_content_search_start(TrashContentSearch *self, const gchar *text) {
+	static GOnce pool_once = G_ONCE_INIT;
+	g_autoptr(GPtrArray) files = NULL;
+	SearchRun *run;
+	SearchJob *job;
+	guint i;
+
+	g_return_if_fail(TRASH_IS_CONTENT_SEARCH(self));
+	g_return_if_fail(text != NULL && *text != '\0');
+
+	trash_content_search_cancel(self);
+
+	search_pool = g_once(&pool_once, create_pool, NULL);
+
+	files = g_ptr_array_new_with_free_func(g_object_unref);
+	trash_manager_foreach_item(self->manager, add_searchable, files);
+
+	run = g_slice_new0(SearchRun);
+	run->ref_count = 1;
+	g_weak_ref_init(&run->owner, self);
+	run->context = g_main_context_ref_thread_default();
+	run->cancellable = g_cancellable_new();
+	run->needle = g_strdup(text);
+	run->needle_length = strlen(text);
+	run->remaining = (gint) files->len;
+
+	self->run = run;
+
+	if (files->len == 0) {
+		g_clear_pointer(&self->run, search_run_unref);
+		g_signal_emit(self, signals[FINISHED], 0);
+		return;
+	}
+
+	for (i = 0; i < files->len; i++) {
+		job = g_slice_new0(SearchJob);
+		job->run = search_run_ref(run);
+		job->info = g_object_ref(g_ptr_array_index(files, i));
+
+		g_thread_pool_push(search_pool, job, NULL);
+	}
+}
+
+/**
+ * trash_content_search_cancel:
+ * @self: a #TrashContentSearch
+ *
+ * Stops the running search, if there is one. Files that are being read
+ * are finished, but nothing more is reported.
+ */
+void trash_content_search_cancel(TrashContentSearch *self) {
+	g_return_if_fail(TRASH_IS_CONTENT_SEARCH(self));
+
+	if (!self->run) {
+		return;
+	}
+
+	g_cancellable_cancel(self->run->cancellable);
+	g_clear_pointer(&self->run, search_run_unref);
+}
+
+/**
+ * trash_content_search_is_running:
+ * @self: a #TrashContentSearch
+ *
+ * Checks whether a search is in progress.
+ *
+ * Returns: %TRUE if a search was started and hasn't finished or been cancelled
+ */
+gboolean trash_content_search_is_running(TrashContentSearch *self) {
+	g_return_val_if_fail(TRASH_IS_CONTENT_SEARCH(self), FALSE);
+
+	return self->run != NULL;
+}
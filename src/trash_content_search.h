@@ -0,0 +1,31 @@
+#pragma once
+
+#include "trash_info.h"
+#include "trash_manager.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * The most bytes of file contents that a single search reads.
+ */
+#define TRASH_CONTENT_SEARCH_MAX_BYTES (512 * 1024 * 1024)
+
+/**
+ * The most bytes searched at the start of any one file.
+ */
+#define TRASH_CONTENT_SEARCH_MAX_FILE_BYTES (32 * 1024 * 1024)
+
+#define TRASH_TYPE_CONTENT_SEARCH (trash_content_search_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashContentSearch, trash_content_search, TRASH, CONTENT_SEARCH, GObject)
+
+TrashContentSearch *trash_content_search_new(TrashManager *manager);
+
+void trash_content_search_start(TrashContentSearch *self, const gchar *text);
+
+void trash_content_search_cancel(TrashContentSearch *self);
+
+gboolean trash_content_search_is_running(TrashContentSearch *self);
+
+G_END_DECLS
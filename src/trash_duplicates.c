@@ -0,0 +1,639 @@
+/**
+ * SECTION:trashduplicates
+ * @Short_description: Finds trashed files with the same contents
+ * @Title: Duplicates
+ *
+ * Looks for trashed regular files that are byte-for-byte copies of each
+ * other, such as the same download trashed several times. Files are
+ * narrowed down in steps, so that only likely duplicates are ever read
+ * in full:
+ *
+ * 1. Files are grouped by size, and files with a size of their own are
+ *    dropped.
+ * 2. The first and last %TRASH_DUPLICATES_EDGE_BYTES of each file are
+ *    hashed, and the groups are split by that hash.
+ * 3. The files that are left are hashed in full, and the groups are split
+ *    by that hash.
+ * 4. The files in each group are compared byte by byte, because the hash
+ *    is a fast 64-bit non-cryptographic one in the style of xxHash64 that
+ *    files made to collide on purpose could fool.
+ *
+ * The reading and hashing in steps 2 and 3 is spread over a thread per
+ * processor. Only regular files are read, and never past the size they
+ * had when they were trashed, so a symlink to a device or a FIFO in the
+ * trash can't keep a thread reading forever.
+ */
+
+#include "trash_duplicates.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The most threads that read files at the same time.
+ */
+#define TRASH_DUPLICATES_MAX_THREADS 8
+
+/**
+ * How much of a file is read at a time when hashing all of it.
+ */
+#define TRASH_DUPLICATES_READ_SIZE (1024 * 1024)
+
+#define HASH_PRIME_1 G_GUINT64_CONSTANT(0x9E3779B185EBCA87)
+#define HASH_PRIME_2 G_GUINT64_CONSTANT(0xC2B2AE3D27D4EB4F)
+#define HASH_PRIME_3 G_GUINT64_CONSTANT(0x165667B19E3779F9)
+
+#define HASH_STRIPE 32
+
+typedef struct {
+	guint64 lanes[4];
+	guint8 buffer[HASH_STRIPE];
+	gsize buffered;
+	guint64 length;
+} Hasher;
+
+typedef struct {
+	TrashInfo *info;
+	guint64 size;
+	guint64 edge_hash;
+	guint64 full_hash;
+	gboolean failed;
+} Candidate;
+
+typedef struct {
+	GPtrArray *groups;
+	guint64 reclaimable;
+} FindResult;
+
+static inline guint64 rotl64(guint64 value, guint bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline guint64 hash_round(guint64 acc, guint64 input) {
+	acc += input * HASH_PRIME_2;
+	acc = rotl64(acc, 31);
+
+	return acc * HASH_PRIME_1;
+}
+
+static inline guint64 read64(const guint8 *data) {
+	guint64 value;
+
+	memcpy(&value, data, sizeof(value));
+
+	return GUINT64_FROM_LE(value);
+}
+
+static void hasher_init(Hasher *hasher) {
+	memset(hasher, 0, sizeof(Hasher));
+
+	hasher->lanes[0] = HASH_PRIME_1 + HASH_PRIME_2;
+	hasher->lanes[1] = HASH_PRIME_2;
+	hasher->lanes[2] = 0;
+	hasher->lanes[3] = -HASH_PRIME_1;
+}
+
+/**
+ * Mix 32 bytes into the four lanes. The lanes don't depend on each other,
+ * so the CPU can work on all of them at once.
+ */
+static inline void hasher_stripe(Hasher *hasher, const guint8 *data) {
+	hasher->lanes[0] = hash_round(hasher->lanes[0], read64(data));
+	hasher->lanes[1] = hash_round(hasher->lanes[1], read64(data + 8));
+	hasher->lanes[2] = hash_round(hasher->lanes[2], read64(data + 16));
+	hasher->lanes[3] = hash_round(hasher->lanes[3], read64(data + 24));
+}
+
+static void hasher_update(Hasher *hasher, const guint8 *data, gsize length) {
+	gsize take;
+
+	hasher->length += length;
+
+	if (hasher->buffered > 0) {
+		take = MIN(HASH_STRIPE - hasher->buffered, length);
+		memcpy(hasher->buffer + hasher->buffered, data, take);
+		hasher->buffered += take;
+		data += take;
+		length -= take;
+
+		if (hasher->buffered < HASH_STRIPE) {
+			return;
+		}
+
+		hasher_stripe(hasher, hasher->buffer);
+		hasher->buffered = 0;
+	}
+
+	while (length >= HASH_STRIPE) {
+		hasher_stripe(hasher, data);
+		data += HASH_STRIPE;
+		length -= HASH_STRIPE;
+	}
+
+	memcpy(hasher->buffer, data, length);
+	hasher->buffered = length;
+}
+
+static guint64 hasher_finish(Hasher *hasher) {
+	guint64 acc;
+	gsize i;
+
+	acc = rotl64(hasher->lanes[0], 1) + rotl64(hasher->lanes[1], 7) + rotl64(hasher->lanes[2], 12) + rotl64(hasher->lanes[3], 18);
+
+	for (i = 0; i < G_N_ELEMENTS(hasher->lanes); i++) {
+		acc = (acc ^ hash_round(0, hasher->lanes[i])) * HASH_PRIME_1 + HASH_PRIME_3;
+	}
+
+	acc += hasher->length;
+
+	for (i = 0; i < hasher->buffered; i++) {
+		acc ^= hasher->buffer[i] * HASH_PRIME_3;
+		acc = rotl64(acc, 11) * HASH_PRIME_1;
+	}
+
+	acc ^= acc >> 33;
+	acc *= HASH_PRIME_2;
+	acc ^= acc >> 29;
+	acc *= HASH_PRIME_3;
+	acc ^= acc >> 32;
+
+	return acc;
+}
+
+static void candidate_free(gpointer data) {
+	Candidate *candidate = data;
+
+	g_object_unref(candidate->info);
+	g_slice_free(Candidate, candidate);
+}
+
+static void find_result_free(gpointer data) {
+	FindResult *result = data;
+
+	g_ptr_array_unref(result->groups);
+	g_slice_free(FindResult, result);
+}
+
+static gboolean read_exactly(int fd, guint8 *buffer, gsize length, off_t offset) {
+	gssize n;
+
+	while (length > 0) {
+		n = pread(fd, buffer, length, offset);
+
+		if (n <= 0) {
+			return FALSE;
+		}
+
+		buffer += n;
+		offset += n;
+		length -= (gsize) n;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Open a trashed file for reading, if it's a regular file and not a link
+ * to one.
+ *
+ * Returns: a file descriptor, or -1
+ */
+static int open_regular(Candidate *candidate) {
+	struct stat st;
+	int fd;
+
+	fd = open(trash_info_peek_target_path(candidate->info), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK | O_NOFOLLOW);
+
+	if (fd < 0) {
+		return -1;
+	}
+
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void hash_edges(gpointer data, gpointer user_data) {
+	Candidate *candidate = data;
+	GCancellable *cancellable = user_data;
+	guint8 buffer[TRASH_DUPLICATES_EDGE_BYTES];
+	Hasher hasher;
+	gsize length;
+	int fd;
+
+	if (g_cancellable_is_cancelled(cancellable)) {
+		candidate->failed = TRUE;
+		return;
+	}
+
+	fd = open_regular(candidate);
+
+	if (fd < 0) {
+		candidate->failed = TRUE;
+		return;
+	}
+
+	hasher_init(&hasher);
+	length = (gsize) MIN(candidate->size, TRASH_DUPLICATES_EDGE_BYTES);
+
+	if (!read_exactly(fd, buffer, length, 0)) {
+		candidate->failed = TRUE;
+		close(fd);
+		return;
+	}
+
+	hasher_update(&hasher, buffer, length);
+
+	if (candidate->size > TRASH_DUPLICATES_EDGE_BYTES) {
+		if (!read_exactly(fd, buffer, length, (off_t) (candidate->size - length))) {
+			candidate->failed = TRUE;
+			close(fd);
+			return;
+		}
+
+		hasher_update(&hasher, buffer, length);
+	}
+
+	close(fd);
+
+	candidate->edge_hash = hasher_finish(&hasher);
+}
+
+static void hash_contents(gpointer data, gpointer user_data) {
+	Candidate *candidate = data;
+	GCancellable *cancellable = user_data;
+	g_autofree guint8 *buffer = NULL;
+	Hasher hasher;
+	guint64 remaining;
+	gssize n = 0;
+	int fd;
+
+	if (g_cancellable_is_cancelled(cancellable)) {
+		candidate->failed = TRUE;
+		return;
+	}
+
+	fd = open_regular(candidate);
+
+	if (fd < 0) {
+		candidate->failed = TRUE;
+		return;
+	}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	buffer = g_malloc(TRASH_DUPLICATES_READ_SIZE);
+	hasher_init(&hasher);
+
+	// One byte more than we expect, to notice a file that grew
+	remaining = candidate->size + 1;
+
+	while (remaining > 0 && (n = read(fd, buffer, (gsize) MIN(remaining, TRASH_DUPLICATES_READ_SIZE))) > 0) {
+		hasher_update(&hasher, buffer, (gsize) n);
+		remaining -= (guint64) n;
+
+		if (g_cancellable_is_cancelled(cancellable)) {
+			n = -1;
+			break;
+		}
+	}
+
+	close(fd);
+
+	// The file changed size since it was trashed, so it can't be compared
+	if (n < 0 || hasher.length != candidate->size) {
+		candidate->failed = TRUE;
+		return;
+	}
+
+	candidate->full_hash = hasher_finish(&hasher);
+}
+
+/**
+ * Run @func on every candidate in every group, spread over a thread per
+ * processor, and wait for all of them to finish.
+ */
+static void run_parallel(GPtrArray *groups, GFunc func, GCancellable *cancellable) {
+	GThreadPool *pool;
+	GPtrArray *group;
+	guint i, j;
+	gint threads;
+
+	threads = CLAMP((gint) g_get_num_processors(), 1, TRASH_DUPLICATES_MAX_THREADS);
+	pool = g_thread_pool_new(func, cancellable, threads, FALSE, NULL);
+
+	for (i = 0; i < groups->len; i++) {
+		group = g_ptr_array_index(groups, i);
+
+		for (j = 0; j < group->len; j++) {
+			g_thread_pool_push(pool, g_ptr_array_index(group, j), NULL);
+		}
+	}
+
+	g_thread_pool_free(pool, FALSE, TRUE);
+}
+
+/**
+ * Split each group by a hash, dropping the candidates that couldn't be
+ * hashed and the ones that are left on their own.
+ */
+static GPtrArray *split_groups(GPtrArray *groups, gboolean full) {
+	g_autoptr(GHashTable) by_hash = NULL;
+	GPtrArray *split;
+	GPtrArray *group, *bucket;
+	GHashTableIter iter;
+	Candidate *candidate;
+	guint64 *hash;
+	guint i, j;
+
+	split = g_ptr_array_new_with_free_func((GDestroyNotify) g_ptr_array_unref);
+	by_hash = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
+
+	for (i = 0; i < groups->len; i++) {
+		group = g_ptr_array_index(groups, i);
+		g_hash_table_remove_all(by_hash);
+
+		for (j = 0; j < group->len; j++) {
+			candidate = g_ptr_array_index(group, j);
+
+			if (candidate->failed) {
+				continue;
+			}
+
+			hash = full ? &candidate->full_hash : &candidate->edge_hash;
+			bucket = g_hash_table_lookup(by_hash, hash);
+
+			if (!bucket) {
+				bucket = g_ptr_array_new();
+				g_hash_table_insert(by_hash, hash, bucket);
+			}
+
+			g_ptr_array_add(bucket, candidate);
+		}
+
+		g_hash_table_iter_init(&iter, by_hash);
+
+		while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &bucket)) {
+			if (bucket->len > 1) {
+				g_ptr_array_add(split, g_ptr_array_ref(bucket));
+			}
+		}
+	}
+
+	return split;
+}
+
+/**
+ * Whether two files of the same size have the same bytes in them.
+ */
+static gboolean files_equal(Candidate *a, Candidate *b, guint8 *buffer_a, guint8 *buffer_b, GCancellable *cancellable) {
+	guint64 offset;
+	gsize length;
+	gboolean equal;
+	int fd_a, fd_b;
+
+	fd_a = open_regular(a);
+	fd_b = fd_a >= 0 ? open_regular(b) : -1;
+
+	equal = fd_a >= 0 && fd_b >= 0;
+
+	for (offset = 0; equal && offset < a->size; offset += length) {
+		length = (gsize) MIN(a->size - offset, TRASH_DUPLICATES_READ_SIZE);
+
+		equal = !g_cancellable_is_cancelled(cancellable) &&
+			read_exactly(fd_a, buffer_a, length, (off_t) offset) &&
+			read_exactly(fd_b, buffer_b, length, (off_t) offset) &&
+			memcmp(buffer_a, buffer_b, length) == 0;
+	}
+
+	if (fd_a >= 0) {
+		close(fd_a);
+	}
+
+	if (fd_b >= 0) {
+		close(fd_b);
+	}
+
+	return equal;
+}
+
+/**
+ * Split each group into sets of files that are really the same, comparing
+ * each file with the first one of every set so far. With a good hash there
+ * is only ever one set per group.
+ */
+static GPtrArray *verify_groups(GPtrArray *groups, GCancellable *cancellable) {
+	g_autofree guint8 *buffer_a = NULL;
+	g_autofree guint8 *buffer_b = NULL;
+	g_autoptr(GPtrArray) sets = NULL;
+	GPtrArray *verified;
+	GPtrArray *group, *set;
+	Candidate *candidate;
+	guint i, j, k;
+
+	verified = g_ptr_array_new_with_free_func((GDestroyNotify) g_ptr_array_unref);
+	buffer_a = g_malloc(TRASH_DUPLICATES_READ_SIZE);
+	buffer_b = g_malloc(TRASH_DUPLICATES_READ_SIZE);
+
+	for (i = 0; i < groups->len; i++) {
+		group = g_ptr_array_index(groups, i);
+		sets = g_ptr_array_new_with_free_func((GDestroyNotify) g_ptr_array_unref);
+
+		for (j = 0; j < group->len; j++) {
+			candidate = g_ptr_array_index(group, j);
+
+			for (k = 0; k < sets->len; k++) {
+				set = g_ptr_array_index(sets, k);
+
+				if (files_equal(g_ptr_array_index(set, 0), candidate, buffer_a, buffer_b, cancellable)) {
+					g_ptr_array_add(set, candidate);
+					break;
+				}
+			}
+
+			if (k == sets->len) {
+				set = g_ptr_array_new();
+				g_ptr_array_add(set, candidate);
+				g_ptr_array_add(sets, set);
+			}
+		}
+
+		for (k = 0; k < sets->len; k++) {
+			set = g_ptr_array_index(sets, k);
+
+			if (set->len > 1) {
+				g_ptr_array_add(verified, g_ptr_array_ref(set));
+			}
+		}
+
+		g_clear_pointer(&sets, g_ptr_array_unref);
+	}
+
+	return verified;
+}
+
+static gint compare_newest_first(gconstpointer a, gconstpointer b) {
+	TrashInfo *info_a = *(TrashInfo **) a;
+	TrashInfo *info_b = *(TrashInfo **) b;
+
+	return trash_info_collate_by_date(info_b, info_a);
+}
+
+static void find_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	(void) source_object;
+	GPtrArray *candidates = task_data;
+	g_autoptr(GHashTable) by_size = NULL;
+	g_autoptr(GPtrArray) sized = NULL;
+	g_autoptr(GPtrArray) edged = NULL;
+	g_autoptr(GPtrArray) hashed = NULL;
+	g_autoptr(GPtrArray) matched = NULL;
+	GPtrArray *group, *infos;
+	GHashTableIter iter;
+	Candidate *candidate;
+	FindResult *result;
+	guint i, j;
+
+	// Step 1: group by size
+	by_size = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
+
+	for (i = 0; i < candidates->len; i++) {
+		candidate = g_ptr_array_index(candidates, i);
+		group = g_hash_table_lookup(by_size, &candidate->size);
+
+		if (!group) {
+			group = g_ptr_array_new();
+			g_hash_table_insert(by_size, &candidate->size, group);
+		}
+
+		g_ptr_array_add(group, candidate);
+	}
+
+	sized = g_ptr_array_new_with_free_func((GDestroyNotify) g_ptr_array_unref);
+	g_hash_table_iter_init(&iter, by_size);
+
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &group)) {
+		if (group->len > 1) {
+			g_ptr_array_add(sized, g_ptr_array_ref(group));
+		}
+	}
+
+	// Step 2: split by a hash of the start and end of each file
+	run_parallel(sized, hash_edges, cancellable);
+	edged = split_groups(sized, FALSE);
+
+	// Step 3: split by a hash of the whole file
+	run_parallel(edged, hash_contents, cancellable);
+	hashed = split_groups(edged, TRUE);
+
+	// Step 4: make sure the files with the same hash really are the same
+	matched = verify_groups(hashed, cancellable);
+
+	if (g_task_return_error_if_cancelled(task)) {
+		return;
+	}
+
+	result = g_slice_new0(FindResult);
+	result->groups = g_ptr_array_new_with_free_func((GDestroyNotify) g_ptr_array_unref);
+
+	for (i = 0; i < matched->len; i++) {
+		group = g_ptr_array_index(matched, i);
+		infos = g_ptr_array_new_full(group->len, g_object_unref);
+
+		for (j = 0; j < group->len; j++) {
+			candidate = g_ptr_array_index(group, j);
+			g_ptr_array_add(infos, g_object_ref(candidate->info));
+		}
+
+		g_ptr_array_sort(infos, compare_newest_first);
+		g_ptr_array_add(result->groups, infos);
+
+		result->reclaimable += candidate->size * (group->len - 1);
+	}
+
+	g_task_return_pointer(task, result, find_result_free);
+}
+
+static void add_candidate(gpointer data, gpointer user_data) {
+	TrashInfo *info = data;
+	Candidate *candidate;
+	goffset size;
+
+	size = trash_info_get_size(info);
+
+	if (trash_info_is_directory(info) || !trash_info_peek_target_path(info) || size <= 0) {
+		return;
+	}
+
+	candidate = g_slice_new0(Candidate);
+	candidate->info = g_object_ref(info);
+	candidate->size = (guint64) size;
+
+	g_ptr_array_add(user_data, candidate);
+}
+
+/**
+ * trash_duplicates_find_async:
+ * @manager: the #TrashManager with the items to look through
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called when the search is done
+ * @user_data: data to pass to @callback
+ *
+ * Starts looking for trashed files with the same contents. Directories,
+ * empty files and files that aren't on a local disk are left out.
+ */
+void trash_duplicates_find_async(TrashManager *manager, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data) {
+	g_autoptr(GTask) task = NULL;
+	GPtrArray *candidates;
+
+	g_return_if_fail(TRASH_IS_MANAGER(manager));
+
+	candidates = g_ptr_array_new_with_free_func(candidate_free);
+	trash_manager_foreach_item(manager, add_candidate, candidates);
+
+	task = g_task_new(NULL, cancellable, callback, user_data);
+	g_task_set_source_tag(task, trash_duplicates_find_async);
+	g_task_set_task_data(task, candidates, (GDestroyNotify) g_ptr_array_unref);
+	g_task_set_priority(task, G_PRIORITY_LOW);
+	g_task_run_in_thread(task, find_thread);
+}
+
+/**
+ * trash_duplicates_find_finish:
+ * @result: a #GAsyncResult
+ * @reclaimable: (out) (optional): return location for how many bytes
+ *   deleting every copy but one would free up
+ * @error: return location for a #GError
+ *
+ * Finishes looking for duplicates.
+ *
+ * Returns: (transfer full) (element-type GPtrArray) (nullable): the sets of
+ *   identical files, each as a #GPtrArray of #TrashInfo with the most
+ *   recently trashed first, or %NULL on error
+ */
+GPtrArray *trash_duplicates_find_finish(GAsyncResult *result, guint64 *reclaimable, GError **error) {
+	FindResult *found;
+	GPtrArray *groups;
+
+	g_return_val_if_fail(g_task_is_valid(result, NULL), NULL);
+
+	found = g_task_propagate_pointer(G_TASK(result), error);
+
+	if (!found) {
+		return NULL;
+	}
+
+	if (reclaimable) {
+		*reclaimable = found->reclaimable;
+	}
+
+	groups = g_ptr_array_ref(found->groups);
+	find_result_free(found);
+
+	return groups;
+}
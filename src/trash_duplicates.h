@@ -0,0 +1,19 @@
+#pragma once
+
+#include "trash_info.h"
+#include "trash_manager.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * How many bytes from the start and from the end of a file go into the
+ * cheap hash that weeds out most files of the same size.
+ */
+#define TRASH_DUPLICATES_EDGE_BYTES 4096
+
+void trash_duplicates_find_async(TrashManager *manager, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+
+GPtrArray *trash_duplicates_find_finish(GAsyncResult *result, guint64 *reclaimable, GError **error);
+
+G_END_DECLS
@@ -23,3 +23,19 @@ GType trash_sort_mode_get_type(void) {
 
 	return (GType) gtype_id;
 }
+
+GType trash_badge_mode_get_type(void) {
+	static gsize gtype_id = 0;
+	static const GEnumValue values[] = {
+		{C_ENUM(TRASH_BADGE_NONE), "TRASH_BADGE_NONE", "none"},
+		{C_ENUM(TRASH_BADGE_COUNT), "TRASH_BADGE_COUNT", "count"},
+		{C_ENUM(TRASH_BADGE_FILL), "TRASH_BADGE_FILL", "fill"},
+		{0, NULL, NULL}};
+
+	if (g_once_init_enter(&gtype_id)) {
+		GType new_type = g_enum_register_static(g_intern_static_string("TrashBadgeMode"), values);
+		g_once_init_leave(&gtype_id, new_type);
+	}
+
+	return (GType) gtype_id;
+}
@@ -7,4 +7,7 @@ G_BEGIN_DECLS
 GType trash_sort_mode_get_type(void);
 #define TRASH_TYPE_SORT_MODE (trash_sort_mode_get_type())
 
+GType trash_badge_mode_get_type(void);
+#define TRASH_TYPE_BADGE_MODE (trash_badge_mode_get_type())
+
 G_END_DECLS
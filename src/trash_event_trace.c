@@ -0,0 +1,356 @@
+/**
+ * SECTION:trasheventtrace
+ * @Short_description: Records change events so that they can be replayed
+ * @Title: Event traces
+ *
+ * An event trace is a compact binary log of the change events that a
+ * #TrashBackend reported to a #TrashManager, with the time that each one
+ * arrived and the file info that was looked up for new items. A trace of
+ * a slow event storm can be replayed offline with `budgie-trash-replay`.
+ *
+ * The file starts with the magic `BTEV` and a version byte. Each record is
+ * a type byte, the microseconds since the previous record and the item
+ * name. Info records add the size, a directory flag, the deletion time and
+ * the restore path. Numbers are stored as LEB128 varints, with signed ones
+ * zigzag encoded, and strings as a varint length followed by the bytes.
+ *
+ * Records are buffered and flushed at most a second after they are
+ * written, rather than one by one, so that recording an event storm
+ * doesn't slow it down. A trace from an applet that crashed or was killed
+ * can end partway through a record; loading it stops at that record.
+ */
+
+#include "trash_event_trace.h"
+#include <errno.h>
+#include <gio/gio.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRASH_EVENT_TRACE_MAGIC "BTEV"
+
+#define TRASH_EVENT_TRACE_VERSION 1
+
+/**
+ * How long to wait, in seconds, after writing a record before flushing it
+ * to disk. Records written in the meantime are flushed together.
+ */
+#define TRASH_EVENT_TRACE_FLUSH_INTERVAL 1
+
+struct _TrashEventWriter {
+	FILE *file;
+	gint64 last_time;
+	guint flush_source_id;
+};
+
+/**
+ * trash_event_free:
+ * @event: (transfer full): a #TrashEvent
+ *
+ * Frees an event read from a trace.
+ */
+void trash_event_free(TrashEvent *event) {
+	if (!event) {
+		return;
+	}
+
+	g_free(event->name);
+	g_free(event->restore_path);
+	g_slice_free(TrashEvent, event);
+}
+
+static void write_varint(FILE *file, guint64 value) {
+	while (value >= 0x80) {
+		fputc((int) ((value & 0x7f) | 0x80), file);
+		value >>= 7;
+	}
+
+	fputc((int) value, file);
+}
+
+static void write_string(FILE *file, const gchar *value) {
+	gsize length;
+
+	length = value ? strlen(value) : 0;
+	write_varint(file, length);
+
+	if (length > 0) {
+		fwrite(value, 1, length, file);
+	}
+}
+
+static gboolean flush_cb(gpointer user_data) {
+	TrashEventWriter *self = user_data;
+
+	self->flush_source_id = 0;
+	fflush(self->file);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Flush what has been written soon. Calling this again before that
+ * happens does nothing.
+ */
+static void schedule_flush(TrashEventWriter *self) {
+	if (self->flush_source_id != 0) {
+		return;
+	}
+
+	self->flush_source_id = g_timeout_add_seconds(TRASH_EVENT_TRACE_FLUSH_INTERVAL, flush_cb, self);
+}
+
+static void write_header(TrashEventWriter *self, TrashEventType type, const gchar *name) {
+	gint64 now;
+
+	now = g_get_monotonic_time();
+
+	fputc(type, self->file);
+	write_varint(self->file, (guint64) (now - self->last_time));
+	write_string(self->file, name);
+
+	self->last_time = now;
+}
+
+/**
+ * trash_event_writer_new:
+ * @path: where to write the trace
+ * @error: return location for a #GError
+ *
+ * Creates a new trace at @path, replacing any file that is already there.
+ *
+ * Returns: (transfer full) (nullable): a new #TrashEventWriter, or %NULL on error
+ */
+TrashEventWriter *trash_event_writer_new(const gchar *path, GError **error) {
+	TrashEventWriter *self;
+	FILE *file;
+	int saved_errno;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	file = fopen(path, "wb");
+
+	if (!file) {
+		saved_errno = errno;
+		g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved_errno), "Unable to create event trace '%s': %s", path, g_strerror(saved_errno));
+		return NULL;
+	}
+
+	fwrite(TRASH_EVENT_TRACE_MAGIC, 1, strlen(TRASH_EVENT_TRACE_MAGIC), file);
+	fputc(TRASH_EVENT_TRACE_VERSION, file);
+
+	self = g_slice_new0(TrashEventWriter);
+	self->file = file;
+	self->last_time = g_get_monotonic_time();
+
+	return self;
+}
+
+/**
+ * trash_event_writer_add:
+ * @self: a #TrashEventWriter
+ * @type: the kind of event
+ * @name: (nullable): the item that the event is about
+ *
+ * Appends a change event to the trace, timestamped now.
+ */
+void trash_event_writer_add(TrashEventWriter *self, TrashEventType type, const gchar *name) {
+	g_return_if_fail(self != NULL);
+	g_return_if_fail(type != TRASH_EVENT_INFO);
+
+	write_header(self, type, name);
+	schedule_flush(self);
+}
+
+/**
+ * trash_event_writer_add_info:
+ * @self: a #TrashEventWriter
+ * @name: the item that the info is for
+ * @restore_path: (nullable): where the item came from
+ * @size: the size of the item
+ * @is_directory: whether the item is a directory
+ * @deletion_time: when the item was trashed, in seconds since the epoch
+ *
+ * Appends the file info for a new item to the trace, timestamped now.
+ */
+void trash_event_writer_add_info(TrashEventWriter *self, const gchar *name, const gchar *restore_path, guint64 size, gboolean is_directory, gint64 deletion_time) {
+	g_return_if_fail(self != NULL);
+
+	write_header(self, TRASH_EVENT_INFO, name);
+	write_varint(self->file, size);
+	fputc(is_directory ? 1 : 0, self->file);
+	write_varint(self->file, ((guint64) deletion_time << 1) ^ (guint64) (deletion_time >> 63));
+	write_string(self->file, restore_path);
+	schedule_flush(self);
+}
+
+/**
+ * trash_event_writer_free:
+ * @self: (transfer full): a #TrashEventWriter
+ *
+ * Flushes and closes the trace, and frees the writer.
+ */
+void trash_event_writer_free(TrashEventWriter *self) {
+	if (!self) {
+		return;
+	}
+
+	if (self->flush_source_id != 0) {
+		g_source_remove(self->flush_source_id);
+	}
+
+	fclose(self->file);
+	g_slice_free(TrashEventWriter, self);
+}
+
+typedef struct {
+	const guint8 *data;
+	gsize length;
+	gsize offset;
+	/* Whether a read failed because the data ran out */
+	gboolean truncated;
+} TraceReader;
+
+static gboolean read_byte(TraceReader *reader, guint8 *value) {
+	if (reader->offset >= reader->length) {
+		reader->truncated = TRUE;
+		return FALSE;
+	}
+
+	*value = reader->data[reader->offset++];
+
+	return TRUE;
+}
+
+static gboolean read_varint(TraceReader *reader, guint64 *value) {
+	guint64 result = 0;
+	guint shift = 0;
+	guint8 byte;
+
+	do {
+		if (shift > 63 || !read_byte(reader, &byte)) {
+			return FALSE;
+		}
+
+		result |= (guint64) (byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	*value = result;
+
+	return TRUE;
+}
+
+static gboolean read_string(TraceReader *reader, gchar **value) {
+	guint64 length;
+
+	if (!read_varint(reader, &length)) {
+		return FALSE;
+	}
+
+	if (length > reader->length - reader->offset) {
+		reader->truncated = TRUE;
+		return FALSE;
+	}
+
+	*value = length > 0 ? g_strndup((const gchar *) reader->data + reader->offset, length) : NULL;
+	reader->offset += length;
+
+	return TRUE;
+}
+
+static TrashEvent *read_event(TraceReader *reader, gint64 *time) {
+	g_autoptr(TrashEvent) event = NULL;
+	guint64 delta, deletion_time;
+	guint8 type, is_directory;
+
+	if (!read_byte(reader, &type) || type < TRASH_EVENT_ADDED || type > TRASH_EVENT_INFO) {
+		return NULL;
+	}
+
+	event = g_slice_new0(TrashEvent);
+	event->type = (TrashEventType) type;
+
+	if (!read_varint(reader, &delta) || !read_string(reader, &event->name)) {
+		return NULL;
+	}
+
+	*time += (gint64) delta;
+	event->time = *time;
+
+	if (event->type != TRASH_EVENT_INFO) {
+		return g_steal_pointer(&event);
+	}
+
+	if (!read_varint(reader, &event->size) || !read_byte(reader, &is_directory) || !read_varint(reader, &deletion_time) || !read_string(reader, &event->restore_path)) {
+		return NULL;
+	}
+
+	event->is_directory = is_directory != 0;
+	event->deletion_time = (gint64) (deletion_time >> 1) ^ -(gint64) (deletion_time & 1);
+
+	return g_steal_pointer(&event);
+}
+
+/**
+ * trash_event_trace_load:
+ * @path: the trace to read
+ * @error: return location for a #GError
+ *
+ * Reads every event in a trace. A record that was cut short at the end
+ * of the trace, because the applet was killed while writing it, is left
+ * out along with anything after it.
+ *
+ * Returns: (transfer full) (element-type TrashEvent) (nullable): the events in the order they were recorded, or %NULL on error
+ */
+GPtrArray *trash_event_trace_load(const gchar *path, GError **error) {
+	g_autofree gchar *contents = NULL;
+	g_autoptr(GPtrArray) events = NULL;
+	TraceReader reader;
+	TrashEvent *event;
+	gsize length;
+	gsize magic_length;
+	gint64 time = 0;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	if (!g_file_get_contents(path, &contents, &length, error)) {
+		return NULL;
+	}
+
+	magic_length = strlen(TRASH_EVENT_TRACE_MAGIC);
+
+	if (length <= magic_length || memcmp(contents, TRASH_EVENT_TRACE_MAGIC, magic_length) != 0) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "'%s' is not an event trace", path);
+		return NULL;
+	}
+
+	if ((guint8) contents[magic_length] != TRASH_EVENT_TRACE_VERSION) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Event trace '%s' has unsupported version %u", path, (guint8) contents[magic_length]);
+		return NULL;
+	}
+
+	reader.data = (const guint8 *) contents;
+	reader.length = length;
+	reader.offset = magic_length + 1;
+	reader.truncated = FALSE;
+
+	events = g_ptr_array_new_with_free_func((GDestroyNotify) trash_event_free);
+
+	while (reader.offset < reader.length) {
+		event = read_event(&reader, &time);
+
+		if (!event && reader.truncated) {
+			g_debug("Event trace '%s' ends partway through a record after %u events", path, events->len);
+			break;
+		}
+
+		if (!event) {
+			g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Event trace '%s' is corrupt at byte %" G_GSIZE_FORMAT, path, reader.offset);
+			return NULL;
+		}
+
+		g_ptr_array_add(events, event);
+	}
+
+	return g_steal_pointer(&events);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * TrashEventType:
+ * @TRASH_EVENT_ADDED: the backend reported a new item
+ * @TRASH_EVENT_REMOVED: the backend reported that an item went away
+ * @TRASH_EVENT_RESYNC: the backend lost track of changes
+ * @TRASH_EVENT_INFO: the file info for a new item was looked up
+ *
+ * The kinds of record in an event trace.
+ */
+typedef enum {
+	TRASH_EVENT_ADDED = 1,
+	TRASH_EVENT_REMOVED,
+	TRASH_EVENT_RESYNC,
+	TRASH_EVENT_INFO,
+} TrashEventType;
+
+/**
+ * TrashEvent:
+ * @type: what happened
+ * @time: when it happened, in microseconds since the start of the trace
+ * @name: (nullable): the name of the item in the trash bin
+ * @restore_path: (nullable): where the item came from, for
+ *   %TRASH_EVENT_INFO records
+ * @size: the size of the item, for %TRASH_EVENT_INFO records
+ * @is_directory: whether the item is a directory, for %TRASH_EVENT_INFO records
+ * @deletion_time: when the item was trashed in seconds since the epoch,
+ *   for %TRASH_EVENT_INFO records
+ *
+ * A single record in an event trace.
+ */
+typedef struct {
+	TrashEventType type;
+	gint64 time;
+	gchar *name;
+	gchar *restore_path;
+	guint64 size;
+	gboolean is_directory;
+	gint64 deletion_time;
+} TrashEvent;
+
+void trash_event_free(TrashEvent *event);
+
+typedef struct _TrashEventWriter TrashEventWriter;
+
+TrashEventWriter *trash_event_writer_new(const gchar *path, GError **error);
+
+void trash_event_writer_add(TrashEventWriter *self, TrashEventType type, const gchar *name);
+
+void trash_event_writer_add_info(TrashEventWriter *self, const gchar *name, const gchar *restore_path, guint64 size, gboolean is_directory, gint64 deletion_time);
+
+void trash_event_writer_free(TrashEventWriter *self);
+
+GPtrArray *trash_event_trace_load(const gchar *path, GError **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(TrashEvent, trash_event_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(TrashEventWriter, trash_event_writer_free)
+
+G_END_DECLS
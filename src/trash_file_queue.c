@@ -0,0 +1,260 @@
+/**
+ * SECTION:trashfilequeue
+ * @Short_description: Runs file operations in the background
+ * @Title: TrashFileQueue
+ *
+ * The #TrashFileQueue runs file operations asynchronously, with only a
+ * limited number of them in flight at any time. This keeps things like
+ * dropping hundreds of files on the applet from blocking the panel, or
+ * from flooding the I/O thread pool.
+ *
+ * Progress is reported for the queue as a whole through the
+ * #TrashFileQueue::progress signal. When the queue drains, the
+ * #TrashFileQueue::finished signal is emitted and any failures are
+ * reported to the user in a single notification.
+ */
+
+#include "trash_file_queue.h"
+#include "notify.h"
+
+enum {
+	PROGRESS,
+	FINISHED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+struct _TrashFileQueue {
+	GObject parent_instance;
+
+	GQueue *waiting;
+	GCancellable *cancellable;
+
+	guint max_in_flight;
+	guint in_flight;
+
+	guint total;
+	guint completed;
+	guint failed;
+	gchar *first_error;
+};
+
+G_DEFINE_FINAL_TYPE(TrashFileQueue, trash_file_queue, G_TYPE_OBJECT)
+
+static void trash_file_queue_dispose(GObject *object) {
+	TrashFileQueue *self;
+
+	self = TRASH_FILE_QUEUE(object);
+
+	g_cancellable_cancel(self->cancellable);
+
+	if (self->waiting) {
+		g_queue_free_full(self->waiting, g_object_unref);
+		self->waiting = NULL;
+	}
+
+	G_OBJECT_CLASS(trash_file_queue_parent_class)->dispose(object);
+}
+
+static void trash_file_queue_finalize(GObject *object) {
+	TrashFileQueue *self;
+
+	self = TRASH_FILE_QUEUE(object);
+
+	g_object_unref(self->cancellable);
+	g_free(self->first_error);
+
+	G_OBJECT_CLASS(trash_file_queue_parent_class)->finalize(object);
+}
+
+static void trash_file_queue_class_init(TrashFileQueueClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_file_queue_dispose;
+	class->finalize = trash_file_queue_finalize;
+
+	// Signals
+
+	/**
+	 * TrashFileQueue::progress:
+	 * @self: a #TrashFileQueue
+	 * @done: the number of operations that have finished
+	 * @total: the number of operations queued since the queue was last empty
+	 *
+	 * Emitted every time an operation finishes.
+	 */
+	signals[PROGRESS] = g_signal_new("progress",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		2,
+		G_TYPE_UINT,
+		G_TYPE_UINT);
+
+	/**
+	 * TrashFileQueue::finished:
+	 * @self: a #TrashFileQueue
+	 * @succeeded: the number of operations that succeeded
+	 * @failed: the number of operations that failed
+	 *
+	 * Emitted when the last queued operation has finished.
+	 */
+	signals[FINISHED] = g_signal_new("finished",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		2,
+		G_TYPE_UINT,
+		G_TYPE_UINT);
+}
+
+static void trash_file_queue_init(TrashFileQueue *self) {
+	self->waiting = g_queue_new();
+	self->cancellable = g_cancellable_new();
+	self->max_in_flight = TRASH_FILE_QUEUE_DEFAULT_MAX_IN_FLIGHT;
+}
+
+/**
+ * trash_file_queue_new:
+ * @max_in_flight: the maximum number of operations to run at once
+ *
+ * Creates a new #TrashFileQueue.
+ *
+ * Returns: a new #TrashFileQueue
+ */
+TrashFileQueue *trash_file_queue_new(guint max_in_flight) {
+	TrashFileQueue *self;
+
+	self = g_object_new(TRASH_TYPE_FILE_QUEUE, NULL);
+
+	if (max_in_flight > 0) {
+		self->max_in_flight = max_in_flight;
+	}
+
+	return self;
+}
+
+/**
+ * Tell the user about everything that went wrong since the queue was
+ * last empty, all at once.
+ */
+static void report_failures(TrashFileQueue *self) {
+	g_autofree gchar *body = NULL;
+
+	if (self->failed == 0) {
+		return;
+	}
+
+	if (self->failed == 1) {
+		body = g_strdup(self->first_error);
+	} else {
+		body = g_strdup_printf("Unable to move %u items to the trash. The first error was: %s", self->failed, self->first_error);
+	}
+
+	trash_notify_try_send("Error Trashing Files", body, "dialog-error-symbolic");
+}
+
+static void start_next(TrashFileQueue *self);
+
+static void trash_finish(GObject *object, GAsyncResult *result, gpointer user_data) {
+	TrashFileQueue *self = user_data;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *name = NULL;
+
+	if (!g_file_trash_finish(G_FILE(object), result, &error)) {
+		if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_object_unref(self);
+			return;
+		}
+
+		name = g_file_get_basename(G_FILE(object));
+		g_critical("Error moving file '%s' to trash: %s", name, error->message);
+
+		if (!self->first_error) {
+			self->first_error = g_strdup_printf("Unable to trash '%s': %s", name, error->message);
+		}
+
+		self->failed++;
+	}
+
+	self->in_flight--;
+	self->completed++;
+
+	g_signal_emit(self, signals[PROGRESS], 0, self->completed, self->total);
+
+	if (self->in_flight == 0 && g_queue_is_empty(self->waiting)) {
+		report_failures(self);
+
+		g_signal_emit(self, signals[FINISHED], 0, self->completed - self->failed, self->failed);
+
+		self->total = 0;
+		self->completed = 0;
+		self->failed = 0;
+		g_clear_pointer(&self->first_error, g_free);
+	} else {
+		start_next(self);
+	}
+
+	g_object_unref(self);
+}
+
+/**
+ * Start as many waiting operations as we are allowed to have in flight.
+ */
+static void start_next(TrashFileQueue *self) {
+	GFile *file;
+
+	while (self->in_flight < self->max_in_flight && !g_queue_is_empty(self->waiting)) {
+		file = g_queue_pop_head(self->waiting);
+		self->in_flight++;
+
+		// For files on the same filesystem as the trash, this is a plain
+		// rename done on a worker thread.
+		g_file_trash_async(
+			file,
+			G_PRIORITY_DEFAULT,
+			self->cancellable,
+			trash_finish,
+			g_object_ref(self));
+
+		g_object_unref(file);
+	}
+}
+
+/**
+ * trash_file_queue_trash:
+ * @self: a #TrashFileQueue
+ * @file: (transfer none): the file to move to the trash
+ *
+ * Queue a file to be moved to the trash bin. This returns right away; the
+ * file will be trashed in the background.
+ */
+void trash_file_queue_trash(TrashFileQueue *self, GFile *file) {
+	g_return_if_fail(TRASH_IS_FILE_QUEUE(self));
+	g_return_if_fail(G_IS_FILE(file));
+
+	g_queue_push_tail(self->waiting, g_object_ref(file));
+	self->total++;
+
+	start_next(self);
+}
+
+/**
+ * trash_file_queue_get_pending:
+ * @self: a #TrashFileQueue
+ *
+ * Gets the number of operations that are queued or running.
+ *
+ * Returns: the number of unfinished operations
+ */
+guint trash_file_queue_get_pending(TrashFileQueue *self) {
+	g_return_val_if_fail(TRASH_IS_FILE_QUEUE(self), 0);
+
+	return self->in_flight + g_queue_get_length(self->waiting);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * The default number of file operations that a #TrashFileQueue will
+ * run at the same time.
+ */
+#define TRASH_FILE_QUEUE_DEFAULT_MAX_IN_FLIGHT 4
+
+#define TRASH_TYPE_FILE_QUEUE (trash_file_queue_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashFileQueue, trash_file_queue, TRASH, FILE_QUEUE, GObject)
+
+TrashFileQueue *trash_file_queue_new(guint max_in_flight);
+
+void trash_file_queue_trash(TrashFileQueue *self, GFile *file);
+
+guint trash_file_queue_get_pending(TrashFileQueue *self);
+
+G_END_DECLS
@@ -0,0 +1,486 @@
+/**
+ * SECTION:trashfilter
+ * @Short_description: Narrows the trash items down to a search query
+ * @Title: TrashFilter
+ *
+ * A #TrashFilter decides which items match what the user typed into the
+ * search entry. An item matches when the query appears anywhere in its
+ * display name or restore path, ignoring case. Both sides are compared
+ * as search keys made by trash_info_make_search_key(), which every
+ * #TrashInfo computes once when it is created.
+ *
+ * The matches for each query are kept on a stack as the query grows, so
+ * typing another character only checks the items that matched before,
+ * and deleting one goes back to a result that is already known. Items
+ * that come and go are added to or removed from every cached result.
+ *
+ * When there are a lot of items to check, the check runs on a worker
+ * thread and the previous result stays in place until it finishes. A new
+ * query cancels a check that is still running.
+ */
+
+#include "trash_filter.h"
+#include <string.h>
+
+/**
+ * The number of items to check above which the check is moved off the
+ * main thread.
+ */
+#define TRASH_FILTER_THREAD_THRESHOLD 10000
+
+/**
+ * How many items a worker thread checks between looking for cancellation.
+ */
+#define TRASH_FILTER_CANCEL_INTERVAL 1024
+
+enum {
+	CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+typedef struct {
+	gchar *query;
+
+	/* URI to TrashInfo; the key is owned by the value */
+	GHashTable *matches;
+} FilterLevel;
+
+typedef struct {
+	gchar *query;
+	GPtrArray *candidates;
+} FilterJob;
+
+struct _TrashFilter {
+	GObject parent_instance;
+
+	TrashManager *manager;
+
+	/* Each level's query contains the one below it; the top one is shown */
+	GPtrArray *levels;
+
+	/* A check running on a worker thread, and what changed meanwhile */
+	GCancellable *cancellable;
+	GPtrArray *pending_added;
+	GHashTable *pending_removed;
+};
+
+G_DEFINE_FINAL_TYPE(TrashFilter, trash_filter, G_TYPE_OBJECT)
+
+static FilterLevel *filter_level_new(const gchar *query) {
+	FilterLevel *level;
+
+	level = g_slice_new0(FilterLevel);
+	level->query = g_strdup(query);
+	level->matches = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_object_unref);
+
+	return level;
+}
+
+static void filter_level_free(gpointer data) {
+	FilterLevel *level = data;
+
+	g_free(level->query);
+	g_hash_table_unref(level->matches);
+	g_slice_free(FilterLevel, level);
+}
+
+static void filter_level_add(FilterLevel *level, TrashInfo *info) {
+	g_hash_table_replace(level->matches, (gpointer) trash_info_peek_uri(info), g_object_ref(info));
+}
+
+static void filter_job_free(gpointer data) {
+	FilterJob *job = data;
+
+	g_free(job->query);
+	g_ptr_array_unref(job->candidates);
+	g_slice_free(FilterJob, job);
+}
+
+/**
+ * Check whether an item matches a search key. glibc's strstr() compares
+ * many bytes at a time with SIMD instructions, which is what keeps this
+ * fast enough to run on every item.
+ */
+static gboolean info_matches(TrashInfo *info, const gchar *query) {
+	const gchar *name_key, *path_key;
+
+	name_key = trash_info_peek_name_key(info);
+	path_key = trash_info_peek_path_key(info);
+
+	return (name_key && strstr(name_key, query)) || (path_key && strstr(path_key, query));
+}
+
+static FilterLevel *top_level(TrashFilter *self) {
+	return self->levels->len > 0 ? g_ptr_array_index(self->levels, self->levels->len - 1) : NULL;
+}
+
+/**
+ * Drop the cached results that can't be narrowed down to @query.
+ */
+static void pop_levels(TrashFilter *self, const gchar *query) {
+	FilterLevel *level;
+
+	while ((level = top_level(self)) && !strstr(query, level->query)) {
+		g_ptr_array_remove_index(self->levels, self->levels->len - 1);
+	}
+}
+
+static void cancel_pending(TrashFilter *self) {
+	if (self->cancellable) {
+		g_cancellable_cancel(self->cancellable);
+		g_clear_object(&self->cancellable);
+	}
+
+	g_clear_pointer(&self->pending_added, g_ptr_array_unref);
+	g_clear_pointer(&self->pending_removed, g_hash_table_unref);
+}
+
+static void trash_added(TrashManager *manager, TrashInfo *info, TrashFilter *self) {
+	(void) manager;
+	FilterLevel *level;
+	guint i;
+
+	for (i = 0; i < self->levels->len; i++) {
+		level = g_ptr_array_index(self->levels, i);
+
+		if (!info_matches(info, level->query)) {
+			// Later levels are narrower, so they won't match either
+			break;
+		}
+
+		filter_level_add(level, info);
+	}
+
+	if (self->pending_added) {
+		g_ptr_array_add(self->pending_added, g_object_ref(info));
+	}
+}
+
+static void trash_removed(TrashManager *manager, const gchar *uri, TrashFilter *self) {
+	(void) manager;
+	FilterLevel *level;
+	guint i;
+
+	for (i = 0; i < self->levels->len; i++) {
+		level = g_ptr_array_index(self->levels, i);
+		g_hash_table_remove(level->matches, uri);
+	}
+
+	if (!self->pending_removed) {
+		return;
+	}
+
+	g_hash_table_add(self->pending_removed, g_strdup(uri));
+
+	// Something that was added and removed again doesn't need to be looked at
+	for (i = self->pending_added->len; i > 0; i--) {
+		if (g_strcmp0(trash_info_peek_uri(g_ptr_array_index(self->pending_added, i - 1)), uri) == 0) {
+			g_ptr_array_remove_index_fast(self->pending_added, i - 1);
+		}
+	}
+}
+
+static void trash_filter_dispose(GObject *object) {
+	TrashFilter *self;
+
+	self = TRASH_FILTER(object);
+
+	cancel_pending(self);
+
+	G_OBJECT_CLASS(trash_filter_parent_class)->dispose(object);
+}
+
+static void trash_filter_finalize(GObject *object) {
+	TrashFilter *self;
+
+	self = TRASH_FILTER(object);
+
+	g_ptr_array_unref(self->levels);
+	g_object_unref(self->manager);
+
+	G_OBJECT_CLASS(trash_filter_parent_class)->finalize(object);
+}
+
+static void trash_filter_class_init(TrashFilterClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_filter_dispose;
+	class->finalize = trash_filter_finalize;
+
+	// Signals
+
+	/**
+	 * TrashFilter::changed:
+	 * @self: a #TrashFilter
+	 *
+	 * Emitted when the result for a new query is ready, and the items that
+	 * match should be looked up again.
+	 */
+	signals[CHANGED] = g_signal_new(
+		"changed",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		0);
+}
+
+static void trash_filter_init(TrashFilter *self) {
+	self->levels = g_ptr_array_new_with_free_func(filter_level_free);
+}
+
+/**
+ * trash_filter_new:
+ * @manager: the #TrashManager with the items to filter
+ *
+ * Creates a new #TrashFilter that matches every item.
+ *
+ * The filter follows the items that @manager adds and removes, so it
+ * should be created before anything that asks it about new items is
+ * connected to @manager.
+ *
+ * Returns: (transfer full): a new #TrashFilter
+ */
+TrashFilter *trash_filter_new(TrashManager *manager) {
+	TrashFilter *self;
+
+	g_return_val_if_fail(TRASH_IS_MANAGER(manager), NULL);
+
+	self = g_object_new(TRASH_TYPE_FILTER, NULL);
+	self->manager = g_object_ref(manager);
+
+	g_signal_connect_object(manager, "trash-added", G_CALLBACK(trash_added), self, 0);
+	g_signal_connect_object(manager, "trash-removed", G_CALLBACK(trash_removed), self, 0);
+
+	return self;
+}
+
+/**
+ * Make @level the shown result, after bringing it up to date with
+ * anything that changed while it was being worked out.
+ */
+static void push_level(TrashFilter *self, FilterLevel *level) {
+	GHashTableIter iter;
+	gpointer uri;
+	TrashInfo *info;
+	guint i;
+
+	if (self->pending_removed) {
+		g_hash_table_iter_init(&iter, self->pending_removed);
+
+		while (g_hash_table_iter_next(&iter, &uri, NULL)) {
+			g_hash_table_remove(level->matches, uri);
+		}
+	}
+
+	if (self->pending_added) {
+		for (i = 0; i < self->pending_added->len; i++) {
+			info = g_ptr_array_index(self->pending_added, i);
+
+			if (info_matches(info, level->query)) {
+				filter_level_add(level, info);
+			}
+		}
+	}
+
+	pop_levels(self, level->query);
+	g_ptr_array_add(self->levels, level);
+
+	g_signal_emit(self, signals[CHANGED], 0);
+}
+
+static void filter_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	(void) source_object;
+	FilterJob *job = task_data;
+	GPtrArray *matches;
+	TrashInfo *info;
+	guint i;
+
+	matches = g_ptr_array_new();
+
+	for (i = 0; i < job->candidates->len; i++) {
+		if (i % TRASH_FILTER_CANCEL_INTERVAL == 0 && g_cancellable_is_cancelled(cancellable)) {
+			g_ptr_array_unref(matches);
+			g_task_return_error_if_cancelled(task);
+			return;
+		}
+
+		info = g_ptr_array_index(job->candidates, i);
+
+		if (info_matches(info, job->query)) {
+			g_ptr_array_add(matches, info);
+		}
+	}
+
+	g_task_return_pointer(task, matches, (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void filter_thread_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	(void) user_data;
+	TrashFilter *self = TRASH_FILTER(source);
+	g_autoptr(GPtrArray) matches = NULL;
+	FilterJob *job;
+	FilterLevel *level;
+	guint i;
+
+	matches = g_task_propagate_pointer(G_TASK(result), NULL);
+
+	// Cancelled because a newer query came along
+	if (!matches) {
+		return;
+	}
+
+	job = g_task_get_task_data(G_TASK(result));
+	level = filter_level_new(job->query);
+
+	// The candidates array still holds a reference to every match
+	for (i = 0; i < matches->len; i++) {
+		filter_level_add(level, g_ptr_array_index(matches, i));
+	}
+
+	push_level(self, level);
+
+	g_clear_object(&self->cancellable);
+	g_clear_pointer(&self->pending_added, g_ptr_array_unref);
+	g_clear_pointer(&self->pending_removed, g_hash_table_unref);
+}
+
+static void add_candidate(gpointer data, gpointer user_data) {
+	g_ptr_array_add(user_data, g_object_ref(data));
+}
+
+/**
+ * Work out the matches for @query, starting from the cached result that
+ * is the closest to it.
+ */
+static void narrow(TrashFilter *self, const gchar *query) {
+	g_autoptr(GTask) task = NULL;
+	GPtrArray *candidates;
+	FilterLevel *base = NULL;
+	FilterLevel *level;
+	FilterJob *job;
+	GHashTableIter iter;
+	gpointer value;
+	guint i;
+
+	for (i = self->levels->len; i > 0; i--) {
+		level = g_ptr_array_index(self->levels, i - 1);
+
+		if (strstr(query, level->query)) {
+			base = level;
+			break;
+		}
+	}
+
+	candidates = g_ptr_array_new_with_free_func(g_object_unref);
+
+	if (base) {
+		g_hash_table_iter_init(&iter, base->matches);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value)) {
+			g_ptr_array_add(candidates, g_object_ref(value));
+		}
+	} else {
+		trash_manager_foreach_item(self->manager, add_candidate, candidates);
+	}
+
+	if (candidates->len < TRASH_FILTER_THREAD_THRESHOLD) {
+		level = filter_level_new(query);
+
+		for (i = 0; i < candidates->len; i++) {
+			if (info_matches(g_ptr_array_index(candidates, i), query)) {
+				filter_level_add(level, g_ptr_array_index(candidates, i));
+			}
+		}
+
+		g_ptr_array_unref(candidates);
+		push_level(self, level);
+		return;
+	}
+
+	job = g_slice_new0(FilterJob);
+	job->query = g_strdup(query);
+	job->candidates = candidates;
+
+	self->cancellable = g_cancellable_new();
+	self->pending_added = g_ptr_array_new_with_free_func(g_object_unref);
+	self->pending_removed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	task = g_task_new(self, self->cancellable, filter_thread_cb, NULL);
+	g_task_set_source_tag(task, narrow);
+	g_task_set_task_data(task, job, filter_job_free);
+	g_task_run_in_thread(task, filter_thread);
+}
+
+/**
+ * trash_filter_set_query:
+ * @self: a #TrashFilter
+ * @text: (nullable): what to search for, or %NULL or an empty string to
+ *   match everything
+ *
+ * Changes what the filter searches for. #TrashFilter::changed is emitted
+ * once the new result is ready, which may be before this returns.
+ */
+void trash_filter_set_query(TrashFilter *self, const gchar *text) {
+	g_autofree gchar *stripped = NULL;
+	g_autofree gchar *query = NULL;
+	FilterLevel *level;
+	guint i;
+
+	g_return_if_fail(TRASH_IS_FILTER(self));
+
+	cancel_pending(self);
+
+	stripped = g_strstrip(g_strdup(text ? text : ""));
+	query = trash_info_make_search_key(stripped);
+
+	if (*query == '\0') {
+		if (self->levels->len > 0) {
+			g_ptr_array_set_size(self->levels, 0);
+			g_signal_emit(self, signals[CHANGED], 0);
+		}
+
+		return;
+	}
+
+	for (i = self->levels->len; i > 0; i--) {
+		level = g_ptr_array_index(self->levels, i - 1);
+
+		if (g_strcmp0(level->query, query) != 0) {
+			continue;
+		}
+
+		// Going back to a shorter query that we already have the result for
+		if (i < self->levels->len) {
+			g_ptr_array_set_size(self->levels, i);
+			g_signal_emit(self, signals[CHANGED], 0);
+		}
+
+		return;
+	}
+
+	narrow(self, query);
+}
+
+/**
+ * trash_filter_matches:
+ * @self: a #TrashFilter
+ * @info: a #TrashInfo
+ *
+ * Checks whether an item should be shown for the current query.
+ *
+ * Returns: %TRUE if @info matches
+ */
+gboolean trash_filter_matches(TrashFilter *self, TrashInfo *info) {
+	FilterLevel *top;
+
+	g_return_val_if_fail(TRASH_IS_FILTER(self), TRUE);
+
+	top = top_level(self);
+
+	return !top || g_hash_table_contains(top->matches, trash_info_peek_uri(info));
+}
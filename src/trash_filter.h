@@ -0,0 +1,19 @@
+#pragma once
+
+#include "trash_info.h"
+#include "trash_manager.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_FILTER (trash_filter_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashFilter, trash_filter, TRASH, FILTER, GObject)
+
+TrashFilter *trash_filter_new(TrashManager *manager);
+
+void trash_filter_set_query(TrashFilter *self, const gchar *text);
+
+gboolean trash_filter_matches(TrashFilter *self, TrashInfo *info);
+
+G_END_DECLS
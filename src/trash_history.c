@@ -0,0 +1,371 @@
+/**
+ * SECTION:trashhistory
+ * @Short_description: Remembers how full the trash bin has been over time
+ * @Title: Trash history
+ *
+ * A #TrashHistory keeps samples of the item count and total size of the
+ * trash bin in a few fixed-size ring buffers, each at a coarser
+ * resolution than the one before: every five minutes for a day, every
+ * hour for two weeks, and every day for a year. A new sample is only
+ * stored when the values change, and a change within the same period as
+ * the last sample replaces it, so older history is kept at lower detail
+ * and the memory used never grows.
+ *
+ * The history can be written out with trash_history_serialize() and read
+ * back with trash_history_load(). The file starts with the magic `BTHS`
+ * and a version byte, followed by the number of rings. Each ring has its
+ * resolution in seconds and its sample count, and then the samples from
+ * oldest to newest as the seconds since the previous sample, the item
+ * count and the size. Numbers are stored as LEB128 varints, with the
+ * time deltas zigzag encoded.
+ */
+
+#include "trash_history.h"
+#include <gio/gio.h>
+#include <string.h>
+
+#define TRASH_HISTORY_MAGIC "BTHS"
+
+#define TRASH_HISTORY_VERSION 1
+
+typedef struct {
+	gint64 resolution;
+	guint capacity;
+} RingSpec;
+
+static const RingSpec ring_specs[] = {
+	{5 * 60, 24 * 12},
+	{60 * 60, 14 * 24},
+	{24 * 60 * 60, 365},
+};
+
+#define N_RINGS G_N_ELEMENTS(ring_specs)
+
+typedef struct {
+	TrashHistorySample *samples;
+	guint start;
+	guint length;
+} Ring;
+
+struct _TrashHistory {
+	Ring rings[N_RINGS];
+};
+
+typedef struct {
+	const guint8 *data;
+	gsize length;
+	gsize offset;
+} HistoryReader;
+
+static TrashHistorySample *ring_get(TrashHistory *self, guint ring, guint index) {
+	Ring *r = &self->rings[ring];
+
+	return &r->samples[(r->start + index) % ring_specs[ring].capacity];
+}
+
+static void ring_push(TrashHistory *self, guint ring, const TrashHistorySample *sample) {
+	Ring *r = &self->rings[ring];
+
+	if (r->length < ring_specs[ring].capacity) {
+		r->length++;
+	} else {
+		r->start = (r->start + 1) % ring_specs[ring].capacity;
+	}
+
+	*ring_get(self, ring, r->length - 1) = *sample;
+}
+
+/**
+ * trash_history_new:
+ *
+ * Creates a new, empty history.
+ *
+ * Returns: (transfer full): a new #TrashHistory
+ */
+TrashHistory *trash_history_new(void) {
+	TrashHistory *self;
+	guint i;
+
+	self = g_slice_new0(TrashHistory);
+
+	for (i = 0; i < N_RINGS; i++) {
+		self->rings[i].samples = g_new0(TrashHistorySample, ring_specs[i].capacity);
+	}
+
+	return self;
+}
+
+/**
+ * trash_history_free:
+ * @self: (transfer full): a #TrashHistory
+ *
+ * Frees a history.
+ */
+void trash_history_free(TrashHistory *self) {
+	guint i;
+
+	if (!self) {
+		return;
+	}
+
+	for (i = 0; i < N_RINGS; i++) {
+		g_free(self->rings[i].samples);
+	}
+
+	g_slice_free(TrashHistory, self);
+}
+
+/**
+ * trash_history_record:
+ * @self: a #TrashHistory
+ * @time: the current time, in seconds since the epoch
+ * @items: the number of items in the trash bin
+ * @bytes: the combined size of the items
+ *
+ * Records how full the trash bin is now. This is cheap enough to call on
+ * every change.
+ *
+ * Returns: %TRUE if anything was stored, or %FALSE if nothing changed
+ *   since the last sample
+ */
+gboolean trash_history_record(TrashHistory *self, gint64 time, guint items, guint64 bytes) {
+	TrashHistorySample sample = {time, items, bytes};
+	TrashHistorySample *last;
+	gboolean changed = FALSE;
+	guint i;
+
+	g_return_val_if_fail(self != NULL, FALSE);
+
+	for (i = 0; i < N_RINGS; i++) {
+		last = self->rings[i].length > 0 ? ring_get(self, i, self->rings[i].length - 1) : NULL;
+
+		if (last && last->items == items && last->bytes == bytes) {
+			continue;
+		}
+
+		changed = TRUE;
+
+		// Still in the same period, or the clock went back
+		if (last && time / ring_specs[i].resolution <= last->time / ring_specs[i].resolution) {
+			last->items = items;
+			last->bytes = bytes;
+			last->time = MAX(last->time, time);
+			continue;
+		}
+
+		ring_push(self, i, &sample);
+	}
+
+	return changed;
+}
+
+/**
+ * trash_history_get_samples:
+ * @self: a #TrashHistory
+ * @since: the earliest time of interest, in seconds since the epoch
+ *
+ * Gets the samples from @since onwards, from the most detailed ring that
+ * still goes back that far. The values hold until the next sample, so the
+ * first sample may be from before @since, to give the value at @since.
+ *
+ * Returns: (transfer full) (element-type TrashHistorySample): the
+ *   samples, oldest first
+ */
+GArray *trash_history_get_samples(TrashHistory *self, gint64 since) {
+	GArray *samples;
+	Ring *r = NULL;
+	guint ring, i, first;
+
+	g_return_val_if_fail(self != NULL, NULL);
+
+	samples = g_array_new(FALSE, FALSE, sizeof(TrashHistorySample));
+
+	for (ring = 0; ring < N_RINGS; ring++) {
+		r = &self->rings[ring];
+
+		// A ring that hasn't wrapped yet has everything there is
+		if (r->length < ring_specs[ring].capacity || ring_get(self, ring, 0)->time <= since || ring == N_RINGS - 1) {
+			break;
+		}
+	}
+
+	if (r->length == 0) {
+		return samples;
+	}
+
+	first = 0;
+
+	for (i = 0; i < r->length && ring_get(self, ring, i)->time <= since; i++) {
+		first = i;
+	}
+
+	for (i = first; i < r->length; i++) {
+		g_array_append_val(samples, *ring_get(self, ring, i));
+	}
+
+	return samples;
+}
+
+static void write_varint(GByteArray *buffer, guint64 value) {
+	guint8 byte;
+
+	while (value >= 0x80) {
+		byte = (guint8) ((value & 0x7f) | 0x80);
+		g_byte_array_append(buffer, &byte, 1);
+		value >>= 7;
+	}
+
+	byte = (guint8) value;
+	g_byte_array_append(buffer, &byte, 1);
+}
+
+/**
+ * trash_history_serialize:
+ * @self: a #TrashHistory
+ *
+ * Encodes the history to be written to disk and read back later with
+ * trash_history_load(). It comes to a few kilobytes at most.
+ *
+ * Returns: (transfer full): the encoded history
+ */
+GBytes *trash_history_serialize(TrashHistory *self) {
+	GByteArray *buffer;
+	TrashHistorySample *sample;
+	gint64 previous, delta;
+	guint8 byte;
+	guint ring, i;
+
+	g_return_val_if_fail(self != NULL, NULL);
+
+	buffer = g_byte_array_new();
+	g_byte_array_append(buffer, (const guint8 *) TRASH_HISTORY_MAGIC, strlen(TRASH_HISTORY_MAGIC));
+
+	byte = TRASH_HISTORY_VERSION;
+	g_byte_array_append(buffer, &byte, 1);
+	write_varint(buffer, N_RINGS);
+
+	for (ring = 0; ring < N_RINGS; ring++) {
+		write_varint(buffer, (guint64) ring_specs[ring].resolution);
+		write_varint(buffer, self->rings[ring].length);
+
+		previous = 0;
+
+		for (i = 0; i < self->rings[ring].length; i++) {
+			sample = ring_get(self, ring, i);
+			delta = sample->time - previous;
+			previous = sample->time;
+
+			write_varint(buffer, ((guint64) delta << 1) ^ (guint64) (delta >> 63));
+			write_varint(buffer, sample->items);
+			write_varint(buffer, sample->bytes);
+		}
+	}
+
+	return g_byte_array_free_to_bytes(buffer);
+}
+
+static gboolean read_varint(HistoryReader *reader, guint64 *value) {
+	guint64 result = 0;
+	guint shift = 0;
+	guint8 byte;
+
+	do {
+		if (shift > 63 || reader->offset >= reader->length) {
+			return FALSE;
+		}
+
+		byte = reader->data[reader->offset++];
+		result |= (guint64) (byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	*value = result;
+
+	return TRUE;
+}
+
+static gboolean read_ring(HistoryReader *reader, TrashHistory *history, guint ring) {
+	TrashHistorySample sample;
+	guint64 resolution, length, delta, items;
+	gint64 time = 0;
+	guint i;
+
+	if (!read_varint(reader, &resolution) || !read_varint(reader, &length)) {
+		return FALSE;
+	}
+
+	if ((gint64) resolution != ring_specs[ring].resolution || length > ring_specs[ring].capacity) {
+		return FALSE;
+	}
+
+	for (i = 0; i < length; i++) {
+		if (!read_varint(reader, &delta) || !read_varint(reader, &items) || !read_varint(reader, &sample.bytes)) {
+			return FALSE;
+		}
+
+		time += (gint64) (delta >> 1) ^ -(gint64) (delta & 1);
+		sample.time = time;
+		sample.items = (guint) items;
+
+		ring_push(history, ring, &sample);
+	}
+
+	return TRUE;
+}
+
+/**
+ * trash_history_load:
+ * @path: the file to read
+ * @error: return location for a #GError
+ *
+ * Reads a history written out with trash_history_serialize().
+ *
+ * Returns: (transfer full) (nullable): the history, or %NULL on error
+ */
+TrashHistory *trash_history_load(const gchar *path, GError **error) {
+	g_autofree gchar *contents = NULL;
+	g_autoptr(TrashHistory) history = NULL;
+	HistoryReader reader;
+	gsize length;
+	gsize magic_length;
+	guint64 rings;
+	guint ring;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	if (!g_file_get_contents(path, &contents, &length, error)) {
+		return NULL;
+	}
+
+	magic_length = strlen(TRASH_HISTORY_MAGIC);
+
+	if (length <= magic_length || memcmp(contents, TRASH_HISTORY_MAGIC, magic_length) != 0) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "'%s' is not a trash history", path);
+		return NULL;
+	}
+
+	if ((guint8) contents[magic_length] != TRASH_HISTORY_VERSION) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Trash history '%s' has unsupported version %u", path, (guint8) contents[magic_length]);
+		return NULL;
+	}
+
+	reader.data = (const guint8 *) contents;
+	reader.length = length;
+	reader.offset = magic_length + 1;
+
+	history = trash_history_new();
+
+	if (!read_varint(&reader, &rings) || rings != N_RINGS) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Trash history '%s' has a different layout", path);
+		return NULL;
+	}
+
+	for (ring = 0; ring < N_RINGS; ring++) {
+		if (!read_ring(&reader, history, ring)) {
+			g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Trash history '%s' is corrupt at byte %" G_GSIZE_FORMAT, path, reader.offset);
+			return NULL;
+		}
+	}
+
+	return g_steal_pointer(&history);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * TrashHistorySample:
+ * @time: when the sample was taken, in seconds since the epoch
+ * @items: the number of items in the trash bin
+ * @bytes: the combined size of the items
+ *
+ * How full the trash bin was at one point in time.
+ */
+typedef struct {
+	gint64 time;
+	guint items;
+	guint64 bytes;
+} TrashHistorySample;
+
+typedef struct _TrashHistory TrashHistory;
+
+TrashHistory *trash_history_new(void);
+
+void trash_history_free(TrashHistory *self);
+
+gboolean trash_history_record(TrashHistory *self, gint64 time, guint items, guint64 bytes);
+
+GArray *trash_history_get_samples(TrashHistory *self, gint64 since);
+
+GBytes *trash_history_serialize(TrashHistory *self);
+
+TrashHistory *trash_history_load(const gchar *path, GError **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(TrashHistory, trash_history_free)
+
+G_END_DECLS
@@ -0,0 +1,373 @@
+/**
+ * SECTION:trashicon
+ * @Short_description: The trash icon shown in the panel
+ * @Title: TrashIcon
+ *
+ * The #TrashIcon widget is the icon on the applet's panel button. It
+ * shows an empty or a full trash bin, and can have a badge with the
+ * number of items or a bar showing how close the trash bin is to its size
+ * limit, see #TrashBadgeMode.
+ *
+ * New counts can be passed in as often as they change. They are only
+ * looked at once per frame, the icon is only changed when the trash bin
+ * goes from empty to full or back, and the badge is drawn into a cached
+ * surface that is only redrawn when what it shows changes.
+ */
+
+#include "trash_icon.h"
+
+/**
+ * Badges show counts up to this, and a plus sign past it.
+ */
+#define TRASH_ICON_MAX_COUNT 999
+
+typedef enum {
+	TRASH_ICON_EMPTY,
+	TRASH_ICON_FULL,
+} TrashIconState;
+
+struct _TrashIcon {
+	GtkImage parent_instance;
+
+	TrashIconState state;
+	TrashBadgeMode badge_mode;
+	guint64 capacity;
+
+	/* The latest counts, applied on the next frame */
+	guint items;
+	guint64 bytes;
+	guint tick_id;
+
+	/* What the badge shows: the item count, or the fill level in tenths
+	 * of a percent, or -1 for no badge */
+	gint badge_value;
+
+	cairo_surface_t *badge;
+	gint badge_width;
+	gint badge_height;
+	gint badge_scale;
+};
+
+G_DEFINE_FINAL_TYPE(TrashIcon, trash_icon, GTK_TYPE_IMAGE)
+
+static gint get_badge_value(TrashIcon *self) {
+	switch (self->badge_mode) {
+		case TRASH_BADGE_COUNT:
+			return self->items > 0 ? (gint) MIN(self->items, TRASH_ICON_MAX_COUNT + 1) : -1;
+		case TRASH_BADGE_FILL:
+			if (self->capacity == 0 || self->bytes == 0) {
+				return -1;
+			}
+
+			return (gint) MIN((gdouble) self->bytes * 1000 / (gdouble) self->capacity, 1000);
+		default:
+			return -1;
+	}
+}
+
+/**
+ * Bring the icon and the badge up to date with the latest counts.
+ */
+static void apply_counts(TrashIcon *self) {
+	TrashIconState state;
+	gint badge_value;
+
+	state = self->items > 0 ? TRASH_ICON_FULL : TRASH_ICON_EMPTY;
+
+	if (state != self->state) {
+		self->state = state;
+		gtk_image_set_from_icon_name(GTK_IMAGE(self), state == TRASH_ICON_FULL ? "user-trash-full-symbolic" : "user-trash-symbolic", GTK_ICON_SIZE_MENU);
+	}
+
+	badge_value = get_badge_value(self);
+
+	if (badge_value != self->badge_value) {
+		self->badge_value = badge_value;
+		g_clear_pointer(&self->badge, cairo_surface_destroy);
+		gtk_widget_queue_draw(GTK_WIDGET(self));
+	}
+}
+
+static gboolean apply_counts_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer user_data) {
+	(void) clock;
+	(void) user_data;
+	TrashIcon *self = TRASH_ICON(widget);
+
+	self->tick_id = 0;
+	apply_counts(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Apply the counts on the next frame, or right away if we aren't on
+ * screen and there won't be one.
+ */
+static void schedule_update(TrashIcon *self) {
+	if (self->tick_id != 0) {
+		return;
+	}
+
+	if (!gtk_widget_get_realized(GTK_WIDGET(self))) {
+		apply_counts(self);
+		return;
+	}
+
+	self->tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(self), apply_counts_tick, NULL, NULL);
+}
+
+static void get_color(GtkStyleContext *context, const gchar *name, const gchar *fallback, GdkRGBA *color) {
+	if (!gtk_style_context_lookup_color(context, name, color)) {
+		gdk_rgba_parse(color, fallback);
+	}
+}
+
+static void draw_count(TrashIcon *self, cairo_t *cr, gint width, gint height) {
+	g_autofree gchar *text = NULL;
+	PangoLayout *layout;
+	PangoFontDescription *font;
+	PangoRectangle extents;
+	GtkStyleContext *context;
+	GdkRGBA background, foreground;
+	gdouble x, y, w, h;
+
+	if (self->badge_value > TRASH_ICON_MAX_COUNT) {
+		text = g_strdup_printf("%d+", TRASH_ICON_MAX_COUNT);
+	} else {
+		text = g_strdup_printf("%d", self->badge_value);
+	}
+
+	layout = gtk_widget_create_pango_layout(GTK_WIDGET(self), text);
+
+	font = pango_font_description_new();
+	pango_font_description_set_weight(font, PANGO_WEIGHT_BOLD);
+	pango_font_description_set_absolute_size(font, height * 0.45 * PANGO_SCALE);
+	pango_layout_set_font_description(layout, font);
+	pango_font_description_free(font);
+
+	pango_layout_get_pixel_extents(layout, NULL, &extents);
+
+	h = extents.height;
+	w = MAX(extents.width + h / 2, h);
+	x = width - w;
+	y = height - h;
+
+	context = gtk_widget_get_style_context(GTK_WIDGET(self));
+	get_color(context, "theme_selected_bg_color", "#3584e4", &background);
+	get_color(context, "theme_selected_fg_color", "#ffffff", &foreground);
+
+	// A pill with round ends
+	cairo_new_sub_path(cr);
+	cairo_arc(cr, x + h / 2, y + h / 2, h / 2, G_PI / 2, 3 * G_PI / 2);
+	cairo_arc(cr, x + w - h / 2, y + h / 2, h / 2, 3 * G_PI / 2, G_PI / 2);
+	cairo_close_path(cr);
+	gdk_cairo_set_source_rgba(cr, &background);
+	cairo_fill(cr);
+
+	gdk_cairo_set_source_rgba(cr, &foreground);
+	cairo_move_to(cr, x + (w - extents.width) / 2 - extents.x, y - extents.y);
+	pango_cairo_show_layout(cr, layout);
+
+	g_object_unref(layout);
+}
+
+static void draw_fill(TrashIcon *self, cairo_t *cr, gint width, gint height) {
+	GtkStyleContext *context;
+	GdkRGBA track, level;
+	gint bar_height;
+
+	context = gtk_widget_get_style_context(GTK_WIDGET(self));
+	gtk_style_context_get_color(context, gtk_style_context_get_state(context), &track);
+	track.alpha *= 0.3;
+
+	// Red once the trash bin is at its limit
+	if (self->badge_value >= 1000) {
+		get_color(context, "error_color", "#e01b24", &level);
+	} else {
+		get_color(context, "theme_selected_bg_color", "#3584e4", &level);
+	}
+
+	bar_height = MAX(2, height / 8);
+
+	gdk_cairo_set_source_rgba(cr, &track);
+	cairo_rectangle(cr, 0, height - bar_height, width, bar_height);
+	cairo_fill(cr);
+
+	gdk_cairo_set_source_rgba(cr, &level);
+	cairo_rectangle(cr, 0, height - bar_height, width * self->badge_value / 1000.0, bar_height);
+	cairo_fill(cr);
+}
+
+/**
+ * Draw the badge into a surface the size of the widget, to be painted
+ * over the icon until the badge changes.
+ */
+static cairo_surface_t *render_badge(TrashIcon *self, gint width, gint height, gint scale) {
+	cairo_surface_t *surface;
+	cairo_t *cr;
+
+	surface = gdk_window_create_similar_image_surface(gtk_widget_get_window(GTK_WIDGET(self)), CAIRO_FORMAT_ARGB32, width, height, scale);
+	cr = cairo_create(surface);
+
+	if (self->badge_mode == TRASH_BADGE_FILL) {
+		draw_fill(self, cr, width, height);
+	} else {
+		draw_count(self, cr, width, height);
+	}
+
+	cairo_destroy(cr);
+
+	self->badge_width = width;
+	self->badge_height = height;
+	self->badge_scale = scale;
+
+	return surface;
+}
+
+static gboolean trash_icon_draw(GtkWidget *widget, cairo_t *cr) {
+	TrashIcon *self = TRASH_ICON(widget);
+	gint width, height, scale;
+
+	GTK_WIDGET_CLASS(trash_icon_parent_class)->draw(widget, cr);
+
+	if (self->badge_value < 0) {
+		return FALSE;
+	}
+
+	width = gtk_widget_get_allocated_width(widget);
+	height = gtk_widget_get_allocated_height(widget);
+	scale = gtk_widget_get_scale_factor(widget);
+
+	if (self->badge && (self->badge_width != width || self->badge_height != height || self->badge_scale != scale)) {
+		g_clear_pointer(&self->badge, cairo_surface_destroy);
+	}
+
+	if (!self->badge) {
+		self->badge = render_badge(self, width, height, scale);
+	}
+
+	cairo_set_source_surface(cr, self->badge, 0, 0);
+	cairo_paint(cr);
+
+	return FALSE;
+}
+
+static void trash_icon_style_updated(GtkWidget *widget) {
+	TrashIcon *self = TRASH_ICON(widget);
+
+	GTK_WIDGET_CLASS(trash_icon_parent_class)->style_updated(widget);
+
+	// The badge uses theme colors
+	g_clear_pointer(&self->badge, cairo_surface_destroy);
+}
+
+static void trash_icon_unrealize(GtkWidget *widget) {
+	TrashIcon *self = TRASH_ICON(widget);
+
+	if (self->tick_id != 0) {
+		gtk_widget_remove_tick_callback(widget, self->tick_id);
+		self->tick_id = 0;
+		apply_counts(self);
+	}
+
+	g_clear_pointer(&self->badge, cairo_surface_destroy);
+
+	GTK_WIDGET_CLASS(trash_icon_parent_class)->unrealize(widget);
+}
+
+static void trash_icon_finalize(GObject *object) {
+	TrashIcon *self = TRASH_ICON(object);
+
+	g_clear_pointer(&self->badge, cairo_surface_destroy);
+
+	G_OBJECT_CLASS(trash_icon_parent_class)->finalize(object);
+}
+
+static void trash_icon_class_init(TrashIconClass *klass) {
+	GObjectClass *class;
+	GtkWidgetClass *widget_class;
+
+	class = G_OBJECT_CLASS(klass);
+	widget_class = GTK_WIDGET_CLASS(klass);
+
+	class->finalize = trash_icon_finalize;
+
+	widget_class->draw = trash_icon_draw;
+	widget_class->style_updated = trash_icon_style_updated;
+	widget_class->unrealize = trash_icon_unrealize;
+}
+
+static void trash_icon_init(TrashIcon *self) {
+	self->state = TRASH_ICON_EMPTY;
+	self->badge_mode = TRASH_BADGE_NONE;
+	self->badge_value = -1;
+
+	gtk_image_set_from_icon_name(GTK_IMAGE(self), "user-trash-symbolic", GTK_ICON_SIZE_MENU);
+}
+
+/**
+ * trash_icon_new:
+ *
+ * Creates a new #TrashIcon showing an empty trash bin.
+ *
+ * Returns: a new #TrashIcon
+ */
+TrashIcon *trash_icon_new(void) {
+	return g_object_new(TRASH_TYPE_ICON, NULL);
+}
+
+/**
+ * trash_icon_set_counts:
+ * @self: a #TrashIcon
+ * @items: the number of items in the trash bin
+ * @bytes: the combined size of the items
+ *
+ * Updates the icon and badge for the current contents of the trash bin,
+ * on the next frame. This is cheap enough to call for every item.
+ */
+void trash_icon_set_counts(TrashIcon *self, guint items, guint64 bytes) {
+	g_return_if_fail(TRASH_IS_ICON(self));
+
+	self->items = items;
+	self->bytes = bytes;
+
+	schedule_update(self);
+}
+
+/**
+ * trash_icon_set_badge_mode:
+ * @self: a #TrashIcon
+ * @mode: what the badge should show
+ *
+ * Sets what the badge on the icon shows, if anything.
+ */
+void trash_icon_set_badge_mode(TrashIcon *self, TrashBadgeMode mode) {
+	g_return_if_fail(TRASH_IS_ICON(self));
+
+	if (mode == self->badge_mode) {
+		return;
+	}
+
+	self->badge_mode = mode;
+	self->badge_value = -1;
+	g_clear_pointer(&self->badge, cairo_surface_destroy);
+	gtk_widget_queue_draw(GTK_WIDGET(self));
+
+	schedule_update(self);
+}
+
+/**
+ * trash_icon_set_capacity:
+ * @self: a #TrashIcon
+ * @capacity: the size limit of the trash bin in bytes, or 0 for none
+ *
+ * Sets the size that counts as a full trash bin for %TRASH_BADGE_FILL.
+ * Without a limit, that badge isn't shown.
+ */
+void trash_icon_set_capacity(TrashIcon *self, guint64 capacity) {
+	g_return_if_fail(TRASH_IS_ICON(self));
+
+	self->capacity = capacity;
+
+	schedule_update(self);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "trash_settings.h"
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_ICON (trash_icon_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashIcon, trash_icon, TRASH, ICON, GtkImage)
+
+TrashIcon *trash_icon_new(void);
+
+void trash_icon_set_counts(TrashIcon *self, guint items, guint64 bytes);
+
+void trash_icon_set_badge_mode(TrashIcon *self, TrashBadgeMode mode);
+
+void trash_icon_set_capacity(TrashIcon *self, guint64 capacity);
+
+G_END_DECLS
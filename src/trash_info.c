@@ -5,10 +5,13 @@ enum {
 	PROP_DISPLAY_NAME,
 	PROP_URI,
 	PROP_RESTORE_PATH,
+	PROP_TARGET_PATH,
 	PROP_ICON,
 	PROP_SIZE,
+	PROP_ALLOCATED_SIZE,
 	PROP_IS_DIR,
 	PROP_DELETION_TIME,
+	PROP_MODIFIED_TIME,
 	LAST_PROP
 };
 
@@ -23,13 +26,24 @@ struct _TrashInfo {
 	const gchar *display_name;
 	const gchar *uri;
 	const gchar *restore_path;
+	const gchar *target_path;
+
+	/* Precomputed so that sorting never has to collate the name itself */
+	gchar *collate_key;
+
+	/* Case-folded copies of the display name and restore path for searching */
+	gchar *name_key;
+	gchar *path_key;
 
 	GIcon *icon;
 
 	goffset size;
+	guint64 allocated_size;
 	gboolean is_directory;
 
 	GDateTime *deleted_time;
+	gint64 deletion_timestamp;
+	gint64 modified_time;
 };
 
 G_DEFINE_FINAL_TYPE(TrashInfo, trash_info, G_TYPE_OBJECT);
@@ -43,8 +57,12 @@ static void trash_info_finalize(GObject *obj) {
 	g_free((gchar *) self->display_name);
 	g_free((gchar *) self->uri);
 	g_free((gchar *) self->restore_path);
-	g_object_unref(self->icon);
-	g_date_time_unref(self->deleted_time);
+	g_free((gchar *) self->target_path);
+	g_free(self->collate_key);
+	g_free(self->name_key);
+	g_free(self->path_key);
+	g_clear_object(&self->icon);
+	g_clear_pointer(&self->deleted_time, g_date_time_unref);
 
 	G_OBJECT_CLASS(trash_info_parent_class)->finalize(obj);
 }
@@ -57,30 +75,39 @@ static void trash_info_get_property(GObject *obj, guint prop_id, GValue *value,
 
 	switch (prop_id) {
 		case PROP_NAME:
-			g_value_set_string(value, trash_info_get_name(self));
+			g_value_set_string(value, self->name);
 			break;
 		case PROP_DISPLAY_NAME:
-			g_value_set_string(value, trash_info_get_display_name(self));
+			g_value_set_string(value, self->display_name);
 			break;
 		case PROP_URI:
-			g_value_set_string(value, trash_info_get_uri(self));
+			g_value_set_string(value, self->uri);
 			break;
 		case PROP_RESTORE_PATH:
-			g_value_set_string(value, trash_info_get_restore_path(self));
+			g_value_set_string(value, self->restore_path);
+			break;
+		case PROP_TARGET_PATH:
+			g_value_set_string(value, self->target_path);
 			break;
 		case PROP_ICON:
-			icon = trash_info_get_icon(self);
-			g_value_set_variant(value, g_icon_serialize(icon));
+			icon = self->icon;
+			g_value_take_variant(value, icon ? g_icon_serialize(icon) : NULL);
 			break;
 		case PROP_SIZE:
 			g_value_set_uint64(value, self->size);
 			break;
+		case PROP_ALLOCATED_SIZE:
+			g_value_set_uint64(value, self->allocated_size);
+			break;
 		case PROP_IS_DIR:
 			g_value_set_boolean(value, self->is_directory);
 			break;
 		case PROP_DELETION_TIME:
 			g_value_set_pointer(value, trash_info_get_deletion_time(self));
 			break;
+		case PROP_MODIFIED_TIME:
+			g_value_set_int64(value, self->modified_time);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, spec);
 			break;
@@ -96,16 +123,22 @@ static void trash_info_set_property(GObject *obj, guint prop_id, const GValue *v
 
 	switch (prop_id) {
 		case PROP_NAME:
-			self->name = g_value_get_string(value);
+			self->name = g_value_dup_string(value);
+			self->collate_key = self->name ? g_utf8_collate_key(self->name, -1) : NULL;
 			break;
 		case PROP_DISPLAY_NAME:
-			self->display_name = g_value_get_string(value);
+			self->display_name = g_value_dup_string(value);
+			self->name_key = trash_info_make_search_key(self->display_name);
 			break;
 		case PROP_URI:
-			self->uri = g_value_get_string(value);
+			self->uri = g_value_dup_string(value);
 			break;
 		case PROP_RESTORE_PATH:
-			self->restore_path = g_value_get_string(value);
+			self->restore_path = g_value_dup_string(value);
+			self->path_key = trash_info_make_search_key(self->restore_path);
+			break;
+		case PROP_TARGET_PATH:
+			self->target_path = g_value_dup_string(value);
 			break;
 		case PROP_ICON:
 			raw_icon = g_value_get_variant(value);
@@ -114,12 +147,19 @@ static void trash_info_set_property(GObject *obj, guint prop_id, const GValue *v
 		case PROP_SIZE:
 			self->size = g_value_get_uint64(value);
 			break;
+		case PROP_ALLOCATED_SIZE:
+			self->allocated_size = g_value_get_uint64(value);
+			break;
 		case PROP_IS_DIR:
 			self->is_directory = g_value_get_boolean(value);
 			break;
 		case PROP_DELETION_TIME:
 			date_pointer = g_value_get_pointer(value);
 			self->deleted_time = (GDateTime *) date_pointer;
+			self->deletion_timestamp = self->deleted_time ? g_date_time_to_unix(self->deleted_time) * G_USEC_PER_SEC + g_date_time_get_microsecond(self->deleted_time) : 0;
+			break;
+		case PROP_MODIFIED_TIME:
+			self->modified_time = g_value_get_int64(value);
 			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, prop_id, spec);
@@ -161,6 +201,13 @@ static void trash_info_class_init(TrashInfoClass *klazz) {
 		NULL,
 		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+	props[PROP_TARGET_PATH] = g_param_spec_string(
+		"target-path",
+		"target path",
+		"Where the trashed file is stored on disk",
+		NULL,
+		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
 	props[PROP_ICON] = g_param_spec_variant(
 		"icon",
 		"file icon",
@@ -178,6 +225,15 @@ static void trash_info_class_init(TrashInfoClass *klazz) {
 		0,
 		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+	props[PROP_ALLOCATED_SIZE] = g_param_spec_uint64(
+		"allocated-size",
+		"allocated size",
+		"The space allocated for the file on disk",
+		0,
+		G_MAXUINT64,
+		0,
+		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
 	props[PROP_IS_DIR] = g_param_spec_boolean(
 		"is-dir",
 		"is directory",
@@ -191,6 +247,15 @@ static void trash_info_class_init(TrashInfoClass *klazz) {
 		"The timestamp of when the file was deleted",
 		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+	props[PROP_MODIFIED_TIME] = g_param_spec_int64(
+		"modified-time",
+		"modified time",
+		"The modification time of the file in microseconds since the epoch",
+		0,
+		G_MAXINT64,
+		0,
+		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties(class, LAST_PROP, props);
 }
 
@@ -201,30 +266,71 @@ static void trash_info_init(TrashInfo *self) {
 /**
  * trash_info_new:
  * @info: a #GFileInfo
- * @uri: (transfer full): a URI to the file
+ * @uri: (transfer none): a URI to the file
  *
  * Creates a new #TrashInfo object.
  *
  * Returns: a new #TrashInfo object
  */
 TrashInfo *trash_info_new(GFileInfo *info, const gchar *uri) {
-	GIcon *icon;
+	g_autoptr(GVariant) icon = NULL;
+	g_autofree gchar *target_path = NULL;
+	const gchar *target_uri;
+	gint64 modified_time;
+	guint64 allocated_size;
+
+	icon = g_icon_serialize(g_file_info_get_icon(info));
+	modified_time = trash_info_get_modified_time_from_file_info(info);
+
+	// Not every backend can tell how much space a file really takes up
+	if (g_file_info_has_attribute(info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE)) {
+		allocated_size = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE);
+	} else {
+		allocated_size = (guint64) g_file_info_get_size(info);
+	}
 
-	icon = g_file_info_get_icon(info);
+	// Backends that keep the trash on a local disk say where the file is
+	target_uri = g_file_info_get_attribute_string(info, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI);
+
+	if (target_uri) {
+		target_path = g_filename_from_uri(target_uri, NULL, NULL);
+	}
 
 	return g_object_new(
 		TRASH_TYPE_INFO,
-		"name", g_strdup(g_file_info_get_name(info)),
-		"display-name", g_strdup(g_file_info_get_display_name(info)),
-		"uri", g_strdup(uri),
-		"restore-path", g_strdup(g_file_info_get_attribute_byte_string(info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH)),
-		"icon", g_icon_serialize(g_object_ref(icon)),
+		"name", g_file_info_get_name(info),
+		"display-name", g_file_info_get_display_name(info),
+		"uri", uri,
+		"restore-path", g_file_info_get_attribute_byte_string(info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH),
+		"target-path", target_path,
+		"icon", icon,
 		"size", g_file_info_get_size(info),
+		"allocated-size", allocated_size,
 		"is-dir", (g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY),
-		"deletion-time", g_date_time_ref(g_file_info_get_deletion_date(info)),
+		"deletion-time", g_file_info_get_deletion_date(info),
+		"modified-time", modified_time,
 		NULL);
 }
 
+/**
+ * trash_info_get_modified_time_from_file_info:
+ * @info: a #GFileInfo
+ *
+ * Gets the modification time of a file in the same form that
+ * trash_info_get_modified_time() uses, so that the two can be compared.
+ *
+ * Returns: the modification time in microseconds, or 0 if @info has none
+ */
+gint64 trash_info_get_modified_time_from_file_info(GFileInfo *info) {
+	guint64 seconds;
+	guint32 usec;
+
+	seconds = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	usec = g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+	return (gint64) (seconds * G_USEC_PER_SEC + usec);
+}
+
 /* Property getters */
 
 /**
@@ -299,6 +405,19 @@ goffset trash_info_get_size(TrashInfo *self) {
 	return self->size;
 }
 
+/**
+ * trash_info_get_allocated_size:
+ * @self: a #TrashInfo
+ *
+ * Gets how much space the file takes up on disk. If the backend couldn't
+ * tell, this is the same as the file's size.
+ *
+ * Returns: the allocated size of the file in bytes
+ */
+guint64 trash_info_get_allocated_size(TrashInfo *self) {
+	return self->allocated_size;
+}
+
 /**
  * trash_info_is_directory:
  * @self: a #TrashInfo
@@ -322,3 +441,206 @@ gboolean trash_info_is_directory(TrashInfo *self) {
 GDateTime *trash_info_get_deletion_time(TrashInfo *self) {
 	return g_date_time_ref(self->deleted_time);
 }
+
+/**
+ * trash_info_get_modified_time:
+ * @self: a #TrashInfo
+ *
+ * Gets the modification time of the trashed file. This is used to tell
+ * whether an item with the same name has been replaced.
+ *
+ * Returns: the modification time in microseconds since the epoch
+ */
+gint64 trash_info_get_modified_time(TrashInfo *self) {
+	return self->modified_time;
+}
+
+/* Borrowed accessors */
+
+/**
+ * trash_info_peek_name:
+ * @self: a #TrashInfo
+ *
+ * Gets the file's name without copying it.
+ *
+ * Returns: (transfer none): the file name
+ */
+const gchar *trash_info_peek_name(TrashInfo *self) {
+	return self->name;
+}
+
+/**
+ * trash_info_peek_display_name:
+ * @self: a #TrashInfo
+ *
+ * Gets the display name for the file without copying it.
+ *
+ * Returns: (transfer none): the file's display name
+ */
+const gchar *trash_info_peek_display_name(TrashInfo *self) {
+	return self->display_name;
+}
+
+/**
+ * trash_info_peek_uri:
+ * @self: a #TrashInfo
+ *
+ * Gets the URI for the file without copying it.
+ *
+ * Returns: (transfer none): the URI to the file
+ */
+const gchar *trash_info_peek_uri(TrashInfo *self) {
+	return self->uri;
+}
+
+/**
+ * trash_info_peek_restore_path:
+ * @self: a #TrashInfo
+ *
+ * Gets the original path of this file without copying it.
+ *
+ * Returns: (transfer none): the file's original path
+ */
+const gchar *trash_info_peek_restore_path(TrashInfo *self) {
+	return self->restore_path;
+}
+
+/**
+ * trash_info_peek_target_path:
+ * @self: a #TrashInfo
+ *
+ * Gets where the trashed file is stored on disk without copying it.
+ *
+ * Returns: (transfer none) (nullable): the path to the trashed file, or
+ *   %NULL if it isn't on a local filesystem
+ */
+const gchar *trash_info_peek_target_path(TrashInfo *self) {
+	return self->target_path;
+}
+
+/**
+ * trash_info_peek_icon:
+ * @self: a #TrashInfo
+ *
+ * Gets the icon for the file without adding a reference to it.
+ *
+ * Returns: (transfer none): an icon for this file
+ */
+GIcon *trash_info_peek_icon(TrashInfo *self) {
+	return self->icon;
+}
+
+/**
+ * trash_info_get_deletion_timestamp:
+ * @self: a #TrashInfo
+ *
+ * Gets the time that this file was trashed as a number, which is cheaper
+ * to compare than a #GDateTime.
+ *
+ * Returns: when the file was trashed in microseconds since the epoch, or 0 if it is not known
+ */
+gint64 trash_info_get_deletion_timestamp(TrashInfo *self) {
+	return self->deletion_timestamp;
+}
+
+/* Searching */
+
+/**
+ * trash_info_make_search_key:
+ * @text: (nullable): some text to search in or for
+ *
+ * Normalizes and case-folds @text, so that searches can compare it
+ * byte for byte.
+ *
+ * Returns: (transfer full) (nullable): the search key, or %NULL if @text is %NULL
+ */
+gchar *trash_info_make_search_key(const gchar *text) {
+	g_autofree gchar *normalized = NULL;
+
+	if (!text) {
+		return NULL;
+	}
+
+	normalized = g_utf8_normalize(text, -1, G_NORMALIZE_ALL);
+
+	return g_utf8_casefold(normalized ? normalized : text, -1);
+}
+
+/**
+ * trash_info_peek_name_key:
+ * @self: a #TrashInfo
+ *
+ * Gets the search key for the display name, see
+ * trash_info_make_search_key(). It never changes, so it is safe to read
+ * from any thread.
+ *
+ * Returns: (transfer none) (nullable): the display name's search key
+ */
+const gchar *trash_info_peek_name_key(TrashInfo *self) {
+	return self->name_key;
+}
+
+/**
+ * trash_info_peek_path_key:
+ * @self: a #TrashInfo
+ *
+ * Gets the search key for the restore path, see
+ * trash_info_make_search_key(). It never changes, so it is safe to read
+ * from any thread.
+ *
+ * Returns: (transfer none) (nullable): the restore path's search key
+ */
+const gchar *trash_info_peek_path_key(TrashInfo *self) {
+	return self->path_key;
+}
+
+/* Sorting */
+
+/**
+ * trash_info_collate_by_date:
+ * @self: a #TrashInfo
+ * @other: a #TrashInfo
+ *
+ * Compares two trashed items by deletion date, in ascending order.
+ *
+ * Returns: < 0 if @self compares before @other, 0 if they compare equal, > 0 if @self compares after @other
+ */
+gint trash_info_collate_by_date(TrashInfo *self, TrashInfo *other) {
+	return (self->deletion_timestamp > other->deletion_timestamp) - (self->deletion_timestamp < other->deletion_timestamp);
+}
+
+/**
+ * trash_info_collate_by_name:
+ * @self: a #TrashInfo
+ * @other: a #TrashInfo
+ *
+ * Compares two trashed items by name, in alphabetical order for the
+ * current locale.
+ *
+ * Returns: < 0 if @self compares before @other, 0 if they compare equal, > 0 if @self compares after @other
+ */
+gint trash_info_collate_by_name(TrashInfo *self, TrashInfo *other) {
+	return g_strcmp0(self->collate_key, other->collate_key);
+}
+
+/**
+ * trash_info_collate_by_type:
+ * @self: a #TrashInfo
+ * @other: a #TrashInfo
+ *
+ * Compares two trashed items, putting directories before regular files
+ * and sorting each of those alphabetically.
+ *
+ * Returns: < 0 if @self compares before @other, 0 if they compare equal, > 0 if @self compares after @other
+ */
+gint trash_info_collate_by_type(TrashInfo *self, TrashInfo *other) {
+	if (self->is_directory && !other->is_directory) {
+		return -1;
+	}
+
+	if (!self->is_directory && other->is_directory) {
+		return 1;
+	}
+
+	return trash_info_collate_by_name(self, other);
+}
@@ -10,6 +10,8 @@ G_DECLARE_FINAL_TYPE(TrashInfo, trash_info, TRASH, INFO, GObject)
 
 TrashInfo *trash_info_new(GFileInfo *info, const char *uri);
 
+gint64 trash_info_get_modified_time_from_file_info(GFileInfo *info);
+
 /* Property getters */
 
 const gchar *trash_info_get_name(TrashInfo *self);
@@ -24,8 +26,44 @@ GIcon *trash_info_get_icon(TrashInfo *self);
 
 goffset trash_info_get_size(TrashInfo *self);
 
+guint64 trash_info_get_allocated_size(TrashInfo *self);
+
 gboolean trash_info_is_directory(TrashInfo *self);
 
 GDateTime *trash_info_get_deletion_time(TrashInfo *self);
 
+gint64 trash_info_get_modified_time(TrashInfo *self);
+
+/* Borrowed accessors */
+
+const gchar *trash_info_peek_name(TrashInfo *self);
+
+const gchar *trash_info_peek_display_name(TrashInfo *self);
+
+const gchar *trash_info_peek_uri(TrashInfo *self);
+
+const gchar *trash_info_peek_restore_path(TrashInfo *self);
+
+const gchar *trash_info_peek_target_path(TrashInfo *self);
+
+GIcon *trash_info_peek_icon(TrashInfo *self);
+
+gint64 trash_info_get_deletion_timestamp(TrashInfo *self);
+
+/* Searching */
+
+gchar *trash_info_make_search_key(const gchar *text);
+
+const gchar *trash_info_peek_name_key(TrashInfo *self);
+
+const gchar *trash_info_peek_path_key(TrashInfo *self);
+
+/* Sorting */
+
+gint trash_info_collate_by_date(TrashInfo *self, TrashInfo *other);
+
+gint trash_info_collate_by_name(TrashInfo *self, TrashInfo *other);
+
+gint trash_info_collate_by_type(TrashInfo *self, TrashInfo *other);
+
 G_END_DECLS
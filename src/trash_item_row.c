@@ -8,18 +8,25 @@
  * and timestamp when the file was sent to the trash, and a button to
  * delete the file.
  *
- * Confirming the deletion of a file is done by using a #TrashButtonBar
- * widget.
+ * Rows are kept small so that they are cheap to build, and can be bound
+ * to a different #TrashInfo with trash_item_row_set_info() so that the
+ * popover can reuse them. Clicking the delete button emits
+ * #TrashItemRow::delete-requested, and the popover moves its one
+ * confirmation bar into the row with trash_item_row_set_confirm_bar().
  *
  * CSS nodes
  *
- * TrashItemRow has a single CSS class with name .trash-item-row
+ * TrashItemRow has a single CSS class with name .trash-item-row, and the
+ * timestamp label has the class .trash-item-date. They are styled by the
+ * applet's `style.css` resource.
  */
 
 #include "trash_item_row.h"
+#include "trash_trace.h"
 
 enum {
 	PROP_TRASH_INFO = 1,
+	PROP_BACKEND,
 	LAST_PROP
 };
 
@@ -27,12 +34,23 @@ static GParamSpec *props[LAST_PROP] = {
 	NULL,
 };
 
+enum {
+	DELETE_REQUESTED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
 struct _TrashItemRow {
 	GtkListBoxRow parent_instance;
 
 	TrashInfo *trash_info;
+	TrashBackend *backend;
 
-	GtkWidget *header;
+	GtkWidget *grid;
+	GtkWidget *icon;
+	GtkWidget *name_label;
+	GtkWidget *date_label;
 	GtkWidget *delete_btn;
 	TrashButtonBar *confirm_bar;
 };
@@ -41,136 +59,9 @@ G_DEFINE_FINAL_TYPE(TrashItemRow, trash_item_row, GTK_TYPE_LIST_BOX_ROW)
 
 static void delete_clicked_cb(GtkButton *source, gpointer user_data) {
 	(void) source;
-
 	TrashItemRow *self = user_data;
-	gboolean revealed;
-
-	revealed = trash_button_bar_get_revealed(self->confirm_bar);
-
-	if (revealed) {
-		trash_button_bar_set_revealed(self->confirm_bar, FALSE);
-	} else {
-		trash_button_bar_set_revealed(self->confirm_bar, TRUE);
-	}
-}
-
-static void confirm_response_cb(TrashButtonBar *source, GtkResponseType type, gpointer user_data) {
-	TrashItemRow *self = user_data;
-
-	trash_button_bar_set_revealed(source, FALSE);
-
-	switch (type) {
-		case GTK_RESPONSE_YES:
-			trash_item_row_delete(self);
-			break;
-		default:
-			break;
-	}
-}
-
-static void trash_item_row_constructed(GObject *object) {
-	TrashItemRow *self;
-
-	GVariant *raw_icon;
-	GIcon *gicon;
-	const gchar *name;
-	const gchar *path;
-	GDateTime *deletion_time;
-	gchar *formatted_date;
-
-	GtkWidget *grid;
-	GtkWidget *icon;
-	GtkWidget *name_label;
-	GtkWidget *date_label;
-	GtkStyleContext *date_style_context;
-	PangoAttrList *attr_list;
-	PangoFontDescription *font_description;
-	PangoAttribute *font_attr;
-	GtkStyleContext *delete_button_style;
-	GtkWidget *content_area, *confirm_label;
-
-	self = TRASH_ITEM_ROW(object);
 
-	g_object_get(
-		self->trash_info,
-		"display-name", &name,
-		"icon", &raw_icon,
-		"restore-path", &path,
-		"deletion-time", &deletion_time,
-		NULL);
-
-	gicon = g_icon_deserialize(raw_icon);
-	icon = gtk_image_new_from_gicon(gicon, GTK_ICON_SIZE_LARGE_TOOLBAR);
-	gtk_widget_set_margin_start(icon, 6);
-	gtk_widget_set_margin_end(icon, 6);
-
-	name_label = gtk_label_new(name);
-	gtk_widget_set_halign(name_label, GTK_ALIGN_START);
-	gtk_widget_set_valign(name_label, GTK_ALIGN_CENTER);
-	gtk_widget_set_hexpand(name_label, TRUE);
-	gtk_widget_set_tooltip_text(name_label, path);
-
-	attr_list = pango_attr_list_new();
-	font_description = pango_font_description_new();
-	pango_font_description_set_stretch(font_description, PANGO_STRETCH_ULTRA_CONDENSED);
-	pango_font_description_set_weight(font_description, PANGO_WEIGHT_SEMILIGHT);
-	font_attr = pango_attr_font_desc_new(font_description);
-	pango_attr_list_insert(attr_list, font_attr);
-
-	formatted_date = g_date_time_format(deletion_time, "%d %b %Y %X");
-	date_label = gtk_label_new(formatted_date);
-	gtk_widget_set_halign(date_label, GTK_ALIGN_START);
-	gtk_widget_set_hexpand(date_label, TRUE);
-	gtk_label_set_attributes(GTK_LABEL(date_label), attr_list);
-	date_style_context = gtk_widget_get_style_context(date_label);
-	gtk_style_context_add_class(date_style_context, GTK_STYLE_CLASS_DIM_LABEL);
-
-	self->delete_btn = gtk_button_new_from_icon_name("user-trash-symbolic", GTK_ICON_SIZE_BUTTON);
-	delete_button_style = gtk_widget_get_style_context(self->delete_btn);
-	gtk_style_context_add_class(delete_button_style, GTK_STYLE_CLASS_DESTRUCTIVE_ACTION);
-	gtk_style_context_add_class(delete_button_style, GTK_STYLE_CLASS_FLAT);
-	gtk_style_context_add_class(delete_button_style, "circular");
-	gtk_widget_set_tooltip_text(self->delete_btn, "Permanently delete this item");
-
-	// Confirmation widget
-
-	self->confirm_bar = trash_button_bar_new();
-	trash_button_bar_set_revealed(self->confirm_bar, FALSE);
-
-	confirm_label = gtk_label_new("Are you sure you want to delete this item?");
-	gtk_label_set_line_wrap(GTK_LABEL(confirm_label), TRUE);
-
-	content_area = trash_button_bar_get_content_area(self->confirm_bar);
-	gtk_box_pack_start(GTK_BOX(content_area), confirm_label, TRUE, TRUE, 6);
-
-	trash_button_bar_add_button(self->confirm_bar, "No", GTK_RESPONSE_NO);
-	trash_button_bar_add_button(self->confirm_bar, "Yes", GTK_RESPONSE_YES);
-
-	trash_button_bar_add_response_style_class(self->confirm_bar, GTK_RESPONSE_YES, GTK_STYLE_CLASS_DESTRUCTIVE_ACTION);
-
-	g_signal_connect(self->confirm_bar, "response", G_CALLBACK(confirm_response_cb), self);
-
-	// Grid
-
-	grid = gtk_grid_new();
-	gtk_grid_set_column_spacing(GTK_GRID(grid), 6);
-	gtk_widget_set_margin_top(GTK_WIDGET(self), 2);
-	gtk_widget_set_margin_bottom(GTK_WIDGET(self), 2);
-
-	gtk_grid_attach(GTK_GRID(grid), icon, 0, 0, 2, 2);
-	gtk_grid_attach(GTK_GRID(grid), name_label, 2, 0, 1, 1);
-	gtk_grid_attach(GTK_GRID(grid), self->delete_btn, 3, 0, 1, 1);
-	gtk_grid_attach(GTK_GRID(grid), date_label, 2, 1, 1, 1);
-	gtk_grid_attach(GTK_GRID(grid), GTK_WIDGET(self->confirm_bar), 0, 3, 4, 1);
-
-	gtk_container_add(GTK_CONTAINER(self), grid);
-
-	gtk_widget_set_margin_end(GTK_WIDGET(self), 10);
-	gtk_widget_show_all(GTK_WIDGET(self));
-
-	g_signal_connect(self->delete_btn, "clicked", G_CALLBACK(delete_clicked_cb), self);
-
-	G_OBJECT_CLASS(trash_item_row_parent_class)->constructed(object);
+	g_signal_emit(self, signals[DELETE_REQUESTED], 0);
 }
 
 static void trash_item_row_finalize(GObject *object) {
@@ -178,7 +69,8 @@ static void trash_item_row_finalize(GObject *object) {
 
 	self = TRASH_ITEM_ROW(object);
 
-	g_object_unref(self->trash_info);
+	g_clear_object(&self->trash_info);
+	g_object_unref(self->backend);
 
 	G_OBJECT_CLASS(trash_item_row_parent_class)->finalize(object);
 }
@@ -190,7 +82,10 @@ static void trash_item_row_get_property(GObject *object, guint prop_id, GValue *
 
 	switch (prop_id) {
 		case PROP_TRASH_INFO:
-			g_value_set_pointer(value, trash_item_row_get_info(self));
+			g_value_set_pointer(value, self->trash_info);
+			break;
+		case PROP_BACKEND:
+			g_value_set_object(value, self->backend);
 			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, spec);
@@ -200,14 +95,15 @@ static void trash_item_row_get_property(GObject *object, guint prop_id, GValue *
 
 static void trash_item_row_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *spec) {
 	TrashItemRow *self;
-	gpointer pointer;
 
 	self = TRASH_ITEM_ROW(object);
 
 	switch (prop_id) {
 		case PROP_TRASH_INFO:
-			pointer = g_value_get_pointer(value);
-			self->trash_info = g_object_ref_sink(pointer);
+			trash_item_row_set_info(self, g_value_get_pointer(value));
+			break;
+		case PROP_BACKEND:
+			self->backend = g_value_dup_object(value);
 			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, spec);
@@ -215,12 +111,26 @@ static void trash_item_row_set_property(GObject *object, guint prop_id, const GV
 	}
 }
 
+static void load_css(void) {
+	g_autoptr(GtkCssProvider) provider = NULL;
+	GdkScreen *screen;
+
+	screen = gdk_screen_get_default();
+
+	if (!screen) {
+		return;
+	}
+
+	provider = gtk_css_provider_new();
+	gtk_css_provider_load_from_resource(provider, "/com/github/EbonJaeger/budgie-trash-applet/style.css");
+	gtk_style_context_add_provider_for_screen(screen, GTK_STYLE_PROVIDER(provider), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+}
+
 static void trash_item_row_class_init(TrashItemRowClass *klass) {
 	GObjectClass *class;
 
 	class = G_OBJECT_CLASS(klass);
 
-	class->constructed = trash_item_row_constructed;
 	class->finalize = trash_item_row_finalize;
 	class->get_property = trash_item_row_get_property;
 	class->set_property = trash_item_row_set_property;
@@ -231,29 +141,169 @@ static void trash_item_row_class_init(TrashItemRowClass *klass) {
 		"trash-info",
 		"Trash info",
 		"The information for this row",
+		G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	props[PROP_BACKEND] = g_param_spec_object(
+		"backend",
+		"Backend",
+		"The trash backend that the item is in",
+		TRASH_TYPE_BACKEND,
 		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
 	g_object_class_install_properties(class, LAST_PROP, props);
+
+	// Signals
+
+	/**
+	 * TrashItemRow::delete-requested:
+	 * @self: a #TrashItemRow
+	 *
+	 * Emitted when the delete button is clicked, so that the deletion can
+	 * be confirmed.
+	 */
+	signals[DELETE_REQUESTED] = g_signal_new(
+		"delete-requested",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		0);
+
+	// Every row shares the same styling
+	load_css();
 }
 
 static void trash_item_row_init(TrashItemRow *self) {
 	GtkStyleContext *style;
+	GtkStyleContext *delete_button_style;
 
 	style = gtk_widget_get_style_context(GTK_WIDGET(self));
-
 	gtk_style_context_add_class(style, "trash-item-row");
+
+	self->icon = gtk_image_new();
+	gtk_widget_set_margin_start(self->icon, 6);
+	gtk_widget_set_margin_end(self->icon, 6);
+
+	self->name_label = gtk_label_new(NULL);
+	gtk_widget_set_halign(self->name_label, GTK_ALIGN_START);
+	gtk_widget_set_valign(self->name_label, GTK_ALIGN_CENTER);
+	gtk_widget_set_hexpand(self->name_label, TRUE);
+
+	self->date_label = gtk_label_new(NULL);
+	gtk_widget_set_halign(self->date_label, GTK_ALIGN_START);
+	gtk_widget_set_hexpand(self->date_label, TRUE);
+	gtk_style_context_add_class(gtk_widget_get_style_context(self->date_label), GTK_STYLE_CLASS_DIM_LABEL);
+	gtk_style_context_add_class(gtk_widget_get_style_context(self->date_label), "trash-item-date");
+
+	self->delete_btn = gtk_button_new_from_icon_name("user-trash-symbolic", GTK_ICON_SIZE_BUTTON);
+	delete_button_style = gtk_widget_get_style_context(self->delete_btn);
+	gtk_style_context_add_class(delete_button_style, GTK_STYLE_CLASS_DESTRUCTIVE_ACTION);
+	gtk_style_context_add_class(delete_button_style, GTK_STYLE_CLASS_FLAT);
+	gtk_style_context_add_class(delete_button_style, "circular");
+	gtk_widget_set_tooltip_text(self->delete_btn, "Permanently delete this item");
+	g_signal_connect(self->delete_btn, "clicked", G_CALLBACK(delete_clicked_cb), self);
+
+	// Grid
+
+	self->grid = gtk_grid_new();
+	gtk_grid_set_column_spacing(GTK_GRID(self->grid), 6);
+	gtk_widget_set_margin_top(GTK_WIDGET(self), 2);
+	gtk_widget_set_margin_bottom(GTK_WIDGET(self), 2);
+
+	gtk_grid_attach(GTK_GRID(self->grid), self->icon, 0, 0, 2, 2);
+	gtk_grid_attach(GTK_GRID(self->grid), self->name_label, 2, 0, 1, 1);
+	gtk_grid_attach(GTK_GRID(self->grid), self->delete_btn, 3, 0, 1, 1);
+	gtk_grid_attach(GTK_GRID(self->grid), self->date_label, 2, 1, 1, 1);
+
+	gtk_container_add(GTK_CONTAINER(self), self->grid);
+
+	gtk_widget_set_margin_end(GTK_WIDGET(self), 10);
+	gtk_widget_show_all(GTK_WIDGET(self));
 }
 
 /**
  * trash_item_row_new:
- * @trash_info: (transfer full): a #TrashInfo
+ * @trash_info: (transfer none): a #TrashInfo
+ * @backend: (transfer none): the #TrashBackend that the item is in
  *
  * Creates a new #TrashItemRow.
  *
  * Returns: a new #TrashItemRow
  */
-TrashItemRow *trash_item_row_new(TrashInfo *trash_info) {
-	return g_object_new(TRASH_TYPE_ITEM_ROW, "trash-info", trash_info, NULL);
+TrashItemRow *trash_item_row_new(TrashInfo *trash_info, TrashBackend *backend) {
+	return g_object_new(TRASH_TYPE_ITEM_ROW, "trash-info", trash_info, "backend", backend, NULL);
+}
+
+/**
+ * trash_item_row_set_info:
+ * @self: a #TrashItemRow
+ * @trash_info: (transfer none) (nullable): a #TrashInfo
+ *
+ * Shows a different item in this row, reusing its widgets. With %NULL
+ * the row lets go of its item and shows nothing, while it waits to be
+ * reused.
+ */
+void trash_item_row_set_info(TrashItemRow *self, TrashInfo *trash_info) {
+	g_autoptr(GDateTime) deletion_time = NULL;
+	g_autofree gchar *formatted_date = NULL;
+	const gchar *name = NULL;
+	gint64 trace_start;
+
+	g_return_if_fail(TRASH_IS_ITEM_ROW(self));
+
+	if (!g_set_object(&self->trash_info, trash_info)) {
+		return;
+	}
+
+	trace_start = TRASH_TRACE_NOW();
+
+	if (trash_info) {
+		name = trash_info_peek_display_name(trash_info);
+		deletion_time = trash_info_get_deletion_time(trash_info);
+		formatted_date = g_date_time_format(deletion_time, "%d %b %Y %X");
+
+		gtk_image_set_from_gicon(GTK_IMAGE(self->icon), trash_info_peek_icon(trash_info), GTK_ICON_SIZE_LARGE_TOOLBAR);
+	} else {
+		gtk_image_clear(GTK_IMAGE(self->icon));
+	}
+
+	gtk_label_set_text(GTK_LABEL(self->name_label), name);
+	gtk_widget_set_tooltip_text(self->name_label, trash_info ? trash_info_peek_restore_path(trash_info) : NULL);
+	gtk_label_set_text(GTK_LABEL(self->date_label), formatted_date);
+
+	g_object_notify_by_pspec(G_OBJECT(self), props[PROP_TRASH_INFO]);
+
+	TRASH_TRACE_MARK(trace_start, "row-bind", "%s", name);
+	TRASH_TRACE_PROBE1(row__bind, name);
+}
+
+/**
+ * trash_item_row_set_confirm_bar:
+ * @self: a #TrashItemRow
+ * @confirm_bar: (transfer none) (nullable): a #TrashButtonBar that isn't
+ *   in any other row
+ *
+ * Shows @confirm_bar below the item, or takes away the one that was there
+ * with %NULL. The caller has to hold a reference to the bar, so that it
+ * survives being moved from row to row.
+ */
+void trash_item_row_set_confirm_bar(TrashItemRow *self, TrashButtonBar *confirm_bar) {
+	g_return_if_fail(TRASH_IS_ITEM_ROW(self));
+
+	if (self->confirm_bar == confirm_bar) {
+		return;
+	}
+
+	if (self->confirm_bar) {
+		gtk_container_remove(GTK_CONTAINER(self->grid), GTK_WIDGET(self->confirm_bar));
+	}
+
+	self->confirm_bar = confirm_bar;
+
+	if (confirm_bar) {
+		gtk_grid_attach(GTK_GRID(self->grid), GTK_WIDGET(confirm_bar), 0, 3, 4, 1);
+	}
 }
 
 /**
@@ -269,20 +319,15 @@ TrashInfo *trash_item_row_get_info(TrashItemRow *self) {
 }
 
 static void delete_finish(GObject *object, GAsyncResult *result, gpointer user_data) {
-	(void) user_data;
-
-	GFile *file;
+	g_autofree gchar *name = user_data;
 	g_autoptr(GError) error = NULL;
+	g_autofree gchar *body = NULL;
 
-	file = G_FILE(object);
-
-	g_file_delete_finish(file, result, &error);
+	if (!trash_backend_delete_item_finish(TRASH_BACKEND(object), result, &error)) {
+		body = g_strdup_printf("Unable to delete '%s': %s", name, error->message);
 
-	if (error) {
-		g_critical("Error deleting file '%s': %s", g_file_get_basename(file), error->message);
-		trash_notify_try_send("Trash Error",
-			g_strdup_printf("Unable to delete '%s': %s", g_file_get_basename(G_FILE(object)), error->message),
-			"user-trash-symbolic");
+		g_critical("Error deleting file '%s': %s", name, error->message);
+		trash_notify_try_send_failure("Trash Error", body, "user-trash-symbolic", "delete");
 	}
 }
 
@@ -293,35 +338,28 @@ static void delete_finish(GObject *object, GAsyncResult *result, gpointer user_d
  * Asynchronously deletes a trashed item.
  */
 void trash_item_row_delete(TrashItemRow *self) {
-	g_autoptr(GFile) file;
-	g_autofree const gchar *name;
-	g_autofree gchar *uri;
+	gchar *name;
 
-	name = trash_info_get_name(self->trash_info);
-	uri = g_strdup_printf("trash:///%s", name);
-	file = g_file_new_for_uri(uri);
+	name = g_strdup(trash_info_peek_name(self->trash_info));
 
-	g_file_delete_async(
-		file,
-		G_PRIORITY_DEFAULT,
+	trash_backend_delete_item_async(
+		self->backend,
+		name,
 		NULL,
 		delete_finish,
-		NULL);
+		name);
 }
 
 static void restore_finish(GObject *object, GAsyncResult *result, gpointer user_data) {
-	(void) user_data;
-
-	gboolean success;
+	g_autofree gchar *name = user_data;
 	g_autoptr(GError) error = NULL;
+	g_autofree gchar *body = NULL;
 
-	success = g_file_move_finish(G_FILE(object), result, &error);
+	if (!trash_backend_restore_item_finish(TRASH_BACKEND(object), result, &error)) {
+		body = g_strdup_printf("Unable to restore '%s': %s", name, error->message);
 
-	if (!success) {
-		g_critical("Error restoring file '%s' to '%s': %s", g_file_get_basename(G_FILE(object)), g_file_get_path(G_FILE(object)), error->message);
-		trash_notify_try_send("Trash Error",
-			g_strdup_printf("Unable to restore '%s': %s", g_file_get_basename(G_FILE(object)), error->message),
-			"user-trash-symbolic");
+		g_critical("Error restoring file '%s': %s", name, error->message);
+		trash_notify_try_send_failure("Trash Error", body, "user-trash-symbolic", "restore");
 	}
 }
 
@@ -332,25 +370,19 @@ static void restore_finish(GObject *object, GAsyncResult *result, gpointer user_
  * Asynchronously restores a trashed item to its original location.
  */
 void trash_item_row_restore(TrashItemRow *self) {
-	g_autoptr(GFile) file, restored_file;
-	g_autofree const gchar *name;
-	g_autofree gchar *uri;
-	g_autofree const gchar *restore_path;
-
-	name = trash_info_get_name(self->trash_info);
-	uri = g_strdup_printf("trash:///%s", name);
-	file = g_file_new_for_uri(uri);
-	restore_path = trash_info_get_restore_path(self->trash_info);
-	restored_file = g_file_new_for_path(restore_path);
-
-	g_file_move_async(
-		file,
-		restored_file,
-		G_FILE_COPY_ALL_METADATA,
-		G_PRIORITY_DEFAULT,
-		NULL, NULL, NULL,
+	gchar *name;
+	const gchar *restore_path;
+
+	name = g_strdup(trash_info_peek_name(self->trash_info));
+	restore_path = trash_info_peek_restore_path(self->trash_info);
+
+	trash_backend_restore_item_async(
+		self->backend,
+		name,
+		restore_path,
+		NULL,
 		restore_finish,
-		NULL);
+		name);
 }
 
 /**
@@ -364,9 +396,7 @@ void trash_item_row_restore(TrashItemRow *self) {
  * Returns: < 0 if @self compares before @other, 0 if they compare equal, > 0 if @self compares after @other
  */
 gint trash_item_row_collate_by_date(TrashItemRow *self, TrashItemRow *other) {
-	return g_date_time_compare(
-		trash_info_get_deletion_time(self->trash_info),
-		trash_info_get_deletion_time(other->trash_info));
+	return trash_info_collate_by_date(self->trash_info, other->trash_info);
 }
 
 /**
@@ -379,9 +409,7 @@ gint trash_item_row_collate_by_date(TrashItemRow *self, TrashItemRow *other) {
  * Returns: < 0 if @self compares before @other, 0 if they compare equal, > 0 if @self compares after @other
  */
 gint trash_item_row_collate_by_name(TrashItemRow *self, TrashItemRow *other) {
-	return strcoll(
-		trash_info_get_name(self->trash_info),
-		trash_info_get_name(other->trash_info));
+	return trash_info_collate_by_name(self->trash_info, other->trash_info);
 }
 
 /**
@@ -398,17 +426,5 @@ gint trash_item_row_collate_by_name(TrashItemRow *self, TrashItemRow *other) {
  * Returns: < 0 if @self compares before @other, 0 if they compare equal, > 0 if @self compares after @other
  */
 gint trash_item_row_collate_by_type(TrashItemRow *self, TrashItemRow *other) {
-	gint ret = 0;
-
-	if (trash_info_is_directory(self->trash_info) && trash_info_is_directory(other->trash_info)) {
-		ret = trash_item_row_collate_by_name(self, other);
-	} else if (trash_info_is_directory(self->trash_info) && !trash_info_is_directory(other->trash_info)) {
-		ret = -1;
-	} else if (!trash_info_is_directory(self->trash_info) && trash_info_is_directory(other->trash_info)) {
-		ret = 1;
-	} else {
-		ret = trash_item_row_collate_by_name(self, other);
-	}
-
-	return ret;
+	return trash_info_collate_by_type(self->trash_info, other->trash_info);
 }
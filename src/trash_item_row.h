@@ -1,10 +1,10 @@
 #pragma once
 
 #include "notify.h"
+#include "trash_backend.h"
 #include "trash_button_bar.h"
 #include "trash_info.h"
 #include <gtk/gtk.h>
-#include <pango/pango.h>
 
 G_BEGIN_DECLS
 
@@ -12,10 +12,14 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE(TrashItemRow, trash_item_row, TRASH, ITEM_ROW, GtkListBoxRow)
 
-TrashItemRow *trash_item_row_new(TrashInfo *trash_info);
+TrashItemRow *trash_item_row_new(TrashInfo *trash_info, TrashBackend *backend);
 
 TrashInfo *trash_item_row_get_info(TrashItemRow *self);
 
+void trash_item_row_set_info(TrashItemRow *self, TrashInfo *trash_info);
+
+void trash_item_row_set_confirm_bar(TrashItemRow *self, TrashButtonBar *confirm_bar);
+
 void trash_item_row_delete(TrashItemRow *self);
 
 void trash_item_row_restore(TrashItemRow *self);
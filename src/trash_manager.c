@@ -1,8 +1,58 @@
+/**
+ * SECTION:trashmanager
+ * @Short_description: Keeps track of the items in the trash bin
+ * @Title: TrashManager
+ *
+ * The #TrashManager keeps a set of #TrashInfo objects for the items in the
+ * trash bin, and emits signals as items are added and removed. Where the
+ * items come from, and how changes are noticed, is up to its
+ * #TrashBackend.
+ *
+ * Every full scan is timed, see trash_manager_get_scan_stats().
+ *
+ * If `BUDGIE_TRASH_RECORD_EVENTS` is set to a file path, every change
+ * event the backend reports is recorded to that file as an event trace,
+ * see trash_manager_start_recording().
+ *
+ * Items are also counted by the directory they were trashed from as they
+ * come and go, see trash_manager_get_origins().
+ *
+ * The item count and total size are sampled into a #TrashHistory as they
+ * change, which can be kept on disk across restarts, see
+ * trash_manager_persist_history().
+ */
+
 #include "trash_manager.h"
+#include "trash_event_trace.h"
+#include "trash_history.h"
+#include "trash_path_tree.h"
+#include "trash_trace.h"
+#include "trash_watchdog.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/**
+ * How long to wait, in seconds, after the history changes before writing
+ * it to disk, so that a burst of changes is written once.
+ */
+#define TRASH_HISTORY_SAVE_DELAY 60
+
+enum {
+	PROP_BACKEND = 1,
+	PROP_EVENTS_PROCESSED,
+	PROP_EVENTS_COALESCED,
+	LAST_PROP
+};
+
+static GParamSpec *props[LAST_PROP] = {
+	NULL,
+};
 
 enum {
 	TRASH_ADDED,
 	TRASH_REMOVED,
+	SCAN_FINISHED,
 	LAST_SIGNAL
 };
 
@@ -11,29 +61,239 @@ static guint signals[LAST_SIGNAL];
 struct _TrashManager {
 	GObject parent_instance;
 
-	GFileMonitor *trash_monitor;
-	gint file_count;
+	TrashBackend *backend;
+	GHashTable *items;
+	GHashTable *pending;
+
+	/* Names that were added again while their info was being looked up */
+	GHashTable *requery;
+
+	GHashTable *scan_seen;
+	GArray *snapshot;
+	gboolean scan_running;
+	gboolean scan_complete;
+	gboolean reconcile_queued;
+	guint reconcile_idle_id;
+
+	gint64 scan_start;
+	gint64 scan_trace_start;
+	gint64 scan_first_item;
+	guint scan_count;
+	TrashScanStats scan_stats;
+	gboolean has_scan_stats;
+
+	guint64 total_bytes;
+	guint64 allocated_bytes;
+	guint64 events_processed;
+	guint64 events_coalesced;
+	TrashPathTree *origins;
+
+	TrashHistory *history;
+	gchar *history_path;
+	guint history_save_id;
+
+	TrashEventWriter *recorder;
 };
 
 G_DEFINE_FINAL_TYPE(TrashManager, trash_manager, G_TYPE_OBJECT)
 
-static void trash_manager_finalize(GObject *object) {
+static void history_written(GObject *source, GAsyncResult *result, gpointer user_data) {
+	(void) user_data;
+	g_autoptr(GError) error = NULL;
+
+	if (!g_file_replace_contents_finish(G_FILE(source), result, NULL, &error)) {
+		g_warning("Unable to save trash history: %s", error->message);
+	}
+}
+
+/**
+ * Write the history to disk, without blocking if @background is set.
+ */
+static void save_history(TrashManager *self, gboolean background) {
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *directory = NULL;
+
+	bytes = trash_history_serialize(self->history);
+	directory = g_path_get_dirname(self->history_path);
+
+	if (g_mkdir_with_parents(directory, 0700) != 0) {
+		g_warning("Unable to create '%s': %s", directory, g_strerror(errno));
+		return;
+	}
+
+	if (background) {
+		file = g_file_new_for_path(self->history_path);
+		g_file_replace_contents_bytes_async(file, bytes, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION, NULL, history_written, NULL);
+		return;
+	}
+
+	if (!g_file_set_contents(self->history_path, g_bytes_get_data(bytes, NULL), (gssize) g_bytes_get_size(bytes), &error)) {
+		g_warning("Unable to save trash history: %s", error->message);
+	}
+}
+
+static gboolean save_history_cb(gpointer user_data) {
+	TrashManager *self = user_data;
+
+	self->history_save_id = 0;
+	save_history(self, TRUE);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Sample the item count and total size into the history. During a scan,
+ * and before the first one has finished, the totals only climb towards
+ * the real ones, so they aren't worth keeping.
+ */
+static void record_history(TrashManager *self) {
+	if (self->scan_running || !self->scan_complete) {
+		return;
+	}
+
+	if (!trash_history_record(self->history, g_get_real_time() / G_USEC_PER_SEC, g_hash_table_size(self->items), self->total_bytes)) {
+		return;
+	}
+
+	if (self->history_path && self->history_save_id == 0) {
+		self->history_save_id = g_timeout_add_seconds(TRASH_HISTORY_SAVE_DELAY, save_history_cb, self);
+	}
+}
+
+static void trash_manager_dispose(GObject *object) {
 	TrashManager *self;
+	GHashTableIter iter;
+	gpointer value;
 
 	self = TRASH_MANAGER(object);
 
-	if (self->trash_monitor) {
-		g_object_unref(self->trash_monitor);
+	if (self->reconcile_idle_id != 0) {
+		g_source_remove(self->reconcile_idle_id);
+		self->reconcile_idle_id = 0;
+	}
+
+	// Don't lose the last changes if the panel is going away
+	if (self->history_save_id != 0) {
+		g_source_remove(self->history_save_id);
+		self->history_save_id = 0;
+		save_history(self, FALSE);
 	}
 
+	// Cancel any queries that are still in flight so their callbacks don't touch us
+	if (self->pending) {
+		g_hash_table_iter_init(&iter, self->pending);
+		while (g_hash_table_iter_next(&iter, NULL, &value)) {
+			g_cancellable_cancel(G_CANCELLABLE(value));
+		}
+	}
+
+	G_OBJECT_CLASS(trash_manager_parent_class)->dispose(object);
+}
+
+static void trash_manager_finalize(GObject *object) {
+	TrashManager *self;
+
+	self = TRASH_MANAGER(object);
+
+	g_clear_pointer(&self->scan_seen, g_hash_table_unref);
+	g_clear_pointer(&self->snapshot, g_array_unref);
+	g_clear_pointer(&self->recorder, trash_event_writer_free);
+	trash_path_tree_free(self->origins);
+	trash_history_free(self->history);
+	g_free(self->history_path);
+	g_hash_table_unref(self->requery);
+	g_hash_table_unref(self->pending);
+	g_hash_table_unref(self->items);
+	g_object_unref(self->backend);
+
 	G_OBJECT_CLASS(trash_manager_parent_class)->finalize(object);
 }
 
+static void trash_manager_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *spec) {
+	TrashManager *self;
+
+	self = TRASH_MANAGER(object);
+
+	switch (prop_id) {
+		case PROP_BACKEND:
+			g_value_set_object(value, self->backend);
+			break;
+		case PROP_EVENTS_PROCESSED:
+			g_value_set_uint64(value, self->events_processed);
+			break;
+		case PROP_EVENTS_COALESCED:
+			g_value_set_uint64(value, self->events_coalesced);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, spec);
+			break;
+	}
+}
+
+static void trash_manager_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *spec) {
+	TrashManager *self;
+
+	self = TRASH_MANAGER(object);
+
+	switch (prop_id) {
+		case PROP_BACKEND:
+			self->backend = g_value_dup_object(value);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, spec);
+			break;
+	}
+}
+
+static void trash_manager_constructed(GObject *object);
+
 static void trash_manager_class_init(TrashManagerClass *klass) {
 	GObjectClass *class;
 
 	class = G_OBJECT_CLASS(klass);
+	class->constructed = trash_manager_constructed;
+	class->dispose = trash_manager_dispose;
 	class->finalize = trash_manager_finalize;
+	class->get_property = trash_manager_get_property;
+	class->set_property = trash_manager_set_property;
+
+	// Properties
+
+	props[PROP_BACKEND] = g_param_spec_object(
+		"backend",
+		"Backend",
+		"Where the trashed items come from",
+		TRASH_TYPE_BACKEND,
+		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * TrashManager:events-processed:
+	 *
+	 * The number of change events that the backend has reported.
+	 */
+	props[PROP_EVENTS_PROCESSED] = g_param_spec_uint64(
+		"events-processed",
+		"Events processed",
+		"Change events reported by the backend",
+		0, G_MAXUINT64, 0,
+		G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * TrashManager:events-coalesced:
+	 *
+	 * The number of change events that didn't need any work, because
+	 * they repeated a change that was already known or being handled.
+	 */
+	props[PROP_EVENTS_COALESCED] = g_param_spec_uint64(
+		"events-coalesced",
+		"Events coalesced",
+		"Change events that repeated a known change",
+		0, G_MAXUINT64, 0,
+		G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties(class, LAST_PROP, props);
 
 	// Signals
 
@@ -56,74 +316,329 @@ static void trash_manager_class_init(TrashManagerClass *klass) {
 		G_TYPE_NONE,
 		1,
 		G_TYPE_POINTER);
+
+	/**
+	 * TrashManager::scan-finished:
+	 * @self: a #TrashManager
+	 *
+	 * Emitted when a scan started by trash_manager_scan_items() has gone
+	 * through every item in the trash bin.
+	 */
+	signals[SCAN_FINISHED] = g_signal_new(
+		"scan-finished",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		0);
 }
 
-static void trash_query_info_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
-	TrashManager *self = user_data;
-	GFileInfo *info;
-	const gchar *uri;
-	const gchar *unescaped_uri;
+/**
+ * Add an item to our set of known items and notify any listeners.
+ *
+ * If an item with the same name is already known, nothing happens.
+ */
+static void add_item(TrashManager *self, GFileInfo *file_info) {
+	const gchar *file_name;
+	g_autofree gchar *uri = NULL;
 	TrashInfo *trash_info;
+	gint64 trace_start;
 
-	info = g_file_query_info_finish(G_FILE(source), result, NULL);
+	trace_start = TRASH_TRACE_NOW();
+	file_name = g_file_info_get_name(file_info);
 
-	g_return_if_fail(G_IS_FILE_INFO(info));
+	if (self->scan_seen) {
+		g_hash_table_add(self->scan_seen, g_strdup(file_name));
+	}
 
-	uri = g_file_get_uri(G_FILE(source));
-	unescaped_uri = g_uri_unescape_string(uri, NULL);
-	trash_info = trash_info_new(info, unescaped_uri);
+	if (g_hash_table_contains(self->items, file_name)) {
+		return;
+	}
+
+	uri = g_strdup_printf("trash:///%s", file_name);
+	trash_info = trash_info_new(file_info, uri);
+
+	g_hash_table_insert(self->items, g_strdup(file_name), trash_info);
+	self->total_bytes += (guint64) trash_info_get_size(trash_info);
+	self->allocated_bytes += trash_info_get_allocated_size(trash_info);
+	trash_path_tree_add(self->origins, trash_info_peek_restore_path(trash_info), (guint64) trash_info_get_size(trash_info));
+
+	record_history(self);
 
-	self->file_count++;
 	g_signal_emit(self, signals[TRASH_ADDED], 0, trash_info);
+
+	TRASH_TRACE_MARK(trace_start, "add-item", "%s", file_name);
+	TRASH_TRACE_PROBE1(item__added, file_name);
 }
 
-static void file_changed(GFileMonitor *monitor, GFile *file, GFile *other_file, GFileMonitorEvent event, TrashManager *self) {
-	(void) monitor;
-	(void) other_file;
-
-	const gchar *uri;
-	const gchar *unescaped_uri;
-
-	switch (event) {
-		case G_FILE_MONITOR_EVENT_MOVED_IN:
-		case G_FILE_MONITOR_EVENT_CREATED:
-			g_file_query_info_async(
-				file,
-				TRASH_FILE_ATTRIBUTES,
-				G_FILE_QUERY_INFO_NONE,
-				G_PRIORITY_DEFAULT,
-				NULL,
-				trash_query_info_cb,
-				self);
-			break;
-		case G_FILE_MONITOR_EVENT_MOVED_OUT:
-		case G_FILE_MONITOR_EVENT_DELETED:
-			self->file_count--;
-			uri = g_file_get_uri(file);
-			unescaped_uri = g_uri_unescape_string(uri, NULL);
-			g_signal_emit(self, signals[TRASH_REMOVED], 0, unescaped_uri);
-			break;
-		default:
-			break;
+/**
+ * Remove an item from our set of known items and notify any listeners.
+ *
+ * If there is no item with the given name, nothing happens.
+ */
+static void remove_item(TrashManager *self, const gchar *file_name) {
+	GCancellable *pending;
+	TrashInfo *trash_info;
+	gint64 trace_start;
+
+	trace_start = TRASH_TRACE_NOW();
+
+	// An add for this item may still be waiting on its file info
+	pending = g_hash_table_lookup(self->pending, file_name);
+	if (pending) {
+		g_cancellable_cancel(pending);
+		g_hash_table_remove(self->pending, file_name);
+		g_hash_table_remove(self->requery, file_name);
+	}
+
+	trash_info = g_hash_table_lookup(self->items, file_name);
+	if (!trash_info) {
+		return;
 	}
+
+	self->total_bytes -= MIN(self->total_bytes, (guint64) trash_info_get_size(trash_info));
+	self->allocated_bytes -= MIN(self->allocated_bytes, trash_info_get_allocated_size(trash_info));
+	trash_path_tree_remove(self->origins, trash_info_peek_restore_path(trash_info), (guint64) trash_info_get_size(trash_info));
+
+	g_signal_emit(self, signals[TRASH_REMOVED], 0, trash_info_peek_uri(trash_info));
+	g_hash_table_remove(self->items, file_name);
+
+	record_history(self);
+
+	TRASH_TRACE_MARK(trace_start, "remove-item", "%s", file_name);
+	TRASH_TRACE_PROBE1(item__removed, file_name);
 }
 
-static void trash_manager_init(TrashManager *self) {
-	GFile *file;
+static gboolean reconcile_idle_cb(gpointer user_data) {
+	TrashManager *self = user_data;
+
+	self->reconcile_idle_id = 0;
+
+	trash_manager_reconcile(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Schedule a reconciliation of the trash bin as soon as we are idle.
+ * Multiple requests before it actually happens are collapsed into one.
+ */
+static void queue_reconcile(TrashManager *self) {
+	if (self->reconcile_idle_id != 0) {
+		return;
+	}
+
+	self->reconcile_idle_id = g_idle_add(reconcile_idle_cb, self);
+}
+
+typedef struct {
+	TrashManager *self;
+	gchar *file_name;
+} QueryData;
+
+static void query_data_free(QueryData *data) {
+	g_free(data->file_name);
+	g_slice_free(QueryData, data);
+}
+
+/**
+ * Add the file info for a newly trashed item to the event trace, so that a
+ * replay can recreate the item.
+ */
+static void record_info(TrashManager *self, GFileInfo *info) {
+	g_autoptr(GDateTime) deletion_date = NULL;
+
+	deletion_date = g_file_info_get_deletion_date(info);
+
+	trash_event_writer_add_info(
+		self->recorder,
+		g_file_info_get_name(info),
+		g_file_info_get_attribute_byte_string(info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH),
+		(guint64) g_file_info_get_size(info),
+		g_file_info_get_file_type(info) == G_FILE_TYPE_DIRECTORY,
+		deletion_date ? g_date_time_to_unix(deletion_date) : 0);
+}
+
+static void query_item(TrashManager *self, const gchar *file_name);
+
+static void trash_query_info_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	QueryData *data = user_data;
+	TrashManager *self = data->self;
+	g_autoptr(GFileInfo) info = NULL;
+	g_autoptr(GError) error = NULL;
+	gboolean added_again;
+
+	info = trash_backend_query_info_finish(TRASH_BACKEND(source), result, &error);
+
+	if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		// The item went away before we got its info; remove_item() already
+		// dropped our pending entry.
+		query_data_free(data);
+		return;
+	}
+
+	g_hash_table_remove(self->pending, data->file_name);
+	added_again = g_hash_table_remove(self->requery, data->file_name);
+
+	if (info && self->recorder) {
+		record_info(self, info);
+	}
+
+	if (!info) {
+		// Items commonly disappear again before we get to them, e.g. when the
+		// trash is emptied while files are still being moved into it. Any
+		// other failure is picked up again by the next event for the item.
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+			g_warning("Error getting info for trashed file '%s': %s", data->file_name, error->message);
+		} else if (added_again) {
+			// The info file usually shows up before the file itself, so the
+			// lookup can miss an item that is only halfway into the trash.
+			// The second add was for the rest of it, so look again.
+			query_item(self, data->file_name);
+		}
+
+		query_data_free(data);
+		return;
+	}
+
+	add_item(self, info);
+	query_data_free(data);
+}
+
+/**
+ * Asynchronously look up the info for a newly trashed item, and add it
+ * once we have it.
+ */
+static void query_item(TrashManager *self, const gchar *file_name) {
+	GCancellable *cancellable;
+	QueryData *data;
+
+	if (g_hash_table_contains(self->items, file_name) || g_hash_table_contains(self->pending, file_name)) {
+		return;
+	}
+
+	cancellable = g_cancellable_new();
+	g_hash_table_insert(self->pending, g_strdup(file_name), cancellable);
+
+	data = g_slice_new(QueryData);
+	data->self = self;
+	data->file_name = g_strdup(file_name);
+
+	trash_backend_query_info_async(
+		self->backend,
+		file_name,
+		TRASH_FILE_ATTRIBUTES,
+		G_PRIORITY_DEFAULT,
+		cancellable,
+		trash_query_info_cb,
+		data);
+}
+
+static void count_event(TrashManager *self) {
+	self->events_processed++;
+	g_object_notify_by_pspec(G_OBJECT(self), props[PROP_EVENTS_PROCESSED]);
+}
+
+static void count_coalesced(TrashManager *self) {
+	self->events_coalesced++;
+	g_object_notify_by_pspec(G_OBJECT(self), props[PROP_EVENTS_COALESCED]);
+}
+
+static void backend_item_added(TrashBackend *backend, const gchar *name, TrashManager *self) {
+	(void) backend;
+
+	count_event(self);
+
+	if (self->recorder) {
+		trash_event_writer_add(self->recorder, TRASH_EVENT_ADDED, name);
+	}
+
+	if (g_hash_table_contains(self->pending, name)) {
+		// The lookup may have started too early to see this change
+		g_hash_table_add(self->requery, g_strdup(name));
+		count_coalesced(self);
+		return;
+	}
+
+	if (g_hash_table_contains(self->items, name)) {
+		count_coalesced(self);
+		return;
+	}
+
+	query_item(self, name);
+}
+
+static void backend_item_removed(TrashBackend *backend, const gchar *name, TrashManager *self) {
+	(void) backend;
+
+	count_event(self);
+
+	if (self->recorder) {
+		trash_event_writer_add(self->recorder, TRASH_EVENT_REMOVED, name);
+	}
+
+	if (!g_hash_table_contains(self->items, name) && !g_hash_table_contains(self->pending, name)) {
+		count_coalesced(self);
+		return;
+	}
+
+	remove_item(self, name);
+}
+
+static void backend_resync(TrashBackend *backend, TrashManager *self) {
+	(void) backend;
+
+	count_event(self);
+
+	if (self->recorder) {
+		trash_event_writer_add(self->recorder, TRASH_EVENT_RESYNC, NULL);
+	}
+
+	if (self->reconcile_idle_id != 0) {
+		count_coalesced(self);
+		return;
+	}
+
+	queue_reconcile(self);
+}
 
-	self->file_count = 0;
+static void trash_manager_constructed(GObject *object) {
+	TrashManager *self;
+	const gchar *record_path;
+	g_autoptr(GError) error = NULL;
+
+	self = TRASH_MANAGER(object);
+
+	if (!self->backend) {
+		self->backend = trash_backend_new_default();
+	}
+
+	g_signal_connect_object(self->backend, "item-added", G_CALLBACK(backend_item_added), self, 0);
+	g_signal_connect_object(self->backend, "item-removed", G_CALLBACK(backend_item_removed), self, 0);
+	g_signal_connect_object(self->backend, "resync", G_CALLBACK(backend_resync), self, 0);
 
-	file = g_file_new_for_uri("trash:///");
+	record_path = g_getenv("BUDGIE_TRASH_RECORD_EVENTS");
 
-	self->trash_monitor = g_file_monitor(file, 0, NULL, NULL);
+	if (record_path && *record_path != '\0' && !trash_manager_start_recording(self, record_path, &error)) {
+		g_warning("%s", error->message);
+	}
+
+	G_OBJECT_CLASS(trash_manager_parent_class)->constructed(object);
+}
 
-	g_signal_connect(self->trash_monitor, "changed", G_CALLBACK(file_changed), self);
+static void trash_manager_init(TrashManager *self) {
+	self->items = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+	self->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+	self->requery = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	self->origins = trash_path_tree_new();
+	self->history = trash_history_new();
 }
 
 /**
  * trash_manager_new:
  *
- * Creates a new #TrashManager object.
+ * Creates a new #TrashManager object using the default backend.
  *
  * Returns: a new #TrashManager object
  */
@@ -131,44 +646,160 @@ TrashManager *trash_manager_new(void) {
 	return g_object_new(TRASH_TYPE_MANAGER, NULL);
 }
 
-static void next_file_cb(gpointer data, gpointer user_data) {
-	TrashManager *self = user_data;
-	g_autoptr(GFileInfo) file_info;
-	const gchar *file_name;
-	g_autofree const gchar *uri;
-	TrashInfo *trash_info;
+/**
+ * trash_manager_new_for_backend:
+ * @backend: (transfer none): the #TrashBackend to get items from
+ *
+ * Creates a new #TrashManager object using the given backend.
+ *
+ * Returns: a new #TrashManager object
+ */
+TrashManager *trash_manager_new_for_backend(TrashBackend *backend) {
+	g_return_val_if_fail(TRASH_IS_BACKEND(backend), NULL);
 
-	file_info = data;
+	return g_object_new(TRASH_TYPE_MANAGER, "backend", backend, NULL);
+}
 
-	g_return_if_fail(G_IS_FILE_INFO(file_info));
+/**
+ * trash_manager_get_backend:
+ * @self: a #TrashManager
+ *
+ * Gets the backend that this manager gets its items from.
+ *
+ * Returns: (transfer none): the #TrashBackend
+ */
+TrashBackend *trash_manager_get_backend(TrashManager *self) {
+	g_return_val_if_fail(TRASH_IS_MANAGER(self), NULL);
 
-	file_name = g_file_info_get_name(file_info);
-	uri = g_strdup_printf("trash:///%s", file_name);
-	trash_info = trash_info_new(file_info, uri);
+	return self->backend;
+}
 
-	self->file_count++;
-	g_signal_emit(self, signals[TRASH_ADDED], 0, trash_info);
+/**
+ * Clean up after a scan or reconciliation.
+ */
+static void scan_done(TrashManager *self) {
+	g_clear_pointer(&self->scan_seen, g_hash_table_unref);
+	g_clear_pointer(&self->snapshot, g_array_unref);
+	self->scan_running = FALSE;
+
+	record_history(self);
+
+	// Events were dropped or a reconcile was requested while we were busy
+	if (self->reconcile_queued) {
+		self->reconcile_queued = FALSE;
+		queue_reconcile(self);
+	}
+
+	g_object_unref(self);
+}
+
+/**
+ * Record how long the scan that just finished took.
+ */
+static void record_scan_stats(TrashManager *self) {
+	TrashScanStats *stats = &self->scan_stats;
+	struct rusage usage;
+	gdouble seconds;
+
+	stats->items = self->scan_count;
+	stats->time_to_complete = g_get_monotonic_time() - self->scan_start;
+	stats->time_to_first_item = self->scan_first_item > 0 ? self->scan_first_item - self->scan_start : -1;
+
+	seconds = (gdouble) stats->time_to_complete / G_USEC_PER_SEC;
+	stats->items_per_second = seconds > 0 ? stats->items / seconds : 0;
+
+	// ru_maxrss is in kilobytes on Linux and the BSDs
+	stats->peak_rss = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+
+	self->has_scan_stats = TRUE;
+
+	g_debug("Scanned %u trashed items in %.3f seconds (%.0f items/s, first item after %.3f seconds)",
+		stats->items,
+		seconds,
+		stats->items_per_second,
+		(gdouble) stats->time_to_first_item / G_USEC_PER_SEC);
+}
+
+/**
+ * Finish up a scan of the trash bin. Any items that we know about but
+ * weren't seen during the scan are no longer in the trash, so they get
+ * removed.
+ */
+static void scan_finished(TrashManager *self, gboolean success) {
+	g_autoptr(GPtrArray) stale = NULL;
+	GHashTableIter iter;
+	gpointer key;
+	guint i;
+
+	if (success) {
+		stale = g_ptr_array_new_with_free_func(g_free);
+
+		g_hash_table_iter_init(&iter, self->items);
+		while (g_hash_table_iter_next(&iter, &key, NULL)) {
+			if (!g_hash_table_contains(self->scan_seen, key) && !g_hash_table_contains(self->pending, key)) {
+				g_ptr_array_add(stale, g_strdup(key));
+			}
+		}
+
+		for (i = 0; i < stale->len; i++) {
+			remove_item(self, g_ptr_array_index(stale, i));
+		}
+
+		record_scan_stats(self);
+		self->scan_complete = TRUE;
+		g_signal_emit(self, signals[SCAN_FINISHED], 0);
+	}
+
+	TRASH_TRACE_MARK(self->scan_trace_start, "scan", "%u items, %s", self->scan_count, success ? "complete" : "failed");
+	TRASH_TRACE_PROBE2(scan__end, self->scan_count, success);
+
+	scan_done(self);
+}
+
+static void next_file_cb(gpointer data, gpointer user_data) {
+	TrashManager *self = user_data;
+	GFileInfo *file_info = data;
+
+	if (self->scan_count++ == 0) {
+		self->scan_first_item = g_get_monotonic_time();
+	}
+
+	add_item(self, file_info);
+	g_object_unref(file_info);
 }
 
 static void next_files_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
 	TrashManager *self = user_data;
-	g_autoptr(GList) files;
+	GList *files;
 	g_autoptr(GError) error = NULL;
+	gint64 trace_start;
+	guint count;
 
 	files = g_file_enumerator_next_files_finish(G_FILE_ENUMERATOR(source), result, &error);
 
 	if (error) {
 		g_critical("Error getting next files from enumerator: %s", error->message);
 		g_object_unref(source); // Unref the file enumerator
+		scan_finished(self, FALSE);
 		return;
 	}
 
 	if (!files) {
 		g_object_unref(source); // Unref the file enumerator
+		scan_finished(self, TRUE);
 		return;
 	}
 
+	trace_start = TRASH_TRACE_NOW();
+	count = self->scan_count;
+
+	trash_watchdog_enter("scan batch");
 	g_list_foreach(files, next_file_cb, self);
+	g_list_free(files);
+	trash_watchdog_leave();
+
+	TRASH_TRACE_MARK(trace_start, "scan-batch", "%u items", self->scan_count - count);
+	TRASH_TRACE_PROBE1(scan__batch, self->scan_count - count);
 
 	g_file_enumerator_next_files_async(G_FILE_ENUMERATOR(source), 8, G_PRIORITY_DEFAULT, NULL, next_files_cb, self);
 }
@@ -178,10 +809,11 @@ static void trash_enumerate_cb(GObject *source, GAsyncResult *result, gpointer u
 	GFileEnumerator *enumerator;
 	g_autoptr(GError) error = NULL;
 
-	enumerator = g_file_enumerate_children_finish(G_FILE(source), result, &error);
+	enumerator = trash_backend_enumerate_finish(TRASH_BACKEND(source), result, &error);
 
 	if (!G_IS_FILE_ENUMERATOR(enumerator)) {
 		g_critical("Error getting trash enumerator: %s", error->message);
+		scan_finished(self, FALSE);
 		return;
 	}
 
@@ -193,23 +825,239 @@ static void trash_enumerate_cb(GObject *source, GAsyncResult *result, gpointer u
  * @self: a #TrashManager
  *
  * Scan the trash bin for items. The `trash-added` signal will be called for each
- * item found in the bin.
+ * item found in the bin that we didn't already know about, and the `trash-removed`
+ * signal will be called for each known item that is no longer in the bin.
  *
- * The files are enumerated asynchronously.
+ * The files are enumerated asynchronously. If a scan or reconciliation is already
+ * running, a reconciliation is queued to run after it finishes instead.
  */
 void trash_manager_scan_items(TrashManager *self) {
-	g_autoptr(GFile) file;
+	g_return_if_fail(TRASH_IS_MANAGER(self));
+
+	if (self->scan_running) {
+		self->reconcile_queued = TRUE;
+		return;
+	}
+
+	self->scan_running = TRUE;
+	self->scan_seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	self->scan_start = g_get_monotonic_time();
+	self->scan_first_item = 0;
+	self->scan_count = 0;
+	self->scan_trace_start = TRASH_TRACE_NOW();
 
-	file = g_file_new_for_uri("trash:///");
+	TRASH_TRACE_PROBE(scan__start);
 
-	g_file_enumerate_children_async(
-		file,
+	trash_backend_enumerate_async(
+		self->backend,
 		TRASH_FILE_ATTRIBUTES,
-		G_FILE_QUERY_INFO_NONE,
 		G_PRIORITY_DEFAULT,
 		NULL,
 		trash_enumerate_cb,
-		self);
+		g_object_ref(self));
+}
+
+typedef struct {
+	gchar *name;
+	gint64 modified_time;
+} SnapshotEntry;
+
+static void snapshot_entry_clear(gpointer data) {
+	SnapshotEntry *entry = data;
+
+	g_free(entry->name);
+}
+
+static gint snapshot_entry_compare(gconstpointer a, gconstpointer b) {
+	const SnapshotEntry *entry_a = a;
+	const SnapshotEntry *entry_b = b;
+
+	return strcmp(entry_a->name, entry_b->name);
+}
+
+/**
+ * Compare a fresh snapshot of the trash bin against the items we know
+ * about, and apply only the differences.
+ *
+ * Both sets are sorted by name and walked in lockstep, so this is
+ * O(n log n) no matter how far the two have drifted apart.
+ *
+ * Returns: TRUE if anything had to be fixed up
+ */
+static gboolean reconcile_apply(TrashManager *self, GArray *snapshot) {
+	g_autoptr(GArray) current = NULL;
+	g_autoptr(GPtrArray) added = NULL;
+	g_autoptr(GPtrArray) removed = NULL;
+	SnapshotEntry *theirs;
+	SnapshotEntry *ours;
+	GHashTableIter iter;
+	gpointer key, value;
+	guint i, j;
+	gint cmp;
+
+	current = g_array_sized_new(FALSE, FALSE, sizeof(SnapshotEntry), g_hash_table_size(self->items));
+
+	// The names here are borrowed from our item table, so don't touch the
+	// table until we are done walking both sets.
+	g_hash_table_iter_init(&iter, self->items);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		SnapshotEntry entry = {key, trash_info_get_modified_time(TRASH_INFO(value))};
+		g_array_append_val(current, entry);
+	}
+
+	g_array_sort(snapshot, snapshot_entry_compare);
+	g_array_sort(current, snapshot_entry_compare);
+
+	added = g_ptr_array_new_with_free_func(g_free);
+	removed = g_ptr_array_new_with_free_func(g_free);
+
+	i = j = 0;
+	while (i < snapshot->len || j < current->len) {
+		theirs = i < snapshot->len ? &g_array_index(snapshot, SnapshotEntry, i) : NULL;
+		ours = j < current->len ? &g_array_index(current, SnapshotEntry, j) : NULL;
+
+		if (!ours) {
+			cmp = -1;
+		} else if (!theirs) {
+			cmp = 1;
+		} else {
+			cmp = strcmp(theirs->name, ours->name);
+		}
+
+		if (cmp < 0) {
+			// We missed this one being added
+			g_ptr_array_add(added, g_strdup(theirs->name));
+			i++;
+		} else if (cmp > 0) {
+			// We missed this one being removed, unless it was added while
+			// the snapshot was being taken.
+			if (!g_hash_table_contains(self->scan_seen, ours->name)) {
+				g_ptr_array_add(removed, g_strdup(ours->name));
+			}
+			j++;
+		} else {
+			// An item with the same name has replaced the one we know about
+			if (theirs->modified_time != ours->modified_time && !g_hash_table_contains(self->scan_seen, ours->name)) {
+				g_ptr_array_add(removed, g_strdup(ours->name));
+				g_ptr_array_add(added, g_strdup(theirs->name));
+			}
+			i++;
+			j++;
+		}
+	}
+
+	for (i = 0; i < removed->len; i++) {
+		remove_item(self, g_ptr_array_index(removed, i));
+	}
+
+	for (i = 0; i < added->len; i++) {
+		query_item(self, g_ptr_array_index(added, i));
+	}
+
+	if (added->len > 0 || removed->len > 0) {
+		g_debug("Reconciled trash bin: %u missed adds, %u missed removals", added->len, removed->len);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void reconcile_finished(TrashManager *self, gboolean success) {
+	if (success) {
+		trash_watchdog_enter("reconcile");
+		reconcile_apply(self, self->snapshot);
+		trash_watchdog_leave();
+	}
+
+	scan_done(self);
+}
+
+static void snapshot_next_files_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	TrashManager *self = user_data;
+	GList *files, *l;
+	g_autoptr(GError) error = NULL;
+
+	files = g_file_enumerator_next_files_finish(G_FILE_ENUMERATOR(source), result, &error);
+
+	if (error) {
+		g_warning("Error taking a snapshot of the trash bin: %s", error->message);
+		g_object_unref(source); // Unref the file enumerator
+		reconcile_finished(self, FALSE);
+		return;
+	}
+
+	if (!files) {
+		g_object_unref(source); // Unref the file enumerator
+		reconcile_finished(self, TRUE);
+		return;
+	}
+
+	for (l = files; l; l = l->next) {
+		GFileInfo *info = l->data;
+		SnapshotEntry entry;
+
+		entry.name = g_strdup(g_file_info_get_name(info));
+		entry.modified_time = trash_info_get_modified_time_from_file_info(info);
+		g_array_append_val(self->snapshot, entry);
+
+		g_object_unref(info);
+	}
+
+	g_list_free(files);
+
+	g_file_enumerator_next_files_async(G_FILE_ENUMERATOR(source), 256, G_PRIORITY_LOW, NULL, snapshot_next_files_cb, self);
+}
+
+static void snapshot_enumerate_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	TrashManager *self = user_data;
+	GFileEnumerator *enumerator;
+	g_autoptr(GError) error = NULL;
+
+	enumerator = trash_backend_enumerate_finish(TRASH_BACKEND(source), result, &error);
+
+	if (!G_IS_FILE_ENUMERATOR(enumerator)) {
+		g_warning("Error taking a snapshot of the trash bin: %s", error->message);
+		reconcile_finished(self, FALSE);
+		return;
+	}
+
+	g_file_enumerator_next_files_async(enumerator, 256, G_PRIORITY_LOW, NULL, snapshot_next_files_cb, self);
+}
+
+/**
+ * trash_manager_reconcile:
+ * @self: a #TrashManager
+ *
+ * Check that our set of items matches what is actually in the trash bin.
+ *
+ * A cheap snapshot of the item names and modification times is taken and
+ * compared against the known items. The `trash-added` and `trash-removed`
+ * signals are only emitted for the items that differ.
+ *
+ * This also happens on its own whenever the backend reports that it may
+ * have missed changes. There is no timer, so nothing wakes up while the
+ * trash bin is left alone.
+ */
+void trash_manager_reconcile(TrashManager *self) {
+	g_return_if_fail(TRASH_IS_MANAGER(self));
+
+	if (self->scan_running) {
+		self->reconcile_queued = TRUE;
+		return;
+	}
+
+	self->scan_running = TRUE;
+	self->scan_seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	self->snapshot = g_array_new(FALSE, FALSE, sizeof(SnapshotEntry));
+	g_array_set_clear_func(self->snapshot, snapshot_entry_clear);
+
+	trash_backend_enumerate_async(
+		self->backend,
+		TRASH_SNAPSHOT_ATTRIBUTES,
+		G_PRIORITY_LOW,
+		NULL,
+		snapshot_enumerate_cb,
+		g_object_ref(self));
 }
 
 /**
@@ -223,5 +1071,167 @@ void trash_manager_scan_items(TrashManager *self) {
 gint trash_manager_get_item_count(TrashManager *self) {
 	g_return_val_if_fail(self != NULL, -1);
 
-	return self->file_count;
+	return (gint) g_hash_table_size(self->items);
+}
+
+/**
+ * trash_manager_foreach_item:
+ * @self: a #TrashManager
+ * @func: (scope call): called with each #TrashInfo
+ * @user_data: data to pass to @func
+ *
+ * Calls @func for every item in the trash bin, in no particular order.
+ * Items must not be added or removed from @func.
+ */
+void trash_manager_foreach_item(TrashManager *self, GFunc func, gpointer user_data) {
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail(TRASH_IS_MANAGER(self));
+	g_return_if_fail(func != NULL);
+
+	g_hash_table_iter_init(&iter, self->items);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		func(value, user_data);
+	}
+}
+
+/**
+ * trash_manager_get_scan_stats:
+ * @self: a #TrashManager
+ * @stats: (out caller-allocates): where to store the stats
+ *
+ * Gets the timings for the last scan started with trash_manager_scan_items()
+ * that went through the whole trash bin.
+ *
+ * Returns: %TRUE if a scan has finished and @stats was filled in
+ */
+gboolean trash_manager_get_scan_stats(TrashManager *self, TrashScanStats *stats) {
+	g_return_val_if_fail(TRASH_IS_MANAGER(self), FALSE);
+	g_return_val_if_fail(stats != NULL, FALSE);
+
+	if (!self->has_scan_stats) {
+		return FALSE;
+	}
+
+	*stats = self->scan_stats;
+
+	return TRUE;
+}
+
+/**
+ * trash_manager_get_counters:
+ * @self: a #TrashManager
+ * @counters: (out caller-allocates): where to store the counters
+ *
+ * Gets the running totals for the items in the trash bin and the change
+ * events that the backend has reported. These are kept up to date as
+ * things happen, so this is cheap to call.
+ */
+void trash_manager_get_counters(TrashManager *self, TrashManagerCounters *counters) {
+	g_return_if_fail(TRASH_IS_MANAGER(self));
+	g_return_if_fail(counters != NULL);
+
+	counters->items = g_hash_table_size(self->items);
+	counters->pending_queries = g_hash_table_size(self->pending);
+	counters->total_bytes = self->total_bytes;
+	counters->allocated_bytes = self->allocated_bytes;
+	counters->events_processed = self->events_processed;
+	counters->events_coalesced = self->events_coalesced;
+}
+
+/**
+ * trash_manager_get_origins:
+ * @self: a #TrashManager
+ *
+ * Gets the counts of items by the directory they were trashed from. The
+ * tree is updated as items are added and removed, so it is always current
+ * without going through the items.
+ *
+ * Returns: (transfer none): the #TrashPathTree owned by @self
+ */
+TrashPathTree *trash_manager_get_origins(TrashManager *self) {
+	g_return_val_if_fail(TRASH_IS_MANAGER(self), NULL);
+
+	return self->origins;
+}
+
+/**
+ * trash_manager_get_history:
+ * @self: a #TrashManager
+ *
+ * Gets the history of how full the trash bin has been. It is sampled as
+ * items come and go, so reading it never touches the disk.
+ *
+ * Returns: (transfer none): the #TrashHistory owned by @self
+ */
+TrashHistory *trash_manager_get_history(TrashManager *self) {
+	g_return_val_if_fail(TRASH_IS_MANAGER(self), NULL);
+
+	return self->history;
+}
+
+/**
+ * trash_manager_persist_history:
+ * @self: a #TrashManager
+ * @path: the file to keep the history in
+ *
+ * Loads the history saved at @path, replacing the one in memory, and
+ * saves it back there a little while after it changes. A missing or
+ * unreadable file just starts a new history.
+ */
+void trash_manager_persist_history(TrashManager *self, const gchar *path) {
+	g_autoptr(GError) error = NULL;
+	TrashHistory *history;
+
+	g_return_if_fail(TRASH_IS_MANAGER(self));
+	g_return_if_fail(path != NULL);
+
+	g_free(self->history_path);
+	self->history_path = g_strdup(path);
+
+	history = trash_history_load(path, &error);
+
+	if (!history) {
+		if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			g_warning("Unable to load trash history: %s", error->message);
+		}
+
+		return;
+	}
+
+	trash_history_free(self->history);
+	self->history = history;
+}
+
+/**
+ * trash_manager_start_recording:
+ * @self: a #TrashManager
+ * @path: where to write the event trace
+ * @error: return location for a #GError
+ *
+ * Starts recording every change event that the backend reports, along
+ * with the file info looked up for new items, to an event trace at @path.
+ * Any recording that was already running is stopped first.
+ *
+ * Returns: %TRUE if recording started
+ */
+gboolean trash_manager_start_recording(TrashManager *self, const gchar *path, GError **error) {
+	TrashEventWriter *recorder;
+
+	g_return_val_if_fail(TRASH_IS_MANAGER(self), FALSE);
+	g_return_val_if_fail(path != NULL, FALSE);
+
+	g_clear_pointer(&self->recorder, trash_event_writer_free);
+
+	recorder = trash_event_writer_new(path, error);
+
+	if (!recorder) {
+		return FALSE;
+	}
+
+	self->recorder = recorder;
+
+	return TRUE;
 }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "trash_backend.h"
+#include "trash_history.h"
 #include "trash_info.h"
+#include "trash_path_tree.h"
 #include <gio/gio.h>
 
 G_BEGIN_DECLS
@@ -9,7 +12,53 @@ G_BEGIN_DECLS
  * All of the file attributes that we need to query for to build a
  * TrashInfo struct.
  */
-#define TRASH_FILE_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," G_FILE_ATTRIBUTE_STANDARD_TARGET_URI "," G_FILE_ATTRIBUTE_STANDARD_ICON "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_TRASH_DELETION_DATE "," G_FILE_ATTRIBUTE_TRASH_ORIG_PATH
+#define TRASH_FILE_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," G_FILE_ATTRIBUTE_STANDARD_TARGET_URI "," G_FILE_ATTRIBUTE_STANDARD_ICON "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE "," G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_TRASH_DELETION_DATE "," G_FILE_ATTRIBUTE_TRASH_ORIG_PATH "," G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+/**
+ * The file attributes needed to take a cheap snapshot of the trash bin
+ * to reconcile against.
+ */
+#define TRASH_SNAPSHOT_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+/**
+ * TrashScanStats:
+ * @items: the number of items found
+ * @time_to_first_item: microseconds from the start of the scan until the
+ *   first item was found, or -1 if the trash bin was empty
+ * @time_to_complete: microseconds from the start of the scan until it finished
+ * @items_per_second: how many items were found per second
+ * @peak_rss: the peak resident set size of the process, in kilobytes
+ *
+ * Timings for a scan of the trash bin.
+ */
+typedef struct {
+	guint items;
+	gint64 time_to_first_item;
+	gint64 time_to_complete;
+	gdouble items_per_second;
+	glong peak_rss;
+} TrashScanStats;
+
+/**
+ * TrashManagerCounters:
+ * @items: the number of items in the trash bin
+ * @pending_queries: the number of new items still waiting on their info
+ * @total_bytes: the combined size of every item
+ * @allocated_bytes: the combined space that the items take up on disk
+ * @events_processed: how many change events the backend has reported
+ * @events_coalesced: how many of those events needed no extra work,
+ *   because the change they reported was already known or queued
+ *
+ * Running totals kept by a #TrashManager as items come and go.
+ */
+typedef struct {
+	guint items;
+	guint pending_queries;
+	guint64 total_bytes;
+	guint64 allocated_bytes;
+	guint64 events_processed;
+	guint64 events_coalesced;
+} TrashManagerCounters;
 
 #define TRASH_TYPE_MANAGER (trash_manager_get_type())
 
@@ -17,8 +66,28 @@ G_DECLARE_FINAL_TYPE(TrashManager, trash_manager, TRASH, MANAGER, GObject)
 
 TrashManager *trash_manager_new(void);
 
+TrashManager *trash_manager_new_for_backend(TrashBackend *backend);
+
+TrashBackend *trash_manager_get_backend(TrashManager *self);
+
 void trash_manager_scan_items(TrashManager *self);
 
+void trash_manager_reconcile(TrashManager *self);
+
 gint trash_manager_get_item_count(TrashManager *self);
 
+void trash_manager_foreach_item(TrashManager *self, GFunc func, gpointer user_data);
+
+gboolean trash_manager_get_scan_stats(TrashManager *self, TrashScanStats *stats);
+
+void trash_manager_get_counters(TrashManager *self, TrashManagerCounters *counters);
+
+TrashPathTree *trash_manager_get_origins(TrashManager *self);
+
+TrashHistory *trash_manager_get_history(TrashManager *self);
+
+void trash_manager_persist_history(TrashManager *self, const gchar *path);
+
+gboolean trash_manager_start_recording(TrashManager *self, const gchar *path, GError **error);
+
 G_END_DECLS
@@ -0,0 +1,389 @@
+/**
+ * SECTION:trashpathtree
+ * @Short_description: Counts trashed items by the directory they came from
+ * @Title: Path trees
+ *
+ * A #TrashPathTree has a node for every directory that an item was
+ * trashed from, and for every directory above those. Each node counts the
+ * items below it and their combined size, so adding or removing an item
+ * only touches the nodes on its path, and the totals for any directory
+ * can be read without going through the items.
+ *
+ * Directories that no longer have anything in them are pruned.
+ */
+
+#include "trash_path_tree.h"
+#include <string.h>
+
+typedef struct _PathNode PathNode;
+
+struct _PathNode {
+	gchar *name;
+	PathNode *parent;
+
+	/* Name to PathNode, or NULL if there are none */
+	GHashTable *children;
+
+	/* Everything trashed from this directory or anywhere below it */
+	guint items;
+	guint64 bytes;
+
+	/* Only what was trashed from this directory itself */
+	guint own_items;
+	guint64 own_bytes;
+};
+
+struct _TrashPathTree {
+	PathNode *root;
+};
+
+typedef struct {
+	PathNode *node;
+	gboolean own_only;
+} Slice;
+
+static PathNode *path_node_new(const gchar *name, PathNode *parent) {
+	PathNode *node;
+
+	node = g_slice_new0(PathNode);
+	node->name = g_strdup(name);
+	node->parent = parent;
+
+	return node;
+}
+
+static void path_node_free(gpointer data) {
+	PathNode *node = data;
+
+	g_clear_pointer(&node->children, g_hash_table_unref);
+	g_free(node->name);
+	g_slice_free(PathNode, node);
+}
+
+static PathNode *path_node_get_child(PathNode *node, const gchar *name, gboolean create) {
+	PathNode *child;
+
+	child = node->children ? g_hash_table_lookup(node->children, name) : NULL;
+
+	if (child || !create) {
+		return child;
+	}
+
+	if (!node->children) {
+		node->children = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, path_node_free);
+	}
+
+	child = path_node_new(name, node);
+	g_hash_table_insert(node->children, child->name, child);
+
+	return child;
+}
+
+/**
+ * Find the node for the directory that @path is in, splitting @path in
+ * place. With @create, missing nodes are added along the way.
+ */
+static PathNode *find_parent_node(TrashPathTree *self, gchar *path, gboolean create) {
+	PathNode *node = self->root;
+	gchar *component, *slash;
+
+	if (!path || *path != G_DIR_SEPARATOR) {
+		return node;
+	}
+
+	component = path + 1;
+
+	while (node && (slash = strchr(component, G_DIR_SEPARATOR))) {
+		*slash = '\0';
+
+		// Skip over empty components from doubled slashes
+		if (*component != '\0') {
+			node = path_node_get_child(node, component, create);
+		}
+
+		component = slash + 1;
+	}
+
+	return node;
+}
+
+/**
+ * trash_path_tree_entry_free:
+ * @entry: (transfer full): a #TrashPathTreeEntry
+ *
+ * Frees an entry from a breakdown.
+ */
+void trash_path_tree_entry_free(TrashPathTreeEntry *entry) {
+	if (!entry) {
+		return;
+	}
+
+	g_free(entry->path);
+	g_slice_free(TrashPathTreeEntry, entry);
+}
+
+/**
+ * trash_path_tree_new:
+ *
+ * Creates a new, empty tree.
+ *
+ * Returns: (transfer full): a new #TrashPathTree
+ */
+TrashPathTree *trash_path_tree_new(void) {
+	TrashPathTree *self;
+
+	self = g_slice_new0(TrashPathTree);
+	self->root = path_node_new("", NULL);
+
+	return self;
+}
+
+/**
+ * trash_path_tree_free:
+ * @self: (transfer full): a #TrashPathTree
+ *
+ * Frees a tree and all of its nodes.
+ */
+void trash_path_tree_free(TrashPathTree *self) {
+	if (!self) {
+		return;
+	}
+
+	path_node_free(self->root);
+	g_slice_free(TrashPathTree, self);
+}
+
+/**
+ * trash_path_tree_add:
+ * @self: a #TrashPathTree
+ * @path: (nullable): the original path of a trashed item
+ * @bytes: the size of the item
+ *
+ * Counts an item under the directory it was trashed from, and every
+ * directory above that. Items without an absolute path are only counted
+ * at the root.
+ */
+void trash_path_tree_add(TrashPathTree *self, const gchar *path, guint64 bytes) {
+	g_autofree gchar *copy = NULL;
+	PathNode *node;
+
+	g_return_if_fail(self != NULL);
+
+	copy = g_strdup(path);
+	node = find_parent_node(self, copy, TRUE);
+
+	node->own_items++;
+	node->own_bytes += bytes;
+
+	for (; node; node = node->parent) {
+		node->items++;
+		node->bytes += bytes;
+	}
+}
+
+/**
+ * trash_path_tree_remove:
+ * @self: a #TrashPathTree
+ * @path: (nullable): the original path of a trashed item
+ * @bytes: the size of the item
+ *
+ * Takes back an item counted with trash_path_tree_add(), using the same
+ * path and size.
+ */
+void trash_path_tree_remove(TrashPathTree *self, const gchar *path, guint64 bytes) {
+	g_autofree gchar *copy = NULL;
+	PathNode *node, *parent;
+
+	g_return_if_fail(self != NULL);
+
+	copy = g_strdup(path);
+	node = find_parent_node(self, copy, FALSE);
+
+	g_return_if_fail(node != NULL && node->own_items > 0);
+
+	node->own_items--;
+	node->own_bytes -= MIN(node->own_bytes, bytes);
+
+	while (node) {
+		parent = node->parent;
+
+		node->items--;
+		node->bytes -= MIN(node->bytes, bytes);
+
+		if (node->items == 0 && parent) {
+			g_hash_table_remove(parent->children, node->name);
+		}
+
+		node = parent;
+	}
+}
+
+/**
+ * trash_path_tree_lookup:
+ * @self: a #TrashPathTree
+ * @directory: an absolute directory path
+ * @items: (out) (optional): return location for the number of items
+ * @bytes: (out) (optional): return location for their combined size
+ *
+ * Gets the totals for everything that was trashed from @directory or any
+ * directory below it.
+ *
+ * Returns: %TRUE if anything was trashed from there
+ */
+gboolean trash_path_tree_lookup(TrashPathTree *self, const gchar *directory, guint *items, guint64 *bytes) {
+	g_autofree gchar *copy = NULL;
+	PathNode *node;
+
+	g_return_val_if_fail(self != NULL, FALSE);
+	g_return_val_if_fail(directory != NULL, FALSE);
+
+	// Look up the directory itself rather than its parent
+	copy = g_strconcat(directory, G_DIR_SEPARATOR_S, NULL);
+	node = find_parent_node(self, copy, FALSE);
+
+	if (!node || node->items == 0) {
+		return FALSE;
+	}
+
+	if (items) {
+		*items = node->items;
+	}
+
+	if (bytes) {
+		*bytes = node->bytes;
+	}
+
+	return TRUE;
+}
+
+static gchar *path_node_get_path(PathNode *node) {
+	GPtrArray *names;
+	GString *path;
+	guint i;
+
+	if (!node->parent) {
+		return g_strdup(G_DIR_SEPARATOR_S);
+	}
+
+	names = g_ptr_array_new();
+
+	for (; node->parent; node = node->parent) {
+		g_ptr_array_add(names, node->name);
+	}
+
+	path = g_string_new(NULL);
+
+	for (i = names->len; i > 0; i--) {
+		g_string_append_c(path, G_DIR_SEPARATOR);
+		g_string_append(path, g_ptr_array_index(names, i - 1));
+	}
+
+	g_ptr_array_unref(names);
+
+	return g_string_free(path, FALSE);
+}
+
+static guint64 slice_bytes(Slice *slice) {
+	return slice->own_only ? slice->node->own_bytes : slice->node->bytes;
+}
+
+static gint compare_entries(gconstpointer a, gconstpointer b) {
+	const TrashPathTreeEntry *entry_a = *(TrashPathTreeEntry **) a;
+	const TrashPathTreeEntry *entry_b = *(TrashPathTreeEntry **) b;
+
+	return (entry_a->bytes < entry_b->bytes) - (entry_a->bytes > entry_b->bytes);
+}
+
+/**
+ * trash_path_tree_get_breakdown:
+ * @self: a #TrashPathTree
+ * @max_entries: the most directories to return
+ *
+ * Splits the trash bin up by where things came from, as finely as
+ * @max_entries allows. Starting from the root, the biggest directory is
+ * repeatedly replaced by its subdirectories, plus an entry of its own for
+ * anything trashed from it directly, for as long as that fits. The
+ * entries don't overlap, so together they add up to the whole trash bin.
+ *
+ * This only looks at the directories that get split, never at the items.
+ *
+ * Returns: (transfer full) (element-type TrashPathTreeEntry): the
+ *   directories, biggest first
+ */
+GPtrArray *trash_path_tree_get_breakdown(TrashPathTree *self, guint max_entries) {
+	g_autoptr(GArray) slices = NULL;
+	GPtrArray *entries;
+	TrashPathTreeEntry *entry;
+	GHashTableIter iter;
+	gpointer value;
+	Slice *slice, *largest;
+	Slice split;
+	guint i, largest_index, added;
+
+	g_return_val_if_fail(self != NULL, NULL);
+
+	entries = g_ptr_array_new_with_free_func((GDestroyNotify) trash_path_tree_entry_free);
+
+	if (self->root->items == 0 || max_entries == 0) {
+		return entries;
+	}
+
+	slices = g_array_new(FALSE, FALSE, sizeof(Slice));
+	g_array_append_val(slices, ((Slice){self->root, FALSE}));
+
+	for (;;) {
+		largest = NULL;
+		largest_index = 0;
+
+		for (i = 0; i < slices->len; i++) {
+			slice = &g_array_index(slices, Slice, i);
+
+			if (slice->own_only || !slice->node->children || g_hash_table_size(slice->node->children) == 0) {
+				continue;
+			}
+
+			if (!largest || slice_bytes(slice) > slice_bytes(largest)) {
+				largest = slice;
+				largest_index = i;
+			}
+		}
+
+		if (!largest) {
+			break;
+		}
+
+		added = g_hash_table_size(largest->node->children) + (largest->node->own_items > 0 ? 1 : 0);
+
+		if (slices->len - 1 + added > max_entries) {
+			break;
+		}
+
+		split = *largest;
+		g_array_remove_index_fast(slices, largest_index);
+
+		if (split.node->own_items > 0) {
+			g_array_append_val(slices, ((Slice){split.node, TRUE}));
+		}
+
+		g_hash_table_iter_init(&iter, split.node->children);
+
+		while (g_hash_table_iter_next(&iter, NULL, &value)) {
+			g_array_append_val(slices, ((Slice){value, FALSE}));
+		}
+	}
+
+	for (i = 0; i < slices->len; i++) {
+		slice = &g_array_index(slices, Slice, i);
+
+		entry = g_slice_new0(TrashPathTreeEntry);
+		entry->path = path_node_get_path(slice->node);
+		entry->items = slice->own_only ? slice->node->own_items : slice->node->items;
+		entry->bytes = slice_bytes(slice);
+
+		g_ptr_array_add(entries, entry);
+	}
+
+	g_ptr_array_sort(entries, compare_entries);
+
+	return entries;
+}
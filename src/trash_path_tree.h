@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * TrashPathTreeEntry:
+ * @path: an absolute directory path
+ * @items: the number of items counted for @path
+ * @bytes: the combined size of those items
+ *
+ * One line of a breakdown from trash_path_tree_get_breakdown().
+ */
+typedef struct {
+	gchar *path;
+	guint items;
+	guint64 bytes;
+} TrashPathTreeEntry;
+
+void trash_path_tree_entry_free(TrashPathTreeEntry *entry);
+
+typedef struct _TrashPathTree TrashPathTree;
+
+TrashPathTree *trash_path_tree_new(void);
+
+void trash_path_tree_free(TrashPathTree *self);
+
+void trash_path_tree_add(TrashPathTree *self, const gchar *path, guint64 bytes);
+
+void trash_path_tree_remove(TrashPathTree *self, const gchar *path, guint64 bytes);
+
+gboolean trash_path_tree_lookup(TrashPathTree *self, const gchar *directory, guint *items, guint64 *bytes);
+
+GPtrArray *trash_path_tree_get_breakdown(TrashPathTree *self, guint max_entries);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(TrashPathTreeEntry, trash_path_tree_entry_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(TrashPathTree, trash_path_tree_free)
+
+G_END_DECLS
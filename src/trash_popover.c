@@ -6,13 +6,71 @@
  * The #TrashPopover widget is the contents of the trash applet's popover. It
  * consists of a header and a list of files below it, as well as buttons to
  * restore items or empty the trash bin.
+ *
+ * Which rows are selected is mirrored into a #TrashSelection as each row
+ * changes, so the selected count and size are always at hand. The header
+ * has a menu to select items in bulk, and Restore and Delete hand the
+ * whole selection to the backend as one batch.
+ *
+ * The search entry above the list hides the items that don't match, see
+ * #TrashFilter. With the button next to it toggled, it looks for the text
+ * inside the trashed files instead, and files show up as they are found.
+ *
+ * Another header button shows where the trash came from: the directories
+ * holding the most trashed bytes, from the counts that the #TrashManager
+ * keeps by directory. Next to the title, a sparkline shows how the size of
+ * the trash bin changed over the last week, drawn from the manager's
+ * #TrashHistory.
+ *
+ * Rows are reused: when an item goes away its row is put aside in a pool
+ * and bound to the next item that comes in. There is only one bar to
+ * confirm deleting a single item, which is moved into whichever row asked
+ * for it.
+ *
+ * While the popover is closed, the list isn't touched at all. Items that
+ * come and go are only noted, with an add and a later remove of the same
+ * item cancelling out, and the rows are brought up to date in one go when
+ * the popover is opened again.
  */
 
 #include "trash_popover.h"
+#include "notify.h"
+#include "trash_content_search.h"
+#include "trash_duplicates.h"
+#include "trash_filter.h"
+#include "trash_selection.h"
+#include "trash_trace.h"
+#include "trash_watchdog.h"
+
+/**
+ * How old items have to be, in days, for "Older Than 30 Days".
+ */
+#define TRASH_SELECT_OLDER_DAYS 30
+
+/**
+ * How big items have to be, in bytes, for "Larger Than 1 GB".
+ */
+#define TRASH_SELECT_LARGER_BYTES G_GUINT64_CONSTANT(1000000000)
+
+/**
+ * How many directories to list for where the trash came from.
+ */
+#define TRASH_ORIGINS_MAX_ENTRIES 8
+
+/**
+ * How far back, in days, the sparkline in the header goes.
+ */
+#define TRASH_SPARKLINE_DAYS 7
+
+/**
+ * How many rows to keep around for reuse after their items go away.
+ */
+#define TRASH_ROW_POOL_SIZE 128
 
 enum {
 	TRASH_RESPONSE_EMPTY = 1,
-	TRASH_RESPONSE_RESTORE
+	TRASH_RESPONSE_RESTORE,
+	TRASH_RESPONSE_DELETE
 };
 
 enum {
@@ -20,29 +78,60 @@ enum {
 	LAST_PROP
 };
 
-enum {
-	TRASH_EMPTY,
-	TRASH_FILLED,
-	LAST_SIGNAL
-};
-
 static GParamSpec *props[LAST_PROP] = {
 	NULL,
 };
-static guint signals[LAST_SIGNAL];
 
 struct _TrashPopover {
 	GtkBox parent_instance;
 
 	TrashManager *trash_manager;
+	TrashPurgeScheduler *purge_scheduler;
+	TrashPressureMonitor *pressure_monitor;
+	TrashSelection *selection;
+	TrashFilter *filter;
+	TrashContentSearch *content_search;
+	GSimpleActionGroup *actions;
+
+	/* URI to row, for every row in the list */
+	GHashTable *rows;
+
+	/* Rows waiting to be bound to a new item */
+	GPtrArray *row_pool;
+
+	/* While the popover is hidden, URI to the item to show for it, or to
+	 * NULL if its row should go away */
+	GHashTable *pending;
+	gboolean detached;
+	gboolean resort_pending;
+
+	/* Set while looking for duplicate files */
+	GCancellable *duplicates_cancellable;
+
+	/* URIs of the files that the content search has found */
+	GHashTable *content_matches;
+	gboolean content_search_interrupted;
 
 	GSettings *settings;
 	TrashSortMode sort_mode;
+	guint sort_comparisons;
 
 	GtkWidget *stack;
 	GtkWidget *file_box;
+	GtkWidget *search_entry;
+	GtkWidget *content_toggle;
+	GtkWidget *content_spinner;
+	GtkWidget *status_label;
+	GtkWidget *origins_grid;
+	GtkWidget *sparkline;
 	TrashButtonBar *button_bar;
 	TrashButtonBar *confirm_bar;
+	GtkWidget *confirm_label;
+	gboolean confirm_selected;
+
+	/* Confirms deleting a single item, in the row that asked for it */
+	TrashButtonBar *item_confirm_bar;
+	TrashItemRow *item_confirm_row;
 };
 
 G_DEFINE_TYPE(TrashPopover, trash_popover, GTK_TYPE_BOX)
@@ -55,6 +144,8 @@ static gint list_box_sort_func(GtkListBoxRow *row1, GtkListBoxRow *row2, gpointe
 	a = TRASH_ITEM_ROW(row1);
 	b = TRASH_ITEM_ROW(row2);
 
+	self->sort_comparisons++;
+
 	switch (self->sort_mode) {
 		case TRASH_SORT_A_Z:
 			return trash_item_row_collate_by_name(a, b);
@@ -70,10 +161,118 @@ static gint list_box_sort_func(GtkListBoxRow *row1, GtkListBoxRow *row2, gpointe
 	}
 }
 
+static gboolean searching_contents(TrashPopover *self) {
+	return gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(self->content_toggle)) && *gtk_entry_get_text(GTK_ENTRY(self->search_entry)) != '\0';
+}
+
+static gboolean list_box_filter_func(GtkListBoxRow *row, gpointer user_data) {
+	TrashPopover *self = user_data;
+	g_autoptr(TrashInfo) info = NULL;
+
+	info = trash_item_row_get_info(TRASH_ITEM_ROW(row));
+
+	if (searching_contents(self)) {
+		return g_hash_table_contains(self->content_matches, trash_info_peek_uri(info));
+	}
+
+	return trash_filter_matches(self->filter, info);
+}
+
+/**
+ * Start the content search over for the text in the search entry, hiding
+ * every row until files are found.
+ */
+static void restart_content_search(TrashPopover *self) {
+	g_hash_table_remove_all(self->content_matches);
+
+	if (searching_contents(self)) {
+		trash_content_search_start(self->content_search, gtk_entry_get_text(GTK_ENTRY(self->search_entry)));
+	} else {
+		trash_content_search_cancel(self->content_search);
+	}
+
+	gtk_widget_set_visible(self->content_spinner, trash_content_search_is_running(self->content_search));
+	gtk_list_box_invalidate_filter(GTK_LIST_BOX(self->file_box));
+}
+
+static void search_changed(GtkSearchEntry *entry, TrashPopover *self) {
+	if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(self->content_toggle))) {
+		restart_content_search(self);
+		return;
+	}
+
+	trash_filter_set_query(self->filter, gtk_entry_get_text(GTK_ENTRY(entry)));
+}
+
+static void content_toggled(GtkToggleButton *button, TrashPopover *self) {
+	if (!gtk_toggle_button_get_active(button)) {
+		trash_filter_set_query(self->filter, gtk_entry_get_text(GTK_ENTRY(self->search_entry)));
+	}
+
+	restart_content_search(self);
+}
+
+static void content_match(TrashContentSearch *search, TrashInfo *info, TrashPopover *self) {
+	(void) search;
+	GtkListBoxRow *row;
+
+	g_hash_table_add(self->content_matches, g_strdup(trash_info_peek_uri(info)));
+
+	// Only this row needs to be filtered again
+	row = g_hash_table_lookup(self->rows, trash_info_peek_uri(info));
+
+	if (row) {
+		gtk_list_box_row_changed(row);
+	}
+}
+
+static void content_finished(TrashContentSearch *search, TrashPopover *self) {
+	(void) search;
+
+	gtk_widget_hide(self->content_spinner);
+}
+
+static void filter_changed(TrashFilter *filter, TrashPopover *self) {
+	(void) filter;
+
+	trash_watchdog_enter("filter");
+	gtk_list_box_invalidate_filter(GTK_LIST_BOX(self->file_box));
+	trash_watchdog_leave();
+}
+
+/**
+ * Sort every row in the list again, and report how long it took.
+ */
+static void resort_items(TrashPopover *self) {
+	gint64 start, elapsed, trace_start;
+	guint count;
+
+	count = g_hash_table_size(self->rows);
+
+	self->sort_comparisons = 0;
+	start = g_get_monotonic_time();
+	trace_start = TRASH_TRACE_NOW();
+
+	trash_watchdog_enter("sort");
+	gtk_list_box_invalidate_sort(GTK_LIST_BOX(self->file_box));
+	trash_watchdog_leave();
+
+	TRASH_TRACE_MARK(trace_start, "sort", "%u items, %u comparisons", count, self->sort_comparisons);
+	TRASH_TRACE_PROBE2(sort, count, self->sort_comparisons);
+
+	elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+	g_debug("Sorted %u items in %.1f ms with %u comparisons", count, (gdouble) elapsed / G_TIME_SPAN_MILLISECOND, self->sort_comparisons);
+}
+
 static void settings_changed(GSettings *settings, gchar *key, gpointer user_data) {
 	TrashPopover *self = user_data;
 	TrashSortMode new_sort_mode;
 
+	if (g_strcmp0(key, TRASH_SETTINGS_KEY_SORT_MODE) != 0) {
+		return;
+	}
+
 	new_sort_mode = (TrashSortMode) g_settings_get_enum(settings, key);
 
 	if (new_sort_mode == self->sort_mode) {
@@ -82,7 +281,12 @@ static void settings_changed(GSettings *settings, gchar *key, gpointer user_data
 
 	self->sort_mode = new_sort_mode;
 
-	gtk_list_box_invalidate_sort(GTK_LIST_BOX(self->file_box));
+	if (self->detached) {
+		self->resort_pending = TRUE;
+		return;
+	}
+
+	resort_items(self);
 }
 
 static void settings_clicked(GtkButton *button, TrashPopover *self) {
@@ -108,84 +312,649 @@ static void settings_clicked(GtkButton *button, TrashPopover *self) {
 	}
 }
 
-static void trash_added(TrashManager *manager, TrashInfo *trash_info, TrashPopover *self) {
-	(void) manager;
+/**
+ * Keep the selection in step with a row as the list box selects and
+ * unselects it.
+ */
+static void row_state_flags_changed(GtkWidget *row, GtkStateFlags previous, TrashPopover *self) {
+	g_autoptr(TrashInfo) info = NULL;
+	gboolean selected;
+
+	selected = gtk_list_box_row_is_selected(GTK_LIST_BOX_ROW(row));
+
+	if (selected == ((previous & GTK_STATE_FLAG_SELECTED) != 0)) {
+		return;
+	}
+
+	info = trash_item_row_get_info(TRASH_ITEM_ROW(row));
+	trash_selection_set_selected(self->selection, info, selected);
+}
+
+/**
+ * Show the confirmation bar in the row whose delete button was clicked,
+ * or hide it if it was already showing there.
+ */
+static void row_delete_requested(TrashItemRow *row, TrashPopover *self) {
+	gboolean revealed;
+
+	revealed = trash_button_bar_get_revealed(self->item_confirm_bar);
+
+	if (self->item_confirm_row == row) {
+		trash_button_bar_set_revealed(self->item_confirm_bar, !revealed);
+		return;
+	}
+
+	if (self->item_confirm_row) {
+		trash_item_row_set_confirm_bar(self->item_confirm_row, NULL);
+	}
+
+	self->item_confirm_row = row;
+	trash_item_row_set_confirm_bar(row, self->item_confirm_bar);
+	trash_button_bar_set_revealed(self->item_confirm_bar, TRUE);
+}
+
+static void item_confirm_response_cb(TrashButtonBar *source, gint response_id, TrashPopover *self) {
+	trash_button_bar_set_revealed(source, FALSE);
+
+	if (response_id == GTK_RESPONSE_YES && self->item_confirm_row) {
+		trash_item_row_delete(self->item_confirm_row);
+	}
+}
+
+/**
+ * Get a row for a new item, reusing one from the pool if there is one.
+ * The caller owns the returned reference.
+ */
+static TrashItemRow *take_row(TrashPopover *self, TrashInfo *trash_info) {
 	TrashItemRow *row;
 
-	row = trash_item_row_new(trash_info);
+	if (self->row_pool->len > 0) {
+		row = g_ptr_array_steal_index_fast(self->row_pool, self->row_pool->len - 1);
+		trash_item_row_set_info(row, trash_info);
+
+		return row;
+	}
+
+	row = g_object_ref_sink(trash_item_row_new(trash_info, trash_manager_get_backend(self->trash_manager)));
+	g_signal_connect(row, "state-flags-changed", G_CALLBACK(row_state_flags_changed), self);
+	g_signal_connect(row, "delete-requested", G_CALLBACK(row_delete_requested), self);
+
+	return row;
+}
 
+/**
+ * Take a row out of the list and put it in the pool, unless the pool is
+ * already full.
+ */
+static void recycle_row(TrashPopover *self, TrashItemRow *row) {
+	if (self->item_confirm_row == row) {
+		trash_button_bar_set_revealed(self->item_confirm_bar, FALSE);
+		trash_item_row_set_confirm_bar(row, NULL);
+		self->item_confirm_row = NULL;
+	}
+
+	if (self->row_pool->len >= TRASH_ROW_POOL_SIZE) {
+		gtk_widget_destroy(GTK_WIDGET(row));
+		return;
+	}
+
+	// So that the row doesn't come back selected
+	gtk_list_box_unselect_row(GTK_LIST_BOX(self->file_box), GTK_LIST_BOX_ROW(row));
+
+	g_ptr_array_add(self->row_pool, g_object_ref(row));
+	gtk_container_remove(GTK_CONTAINER(self->file_box), GTK_WIDGET(row));
+	trash_item_row_set_info(row, NULL);
+}
+
+static void add_row(TrashPopover *self, TrashInfo *trash_info) {
+	TrashItemRow *row;
+
+	row = take_row(self, trash_info);
+	g_hash_table_replace(self->rows, g_strdup(trash_info_peek_uri(trash_info)), row);
+
+	// The list box has a sort function, so this inserts the row in order
 	gtk_list_box_insert(GTK_LIST_BOX(self->file_box), GTK_WIDGET(row), -1);
+	g_object_unref(row);
+}
 
-	gtk_list_box_invalidate_sort(GTK_LIST_BOX(self->file_box));
+static void remove_row(TrashPopover *self, const gchar *uri) {
+	GtkWidget *row;
+
+	row = g_hash_table_lookup(self->rows, uri);
+
+	if (!row) {
+		return;
+	}
 
-	g_signal_emit(self, signals[TRASH_FILLED], 0, NULL);
+	g_hash_table_remove(self->rows, uri);
+	recycle_row(self, TRASH_ITEM_ROW(row));
 }
 
-static void foreach_item_cb(TrashItemRow *row, gchar *uri) {
-	TrashInfo *info;
-	g_autofree const gchar *info_uri;
+static void free_pending(gpointer data) {
+	if (data) {
+		g_object_unref(data);
+	}
+}
 
-	info = trash_item_row_get_info(row);
-	info_uri = trash_info_get_uri(info);
+/**
+ * Bring the list up to date with everything that changed while the
+ * popover was hidden.
+ */
+static void apply_pending(TrashPopover *self) {
+	GHashTableIter iter;
+	gpointer key, value;
+	guint count;
+	gint64 trace_start;
 
-	if (g_strcmp0(info_uri, uri) == 0) {
-		gtk_widget_destroy(GTK_WIDGET(row));
+	count = g_hash_table_size(self->pending);
+
+	if (count == 0) {
+		return;
+	}
+
+	trace_start = TRASH_TRACE_NOW();
+	trash_watchdog_enter("replay");
+
+	// Take out the old rows first, so they can be reused for the new ones.
+	// This includes items that were removed and then added again.
+	g_hash_table_iter_init(&iter, self->pending);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		remove_row(self, key);
+	}
+
+	g_hash_table_iter_init(&iter, self->pending);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		if (value) {
+			add_row(self, value);
+		}
+	}
+
+	g_hash_table_remove_all(self->pending);
+
+	trash_watchdog_leave();
+
+	TRASH_TRACE_MARK(trace_start, "replay", "%u items", count);
+	TRASH_TRACE_PROBE1(replay, count);
+}
+
+static void trash_added(TrashManager *manager, TrashInfo *trash_info, TrashPopover *self) {
+	(void) manager;
+
+	if (self->detached) {
+		g_hash_table_replace(self->pending, g_strdup(trash_info_peek_uri(trash_info)), g_object_ref(trash_info));
+	} else {
+		trash_watchdog_enter("row build");
+		add_row(self, trash_info);
+		trash_watchdog_leave();
 	}
+
+	gtk_widget_queue_draw(self->sparkline);
 }
 
 static void trash_removed(TrashManager *manager, gchar *name, TrashPopover *self) {
 	(void) manager;
-	gint count;
 
-	gtk_container_foreach(GTK_CONTAINER(self->file_box), (GtkCallback) foreach_item_cb, name);
+	if (!self->detached) {
+		remove_row(self, name);
+	} else if (g_hash_table_contains(self->rows, name)) {
+		g_hash_table_replace(self->pending, g_strdup(name), NULL);
+	} else {
+		// Added while hidden, so there's nothing to take back
+		g_hash_table_remove(self->pending, name);
+	}
 
-	gtk_list_box_invalidate_sort(GTK_LIST_BOX(self->file_box));
+	g_hash_table_remove(self->content_matches, name);
+	gtk_widget_queue_draw(self->sparkline);
+}
+
+static void selection_changed(TrashSelection *selection, TrashPopover *self) {
+	g_autofree gchar *size = NULL;
+	g_autofree gchar *summary = NULL;
+	GAction *action;
+	guint count;
+
+	count = trash_selection_get_count(selection);
+
+	trash_button_bar_set_response_sensitive(self->button_bar, TRASH_RESPONSE_RESTORE, count > 0);
+	trash_button_bar_set_response_sensitive(self->button_bar, TRASH_RESPONSE_DELETE, count > 0);
+
+	action = g_action_map_lookup_action(G_ACTION_MAP(self->actions), "select-folders");
+	g_simple_action_set_enabled(G_SIMPLE_ACTION(action), count > 0);
+
+	if (count > 0) {
+		size = g_format_size(trash_selection_get_bytes(selection));
+		summary = g_strdup_printf("%u selected (%s)", count, size);
+	}
+
+	gtk_widget_set_tooltip_text(GTK_WIDGET(self->button_bar), summary);
 
-	count = trash_manager_get_item_count(self->trash_manager);
 	if (count == 0) {
-		g_signal_emit(self, signals[TRASH_EMPTY], 0, NULL);
+		gtk_widget_hide(self->status_label);
+	}
+}
+
+/**
+ * Make the selected rows in the list box match the selection, after items
+ * were selected in bulk.
+ */
+static void sync_row_selection(GtkWidget *widget, gpointer user_data) {
+	TrashPopover *self = user_data;
+	GtkListBoxRow *row = GTK_LIST_BOX_ROW(widget);
+	g_autoptr(TrashInfo) info = NULL;
+	gboolean selected;
+
+	info = trash_item_row_get_info(TRASH_ITEM_ROW(widget));
+	selected = trash_selection_contains(self->selection, trash_info_peek_uri(info));
+
+	if (selected == gtk_list_box_row_is_selected(row)) {
+		return;
+	}
+
+	if (selected) {
+		gtk_list_box_select_row(GTK_LIST_BOX(self->file_box), row);
+	} else {
+		gtk_list_box_unselect_row(GTK_LIST_BOX(self->file_box), row);
 	}
 }
 
-static void selected_rows_changed(GtkListBox *source, gpointer user_data) {
-	TrashButtonBar *button_bar = user_data;
-	GList *selected_rows;
+static void sync_rows(TrashPopover *self) {
+	trash_watchdog_enter("select");
+	gtk_container_foreach(GTK_CONTAINER(self->file_box), sync_row_selection, self);
+	trash_watchdog_leave();
+}
+
+static void select_all_activated(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+	(void) action;
+	(void) parameter;
+	TrashPopover *self = user_data;
+
+	gtk_list_box_select_all(GTK_LIST_BOX(self->file_box));
+}
+
+static void select_none_activated(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+	(void) action;
+	(void) parameter;
+	TrashPopover *self = user_data;
+
+	gtk_list_box_unselect_all(GTK_LIST_BOX(self->file_box));
+	trash_selection_clear(self->selection);
+}
+
+static void select_older_activated(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+	(void) action;
+	(void) parameter;
+	TrashPopover *self = user_data;
+
+	if (trash_selection_select_older_than(self->selection, TRASH_SELECT_OLDER_DAYS * G_TIME_SPAN_DAY) > 0) {
+		sync_rows(self);
+	}
+}
+
+static void select_larger_activated(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+	(void) action;
+	(void) parameter;
+	TrashPopover *self = user_data;
+
+	if (trash_selection_select_larger_than(self->selection, TRASH_SELECT_LARGER_BYTES) > 0) {
+		sync_rows(self);
+	}
+}
+
+static void select_folders_activated(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+	(void) action;
+	(void) parameter;
+	TrashPopover *self = user_data;
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GHashTable) directories = NULL;
+	g_autofree gchar **paths = NULL;
+	const gchar *restore_path;
+	guint i;
+
+	items = trash_selection_get_items(self->selection);
+	directories = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i = 0; i < items->len; i++) {
+		restore_path = trash_info_peek_restore_path(g_ptr_array_index(items, i));
+
+		if (restore_path) {
+			g_hash_table_add(directories, g_path_get_dirname(restore_path));
+		}
+	}
+
+	paths = (gchar **) g_hash_table_get_keys_as_array(directories, NULL);
+
+	if (trash_selection_select_in_directories(self->selection, (const gchar *const *) paths) > 0) {
+		sync_rows(self);
+	}
+}
+
+static gboolean in_set(TrashInfo *info, gpointer user_data) {
+	return g_hash_table_contains(user_data, trash_info_peek_uri(info));
+}
+
+static void duplicates_found(GObject *source, GAsyncResult *result, gpointer user_data) {
+	(void) source;
+	g_autoptr(TrashPopover) self = user_data;
+	g_autoptr(GPtrArray) groups = NULL;
+	g_autoptr(GHashTable) copies = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *size = NULL;
+	g_autofree gchar *text = NULL;
+	GPtrArray *group;
+	GAction *action;
+	guint64 reclaimable = 0;
 	guint count;
+	guint i, j;
+
+	action = g_action_map_lookup_action(G_ACTION_MAP(self->actions), "select-duplicates");
+	g_simple_action_set_enabled(G_SIMPLE_ACTION(action), TRUE);
+	g_clear_object(&self->duplicates_cancellable);
+
+	groups = trash_duplicates_find_finish(result, &reclaimable, &error);
+
+	if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		return;
+	}
+
+	if (!groups) {
+		g_warning("Unable to look for duplicate files: %s", error->message);
+		return;
+	}
 
-	selected_rows = gtk_list_box_get_selected_rows(source);
-	count = g_list_length(selected_rows);
+	// Every copy except the most recently trashed one
+	copies = g_hash_table_new(g_str_hash, g_str_equal);
 
-	trash_button_bar_set_response_sensitive(button_bar, TRASH_RESPONSE_RESTORE, count > 0);
-	g_list_free(selected_rows);
+	for (i = 0; i < groups->len; i++) {
+		group = g_ptr_array_index(groups, i);
+
+		for (j = 1; j < group->len; j++) {
+			g_hash_table_add(copies, (gpointer) trash_info_peek_uri(g_ptr_array_index(group, j)));
+		}
+	}
+
+	count = g_hash_table_size(copies);
+
+	if (count > 0 && trash_selection_select_matching(self->selection, in_set, copies) > 0) {
+		sync_rows(self);
+	}
+
+	if (count == 0) {
+		text = g_strdup("No duplicate files found");
+	} else {
+		size = g_format_size(reclaimable);
+		text = g_strdup_printf("%u duplicate %s, %s can be freed", count, count == 1 ? "file" : "files", size);
+	}
+
+	gtk_label_set_text(GTK_LABEL(self->status_label), text);
+	gtk_widget_show(self->status_label);
 }
 
-static void delete_item(GtkWidget *widget, gpointer user_data) {
+static void select_duplicates_activated(GSimpleAction *action, GVariant *parameter, gpointer user_data) {
+	(void) parameter;
+	TrashPopover *self = user_data;
+
+	// Only one search at a time; the action comes back when it's done
+	g_simple_action_set_enabled(action, FALSE);
+
+	self->duplicates_cancellable = g_cancellable_new();
+	trash_duplicates_find_async(self->trash_manager, self->duplicates_cancellable, duplicates_found, g_object_ref(self));
+}
+
+/**
+ * Draw the size of the trash bin over the last few days as a step line,
+ * scaled so that the largest size reaches the top.
+ */
+static gboolean draw_sparkline(GtkWidget *widget, cairo_t *cr, TrashPopover *self) {
+	g_autoptr(GArray) samples = NULL;
+	TrashHistorySample *sample;
+	GtkStyleContext *context;
+	GdkRGBA color;
+	gint64 now, since;
+	guint64 max_bytes = 0;
+	gdouble width, height, x, y, previous_y = 0;
+	guint i;
+
+	now = g_get_real_time() / G_USEC_PER_SEC;
+	since = now - TRASH_SPARKLINE_DAYS * 24 * 60 * 60;
+	samples = trash_history_get_samples(trash_manager_get_history(self->trash_manager), since);
+
+	if (samples->len == 0) {
+		return FALSE;
+	}
+
+	for (i = 0; i < samples->len; i++) {
+		max_bytes = MAX(max_bytes, g_array_index(samples, TrashHistorySample, i).bytes);
+	}
+
+	width = gtk_widget_get_allocated_width(widget);
+	height = gtk_widget_get_allocated_height(widget);
+
+	context = gtk_widget_get_style_context(widget);
+	gtk_style_context_get_color(context, gtk_style_context_get_state(context), &color);
+	gdk_cairo_set_source_rgba(cr, &color);
+	cairo_set_line_width(cr, 1.0);
+
+	for (i = 0; i < samples->len; i++) {
+		sample = &g_array_index(samples, TrashHistorySample, i);
+
+		x = (gdouble) (MAX(sample->time, since) - since) / (gdouble) (now - since) * width;
+		y = height - 1 - (max_bytes > 0 ? (gdouble) sample->bytes / (gdouble) max_bytes * (height - 2) : 0);
+
+		// Each size holds until the next sample
+		if (i == 0) {
+			cairo_move_to(cr, x, y);
+		} else {
+			cairo_line_to(cr, x, previous_y);
+			cairo_line_to(cr, x, y);
+		}
+
+		previous_y = y;
+	}
+
+	cairo_line_to(cr, width, previous_y);
+	cairo_stroke(cr);
+
+	return FALSE;
+}
+
+static void origins_attach_label(GtkGrid *grid, const gchar *text, gint column, gint row) {
+	GtkWidget *label;
+
+	label = gtk_label_new(text);
+
+	if (column == 0) {
+		gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_MIDDLE);
+		gtk_label_set_max_width_chars(GTK_LABEL(label), 32);
+		gtk_widget_set_hexpand(label, TRUE);
+		gtk_widget_set_halign(label, GTK_ALIGN_START);
+	} else {
+		gtk_widget_set_halign(label, GTK_ALIGN_END);
+		gtk_style_context_add_class(gtk_widget_get_style_context(label), GTK_STYLE_CLASS_DIM_LABEL);
+	}
+
+	gtk_grid_attach(grid, label, column, row, 1, 1);
+}
+
+/**
+ * Fill in the breakdown of where the trash came from each time it is
+ * shown. This only walks the directories that get split up, so it stays
+ * cheap however many items there are.
+ */
+static void origins_shown(GtkWidget *popover, TrashPopover *self) {
+	(void) popover;
+	g_autoptr(GPtrArray) entries = NULL;
+	g_autoptr(GList) children = NULL;
+	TrashPathTreeEntry *entry;
+	GtkGrid *grid;
+	GList *l;
+	guint i;
+
+	grid = GTK_GRID(self->origins_grid);
+
+	children = gtk_container_get_children(GTK_CONTAINER(grid));
+	for (l = children; l; l = l->next) {
+		gtk_widget_destroy(l->data);
+	}
+
+	entries = trash_path_tree_get_breakdown(trash_manager_get_origins(self->trash_manager), TRASH_ORIGINS_MAX_ENTRIES);
+
+	if (entries->len == 0) {
+		origins_attach_label(grid, "The trash bin is empty", 0, 0);
+	}
+
+	for (i = 0; i < entries->len; i++) {
+		g_autofree gchar *size = NULL;
+		g_autofree gchar *items = NULL;
+
+		entry = g_ptr_array_index(entries, i);
+		size = g_format_size(entry->bytes);
+		items = g_strdup_printf("%u %s", entry->items, entry->items == 1 ? "item" : "items");
+
+		origins_attach_label(grid, entry->path, 0, (gint) i);
+		origins_attach_label(grid, size, 1, (gint) i);
+		origins_attach_label(grid, items, 2, (gint) i);
+	}
+
+	gtk_widget_show_all(self->origins_grid);
+}
+
+static void report_batch_failure(const gchar *action, guint failed, GError *error) {
+	g_autofree gchar *body = NULL;
+
+	body = g_strdup_printf("Unable to %s %u %s: %s", action, failed, failed == 1 ? "item" : "items", error->message);
+
+	g_critical("Error trying to %s %u items: %s", action, failed, error->message);
+	trash_notify_try_send_failure("Trash Error", body, "user-trash-symbolic", action);
+}
+
+static void delete_items_finish(GObject *object, GAsyncResult *result, gpointer user_data) {
 	(void) user_data;
+	g_autoptr(GError) error = NULL;
+	guint failed = 0;
 
-	trash_item_row_delete(TRASH_ITEM_ROW(widget));
+	if (!trash_backend_delete_items_finish(TRASH_BACKEND(object), result, &failed, &error)) {
+		report_batch_failure("delete", failed, error);
+	}
 }
 
-static void restore_item(gpointer data, gpointer user_data) {
+static void restore_items_finish(GObject *object, GAsyncResult *result, gpointer user_data) {
 	(void) user_data;
-	TrashItemRow *row = data;
+	g_autoptr(GError) error = NULL;
+	guint failed = 0;
+
+	if (!trash_backend_restore_items_finish(TRASH_BACKEND(object), result, &failed, &error)) {
+		report_batch_failure("restore", failed, error);
+	}
+}
+
+/**
+ * Restore every selected item in one batch.
+ */
+static void restore_selected(TrashPopover *self) {
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GPtrArray) names = NULL;
+	g_autoptr(GPtrArray) restore_paths = NULL;
+	TrashInfo *info;
+	guint i;
+
+	items = trash_selection_get_items(self->selection);
+	names = g_ptr_array_sized_new(items->len + 1);
+	restore_paths = g_ptr_array_sized_new(items->len + 1);
 
-	trash_item_row_restore(row);
+	for (i = 0; i < items->len; i++) {
+		info = g_ptr_array_index(items, i);
+
+		if (!trash_info_peek_restore_path(info)) {
+			continue;
+		}
+
+		g_ptr_array_add(names, (gpointer) trash_info_peek_name(info));
+		g_ptr_array_add(restore_paths, (gpointer) trash_info_peek_restore_path(info));
+	}
+
+	if (names->len == 0) {
+		return;
+	}
+
+	g_ptr_array_add(names, NULL);
+	g_ptr_array_add(restore_paths, NULL);
+
+	trash_backend_restore_items_async(
+		trash_manager_get_backend(self->trash_manager),
+		(const gchar *const *) names->pdata,
+		(const gchar *const *) restore_paths->pdata,
+		NULL,
+		restore_items_finish,
+		NULL);
+}
+
+static void add_name(gpointer data, gpointer user_data) {
+	g_ptr_array_add(user_data, (gpointer) trash_info_peek_name(data));
+}
+
+/**
+ * Permanently delete either the selected items or everything in the trash
+ * bin, in one batch.
+ */
+static void delete_items(TrashPopover *self, gboolean selected_only) {
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GPtrArray) names = NULL;
+
+	names = g_ptr_array_new();
+
+	if (selected_only) {
+		items = trash_selection_get_items(self->selection);
+		g_ptr_array_foreach(items, add_name, names);
+	} else {
+		trash_manager_foreach_item(self->trash_manager, add_name, names);
+	}
+
+	if (names->len == 0) {
+		return;
+	}
+
+	g_ptr_array_add(names, NULL);
+
+	trash_backend_delete_items_async(
+		trash_manager_get_backend(self->trash_manager),
+		(const gchar *const *) names->pdata,
+		NULL,
+		delete_items_finish,
+		NULL);
+}
+
+static void show_confirm_bar(TrashPopover *self, gboolean selected_only) {
+	g_autofree gchar *text = NULL;
+	guint count;
+
+	self->confirm_selected = selected_only;
+
+	if (selected_only) {
+		count = trash_selection_get_count(self->selection);
+		text = g_strdup_printf("Are you sure you want to permanently delete %u selected %s?", count, count == 1 ? "item" : "items");
+	} else {
+		text = g_strdup("Are you sure you want to empty the trash bin?");
+	}
+
+	gtk_label_set_text(GTK_LABEL(self->confirm_label), text);
+
+	trash_button_bar_set_revealed(self->button_bar, FALSE);
+	trash_button_bar_set_revealed(self->confirm_bar, TRUE);
 }
 
 static void handle_response_cb(TrashButtonBar *source, gint response, gpointer user_data) {
 	(void) source;
 	TrashPopover *self = user_data;
-	GList *selected_rows;
 
 	switch (response) {
 		case TRASH_RESPONSE_RESTORE:
-			selected_rows = gtk_list_box_get_selected_rows(GTK_LIST_BOX(self->file_box));
-			g_list_foreach(selected_rows, restore_item, NULL);
-			g_list_free(selected_rows);
+			restore_selected(self);
+			break;
+		case TRASH_RESPONSE_DELETE:
+			show_confirm_bar(self, TRUE);
 			break;
 		case TRASH_RESPONSE_EMPTY:
-			trash_button_bar_set_revealed(self->button_bar, FALSE);
-			trash_button_bar_set_revealed(self->confirm_bar, TRUE);
+			show_confirm_bar(self, FALSE);
 			break;
 	}
 }
@@ -195,7 +964,7 @@ static void confirm_response_cb(TrashButtonBar *source, gint response_id, gpoint
 
 	switch (response_id) {
 		case GTK_RESPONSE_YES:
-			gtk_container_foreach(GTK_CONTAINER(self->file_box), delete_item, NULL);
+			delete_items(self, self->confirm_selected);
 			break;
 		default:
 			break;
@@ -205,6 +974,15 @@ static void confirm_response_cb(TrashButtonBar *source, gint response_id, gpoint
 	trash_button_bar_set_revealed(self->button_bar, TRUE);
 }
 
+static const GActionEntry selection_actions[] = {
+	{"select-all", select_all_activated, NULL, NULL, NULL, {0}},
+	{"select-none", select_none_activated, NULL, NULL, NULL, {0}},
+	{"select-older", select_older_activated, NULL, NULL, NULL, {0}},
+	{"select-larger", select_larger_activated, NULL, NULL, NULL, {0}},
+	{"select-folders", select_folders_activated, NULL, NULL, NULL, {0}},
+	{"select-duplicates", select_duplicates_activated, NULL, NULL, NULL, {0}},
+};
+
 static void trash_popover_constructed(GObject *object) {
 	TrashPopover *self;
 	GtkWidget *header;
@@ -213,12 +991,21 @@ static void trash_popover_constructed(GObject *object) {
 	PangoAttribute *font_attr;
 	GtkWidget *header_label;
 	GtkWidget *settings_button;
+	GtkWidget *select_button;
+	g_autoptr(GMenu) select_menu = NULL;
+	GtkWidget *origins_button;
+	GtkWidget *origins_popover;
+	g_autofree gchar *history_path = NULL;
 	GtkStyleContext *header_label_style;
 	GtkStyleContext *settings_button_style;
+	GtkStyleContext *select_button_style;
+	GtkStyleContext *origins_button_style;
 	GtkWidget *separator;
 	GtkWidget *main_view;
 	GtkWidget *scroller;
-	GtkWidget *content_area, *confirm_label;
+	GtkWidget *search_box;
+	GtkWidget *content_area;
+	GtkWidget *item_confirm_label;
 	GtkWidget *btn;
 	TrashSettings *settings_view;
 
@@ -228,7 +1015,7 @@ static void trash_popover_constructed(GObject *object) {
 
 	// Settings
 	self->sort_mode = (TrashSortMode) g_settings_get_enum(self->settings, TRASH_SETTINGS_KEY_SORT_MODE);
-	g_signal_connect(self->settings, "changed", G_CALLBACK(settings_changed), self);
+	g_signal_connect_object(self->settings, "changed", G_CALLBACK(settings_changed), self, 0);
 
 	// Create our header
 	header = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
@@ -252,6 +1039,15 @@ static void trash_popover_constructed(GObject *object) {
 	header_label_style = gtk_widget_get_style_context(header_label);
 	gtk_style_context_add_class(header_label_style, GTK_STYLE_CLASS_DIM_LABEL);
 
+	// Trash size over time
+	self->sparkline = gtk_drawing_area_new();
+	gtk_widget_set_size_request(self->sparkline, 64, 16);
+	gtk_widget_set_valign(self->sparkline, GTK_ALIGN_CENTER);
+	gtk_widget_set_margin_end(self->sparkline, 4);
+	gtk_widget_set_tooltip_text(self->sparkline, "Trash size over the last 7 days");
+	gtk_style_context_add_class(gtk_widget_get_style_context(self->sparkline), GTK_STYLE_CLASS_DIM_LABEL);
+	g_signal_connect(self->sparkline, "draw", G_CALLBACK(draw_sparkline), self);
+
 	settings_button = gtk_button_new_from_icon_name("preferences-system-symbolic", GTK_ICON_SIZE_BUTTON);
 	gtk_widget_set_tooltip_text(settings_button, "Trash Applet Settings");
 	g_signal_connect(settings_button, "clicked", G_CALLBACK(settings_clicked), self);
@@ -260,11 +1056,55 @@ static void trash_popover_constructed(GObject *object) {
 	gtk_style_context_add_class(settings_button_style, GTK_STYLE_CLASS_FLAT);
 	gtk_style_context_remove_class(settings_button_style, GTK_STYLE_CLASS_BUTTON);
 
+	// Bulk selection menu
+	self->actions = g_simple_action_group_new();
+	g_action_map_add_action_entries(G_ACTION_MAP(self->actions), selection_actions, G_N_ELEMENTS(selection_actions), self);
+	gtk_widget_insert_action_group(GTK_WIDGET(self), "trash", G_ACTION_GROUP(self->actions));
+
+	select_menu = g_menu_new();
+	g_menu_append(select_menu, "Select All", "trash.select-all");
+	g_menu_append(select_menu, "Select None", "trash.select-none");
+	g_menu_append(select_menu, "Older Than 30 Days", "trash.select-older");
+	g_menu_append(select_menu, "Larger Than 1 GB", "trash.select-larger");
+	g_menu_append(select_menu, "From the Same Folders", "trash.select-folders");
+	g_menu_append(select_menu, "Duplicates Except Newest", "trash.select-duplicates");
+
+	select_button = gtk_menu_button_new();
+	gtk_button_set_image(GTK_BUTTON(select_button), gtk_image_new_from_icon_name("edit-select-all-symbolic", GTK_ICON_SIZE_BUTTON));
+	gtk_menu_button_set_menu_model(GTK_MENU_BUTTON(select_button), G_MENU_MODEL(select_menu));
+	gtk_widget_set_tooltip_text(select_button, "Select Items");
+
+	select_button_style = gtk_widget_get_style_context(select_button);
+	gtk_style_context_add_class(select_button_style, GTK_STYLE_CLASS_FLAT);
+	gtk_style_context_remove_class(select_button_style, GTK_STYLE_CLASS_BUTTON);
+
+	// Where the trash came from
+	self->origins_grid = gtk_grid_new();
+	gtk_grid_set_row_spacing(GTK_GRID(self->origins_grid), 4);
+	gtk_grid_set_column_spacing(GTK_GRID(self->origins_grid), 12);
+	g_object_set(self->origins_grid, "margin", 8, NULL);
+
+	origins_button = gtk_menu_button_new();
+	gtk_button_set_image(GTK_BUTTON(origins_button), gtk_image_new_from_icon_name("folder-symbolic", GTK_ICON_SIZE_BUTTON));
+	gtk_widget_set_tooltip_text(origins_button, "Where the Trash Came From");
+
+	origins_popover = gtk_popover_new(origins_button);
+	gtk_container_add(GTK_CONTAINER(origins_popover), self->origins_grid);
+	gtk_menu_button_set_popover(GTK_MENU_BUTTON(origins_button), origins_popover);
+	g_signal_connect(origins_popover, "show", G_CALLBACK(origins_shown), self);
+
+	origins_button_style = gtk_widget_get_style_context(origins_button);
+	gtk_style_context_add_class(origins_button_style, GTK_STYLE_CLASS_FLAT);
+	gtk_style_context_remove_class(origins_button_style, GTK_STYLE_CLASS_BUTTON);
+
 	separator = gtk_separator_new(GTK_ORIENTATION_HORIZONTAL);
 
 	// Pack up the header
 	gtk_box_pack_start(GTK_BOX(header), header_label, TRUE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(header), self->sparkline, FALSE, FALSE, 0);
 	gtk_box_pack_end(GTK_BOX(header), settings_button, FALSE, FALSE, 0);
+	gtk_box_pack_end(GTK_BOX(header), select_button, FALSE, FALSE, 0);
+	gtk_box_pack_end(GTK_BOX(header), origins_button, FALSE, FALSE, 0);
 
 	// Create our main view
 
@@ -273,6 +1113,9 @@ static void trash_popover_constructed(GObject *object) {
 	btn = trash_button_bar_add_button(self->button_bar, "Restore", TRASH_RESPONSE_RESTORE);
 	gtk_widget_set_tooltip_text(btn, "Restore selected items");
 
+	btn = trash_button_bar_add_button(self->button_bar, "Delete", TRASH_RESPONSE_DELETE);
+	gtk_widget_set_tooltip_text(btn, "Permanently delete selected items");
+
 	btn = trash_button_bar_add_button(self->button_bar, "Empty", TRASH_RESPONSE_EMPTY);
 	gtk_widget_set_tooltip_text(btn, "Empty the trash bin");
 
@@ -281,14 +1124,14 @@ static void trash_popover_constructed(GObject *object) {
 	self->confirm_bar = trash_button_bar_new();
 	trash_button_bar_set_revealed(self->confirm_bar, FALSE);
 
-	confirm_label = gtk_label_new("Are you sure you want to empty the trash bin?");
-	gtk_label_set_attributes(GTK_LABEL(confirm_label), attr_list);
-	gtk_label_set_line_wrap(GTK_LABEL(confirm_label), TRUE);
-	gtk_label_set_max_width_chars(GTK_LABEL(confirm_label), 32);
-	gtk_label_set_width_chars(GTK_LABEL(confirm_label), 32);
+	self->confirm_label = gtk_label_new("Are you sure you want to empty the trash bin?");
+	gtk_label_set_attributes(GTK_LABEL(self->confirm_label), attr_list);
+	gtk_label_set_line_wrap(GTK_LABEL(self->confirm_label), TRUE);
+	gtk_label_set_max_width_chars(GTK_LABEL(self->confirm_label), 32);
+	gtk_label_set_width_chars(GTK_LABEL(self->confirm_label), 32);
 
 	content_area = trash_button_bar_get_content_area(self->confirm_bar);
-	gtk_box_pack_start(GTK_BOX(content_area), confirm_label, TRUE, TRUE, 6);
+	gtk_box_pack_start(GTK_BOX(content_area), self->confirm_label, TRUE, TRUE, 6);
 
 	trash_button_bar_add_button(self->confirm_bar, "No", GTK_RESPONSE_NO);
 	trash_button_bar_add_button(self->confirm_bar, "Yes", GTK_RESPONSE_YES);
@@ -297,13 +1140,61 @@ static void trash_popover_constructed(GObject *object) {
 
 	g_signal_connect(self->confirm_bar, "response", G_CALLBACK(confirm_response_cb), self);
 
+	pango_attr_list_unref(attr_list);
+	pango_font_description_free(font_description);
+
+	// Shared by every row, so we keep our own reference as it moves between them
+	self->item_confirm_bar = g_object_ref_sink(trash_button_bar_new());
+	trash_button_bar_set_revealed(self->item_confirm_bar, FALSE);
+
+	item_confirm_label = gtk_label_new("Are you sure you want to delete this item?");
+	gtk_label_set_line_wrap(GTK_LABEL(item_confirm_label), TRUE);
+
+	content_area = trash_button_bar_get_content_area(self->item_confirm_bar);
+	gtk_box_pack_start(GTK_BOX(content_area), item_confirm_label, TRUE, TRUE, 6);
+
+	trash_button_bar_add_button(self->item_confirm_bar, "No", GTK_RESPONSE_NO);
+	trash_button_bar_add_button(self->item_confirm_bar, "Yes", GTK_RESPONSE_YES);
+
+	trash_button_bar_add_response_style_class(self->item_confirm_bar, GTK_RESPONSE_YES, GTK_STYLE_CLASS_DESTRUCTIVE_ACTION);
+
+	g_signal_connect(self->item_confirm_bar, "response", G_CALLBACK(item_confirm_response_cb), self);
+	gtk_widget_show_all(GTK_WIDGET(self->item_confirm_bar));
+
 	// Create our drive list box
 	self->file_box = gtk_list_box_new();
 	gtk_list_box_set_activate_on_single_click(GTK_LIST_BOX(self->file_box), FALSE);
 	gtk_list_box_set_selection_mode(GTK_LIST_BOX(self->file_box), GTK_SELECTION_MULTIPLE);
 	gtk_list_box_set_sort_func(GTK_LIST_BOX(self->file_box), list_box_sort_func, self, NULL);
-
-	g_signal_connect(self->file_box, "selected-rows-changed", G_CALLBACK(selected_rows_changed), self->button_bar);
+	gtk_list_box_set_filter_func(GTK_LIST_BOX(self->file_box), list_box_filter_func, self, NULL);
+
+	// Create our search entry
+	self->search_entry = gtk_search_entry_new();
+	gtk_entry_set_placeholder_text(GTK_ENTRY(self->search_entry), "Search the trash bin");
+	g_signal_connect(self->search_entry, "search-changed", G_CALLBACK(search_changed), self);
+
+	self->content_toggle = gtk_toggle_button_new();
+	gtk_button_set_image(GTK_BUTTON(self->content_toggle), gtk_image_new_from_icon_name("text-x-generic-symbolic", GTK_ICON_SIZE_BUTTON));
+	gtk_widget_set_tooltip_text(self->content_toggle, "Search inside files (case-sensitive)");
+	g_signal_connect(self->content_toggle, "toggled", G_CALLBACK(content_toggled), self);
+
+	self->content_spinner = gtk_spinner_new();
+	gtk_spinner_start(GTK_SPINNER(self->content_spinner));
+	gtk_widget_set_no_show_all(self->content_spinner, TRUE);
+
+	self->status_label = gtk_label_new(NULL);
+	gtk_label_set_line_wrap(GTK_LABEL(self->status_label), TRUE);
+	gtk_widget_set_margin_bottom(self->status_label, 4);
+	gtk_style_context_add_class(gtk_widget_get_style_context(self->status_label), GTK_STYLE_CLASS_DIM_LABEL);
+	gtk_widget_set_no_show_all(self->status_label, TRUE);
+
+	search_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4);
+	gtk_widget_set_margin_start(search_box, 4);
+	gtk_widget_set_margin_end(search_box, 4);
+	gtk_widget_set_margin_bottom(search_box, 4);
+	gtk_box_pack_start(GTK_BOX(search_box), self->search_entry, TRUE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(search_box), self->content_spinner, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(search_box), self->content_toggle, FALSE, FALSE, 0);
 
 	// Create our scrolled window
 	scroller = gtk_scrolled_window_new(NULL, NULL);
@@ -314,9 +1205,10 @@ static void trash_popover_constructed(GObject *object) {
 	gtk_container_add(GTK_CONTAINER(scroller), self->file_box);
 
 	main_view = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
-	selected_rows_changed(GTK_LIST_BOX(self->file_box), self->button_bar);
 	gtk_container_add(GTK_CONTAINER(main_view), GTK_WIDGET(self->button_bar));
 	gtk_container_add(GTK_CONTAINER(main_view), GTK_WIDGET(self->confirm_bar));
+	gtk_container_add(GTK_CONTAINER(main_view), search_box);
+	gtk_container_add(GTK_CONTAINER(main_view), self->status_label);
 	gtk_container_add(GTK_CONTAINER(main_view), scroller);
 	gtk_widget_show_all(main_view);
 
@@ -329,8 +1221,27 @@ static void trash_popover_constructed(GObject *object) {
 
 	self->trash_manager = trash_manager_new();
 
-	g_signal_connect(self->trash_manager, "trash-added", G_CALLBACK(trash_added), self);
-	g_signal_connect(self->trash_manager, "trash-removed", G_CALLBACK(trash_removed), self);
+	history_path = g_build_filename(g_get_user_cache_dir(), "budgie-trash-applet", "history", NULL);
+	trash_manager_persist_history(self->trash_manager, history_path);
+
+	// The filter has to hear about new items before their rows are filtered
+	self->filter = trash_filter_new(self->trash_manager);
+	g_signal_connect(self->filter, "changed", G_CALLBACK(filter_changed), self);
+
+	self->content_search = trash_content_search_new(self->trash_manager);
+	g_signal_connect_object(self->content_search, "match", G_CALLBACK(content_match), self, 0);
+	g_signal_connect_object(self->content_search, "finished", G_CALLBACK(content_finished), self, 0);
+
+	// The stats service keeps the manager alive after we are gone
+	g_signal_connect_object(self->trash_manager, "trash-added", G_CALLBACK(trash_added), self, 0);
+	g_signal_connect_object(self->trash_manager, "trash-removed", G_CALLBACK(trash_removed), self, 0);
+
+	self->selection = trash_selection_new(self->trash_manager);
+	g_signal_connect(self->selection, "changed", G_CALLBACK(selection_changed), self);
+	selection_changed(self->selection, self);
+
+	self->purge_scheduler = trash_purge_scheduler_new(self->trash_manager, self->settings);
+	self->pressure_monitor = trash_pressure_monitor_new(self->purge_scheduler, self->settings);
 
 	trash_manager_scan_items(self->trash_manager);
 
@@ -354,6 +1265,17 @@ static void trash_popover_finalize(GObject *object) {
 
 	self = TRASH_POPOVER(object);
 
+	g_object_unref(self->actions);
+	g_object_unref(self->selection);
+	g_object_unref(self->filter);
+	g_object_unref(self->content_search);
+	g_hash_table_unref(self->content_matches);
+	g_hash_table_unref(self->rows);
+	g_ptr_array_unref(self->row_pool);
+	g_hash_table_unref(self->pending);
+	g_object_unref(self->item_confirm_bar);
+	g_object_unref(self->pressure_monitor);
+	g_object_unref(self->purge_scheduler);
 	g_object_unref(self->trash_manager);
 	g_object_unref(self->settings);
 
@@ -390,8 +1312,54 @@ static void trash_popover_set_property(GObject *object, guint prop_id, const GVa
 	}
 }
 
+static void trash_popover_map(GtkWidget *widget) {
+	TrashPopover *self;
+
+	self = TRASH_POPOVER(widget);
+
+	// Catch the list up before it's mapped, so it's laid out only once
+	self->detached = FALSE;
+	apply_pending(self);
+
+	if (self->resort_pending) {
+		self->resort_pending = FALSE;
+		resort_items(self);
+	}
+
+	GTK_WIDGET_CLASS(trash_popover_parent_class)->map(widget);
+
+	// Pick a content search back up that was cut short by closing the popover
+	if (self->content_search_interrupted) {
+		self->content_search_interrupted = FALSE;
+		restart_content_search(self);
+	}
+}
+
+static void trash_popover_unmap(GtkWidget *widget) {
+	TrashPopover *self;
+
+	self = TRASH_POPOVER(widget);
+
+	// Don't keep reading files for a popover that nobody can see
+	if (trash_content_search_is_running(self->content_search)) {
+		self->content_search_interrupted = TRUE;
+		trash_content_search_cancel(self->content_search);
+	}
+
+	gtk_widget_hide(self->content_spinner);
+
+	if (self->duplicates_cancellable) {
+		g_cancellable_cancel(self->duplicates_cancellable);
+	}
+
+	self->detached = TRUE;
+
+	GTK_WIDGET_CLASS(trash_popover_parent_class)->unmap(widget);
+}
+
 static void trash_popover_class_init(TrashPopoverClass *klass) {
 	GObjectClass *class;
+	GtkWidgetClass *widget_class;
 
 	class = G_OBJECT_CLASS(klass);
 	class->constructed = trash_popover_constructed;
@@ -399,6 +1367,10 @@ static void trash_popover_class_init(TrashPopoverClass *klass) {
 	class->get_property = trash_popover_get_property;
 	class->set_property = trash_popover_set_property;
 
+	widget_class = GTK_WIDGET_CLASS(klass);
+	widget_class->map = trash_popover_map;
+	widget_class->unmap = trash_popover_unmap;
+
 	// Properties
 
 	props[PROP_SETTINGS] = g_param_spec_pointer(
@@ -407,43 +1379,15 @@ static void trash_popover_class_init(TrashPopoverClass *klass) {
 		"The applet instance settings for this Trash Applet",
 		G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
-	// Signals
-
-	/**
-	 * TrashPopover::trash-empty:
-	 * @self: a #TrashPopover
-	 *
-	 * Emitted when there are no more items in the trash bin.
-	 */
-	signals[TRASH_EMPTY] = g_signal_new("trash-empty",
-		G_TYPE_FROM_CLASS(klass),
-		G_SIGNAL_RUN_LAST,
-		0,
-		NULL, NULL, NULL,
-		G_TYPE_NONE,
-		0,
-		NULL);
-
-	/**
-	 * TrashPopover::trash-filled:
-	 * @self: a #TrashPopover
-	 *
-	 * Emitted when something has been added to the trash bin.
-	 */
-	signals[TRASH_FILLED] = g_signal_new("trash-filled",
-		G_TYPE_FROM_CLASS(klass),
-		G_SIGNAL_RUN_LAST,
-		0,
-		NULL, NULL, NULL,
-		G_TYPE_NONE,
-		0,
-		NULL);
-
 	g_object_class_install_properties(class, LAST_PROP, props);
 }
 
 static void trash_popover_init(TrashPopover *self) {
-	(void) self;
+	self->rows = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	self->row_pool = g_ptr_array_new_with_free_func(g_object_unref);
+	self->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_pending);
+	self->detached = TRUE;
+	self->content_matches = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 }
 
 /**
@@ -457,3 +1401,31 @@ static void trash_popover_init(TrashPopover *self) {
 TrashPopover *trash_popover_new(GSettings *settings) {
 	return g_object_new(TRASH_TYPE_POPOVER, "settings", settings, "orientation", GTK_ORIENTATION_VERTICAL, "spacing", 0, NULL);
 }
+
+/**
+ * trash_popover_get_manager:
+ * @self: a #TrashPopover
+ *
+ * Gets the #TrashManager that keeps track of the items shown.
+ *
+ * Returns: (transfer none): the trash manager
+ */
+TrashManager *trash_popover_get_manager(TrashPopover *self) {
+	g_return_val_if_fail(TRASH_IS_POPOVER(self), NULL);
+
+	return self->trash_manager;
+}
+
+/**
+ * trash_popover_get_purge_scheduler:
+ * @self: a #TrashPopover
+ *
+ * Gets the #TrashPurgeScheduler that deletes old items.
+ *
+ * Returns: (transfer none): the purge scheduler
+ */
+TrashPurgeScheduler *trash_popover_get_purge_scheduler(TrashPopover *self) {
+	g_return_val_if_fail(TRASH_IS_POPOVER(self), NULL);
+
+	return self->purge_scheduler;
+}
@@ -4,6 +4,8 @@
 #include "trash_info.h"
 #include "trash_item_row.h"
 #include "trash_manager.h"
+#include "trash_pressure_monitor.h"
+#include "trash_purge_scheduler.h"
 #include "trash_settings.h"
 #include <budgie-desktop/popover.h>
 #include <gtk/gtk.h>
@@ -16,4 +18,8 @@ G_DECLARE_FINAL_TYPE(TrashPopover, trash_popover, TRASH, POPOVER, GtkBox)
 
 TrashPopover *trash_popover_new(GSettings *settings);
 
+TrashManager *trash_popover_get_manager(TrashPopover *self);
+
+TrashPurgeScheduler *trash_popover_get_purge_scheduler(TrashPopover *self);
+
 G_END_DECLS
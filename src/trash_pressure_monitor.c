@@ -0,0 +1,280 @@
+/**
+ * SECTION:trashpressuremonitor
+ * @Short_description: Frees up trash space when a disk is nearly full
+ * @Title: TrashPressureMonitor
+ *
+ * The #TrashPressureMonitor keeps an eye on how much free space is left on
+ * each filesystem that has items in the trash. When the free space on one
+ * of them drops below the low watermark set by the user, trashed items on
+ * that filesystem are purged until the free space is back above the high
+ * watermark.
+ *
+ * Checking free space is cheap but not free, so how often we look depends
+ * on how close we are to the low watermark. While there is plenty of room,
+ * the interval backs off to half an hour.
+ */
+
+#include "trash_pressure_monitor.h"
+#include "trash_settings_keys.h"
+#include <sys/statvfs.h>
+
+/**
+ * How long, in seconds, to wait before checking again after purging.
+ */
+#define TRASH_PRESSURE_RECHECK_INTERVAL 5
+
+/**
+ * How long, in seconds, to wait between checks while free space is
+ * getting close to the low watermark.
+ */
+#define TRASH_PRESSURE_NEAR_INTERVAL 10
+
+/**
+ * How long, in seconds, to wait between checks while free space is
+ * somewhat close to the low watermark.
+ */
+#define TRASH_PRESSURE_WARM_INTERVAL 60
+
+/**
+ * The longest time, in seconds, to go without checking.
+ */
+#define TRASH_PRESSURE_MAX_INTERVAL (30 * 60)
+
+typedef struct {
+	const gchar *mount;
+	guint64 free_bytes;
+	guint64 total_bytes;
+} MountSpace;
+
+struct _TrashPressureMonitor {
+	GObject parent_instance;
+
+	TrashPurgeScheduler *scheduler;
+	GSettings *settings;
+	GCancellable *cancellable;
+
+	guint check_source_id;
+	guint idle_interval;
+	gboolean checking;
+};
+
+G_DEFINE_FINAL_TYPE(TrashPressureMonitor, trash_pressure_monitor, G_TYPE_OBJECT)
+
+static void trash_pressure_monitor_dispose(GObject *object) {
+	TrashPressureMonitor *self;
+
+	self = TRASH_PRESSURE_MONITOR(object);
+
+	g_cancellable_cancel(self->cancellable);
+
+	if (self->check_source_id != 0) {
+		g_source_remove(self->check_source_id);
+		self->check_source_id = 0;
+	}
+
+	g_clear_object(&self->scheduler);
+	g_clear_object(&self->settings);
+
+	G_OBJECT_CLASS(trash_pressure_monitor_parent_class)->dispose(object);
+}
+
+static void trash_pressure_monitor_finalize(GObject *object) {
+	TrashPressureMonitor *self;
+
+	self = TRASH_PRESSURE_MONITOR(object);
+
+	g_object_unref(self->cancellable);
+
+	G_OBJECT_CLASS(trash_pressure_monitor_parent_class)->finalize(object);
+}
+
+static void trash_pressure_monitor_class_init(TrashPressureMonitorClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_pressure_monitor_dispose;
+	class->finalize = trash_pressure_monitor_finalize;
+}
+
+static void trash_pressure_monitor_init(TrashPressureMonitor *self) {
+	self->cancellable = g_cancellable_new();
+	self->idle_interval = TRASH_PRESSURE_WARM_INTERVAL;
+}
+
+static void schedule_check(TrashPressureMonitor *self, guint delay);
+
+/**
+ * Look up the free space on each mount. This runs on a worker thread
+ * because statvfs() can block on network filesystems.
+ */
+static void check_space_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	(void) source_object;
+
+	GPtrArray *mounts = task_data;
+	GArray *spaces;
+	MountSpace space;
+	struct statvfs buf;
+	guint i;
+
+	spaces = g_array_sized_new(FALSE, FALSE, sizeof(MountSpace), mounts->len);
+
+	for (i = 0; i < mounts->len; i++) {
+		if (g_cancellable_is_cancelled(cancellable)) {
+			break;
+		}
+
+		space.mount = g_ptr_array_index(mounts, i);
+
+		if (statvfs(space.mount, &buf) != 0 || buf.f_blocks == 0) {
+			continue;
+		}
+
+		// Count only the space that we can actually use, not the blocks
+		// reserved for root.
+		space.free_bytes = (guint64) buf.f_bavail * buf.f_frsize;
+		space.total_bytes = (guint64) buf.f_blocks * buf.f_frsize;
+		g_array_append_val(spaces, space);
+	}
+
+	g_task_return_pointer(task, spaces, (GDestroyNotify) g_array_unref);
+}
+
+static void check_space_finished(GObject *source, GAsyncResult *result, gpointer user_data) {
+	TrashPressureMonitor *self = TRASH_PRESSURE_MONITOR(source);
+	g_autoptr(GArray) spaces = NULL;
+	g_autofree gchar *formatted = NULL;
+	MountSpace *space;
+	guint low, high, i;
+	guint64 low_bytes, high_bytes, freed;
+	guint delay;
+
+	(void) user_data;
+
+	spaces = g_task_propagate_pointer(G_TASK(result), NULL);
+
+	if (g_cancellable_is_cancelled(self->cancellable)) {
+		return;
+	}
+
+	self->checking = FALSE;
+
+	low = g_settings_get_uint(self->settings, TRASH_SETTINGS_KEY_FREE_SPACE_LOW_WATERMARK);
+	high = MAX(g_settings_get_uint(self->settings, TRASH_SETTINGS_KEY_FREE_SPACE_HIGH_WATERMARK), low);
+
+	if (low == 0) {
+		return;
+	}
+
+	delay = 0;
+
+	for (i = 0; spaces && i < spaces->len; i++) {
+		space = &g_array_index(spaces, MountSpace, i);
+		low_bytes = space->total_bytes / 100 * low;
+		high_bytes = space->total_bytes / 100 * high;
+
+		if (space->free_bytes < low_bytes) {
+			freed = trash_purge_scheduler_purge_space(self->scheduler, space->mount, high_bytes - space->free_bytes);
+
+			if (freed > 0) {
+				formatted = g_format_size(freed);
+				g_message("Low on disk space on '%s', purging %s from the trash", space->mount, formatted);
+				g_clear_pointer(&formatted, g_free);
+			}
+
+			delay = TRASH_PRESSURE_RECHECK_INTERVAL;
+		} else if (space->free_bytes < low_bytes * 2) {
+			delay = delay ? MIN(delay, TRASH_PRESSURE_NEAR_INTERVAL) : TRASH_PRESSURE_NEAR_INTERVAL;
+		} else if (space->free_bytes < low_bytes * 4) {
+			delay = delay ? MIN(delay, TRASH_PRESSURE_WARM_INTERVAL) : TRASH_PRESSURE_WARM_INTERVAL;
+		}
+	}
+
+	if (delay == 0) {
+		// Plenty of room everywhere, so back off
+		delay = self->idle_interval;
+		self->idle_interval = MIN(self->idle_interval * 2, TRASH_PRESSURE_MAX_INTERVAL);
+	} else {
+		self->idle_interval = TRASH_PRESSURE_WARM_INTERVAL;
+	}
+
+	schedule_check(self, delay);
+}
+
+static gboolean check_timeout_cb(gpointer user_data) {
+	TrashPressureMonitor *self = user_data;
+	g_autoptr(GTask) task = NULL;
+	GPtrArray *mounts;
+
+	self->check_source_id = 0;
+
+	if (g_settings_get_uint(self->settings, TRASH_SETTINGS_KEY_FREE_SPACE_LOW_WATERMARK) == 0) {
+		return G_SOURCE_REMOVE;
+	}
+
+	mounts = trash_purge_scheduler_get_mounts(self->scheduler);
+
+	if (mounts->len == 0) {
+		// Nothing we could purge anyway; look again later in case that changes
+		g_ptr_array_unref(mounts);
+		schedule_check(self, TRASH_PRESSURE_WARM_INTERVAL);
+		return G_SOURCE_REMOVE;
+	}
+
+	self->checking = TRUE;
+
+	task = g_task_new(self, self->cancellable, check_space_finished, NULL);
+	g_task_set_priority(task, G_PRIORITY_LOW);
+	g_task_set_task_data(task, mounts, (GDestroyNotify) g_ptr_array_unref);
+	g_task_run_in_thread(task, check_space_thread);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Check free space after @delay seconds, replacing any check that was
+ * already scheduled.
+ */
+static void schedule_check(TrashPressureMonitor *self, guint delay) {
+	if (self->check_source_id != 0) {
+		g_source_remove(self->check_source_id);
+	}
+
+	self->check_source_id = g_timeout_add_seconds(delay, check_timeout_cb, self);
+}
+
+static void settings_changed(GSettings *settings, gchar *key, TrashPressureMonitor *self) {
+	(void) settings;
+	(void) key;
+
+	self->idle_interval = TRASH_PRESSURE_WARM_INTERVAL;
+
+	if (!self->checking) {
+		schedule_check(self, TRASH_PRESSURE_RECHECK_INTERVAL);
+	}
+}
+
+/**
+ * trash_pressure_monitor_new:
+ * @scheduler: (transfer none): the #TrashPurgeScheduler to purge items with
+ * @settings: (transfer none): the applet instance settings
+ *
+ * Creates a new #TrashPressureMonitor. Nothing happens until the user sets
+ * a low watermark.
+ *
+ * Returns: a new #TrashPressureMonitor
+ */
+TrashPressureMonitor *trash_pressure_monitor_new(TrashPurgeScheduler *scheduler, GSettings *settings) {
+	TrashPressureMonitor *self;
+
+	self = g_object_new(TRASH_TYPE_PRESSURE_MONITOR, NULL);
+	self->scheduler = g_object_ref(scheduler);
+	self->settings = g_object_ref(settings);
+
+	g_signal_connect_object(settings, "changed::" TRASH_SETTINGS_KEY_FREE_SPACE_LOW_WATERMARK, G_CALLBACK(settings_changed), self, 0);
+	g_signal_connect_object(settings, "changed::" TRASH_SETTINGS_KEY_FREE_SPACE_HIGH_WATERMARK, G_CALLBACK(settings_changed), self, 0);
+
+	// Give the trash manager time to find everything before the first check
+	schedule_check(self, TRASH_PRESSURE_WARM_INTERVAL);
+
+	return self;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "trash_purge_scheduler.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_PRESSURE_MONITOR (trash_pressure_monitor_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashPressureMonitor, trash_pressure_monitor, TRASH, PRESSURE_MONITOR, GObject)
+
+TrashPressureMonitor *trash_pressure_monitor_new(TrashPurgeScheduler *scheduler, GSettings *settings);
+
+G_END_DECLS
@@ -0,0 +1,993 @@
+/**
+ * SECTION:trashpurgescheduler
+ * @Short_description: Automatically deletes old trashed items
+ * @Title: TrashPurgeScheduler
+ *
+ * The #TrashPurgeScheduler enforces the retention policy from the applet
+ * settings: items older than a number of days are deleted, and while the
+ * trash bin is bigger than a size limit the oldest items are deleted.
+ *
+ * Items are kept in a min-heap ordered by deletion time, which is updated
+ * as the #TrashManager reports items being added and removed, so finding
+ * the next item to purge never requires a scan.
+ *
+ * Purging happens in small slices on a worker thread with idle I/O
+ * priority, with a pause between slices, so that it doesn't compete with
+ * anything the user is doing.
+ *
+ * The scheduler also keeps track of how much is in the trash on each
+ * filesystem, so that space can be freed up on a particular filesystem
+ * when it is running low. See trash_purge_scheduler_purge_space().
+ */
+
+#include "trash_purge_scheduler.h"
+#include "trash_settings_keys.h"
+#include <gio/gunixmounts.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * How long to wait, in seconds, after something changes before starting
+ * a purge pass. This lets bursts of changes settle first.
+ */
+#define TRASH_PURGE_PASS_DELAY 5
+
+/**
+ * The maximum number of items deleted in a single slice.
+ */
+#define TRASH_PURGE_SLICE_SIZE 16
+
+/**
+ * The pause, in milliseconds, between two slices of a purge pass.
+ */
+#define TRASH_PURGE_SLICE_INTERVAL 250
+
+/**
+ * The longest we will sleep, in seconds, before checking for items that
+ * have aged out of the retention period.
+ */
+#define TRASH_PURGE_MAX_SLEEP (24 * 60 * 60)
+
+#define TRASH_PURGE_SECONDS_PER_DAY (24 * 60 * 60)
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_PRIO_VALUE(class, data) (((class) << IOPRIO_CLASS_SHIFT) | (data))
+#endif
+
+/**
+ * Where an item that isn't in the heap stands, in place of its index.
+ */
+#define TRASH_PURGE_DETACHED -1
+#define TRASH_PURGE_FAILED -2
+
+enum {
+	PROP_QUEUED = 1,
+	LAST_PROP
+};
+
+static GParamSpec *props[LAST_PROP] = {
+	NULL,
+};
+
+typedef struct {
+	gchar *name;
+	gchar *uri;
+	const gchar *mount;
+	gint64 deletion_time;
+	goffset size;
+	gint index;
+} PurgeItem;
+
+typedef struct {
+	gchar *name;
+	gchar *uri;
+	goffset size;
+} PurgeJob;
+
+typedef struct {
+	TrashBackend *backend;
+	GPtrArray *jobs;
+	gboolean urgent;
+} PurgeSlice;
+
+typedef struct {
+	guint count;
+	guint64 bytes;
+	/* Bytes picked to be purged that haven't been reported gone yet */
+	guint64 detached;
+} MountUsage;
+
+typedef struct {
+	guint count;
+	guint64 bytes;
+	GPtrArray *failed;
+} PurgeResult;
+
+struct _TrashPurgeScheduler {
+	GObject parent_instance;
+
+	TrashManager *manager;
+	GSettings *settings;
+	GCancellable *cancellable;
+
+	GHashTable *items;
+	GPtrArray *heap;
+	guint64 total_bytes;
+	guint64 detached_bytes;
+	guint64 failed_bytes;
+
+	GUnixMountMonitor *mount_monitor;
+	GList *mount_paths;
+	GHashTable *mounts;
+	GPtrArray *pressure_jobs;
+
+	guint pass_source_id;
+	guint slice_source_id;
+	gboolean pass_running;
+	gboolean pass_again;
+
+	gint64 pass_start;
+	guint pass_count;
+	guint64 pass_bytes;
+};
+
+G_DEFINE_FINAL_TYPE(TrashPurgeScheduler, trash_purge_scheduler, G_TYPE_OBJECT)
+
+static void purge_item_free(gpointer data) {
+	PurgeItem *item = data;
+
+	g_free(item->name);
+	g_free(item->uri);
+	g_slice_free(PurgeItem, item);
+}
+
+static void purge_job_free(gpointer data) {
+	PurgeJob *job = data;
+
+	g_free(job->name);
+	g_free(job->uri);
+	g_slice_free(PurgeJob, job);
+}
+
+static void purge_slice_free(gpointer data) {
+	PurgeSlice *slice = data;
+
+	g_object_unref(slice->backend);
+	g_ptr_array_unref(slice->jobs);
+	g_slice_free(PurgeSlice, slice);
+}
+
+static void purge_result_free(gpointer data) {
+	PurgeResult *result = data;
+
+	g_ptr_array_unref(result->failed);
+	g_slice_free(PurgeResult, result);
+}
+
+static void mount_usage_free(gpointer data) {
+	g_slice_free(MountUsage, data);
+}
+
+/* Heap helpers */
+
+static inline PurgeItem *heap_get(TrashPurgeScheduler *self, guint index) {
+	return g_ptr_array_index(self->heap, index);
+}
+
+static void heap_swap(TrashPurgeScheduler *self, guint a, guint b) {
+	PurgeItem *item_a = heap_get(self, a);
+	PurgeItem *item_b = heap_get(self, b);
+
+	self->heap->pdata[a] = item_b;
+	self->heap->pdata[b] = item_a;
+	item_a->index = (gint) b;
+	item_b->index = (gint) a;
+}
+
+static void heap_sift_up(TrashPurgeScheduler *self, guint index) {
+	guint parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+
+		if (heap_get(self, parent)->deletion_time <= heap_get(self, index)->deletion_time) {
+			break;
+		}
+
+		heap_swap(self, parent, index);
+		index = parent;
+	}
+}
+
+static void heap_sift_down(TrashPurgeScheduler *self, guint index) {
+	guint left, right, smallest;
+
+	for (;;) {
+		left = index * 2 + 1;
+		right = left + 1;
+		smallest = index;
+
+		if (left < self->heap->len && heap_get(self, left)->deletion_time < heap_get(self, smallest)->deletion_time) {
+			smallest = left;
+		}
+
+		if (right < self->heap->len && heap_get(self, right)->deletion_time < heap_get(self, smallest)->deletion_time) {
+			smallest = right;
+		}
+
+		if (smallest == index) {
+			break;
+		}
+
+		heap_swap(self, index, smallest);
+		index = smallest;
+	}
+}
+
+static void heap_push(TrashPurgeScheduler *self, PurgeItem *item) {
+	item->index = (gint) self->heap->len;
+	g_ptr_array_add(self->heap, item);
+	heap_sift_up(self, self->heap->len - 1);
+}
+
+/**
+ * Take an item out of the heap, wherever it is.
+ */
+static void heap_remove(TrashPurgeScheduler *self, PurgeItem *item) {
+	guint index = (guint) item->index;
+	guint last = self->heap->len - 1;
+
+	if (index != last) {
+		heap_swap(self, index, last);
+	}
+
+	g_ptr_array_remove_index(self->heap, last);
+	item->index = TRASH_PURGE_DETACHED;
+
+	if (index < self->heap->len) {
+		heap_sift_up(self, index);
+		heap_sift_down(self, index);
+	}
+}
+
+/**
+ * Take an item out of the heap to be purged. It stays in our table until
+ * the manager tells us it is gone, but no longer counts towards the size
+ * limit or the space still to be freed on its filesystem.
+ */
+static void detach_item(TrashPurgeScheduler *self, PurgeItem *item) {
+	MountUsage *usage;
+
+	heap_remove(self, item);
+	self->detached_bytes += (guint64) item->size;
+
+	usage = item->mount ? g_hash_table_lookup(self->mounts, item->mount) : NULL;
+	if (usage) {
+		usage->detached += (guint64) item->size;
+	}
+}
+
+/**
+ * Undo detach_item(), for an item that is gone or couldn't be purged.
+ */
+static void release_item(TrashPurgeScheduler *self, PurgeItem *item) {
+	MountUsage *usage;
+
+	self->detached_bytes -= (guint64) item->size;
+
+	usage = item->mount ? g_hash_table_lookup(self->mounts, item->mount) : NULL;
+	if (usage) {
+		usage->detached -= (guint64) item->size;
+	}
+}
+
+static void trash_purge_scheduler_dispose(GObject *object) {
+	TrashPurgeScheduler *self;
+
+	self = TRASH_PURGE_SCHEDULER(object);
+
+	g_cancellable_cancel(self->cancellable);
+
+	if (self->pass_source_id != 0) {
+		g_source_remove(self->pass_source_id);
+		self->pass_source_id = 0;
+	}
+
+	if (self->slice_source_id != 0) {
+		g_source_remove(self->slice_source_id);
+		self->slice_source_id = 0;
+	}
+
+	if (self->mount_monitor) {
+		g_signal_handlers_disconnect_by_data(self->mount_monitor, self);
+		g_clear_object(&self->mount_monitor);
+	}
+
+	g_clear_object(&self->manager);
+	g_clear_object(&self->settings);
+
+	G_OBJECT_CLASS(trash_purge_scheduler_parent_class)->dispose(object);
+}
+
+static void trash_purge_scheduler_finalize(GObject *object) {
+	TrashPurgeScheduler *self;
+
+	self = TRASH_PURGE_SCHEDULER(object);
+
+	g_ptr_array_unref(self->pressure_jobs);
+	g_hash_table_unref(self->mounts);
+	g_list_free(self->mount_paths);
+	g_ptr_array_unref(self->heap);
+	g_hash_table_unref(self->items);
+	g_object_unref(self->cancellable);
+
+	G_OBJECT_CLASS(trash_purge_scheduler_parent_class)->finalize(object);
+}
+
+static void trash_purge_scheduler_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *spec) {
+	TrashPurgeScheduler *self;
+
+	self = TRASH_PURGE_SCHEDULER(object);
+
+	switch (prop_id) {
+		case PROP_QUEUED:
+			g_value_set_uint(value, self->pressure_jobs->len);
+			break;
+		default:
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, spec);
+			break;
+	}
+}
+
+static void trash_purge_scheduler_class_init(TrashPurgeSchedulerClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_purge_scheduler_dispose;
+	class->finalize = trash_purge_scheduler_finalize;
+	class->get_property = trash_purge_scheduler_get_property;
+
+	/**
+	 * TrashPurgeScheduler:queued:
+	 *
+	 * The number of items queued to be purged to free up disk space that
+	 * haven't been handed to a slice yet.
+	 */
+	props[PROP_QUEUED] = g_param_spec_uint(
+		"queued",
+		"Queued",
+		"Items queued to free up disk space",
+		0, G_MAXUINT, 0,
+		G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties(class, LAST_PROP, props);
+}
+
+static gint compare_length_descending(gconstpointer a, gconstpointer b) {
+	return (gint) strlen(b) - (gint) strlen(a);
+}
+
+/**
+ * Refresh our list of mount points, longest first so that the first
+ * match for a path is the mount it lives on.
+ */
+static void reload_mounts(TrashPurgeScheduler *self) {
+	GList *mounts, *l;
+
+	g_clear_pointer(&self->mount_paths, g_list_free);
+
+	mounts = g_unix_mounts_get(NULL);
+
+	for (l = mounts; l; l = l->next) {
+		self->mount_paths = g_list_prepend(self->mount_paths, (gpointer) g_intern_string(g_unix_mount_get_mount_path(l->data)));
+	}
+
+	g_list_free_full(mounts, (GDestroyNotify) g_unix_mount_free);
+
+	self->mount_paths = g_list_sort(self->mount_paths, compare_length_descending);
+}
+
+/**
+ * Find the mount point that a path is on, without touching the disk.
+ *
+ * Returns: (transfer none) (nullable): an interned mount path
+ */
+static const gchar *find_mount(TrashPurgeScheduler *self, const gchar *path) {
+	const gchar *mount_path;
+	gsize len;
+	GList *l;
+
+	if (!path) {
+		return NULL;
+	}
+
+	for (l = self->mount_paths; l; l = l->next) {
+		mount_path = l->data;
+		len = strlen(mount_path);
+
+		if (g_str_equal(mount_path, "/")) {
+			return mount_path;
+		}
+
+		if (strncmp(path, mount_path, len) == 0 && (path[len] == '/' || path[len] == '\0')) {
+			return mount_path;
+		}
+	}
+
+	return NULL;
+}
+
+static void mounts_changed(GUnixMountMonitor *monitor, TrashPurgeScheduler *self) {
+	(void) monitor;
+
+	reload_mounts(self);
+}
+
+static void trash_purge_scheduler_init(TrashPurgeScheduler *self) {
+	self->cancellable = g_cancellable_new();
+	self->items = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, purge_item_free);
+	self->heap = g_ptr_array_new();
+	self->mounts = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, mount_usage_free);
+	self->pressure_jobs = g_ptr_array_new_with_free_func(purge_job_free);
+
+	reload_mounts(self);
+
+	self->mount_monitor = g_unix_mount_monitor_get();
+	g_signal_connect(self->mount_monitor, "mounts-changed", G_CALLBACK(mounts_changed), self);
+}
+
+/**
+ * Get the retention policy limits from the settings.
+ */
+static void get_limits(TrashPurgeScheduler *self, gint64 *cutoff, guint64 *max_bytes) {
+	guint days;
+	guint gigabytes;
+
+	days = g_settings_get_uint(self->settings, TRASH_SETTINGS_KEY_RETENTION_DAYS);
+	gigabytes = g_settings_get_uint(self->settings, TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE);
+
+	*cutoff = days > 0 ? g_get_real_time() / G_USEC_PER_SEC - (gint64) days * TRASH_PURGE_SECONDS_PER_DAY : G_MININT64;
+	*max_bytes = gigabytes > 0 ? (guint64) gigabytes * 1000 * 1000 * 1000 : G_MAXUINT64;
+}
+
+/**
+ * Whether or not the oldest item needs to be purged under the given limits.
+ * Items that couldn't be purged don't count towards the size limit, or
+ * newer items would be purged in their place.
+ */
+static gboolean should_purge_oldest(TrashPurgeScheduler *self, gint64 cutoff, guint64 max_bytes) {
+	if (self->heap->len == 0) {
+		return FALSE;
+	}
+
+	if (heap_get(self, 0)->deletion_time <= cutoff) {
+		return TRUE;
+	}
+
+	return self->total_bytes - self->detached_bytes - self->failed_bytes > max_bytes;
+}
+
+/* Worker thread */
+
+static void purge_slice_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable) {
+	(void) source_object;
+
+	PurgeSlice *slice = task_data;
+	GPtrArray *jobs = slice->jobs;
+	PurgeResult *result;
+	PurgeJob *job;
+	guint64 freed;
+	guint i;
+#if defined(__linux__) && defined(SYS_ioprio_set)
+	long old_priority;
+#endif
+
+	result = g_slice_new0(PurgeResult);
+	result->failed = g_ptr_array_new_with_free_func(g_free);
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+	// This is a shared pool thread, so put its priority back when we're done.
+	// When a disk is filling up, freeing space is the most important thing
+	// going on, so don't hold back then.
+	old_priority = -1;
+	if (!slice->urgent) {
+		old_priority = syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+		syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0));
+	}
+#endif
+
+	for (i = 0; i < jobs->len; i++) {
+		g_autoptr(GError) error = NULL;
+
+		if (g_cancellable_is_cancelled(cancellable)) {
+			break;
+		}
+
+		job = g_ptr_array_index(jobs, i);
+
+		if (!trash_backend_delete_item(slice->backend, job->name, &freed, cancellable, &error)) {
+			g_warning("Unable to purge trashed item '%s': %s", job->name, error->message);
+			g_ptr_array_add(result->failed, g_strdup(job->uri));
+			continue;
+		}
+
+		// Not every backend can tell how much was actually freed
+		result->bytes += freed > 0 ? freed : (guint64) job->size;
+		result->count++;
+	}
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+	if (old_priority >= 0) {
+		syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, old_priority);
+	}
+#endif
+
+	g_task_return_pointer(task, result, purge_result_free);
+}
+
+/* Purge passes */
+
+static void schedule_pass(TrashPurgeScheduler *self, guint delay);
+
+static void run_slice(TrashPurgeScheduler *self, gboolean urgent);
+
+/**
+ * Finish a purge pass, and figure out when the next one should be.
+ */
+static void finish_pass(TrashPurgeScheduler *self) {
+	g_autofree gchar *formatted = NULL;
+	gint64 cutoff, wake;
+	guint64 max_bytes;
+	gdouble seconds;
+	guint days;
+
+	self->pass_running = FALSE;
+
+	if (self->pass_count > 0) {
+		seconds = (gdouble) (g_get_monotonic_time() - self->pass_start) / G_USEC_PER_SEC;
+		formatted = g_format_size(self->pass_bytes);
+
+		g_message("Purged %u trashed items, reclaiming %s in %.2f seconds", self->pass_count, formatted, seconds);
+	}
+
+	if (self->pass_again) {
+		self->pass_again = FALSE;
+		schedule_pass(self, TRASH_PURGE_PASS_DELAY);
+		return;
+	}
+
+	// Sleep until the oldest item ages out of the retention period
+	days = g_settings_get_uint(self->settings, TRASH_SETTINGS_KEY_RETENTION_DAYS);
+	get_limits(self, &cutoff, &max_bytes);
+
+	if (days > 0 && self->heap->len > 0) {
+		wake = heap_get(self, 0)->deletion_time - cutoff + 1;
+		schedule_pass(self, (guint) CLAMP(wake, TRASH_PURGE_PASS_DELAY, TRASH_PURGE_MAX_SLEEP));
+	}
+}
+
+/**
+ * Stop counting an item that couldn't be purged as on its way out. It
+ * isn't put back in the heap, or it would be the first one picked again,
+ * and its size is left out of the size limit from now on.
+ */
+static void purge_failed(TrashPurgeScheduler *self, const gchar *uri) {
+	PurgeItem *item;
+
+	item = g_hash_table_lookup(self->items, uri);
+
+	if (!item || item->index != TRASH_PURGE_DETACHED) {
+		return;
+	}
+
+	release_item(self, item);
+	item->index = TRASH_PURGE_FAILED;
+	self->failed_bytes += (guint64) item->size;
+}
+
+static void slice_finished(GObject *source, GAsyncResult *result, gpointer user_data) {
+	TrashPurgeScheduler *self = TRASH_PURGE_SCHEDULER(source);
+	PurgeResult *purge_result;
+	guint i;
+
+	(void) user_data;
+
+	purge_result = g_task_propagate_pointer(G_TASK(result), NULL);
+
+	if (purge_result) {
+		self->pass_count += purge_result->count;
+		self->pass_bytes += purge_result->bytes;
+
+		for (i = 0; i < purge_result->failed->len; i++) {
+			purge_failed(self, g_ptr_array_index(purge_result->failed, i));
+		}
+
+		purge_result_free(purge_result);
+	}
+
+	if (g_cancellable_is_cancelled(self->cancellable)) {
+		return;
+	}
+
+	run_slice(self, self->pressure_jobs->len > 0);
+}
+
+static gboolean slice_timeout_cb(gpointer user_data) {
+	TrashPurgeScheduler *self = user_data;
+	g_autoptr(GTask) task = NULL;
+	g_autoptr(GPtrArray) jobs = NULL;
+	PurgeSlice *slice;
+	PurgeItem *item;
+	PurgeJob *job;
+	gint64 cutoff;
+	guint64 max_bytes;
+
+	self->slice_source_id = 0;
+
+	get_limits(self, &cutoff, &max_bytes);
+
+	jobs = g_ptr_array_new_with_free_func(purge_job_free);
+	slice = g_slice_new(PurgeSlice);
+	slice->backend = g_object_ref(trash_manager_get_backend(self->manager));
+	slice->urgent = self->pressure_jobs->len > 0;
+
+	// Freeing up space on a full disk comes first
+	while (jobs->len < TRASH_PURGE_SLICE_SIZE && self->pressure_jobs->len > 0) {
+		g_ptr_array_add(jobs, g_ptr_array_steal_index(self->pressure_jobs, self->pressure_jobs->len - 1));
+	}
+
+	if (jobs->len > 0) {
+		g_object_notify_by_pspec(G_OBJECT(self), props[PROP_QUEUED]);
+	}
+
+	while (jobs->len < TRASH_PURGE_SLICE_SIZE && should_purge_oldest(self, cutoff, max_bytes)) {
+		item = heap_get(self, 0);
+
+		detach_item(self, item);
+
+		job = g_slice_new(PurgeJob);
+		job->name = g_strdup(item->name);
+		job->uri = g_strdup(item->uri);
+		job->size = item->size;
+		g_ptr_array_add(jobs, job);
+	}
+
+	if (jobs->len == 0) {
+		g_object_unref(slice->backend);
+		g_slice_free(PurgeSlice, slice);
+		finish_pass(self);
+		return G_SOURCE_REMOVE;
+	}
+
+	slice->jobs = g_steal_pointer(&jobs);
+
+	task = g_task_new(self, self->cancellable, slice_finished, NULL);
+	g_task_set_priority(task, slice->urgent ? G_PRIORITY_DEFAULT : G_PRIORITY_LOW);
+	g_task_set_task_data(task, slice, purge_slice_free);
+	g_task_run_in_thread(task, purge_slice_thread);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Queue up the next slice of the current pass, after a short pause unless
+ * we are in a hurry.
+ */
+static void run_slice(TrashPurgeScheduler *self, gboolean urgent) {
+	if (urgent) {
+		self->slice_source_id = g_idle_add(slice_timeout_cb, self);
+	} else {
+		self->slice_source_id = g_timeout_add(TRASH_PURGE_SLICE_INTERVAL, slice_timeout_cb, self);
+	}
+}
+
+static gboolean pass_timeout_cb(gpointer user_data) {
+	TrashPurgeScheduler *self = user_data;
+
+	self->pass_source_id = 0;
+	self->pass_running = TRUE;
+	self->pass_start = g_get_monotonic_time();
+	self->pass_count = 0;
+	self->pass_bytes = 0;
+
+	// Run the first slice right away
+	self->slice_source_id = g_idle_add(slice_timeout_cb, self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Start a purge pass after @delay seconds, replacing any that was
+ * already scheduled.
+ */
+static void schedule_pass(TrashPurgeScheduler *self, guint delay) {
+	if (self->pass_source_id != 0) {
+		g_source_remove(self->pass_source_id);
+	}
+
+	self->pass_source_id = g_timeout_add_seconds(delay, pass_timeout_cb, self);
+}
+
+/* Manager and settings hookups */
+
+static void trash_added(TrashManager *manager, TrashInfo *trash_info, TrashPurgeScheduler *self) {
+	(void) manager;
+	PurgeItem *item;
+	MountUsage *usage;
+	const gchar *target_path;
+	gint64 cutoff;
+	guint64 max_bytes;
+
+	item = g_slice_new0(PurgeItem);
+	item->name = g_strdup(trash_info_peek_name(trash_info));
+	item->uri = g_strdup(trash_info_peek_uri(trash_info));
+	item->size = trash_info_get_size(trash_info);
+
+	item->deletion_time = trash_info_get_deletion_timestamp(trash_info) / G_USEC_PER_SEC;
+
+	// Without a deletion date, count the retention period from when we
+	// first saw the item rather than from the epoch
+	if (item->deletion_time == 0) {
+		item->deletion_time = g_get_real_time() / G_USEC_PER_SEC;
+	}
+
+	// Purging frees space where the item is kept now. That is usually the
+	// filesystem it came from, but not when it was moved across devices to
+	// the home trash bin, so only go by where it came from when the
+	// backend doesn't say where it is.
+	target_path = trash_info_peek_target_path(trash_info);
+	item->mount = find_mount(self, target_path ? target_path : trash_info_peek_restore_path(trash_info));
+
+	g_hash_table_replace(self->items, item->uri, item);
+	heap_push(self, item);
+	self->total_bytes += (guint64) item->size;
+
+	if (item->mount) {
+		usage = g_hash_table_lookup(self->mounts, item->mount);
+
+		if (!usage) {
+			usage = g_slice_new0(MountUsage);
+			g_hash_table_insert(self->mounts, (gpointer) item->mount, usage);
+		}
+
+		usage->count++;
+		usage->bytes += (guint64) item->size;
+	}
+
+	get_limits(self, &cutoff, &max_bytes);
+	if (should_purge_oldest(self, cutoff, max_bytes)) {
+		trash_purge_scheduler_queue_pass(self);
+	}
+}
+
+static void trash_removed(TrashManager *manager, gchar *uri, TrashPurgeScheduler *self) {
+	(void) manager;
+	PurgeItem *item;
+	MountUsage *usage;
+
+	item = g_hash_table_lookup(self->items, uri);
+
+	if (!item) {
+		return;
+	}
+
+	if (item->index >= 0) {
+		heap_remove(self, item);
+	} else if (item->index == TRASH_PURGE_DETACHED) {
+		release_item(self, item);
+	} else if (item->index == TRASH_PURGE_FAILED) {
+		self->failed_bytes -= (guint64) item->size;
+	}
+
+	self->total_bytes -= (guint64) item->size;
+
+	usage = item->mount ? g_hash_table_lookup(self->mounts, item->mount) : NULL;
+	if (usage) {
+		usage->bytes -= (guint64) item->size;
+
+		if (--usage->count == 0) {
+			g_hash_table_remove(self->mounts, item->mount);
+		}
+	}
+
+	g_hash_table_remove(self->items, uri);
+}
+
+static void settings_changed(GSettings *settings, gchar *key, TrashPurgeScheduler *self) {
+	(void) settings;
+	(void) key;
+
+	trash_purge_scheduler_queue_pass(self);
+}
+
+/**
+ * trash_purge_scheduler_new:
+ * @manager: (transfer none): the #TrashManager to get items from
+ * @settings: (transfer none): the applet settings with the retention policy
+ *
+ * Creates a new #TrashPurgeScheduler.
+ *
+ * Returns: a new #TrashPurgeScheduler
+ */
+TrashPurgeScheduler *trash_purge_scheduler_new(TrashManager *manager, GSettings *settings) {
+	TrashPurgeScheduler *self;
+
+	self = g_object_new(TRASH_TYPE_PURGE_SCHEDULER, NULL);
+	self->manager = g_object_ref(manager);
+	self->settings = g_object_ref(settings);
+
+	g_signal_connect_object(manager, "trash-added", G_CALLBACK(trash_added), self, 0);
+	g_signal_connect_object(manager, "trash-removed", G_CALLBACK(trash_removed), self, 0);
+	g_signal_connect_object(settings, "changed::" TRASH_SETTINGS_KEY_RETENTION_DAYS, G_CALLBACK(settings_changed), self, 0);
+	g_signal_connect_object(settings, "changed::" TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE, G_CALLBACK(settings_changed), self, 0);
+
+	return self;
+}
+
+/**
+ * trash_purge_scheduler_queue_pass:
+ * @self: a #TrashPurgeScheduler
+ *
+ * Queue up a purge pass to enforce the retention policy. The pass starts
+ * after a short delay so that bursts of changes are handled together.
+ */
+void trash_purge_scheduler_queue_pass(TrashPurgeScheduler *self) {
+	g_return_if_fail(TRASH_IS_PURGE_SCHEDULER(self));
+
+	if (self->pass_running) {
+		self->pass_again = TRUE;
+		return;
+	}
+
+	schedule_pass(self, TRASH_PURGE_PASS_DELAY);
+}
+
+/**
+ * trash_purge_scheduler_get_mounts:
+ * @self: a #TrashPurgeScheduler
+ *
+ * Gets the mount points of every filesystem that currently has items in
+ * the trash.
+ *
+ * Returns: (transfer container) (element-type utf8): the interned mount paths
+ */
+GPtrArray *trash_purge_scheduler_get_mounts(TrashPurgeScheduler *self) {
+	GPtrArray *mounts;
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_val_if_fail(TRASH_IS_PURGE_SCHEDULER(self), NULL);
+
+	mounts = g_ptr_array_sized_new(g_hash_table_size(self->mounts));
+
+	g_hash_table_iter_init(&iter, self->mounts);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		g_ptr_array_add(mounts, key);
+	}
+
+	return mounts;
+}
+
+static gint compare_pressure_candidates(gconstpointer a, gconstpointer b) {
+	const PurgeItem *item_a = *(const PurgeItem **) a;
+	const PurgeItem *item_b = *(const PurgeItem **) b;
+
+	// Largest first, and the oldest of those that are the same size
+	if (item_a->size != item_b->size) {
+		return item_a->size > item_b->size ? -1 : 1;
+	}
+
+	if (item_a->deletion_time != item_b->deletion_time) {
+		return item_a->deletion_time < item_b->deletion_time ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/**
+ * trash_purge_scheduler_purge_space:
+ * @self: a #TrashPurgeScheduler
+ * @mount_path: (transfer none): the mount point to free space on
+ * @bytes: how many bytes to free
+ *
+ * Purge trashed items on the filesystem mounted at @mount_path, largest
+ * and oldest first, until at least @bytes bytes would be freed or there
+ * is nothing left to purge there.
+ *
+ * The items are picked from the set the scheduler already knows about, and
+ * purging starts right away without the usual pauses. Items on that
+ * filesystem that are already being purged count towards @bytes, so
+ * asking again before they are gone doesn't purge more than needed.
+ *
+ * Returns: the number of bytes that are going to be freed, on top of
+ *   what was already being purged
+ */
+guint64 trash_purge_scheduler_purge_space(TrashPurgeScheduler *self, const gchar *mount_path, guint64 bytes) {
+	g_autoptr(GPtrArray) candidates = NULL;
+	const gchar *mount;
+	MountUsage *usage;
+	guint64 scheduled = 0;
+	PurgeItem *item;
+	PurgeJob *job;
+	guint i;
+
+	g_return_val_if_fail(TRASH_IS_PURGE_SCHEDULER(self), 0);
+	g_return_val_if_fail(mount_path != NULL, 0);
+
+	mount = g_intern_string(mount_path);
+	usage = g_hash_table_lookup(self->mounts, mount);
+
+	if (!usage || usage->detached >= bytes) {
+		return 0;
+	}
+
+	bytes -= usage->detached;
+
+	candidates = g_ptr_array_new();
+
+	// Only items still in the heap; the rest are already being purged
+	for (i = 0; i < self->heap->len; i++) {
+		item = heap_get(self, i);
+
+		if (item->mount == mount) {
+			g_ptr_array_add(candidates, item);
+		}
+	}
+
+	g_ptr_array_sort(candidates, compare_pressure_candidates);
+
+	// Jobs are taken from the end of the list, so add the most important
+	// ones last.
+	for (i = 0; i < candidates->len && scheduled < bytes; i++) {
+		item = g_ptr_array_index(candidates, i);
+		scheduled += (guint64) item->size;
+	}
+
+	while (i-- > 0) {
+		item = g_ptr_array_index(candidates, i);
+
+		detach_item(self, item);
+
+		job = g_slice_new(PurgeJob);
+		job->name = g_strdup(item->name);
+		job->uri = g_strdup(item->uri);
+		job->size = item->size;
+		g_ptr_array_add(self->pressure_jobs, job);
+	}
+
+	if (scheduled > 0) {
+		g_object_notify_by_pspec(G_OBJECT(self), props[PROP_QUEUED]);
+	}
+
+	if (scheduled > 0 && !self->pass_running) {
+		if (self->pass_source_id != 0) {
+			g_source_remove(self->pass_source_id);
+		}
+
+		self->pass_source_id = g_idle_add(pass_timeout_cb, self);
+	}
+
+	return scheduled;
+}
+
+/**
+ * trash_purge_scheduler_get_queued:
+ * @self: a #TrashPurgeScheduler
+ *
+ * Gets the number of items queued to be purged to free up disk space
+ * that haven't been deleted yet.
+ *
+ * Returns: the number of queued items
+ */
+guint trash_purge_scheduler_get_queued(TrashPurgeScheduler *self) {
+	g_return_val_if_fail(TRASH_IS_PURGE_SCHEDULER(self), 0);
+
+	return self->pressure_jobs->len;
+}
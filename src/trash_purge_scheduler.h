@@ -0,0 +1,22 @@
+#pragma once
+
+#include "trash_manager.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TRASH_TYPE_PURGE_SCHEDULER (trash_purge_scheduler_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashPurgeScheduler, trash_purge_scheduler, TRASH, PURGE_SCHEDULER, GObject)
+
+TrashPurgeScheduler *trash_purge_scheduler_new(TrashManager *manager, GSettings *settings);
+
+void trash_purge_scheduler_queue_pass(TrashPurgeScheduler *self);
+
+GPtrArray *trash_purge_scheduler_get_mounts(TrashPurgeScheduler *self);
+
+guint64 trash_purge_scheduler_purge_space(TrashPurgeScheduler *self, const gchar *mount_path, guint64 bytes);
+
+guint trash_purge_scheduler_get_queued(TrashPurgeScheduler *self);
+
+G_END_DECLS
@@ -0,0 +1,406 @@
+/**
+ * SECTION:trashselection
+ * @Short_description: The set of trashed items the user has picked
+ * @Title: TrashSelection
+ *
+ * A #TrashSelection keeps track of which items are selected, along with
+ * how many there are and their combined size. The totals are updated as
+ * items are selected and unselected, so reading them never walks the
+ * selection. Items that leave the trash bin are dropped from the
+ * selection automatically.
+ *
+ * Besides selecting items one at a time, every item that matches a
+ * predicate can be selected in a single pass over the #TrashManager, see
+ * trash_selection_select_matching().
+ */
+
+#include "trash_selection.h"
+#include <string.h>
+
+enum {
+	CHANGED,
+	LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+struct _TrashSelection {
+	GObject parent_instance;
+
+	TrashManager *manager;
+
+	/* URI to TrashInfo; the key is owned by the value */
+	GHashTable *items;
+	guint64 bytes;
+};
+
+G_DEFINE_FINAL_TYPE(TrashSelection, trash_selection, G_TYPE_OBJECT)
+
+static guint64 item_bytes(TrashInfo *info) {
+	goffset size;
+
+	size = trash_info_get_size(info);
+
+	return size > 0 ? (guint64) size : 0;
+}
+
+/**
+ * Add an item without emitting any signals.
+ *
+ * Returns: %TRUE if the item wasn't selected yet
+ */
+static gboolean add_item(TrashSelection *self, TrashInfo *info) {
+	const gchar *uri;
+
+	uri = trash_info_peek_uri(info);
+
+	if (g_hash_table_contains(self->items, uri)) {
+		return FALSE;
+	}
+
+	g_hash_table_insert(self->items, (gpointer) uri, g_object_ref(info));
+	self->bytes += item_bytes(info);
+
+	return TRUE;
+}
+
+/**
+ * Remove an item without emitting any signals.
+ *
+ * Returns: %TRUE if the item was selected
+ */
+static gboolean remove_item(TrashSelection *self, const gchar *uri) {
+	TrashInfo *info;
+
+	info = g_hash_table_lookup(self->items, uri);
+
+	if (!info) {
+		return FALSE;
+	}
+
+	self->bytes -= MIN(self->bytes, item_bytes(info));
+	g_hash_table_remove(self->items, uri);
+
+	return TRUE;
+}
+
+static void trash_removed(TrashManager *manager, const gchar *uri, TrashSelection *self) {
+	(void) manager;
+
+	if (remove_item(self, uri)) {
+		g_signal_emit(self, signals[CHANGED], 0);
+	}
+}
+
+static void trash_selection_finalize(GObject *object) {
+	TrashSelection *self;
+
+	self = TRASH_SELECTION(object);
+
+	g_hash_table_unref(self->items);
+	g_object_unref(self->manager);
+
+	G_OBJECT_CLASS(trash_selection_parent_class)->finalize(object);
+}
+
+static void trash_selection_class_init(TrashSelectionClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->finalize = trash_selection_finalize;
+
+	// Signals
+
+	/**
+	 * TrashSelection::changed:
+	 * @self: a #TrashSelection
+	 *
+	 * Emitted when items have been selected or unselected. A bulk
+	 * selection emits this once.
+	 */
+	signals[CHANGED] = g_signal_new(
+		"changed",
+		G_TYPE_FROM_CLASS(klass),
+		G_SIGNAL_RUN_LAST,
+		0,
+		NULL, NULL, NULL,
+		G_TYPE_NONE,
+		0);
+}
+
+static void trash_selection_init(TrashSelection *self) {
+	self->items = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_object_unref);
+}
+
+/**
+ * trash_selection_new:
+ * @manager: the #TrashManager with the items to select from
+ *
+ * Creates a new, empty #TrashSelection.
+ *
+ * Returns: (transfer full): a new #TrashSelection
+ */
+TrashSelection *trash_selection_new(TrashManager *manager) {
+	TrashSelection *self;
+
+	g_return_val_if_fail(TRASH_IS_MANAGER(manager), NULL);
+
+	self = g_object_new(TRASH_TYPE_SELECTION, NULL);
+	self->manager = g_object_ref(manager);
+
+	g_signal_connect_object(manager, "trash-removed", G_CALLBACK(trash_removed), self, 0);
+
+	return self;
+}
+
+/**
+ * trash_selection_set_selected:
+ * @self: a #TrashSelection
+ * @info: a #TrashInfo
+ * @selected: whether @info should be selected
+ *
+ * Selects or unselects a single item.
+ *
+ * Returns: %TRUE if the selection changed
+ */
+gboolean trash_selection_set_selected(TrashSelection *self, TrashInfo *info, gboolean selected) {
+	gboolean changed;
+
+	g_return_val_if_fail(TRASH_IS_SELECTION(self), FALSE);
+	g_return_val_if_fail(TRASH_IS_INFO(info), FALSE);
+
+	changed = selected ? add_item(self, info) : remove_item(self, trash_info_peek_uri(info));
+
+	if (changed) {
+		g_signal_emit(self, signals[CHANGED], 0);
+	}
+
+	return changed;
+}
+
+/**
+ * trash_selection_contains:
+ * @self: a #TrashSelection
+ * @uri: the URI of a trashed item
+ *
+ * Checks whether an item is selected.
+ *
+ * Returns: %TRUE if the item with @uri is selected
+ */
+gboolean trash_selection_contains(TrashSelection *self, const gchar *uri) {
+	g_return_val_if_fail(TRASH_IS_SELECTION(self), FALSE);
+	g_return_val_if_fail(uri != NULL, FALSE);
+
+	return g_hash_table_contains(self->items, uri);
+}
+
+/**
+ * trash_selection_clear:
+ * @self: a #TrashSelection
+ *
+ * Unselects every item.
+ */
+void trash_selection_clear(TrashSelection *self) {
+	g_return_if_fail(TRASH_IS_SELECTION(self));
+
+	if (g_hash_table_size(self->items) == 0) {
+		return;
+	}
+
+	g_hash_table_remove_all(self->items);
+	self->bytes = 0;
+
+	g_signal_emit(self, signals[CHANGED], 0);
+}
+
+/**
+ * trash_selection_get_count:
+ * @self: a #TrashSelection
+ *
+ * Gets the number of selected items.
+ *
+ * Returns: the number of selected items
+ */
+guint trash_selection_get_count(TrashSelection *self) {
+	g_return_val_if_fail(TRASH_IS_SELECTION(self), 0);
+
+	return g_hash_table_size(self->items);
+}
+
+/**
+ * trash_selection_get_bytes:
+ * @self: a #TrashSelection
+ *
+ * Gets the combined size of the selected items.
+ *
+ * Returns: the size of the selection in bytes
+ */
+guint64 trash_selection_get_bytes(TrashSelection *self) {
+	g_return_val_if_fail(TRASH_IS_SELECTION(self), 0);
+
+	return self->bytes;
+}
+
+/**
+ * trash_selection_get_items:
+ * @self: a #TrashSelection
+ *
+ * Gets the selected items, so that they can be acted on as one batch.
+ *
+ * Returns: (transfer full) (element-type TrashInfo): the selected items, in no particular order
+ */
+GPtrArray *trash_selection_get_items(TrashSelection *self) {
+	GPtrArray *items;
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_val_if_fail(TRASH_IS_SELECTION(self), NULL);
+
+	items = g_ptr_array_new_full(g_hash_table_size(self->items), g_object_unref);
+
+	g_hash_table_iter_init(&iter, self->items);
+
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		g_ptr_array_add(items, g_object_ref(value));
+	}
+
+	return items;
+}
+
+typedef struct {
+	TrashSelection *self;
+	TrashInfoPredicate predicate;
+	gpointer user_data;
+	guint added;
+} MatchData;
+
+static void select_if_matching(gpointer data, gpointer user_data) {
+	TrashInfo *info = data;
+	MatchData *match = user_data;
+
+	if (!match->predicate(info, match->user_data)) {
+		return;
+	}
+
+	if (add_item(match->self, info)) {
+		match->added++;
+	}
+}
+
+/**
+ * trash_selection_select_matching:
+ * @self: a #TrashSelection
+ * @predicate: (scope call): decides which items to select
+ * @user_data: data to pass to @predicate
+ *
+ * Adds every item in the trash bin that @predicate returns %TRUE for to
+ * the selection, in a single pass. Items that are already selected stay
+ * selected. #TrashSelection::changed is emitted once at the end.
+ *
+ * Returns: the number of items that were newly selected
+ */
+guint trash_selection_select_matching(TrashSelection *self, TrashInfoPredicate predicate, gpointer user_data) {
+	MatchData match = {self, predicate, user_data, 0};
+
+	g_return_val_if_fail(TRASH_IS_SELECTION(self), 0);
+	g_return_val_if_fail(predicate != NULL, 0);
+
+	trash_manager_foreach_item(self->manager, select_if_matching, &match);
+
+	if (match.added > 0) {
+		g_signal_emit(self, signals[CHANGED], 0);
+	}
+
+	return match.added;
+}
+
+static gboolean deleted_before(TrashInfo *info, gpointer user_data) {
+	gint64 timestamp;
+
+	timestamp = trash_info_get_deletion_timestamp(info);
+
+	return timestamp != 0 && timestamp < *(gint64 *) user_data;
+}
+
+/**
+ * trash_selection_select_older_than:
+ * @self: a #TrashSelection
+ * @age: how long ago, in microseconds
+ *
+ * Selects every item that was trashed more than @age ago.
+ *
+ * Returns: the number of items that were newly selected
+ */
+guint trash_selection_select_older_than(TrashSelection *self, GTimeSpan age) {
+	gint64 cutoff;
+
+	cutoff = g_get_real_time() - age;
+
+	return trash_selection_select_matching(self, deleted_before, &cutoff);
+}
+
+static gboolean larger_than(TrashInfo *info, gpointer user_data) {
+	return item_bytes(info) > *(guint64 *) user_data;
+}
+
+/**
+ * trash_selection_select_larger_than:
+ * @self: a #TrashSelection
+ * @bytes: a size in bytes
+ *
+ * Selects every item that is bigger than @bytes.
+ *
+ * Returns: the number of items that were newly selected
+ */
+guint trash_selection_select_larger_than(TrashSelection *self, guint64 bytes) {
+	return trash_selection_select_matching(self, larger_than, &bytes);
+}
+
+static gboolean in_directories(TrashInfo *info, gpointer user_data) {
+	GPtrArray *directories = user_data;
+	const gchar *path, *directory;
+	gsize length;
+	guint i;
+
+	path = trash_info_peek_restore_path(info);
+
+	if (!path) {
+		return FALSE;
+	}
+
+	for (i = 0; i < directories->len; i++) {
+		directory = g_ptr_array_index(directories, i);
+		length = strlen(directory);
+
+		if (strncmp(path, directory, length) == 0 && (path[length] == G_DIR_SEPARATOR || (length > 0 && directory[length - 1] == G_DIR_SEPARATOR))) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * trash_selection_select_in_directories:
+ * @self: a #TrashSelection
+ * @directories: (array zero-terminated=1): absolute paths of directories
+ *
+ * Selects every item that was trashed from inside one of @directories,
+ * or from any directory below them.
+ *
+ * Returns: the number of items that were newly selected
+ */
+guint trash_selection_select_in_directories(TrashSelection *self, const gchar *const *directories) {
+	g_autoptr(GPtrArray) canonical = NULL;
+	guint i;
+
+	g_return_val_if_fail(directories != NULL, 0);
+
+	canonical = g_ptr_array_new_with_free_func(g_free);
+
+	for (i = 0; directories[i]; i++) {
+		g_ptr_array_add(canonical, g_canonicalize_filename(directories[i], "/"));
+	}
+
+	return trash_selection_select_matching(self, in_directories, canonical);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "trash_info.h"
+#include "trash_manager.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * TrashInfoPredicate:
+ * @info: a #TrashInfo
+ * @user_data: the data passed along with the predicate
+ *
+ * Decides whether an item should be selected.
+ *
+ * Returns: %TRUE to select @info
+ */
+typedef gboolean (*TrashInfoPredicate)(TrashInfo *info, gpointer user_data);
+
+#define TRASH_TYPE_SELECTION (trash_selection_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashSelection, trash_selection, TRASH, SELECTION, GObject)
+
+TrashSelection *trash_selection_new(TrashManager *manager);
+
+gboolean trash_selection_set_selected(TrashSelection *self, TrashInfo *info, gboolean selected);
+
+gboolean trash_selection_contains(TrashSelection *self, const gchar *uri);
+
+void trash_selection_clear(TrashSelection *self);
+
+guint trash_selection_get_count(TrashSelection *self);
+
+guint64 trash_selection_get_bytes(TrashSelection *self);
+
+GPtrArray *trash_selection_get_items(TrashSelection *self);
+
+/* Bulk selection */
+
+guint trash_selection_select_matching(TrashSelection *self, TrashInfoPredicate predicate, gpointer user_data);
+
+guint trash_selection_select_older_than(TrashSelection *self, GTimeSpan age);
+
+guint trash_selection_select_larger_than(TrashSelection *self, guint64 bytes);
+
+guint trash_selection_select_in_directories(TrashSelection *self, const gchar *const *directories);
+
+G_END_DECLS
@@ -20,6 +20,13 @@ struct _TrashSettings {
 	GtkRadioButton *btn_sort_reverse_alphabetical;
 	GtkRadioButton *btn_sort_date_ascending;
 	GtkRadioButton *btn_sort_date_descending;
+
+	GtkSpinButton *spin_retention_days;
+	GtkSpinButton *spin_retention_max_size;
+	GtkSpinButton *spin_free_space_low;
+	GtkSpinButton *spin_free_space_high;
+
+	GtkComboBoxText *combo_badge;
 };
 
 G_DEFINE_FINAL_TYPE(TrashSettings, trash_settings, GTK_TYPE_GRID);
@@ -45,6 +52,11 @@ static void trash_settings_class_init(TrashSettingsClass *klass) {
 	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, btn_sort_reverse_alphabetical);
 	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, btn_sort_date_ascending);
 	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, btn_sort_date_descending);
+	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, spin_retention_days);
+	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, spin_retention_max_size);
+	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, spin_free_space_low);
+	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, spin_free_space_high);
+	gtk_widget_class_bind_template_child(GTK_WIDGET_CLASS(klass), TrashSettings, combo_badge);
 
 	class->finalize = trash_settings_finalize;
 }
@@ -144,5 +156,11 @@ TrashSettings *trash_settings_new(GSettings *settings) {
 
 	g_signal_connect(self->settings, "changed", G_CALLBACK(settings_changed), self);
 
+	g_settings_bind(self->settings, TRASH_SETTINGS_KEY_RETENTION_DAYS, self->spin_retention_days, "value", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(self->settings, TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE, self->spin_retention_max_size, "value", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(self->settings, TRASH_SETTINGS_KEY_FREE_SPACE_LOW_WATERMARK, self->spin_free_space_low, "value", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(self->settings, TRASH_SETTINGS_KEY_FREE_SPACE_HIGH_WATERMARK, self->spin_free_space_high, "value", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(self->settings, TRASH_SETTINGS_KEY_BADGE, self->combo_badge, "active-id", G_SETTINGS_BIND_DEFAULT);
+
 	return self;
 }
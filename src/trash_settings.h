@@ -1,6 +1,7 @@
 #pragma once
 
 #include "trash_enum_types.h"
+#include "trash_settings_keys.h"
 #include <gtk/gtk.h>
 
 G_BEGIN_DECLS
@@ -13,13 +14,25 @@ typedef enum {
 	TRASH_SORT_DATE_DESCENDING = 5
 } TrashSortMode;
 
+/**
+ * TrashBadgeMode:
+ * @TRASH_BADGE_NONE: no badge
+ * @TRASH_BADGE_COUNT: the number of items in the trash bin
+ * @TRASH_BADGE_FILL: how close the trash bin is to its size limit
+ *
+ * What the badge on the panel icon shows.
+ */
+typedef enum {
+	TRASH_BADGE_NONE = 1,
+	TRASH_BADGE_COUNT = 2,
+	TRASH_BADGE_FILL = 3
+} TrashBadgeMode;
+
 /**
  * Constant ID for our settings gschema
  */
 #define TRASH_SETTINGS_SCHEMA_ID "com.github.ebonjaeger.budgie-trash-applet"
 
-#define TRASH_SETTINGS_KEY_SORT_MODE "sort-mode"
-
 #define TRASH_TYPE_SETTINGS (trash_settings_get_type())
 
 G_DECLARE_FINAL_TYPE(TrashSettings, trash_settings, TRASH, SETTINGS, GtkGrid)
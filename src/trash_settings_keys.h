@@ -0,0 +1,13 @@
+#pragma once
+
+/**
+ * The keys of the applet settings, kept apart from the settings view so
+ * that code without GTK can read them.
+ */
+
+#define TRASH_SETTINGS_KEY_SORT_MODE "sort-mode"
+#define TRASH_SETTINGS_KEY_RETENTION_DAYS "retention-days"
+#define TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE "retention-max-size"
+#define TRASH_SETTINGS_KEY_FREE_SPACE_LOW_WATERMARK "free-space-low-watermark"
+#define TRASH_SETTINGS_KEY_FREE_SPACE_HIGH_WATERMARK "free-space-high-watermark"
+#define TRASH_SETTINGS_KEY_BADGE "badge"
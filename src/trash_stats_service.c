@@ -0,0 +1,404 @@
+/**
+ * SECTION:trashstatsservice
+ * @Short_description: Publishes trash statistics on the session bus
+ * @Title: TrashStatsService
+ *
+ * The #TrashStatsService exports an object with the
+ * `com.github.EbonJaeger.BudgieTrashApplet.Stats` interface on the session
+ * bus, so that the size of the trash bin and the health of the applet can
+ * be monitored without opening the popover.
+ *
+ * Every value is a running total kept by the #TrashManager, the
+ * #TrashPurgeScheduler, the #TrashFileQueue or the #TrashBackend, so
+ * answering a query never walks the trash bin. Each of them signals when
+ * a value changes, and the changes are published with `PropertiesChanged`
+ * at most once per second.
+ *
+ * The `GetStalls` method returns the longest main loop stalls recorded by
+ * the watchdog, if it is running.
+ */
+
+#include "trash_stats_service.h"
+#include "trash_watchdog.h"
+
+/**
+ * How long to wait, in seconds, after something changes before publishing
+ * the new values. Changes that happen in the meantime are published
+ * together.
+ */
+#define TRASH_STATS_FLUSH_INTERVAL 1
+
+static const gchar trash_stats_xml[] =
+	"<node>"
+	"  <interface name='" TRASH_STATS_INTERFACE "'>"
+	"    <property name='ItemCount' type='u' access='read'/>"
+	"    <property name='TotalBytes' type='t' access='read'/>"
+	"    <property name='AllocatedBytes' type='t' access='read'/>"
+	"    <property name='LastScanDuration' type='x' access='read'/>"
+	"    <property name='EventsProcessed' type='t' access='read'/>"
+	"    <property name='EventsCoalesced' type='t' access='read'/>"
+	"    <property name='PendingOperations' type='u' access='read'/>"
+	"    <property name='PendingQueries' type='u' access='read'/>"
+	"    <property name='FileQueueDepth' type='u' access='read'/>"
+	"    <property name='PurgeQueueDepth' type='u' access='read'/>"
+	"    <method name='GetStalls'>"
+	"      <arg name='stalls' type='a(sxx)' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"</node>";
+
+typedef enum {
+	STAT_ITEM_COUNT,
+	STAT_TOTAL_BYTES,
+	STAT_ALLOCATED_BYTES,
+	STAT_LAST_SCAN_DURATION,
+	STAT_EVENTS_PROCESSED,
+	STAT_EVENTS_COALESCED,
+	STAT_PENDING_OPERATIONS,
+	STAT_PENDING_QUERIES,
+	STAT_FILE_QUEUE_DEPTH,
+	STAT_PURGE_QUEUE_DEPTH,
+	N_STATS
+} TrashStat;
+
+static const gchar *stat_names[N_STATS] = {
+	"ItemCount",
+	"TotalBytes",
+	"AllocatedBytes",
+	"LastScanDuration",
+	"EventsProcessed",
+	"EventsCoalesced",
+	"PendingOperations",
+	"PendingQueries",
+	"FileQueueDepth",
+	"PurgeQueueDepth",
+};
+
+struct _TrashStatsService {
+	GObject parent_instance;
+
+	TrashManager *manager;
+	TrashPurgeScheduler *purge_scheduler;
+	TrashFileQueue *file_queue;
+
+	gchar *object_path;
+	GCancellable *cancellable;
+	GDBusConnection *connection;
+	GDBusNodeInfo *node_info;
+	guint registration_id;
+	guint owner_id;
+
+	GVariant *published[N_STATS];
+	guint flush_source_id;
+};
+
+G_DEFINE_FINAL_TYPE(TrashStatsService, trash_stats_service, G_TYPE_OBJECT)
+
+static void trash_stats_service_dispose(GObject *object) {
+	TrashStatsService *self;
+
+	self = TRASH_STATS_SERVICE(object);
+
+	g_cancellable_cancel(self->cancellable);
+
+	if (self->flush_source_id != 0) {
+		g_source_remove(self->flush_source_id);
+		self->flush_source_id = 0;
+	}
+
+	if (self->owner_id != 0) {
+		g_bus_unown_name(self->owner_id);
+		self->owner_id = 0;
+	}
+
+	if (self->registration_id != 0) {
+		g_dbus_connection_unregister_object(self->connection, self->registration_id);
+		self->registration_id = 0;
+	}
+
+	g_clear_object(&self->connection);
+	g_clear_object(&self->manager);
+	g_clear_object(&self->purge_scheduler);
+	g_clear_object(&self->file_queue);
+
+	G_OBJECT_CLASS(trash_stats_service_parent_class)->dispose(object);
+}
+
+static void trash_stats_service_finalize(GObject *object) {
+	TrashStatsService *self;
+	guint i;
+
+	self = TRASH_STATS_SERVICE(object);
+
+	for (i = 0; i < N_STATS; i++) {
+		g_clear_pointer(&self->published[i], g_variant_unref);
+	}
+
+	g_free(self->object_path);
+	g_object_unref(self->cancellable);
+	g_dbus_node_info_unref(self->node_info);
+
+	G_OBJECT_CLASS(trash_stats_service_parent_class)->finalize(object);
+}
+
+static void trash_stats_service_class_init(TrashStatsServiceClass *klass) {
+	GObjectClass *class;
+
+	class = G_OBJECT_CLASS(klass);
+	class->dispose = trash_stats_service_dispose;
+	class->finalize = trash_stats_service_finalize;
+}
+
+static void trash_stats_service_init(TrashStatsService *self) {
+	self->cancellable = g_cancellable_new();
+	self->node_info = g_dbus_node_info_new_for_xml(trash_stats_xml, NULL);
+}
+
+/**
+ * Get the current value of a statistic.
+ */
+static GVariant *get_stat(TrashStatsService *self, TrashStat stat) {
+	TrashManagerCounters counters;
+	TrashScanStats scan_stats;
+
+	trash_manager_get_counters(self->manager, &counters);
+
+	switch (stat) {
+		case STAT_ITEM_COUNT:
+			return g_variant_new_uint32(counters.items);
+		case STAT_TOTAL_BYTES:
+			return g_variant_new_uint64(counters.total_bytes);
+		case STAT_ALLOCATED_BYTES:
+			return g_variant_new_uint64(counters.allocated_bytes);
+		case STAT_LAST_SCAN_DURATION:
+			if (!trash_manager_get_scan_stats(self->manager, &scan_stats)) {
+				return g_variant_new_int64(-1);
+			}
+
+			return g_variant_new_int64(scan_stats.time_to_complete);
+		case STAT_EVENTS_PROCESSED:
+			return g_variant_new_uint64(counters.events_processed);
+		case STAT_EVENTS_COALESCED:
+			return g_variant_new_uint64(counters.events_coalesced);
+		case STAT_PENDING_OPERATIONS:
+			return g_variant_new_uint32(trash_backend_get_pending_operations() + trash_file_queue_get_pending(self->file_queue));
+		case STAT_PENDING_QUERIES:
+			return g_variant_new_uint32(counters.pending_queries);
+		case STAT_FILE_QUEUE_DEPTH:
+			return g_variant_new_uint32(trash_file_queue_get_pending(self->file_queue));
+		case STAT_PURGE_QUEUE_DEPTH:
+			return g_variant_new_uint32(trash_purge_scheduler_get_queued(self->purge_scheduler));
+		default:
+			break;
+	}
+
+	g_return_val_if_reached(NULL);
+}
+
+static GVariant *handle_get_property(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *property_name, GError **error, gpointer user_data) {
+	(void) connection;
+	(void) sender;
+	(void) object_path;
+	(void) interface_name;
+
+	TrashStatsService *self = user_data;
+	guint i;
+
+	for (i = 0; i < N_STATS; i++) {
+		if (g_strcmp0(stat_names[i], property_name) == 0) {
+			return get_stat(self, (TrashStat) i);
+		}
+	}
+
+	g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "No such property '%s'", property_name);
+
+	return NULL;
+}
+
+static void handle_method_call(GDBusConnection *connection, const gchar *sender, const gchar *object_path, const gchar *interface_name, const gchar *method_name, GVariant *parameters, GDBusMethodInvocation *invocation, gpointer user_data) {
+	(void) connection;
+	(void) sender;
+	(void) object_path;
+	(void) interface_name;
+	(void) parameters;
+	(void) user_data;
+
+	if (g_strcmp0(method_name, "GetStalls") == 0) {
+		g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a(sxx))", trash_watchdog_get_stalls()));
+		return;
+	}
+
+	g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD, "No such method '%s'", method_name);
+}
+
+static const GDBusInterfaceVTable interface_vtable = {
+	handle_method_call,
+	handle_get_property,
+	NULL,
+	{0},
+};
+
+/**
+ * Emit `PropertiesChanged` for every value that changed since we last
+ * published it.
+ */
+static gboolean flush_cb(gpointer user_data) {
+	TrashStatsService *self = user_data;
+	GVariantBuilder changed;
+	GVariant *value;
+	gboolean any = FALSE;
+	guint i;
+
+	self->flush_source_id = 0;
+
+	if (self->registration_id == 0) {
+		return G_SOURCE_REMOVE;
+	}
+
+	g_variant_builder_init(&changed, G_VARIANT_TYPE_VARDICT);
+
+	for (i = 0; i < N_STATS; i++) {
+		value = g_variant_ref_sink(get_stat(self, (TrashStat) i));
+
+		if (self->published[i] && g_variant_equal(self->published[i], value)) {
+			g_variant_unref(value);
+			continue;
+		}
+
+		g_variant_builder_add(&changed, "{sv}", stat_names[i], value);
+		g_clear_pointer(&self->published[i], g_variant_unref);
+		self->published[i] = value;
+		any = TRUE;
+	}
+
+	if (any) {
+		g_dbus_connection_emit_signal(
+			self->connection,
+			NULL,
+			self->object_path,
+			"org.freedesktop.DBus.Properties",
+			"PropertiesChanged",
+			g_variant_new("(sa{sv}as)", TRASH_STATS_INTERFACE, &changed, NULL),
+			NULL);
+	} else {
+		g_variant_builder_clear(&changed);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Publish the current values soon. Calling this again before that happens
+ * does nothing.
+ */
+static void schedule_flush(TrashStatsService *self) {
+	if (self->flush_source_id != 0) {
+		return;
+	}
+
+	self->flush_source_id = g_timeout_add_seconds(TRASH_STATS_FLUSH_INTERVAL, flush_cb, self);
+}
+
+static void something_changed(TrashStatsService *self) {
+	schedule_flush(self);
+}
+
+static void bus_get_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	(void) source;
+
+	TrashStatsService *self;
+	GDBusConnection *connection;
+	g_autoptr(GError) error = NULL;
+
+	connection = g_bus_get_finish(result, &error);
+
+	if (!connection) {
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_warning("Unable to connect to the session bus: %s", error->message);
+		}
+
+		return;
+	}
+
+	self = TRASH_STATS_SERVICE(user_data);
+	self->connection = connection;
+
+	self->registration_id = g_dbus_connection_register_object(
+		connection,
+		self->object_path,
+		self->node_info->interfaces[0],
+		&interface_vtable,
+		self,
+		NULL,
+		&error);
+
+	if (self->registration_id == 0) {
+		g_warning("Unable to export trash stats at '%s': %s", self->object_path, error->message);
+		return;
+	}
+
+	// Only one applet gets the name; the others can still be found through
+	// the panel's unique name.
+	self->owner_id = g_bus_own_name_on_connection(connection, TRASH_STATS_BUS_NAME, G_BUS_NAME_OWNER_FLAGS_NONE, NULL, NULL, NULL, NULL);
+
+	schedule_flush(self);
+}
+
+/**
+ * Turn an applet UUID into something that can be used as an element of a
+ * D-Bus object path.
+ */
+static gchar *object_path_for_uuid(const gchar *uuid) {
+	GString *path;
+	const gchar *c;
+
+	path = g_string_new(TRASH_STATS_OBJECT_PATH);
+
+	if (!uuid || *uuid == '\0') {
+		return g_string_free(path, FALSE);
+	}
+
+	g_string_append_c(path, '/');
+
+	for (c = uuid; *c != '\0'; c++) {
+		g_string_append_c(path, g_ascii_isalnum(*c) ? *c : '_');
+	}
+
+	return g_string_free(path, FALSE);
+}
+
+/**
+ * trash_stats_service_new:
+ * @uuid: (nullable): the UUID of the applet instance
+ * @manager: (transfer none): the #TrashManager to report on
+ * @purge_scheduler: (transfer none): the #TrashPurgeScheduler to report on
+ * @file_queue: (transfer none): the #TrashFileQueue to report on
+ *
+ * Creates a new #TrashStatsService, and starts exporting it on the session
+ * bus at `/com/github/EbonJaeger/BudgieTrashApplet/<uuid>`.
+ *
+ * Returns: a new #TrashStatsService
+ */
+TrashStatsService *trash_stats_service_new(const gchar *uuid, TrashManager *manager, TrashPurgeScheduler *purge_scheduler, TrashFileQueue *file_queue) {
+	TrashStatsService *self;
+
+	self = g_object_new(TRASH_TYPE_STATS_SERVICE, NULL);
+	self->object_path = object_path_for_uuid(uuid);
+	self->manager = g_object_ref(manager);
+	self->purge_scheduler = g_object_ref(purge_scheduler);
+	self->file_queue = g_object_ref(file_queue);
+
+	g_signal_connect_object(manager, "trash-added", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(manager, "trash-removed", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(manager, "scan-finished", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(file_queue, "progress", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(file_queue, "finished", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(manager, "notify::events-processed", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(manager, "notify::events-coalesced", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(purge_scheduler, "notify::queued", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+	g_signal_connect_object(trash_manager_get_backend(manager), "operations-changed", G_CALLBACK(something_changed), self, G_CONNECT_SWAPPED);
+
+	g_bus_get(G_BUS_TYPE_SESSION, self->cancellable, bus_get_cb, self);
+
+	return self;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "trash_file_queue.h"
+#include "trash_manager.h"
+#include "trash_purge_scheduler.h"
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * The well-known name that the first trash applet on the session bus
+ * takes, so that the statistics are easy to find.
+ */
+#define TRASH_STATS_BUS_NAME "com.github.EbonJaeger.BudgieTrashApplet"
+
+#define TRASH_STATS_INTERFACE "com.github.EbonJaeger.BudgieTrashApplet.Stats"
+
+#define TRASH_STATS_OBJECT_PATH "/com/github/EbonJaeger/BudgieTrashApplet"
+
+#define TRASH_TYPE_STATS_SERVICE (trash_stats_service_get_type())
+
+G_DECLARE_FINAL_TYPE(TrashStatsService, trash_stats_service, TRASH, STATS_SERVICE, GObject)
+
+TrashStatsService *trash_stats_service_new(const gchar *uuid, TrashManager *manager, TrashPurgeScheduler *purge_scheduler, TrashFileQueue *file_queue);
+
+G_END_DECLS
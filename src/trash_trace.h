@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * Trace points for profiling the applet.
+ *
+ * When built with `-Dtracing=enabled`, a trace point becomes a sysprof
+ * capture mark, which is only recorded while a sysprof collector is
+ * attached, and a USDT probe in the `budgie_trash` provider for perf and
+ * bpftrace. Otherwise trace points compile to nothing.
+ *
+ * Marks cover a span of time: take a timestamp with TRASH_TRACE_NOW()
+ * where the span begins, and pass it to TRASH_TRACE_MARK() where it ends.
+ */
+
+#include <glib.h>
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#ifdef HAVE_SDT
+#include <sys/sdt.h>
+#endif
+
+#ifdef HAVE_SYSPROF
+#define TRASH_TRACE_NOW() SYSPROF_CAPTURE_CURRENT_TIME
+#define TRASH_TRACE_MARK(begin, name, ...) \
+	G_STMT_START { \
+		if (sysprof_collector_is_active()) { \
+			sysprof_collector_mark_printf((begin), SYSPROF_CAPTURE_CURRENT_TIME - (begin), "budgie-trash", (name), __VA_ARGS__); \
+		} \
+	} \
+	G_STMT_END
+#else
+#define TRASH_TRACE_NOW() ((gint64) 0)
+#define TRASH_TRACE_MARK(begin, name, ...) \
+	G_STMT_START { \
+		(void) (begin); \
+	} \
+	G_STMT_END
+#endif
+
+#ifdef HAVE_SDT
+#define TRASH_TRACE_PROBE(probe) DTRACE_PROBE(budgie_trash, probe)
+#define TRASH_TRACE_PROBE1(probe, a) DTRACE_PROBE1(budgie_trash, probe, a)
+#define TRASH_TRACE_PROBE2(probe, a, b) DTRACE_PROBE2(budgie_trash, probe, a, b)
+#else
+#define TRASH_TRACE_PROBE(probe) \
+	G_STMT_START { \
+	} \
+	G_STMT_END
+#define TRASH_TRACE_PROBE1(probe, a) \
+	G_STMT_START { \
+		(void) (a); \
+	} \
+	G_STMT_END
+#define TRASH_TRACE_PROBE2(probe, a, b) \
+	G_STMT_START { \
+		(void) (a); \
+		(void) (b); \
+	} \
+	G_STMT_END
+#endif
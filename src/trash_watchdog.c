@@ -0,0 +1,366 @@
+/**
+ * SECTION:trashwatchdog
+ * @Short_description: Catches the applet blocking the panel's main loop
+ * @Title: Watchdog
+ *
+ * The applet runs inside budgie-panel, so anything that blocks the main
+ * loop for long freezes the whole panel. When the `BUDGIE_TRASH_WATCHDOG`
+ * environment variable is set to a number of milliseconds, a heartbeat is
+ * scheduled on the main loop and a watchdog thread checks that it keeps
+ * running. A heartbeat that is late by more than that many milliseconds is
+ * recorded as a stall.
+ *
+ * Code that might take a while marks itself with trash_watchdog_enter()
+ * and trash_watchdog_leave(). When the watchdog thread notices a stall, it
+ * blames whatever operation is on top of that stack. The longest stalls
+ * are kept so that they can be included in bug reports, see
+ * trash_watchdog_dump().
+ *
+ * When the watchdog isn't running, entering and leaving an operation costs
+ * one atomic read.
+ */
+
+#include "trash_watchdog.h"
+
+/**
+ * How deeply operations can be nested before we lose track of which one
+ * is innermost.
+ */
+#define TRASH_WATCHDOG_MAX_DEPTH 16
+
+/**
+ * The shortest time, in microseconds, between two heartbeats.
+ */
+#define TRASH_WATCHDOG_MIN_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+
+typedef struct {
+	const gchar *operation;
+	gint64 duration;
+	gint64 wall_time;
+} Stall;
+
+static guint watchdog_users = 0;
+static gint watchdog_enabled = 0;
+static guint heartbeat_source_id = 0;
+static gint64 threshold = 0;
+static gint64 interval = 0;
+
+static GMutex watchdog_lock;
+static GCond watchdog_cond;
+static GThread *watchdog_thread = NULL;
+static gboolean watchdog_running = FALSE;
+
+/* Protected by watchdog_lock */
+static gint64 last_beat = 0;
+static const gchar *stalled_operation = NULL;
+static Stall stalls[TRASH_WATCHDOG_MAX_STALLS];
+static guint n_stalls = 0;
+
+/* Only touched on the main thread; the top is published for the watchdog */
+static const gchar *operation_stack[TRASH_WATCHDOG_MAX_DEPTH];
+static guint operation_depth = 0;
+static gpointer current_operation = NULL;
+
+/**
+ * Remember a stall if it is one of the longest so far.
+ *
+ * Must be called with watchdog_lock held.
+ */
+static void record_stall(const gchar *operation, gint64 duration) {
+	guint shortest = 0;
+	guint i;
+
+	if (n_stalls < TRASH_WATCHDOG_MAX_STALLS) {
+		shortest = n_stalls++;
+	} else {
+		for (i = 1; i < n_stalls; i++) {
+			if (stalls[i].duration < stalls[shortest].duration) {
+				shortest = i;
+			}
+		}
+
+		if (stalls[shortest].duration >= duration) {
+			return;
+		}
+	}
+
+	stalls[shortest].operation = operation;
+	stalls[shortest].duration = duration;
+	stalls[shortest].wall_time = g_get_real_time();
+}
+
+static gboolean heartbeat_cb(gpointer user_data) {
+	(void) user_data;
+
+	const gchar *operation;
+	gint64 now, late;
+
+	now = g_get_monotonic_time();
+
+	g_mutex_lock(&watchdog_lock);
+
+	late = now - last_beat - interval;
+	operation = stalled_operation ? stalled_operation : "unknown";
+
+	if (late > threshold) {
+		record_stall(operation, late);
+	}
+
+	last_beat = now;
+	stalled_operation = NULL;
+
+	g_mutex_unlock(&watchdog_lock);
+
+	if (late > threshold) {
+		g_warning("The main loop was blocked for %.0f ms during %s", (gdouble) late / G_TIME_SPAN_MILLISECOND, operation);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * Wake up a few times per heartbeat, and if the heartbeat is late, note
+ * which operation the main thread is in the middle of.
+ */
+static gpointer watchdog_thread_func(gpointer data) {
+	(void) data;
+
+	gint64 now;
+
+	g_mutex_lock(&watchdog_lock);
+
+	while (watchdog_running) {
+		g_cond_wait_until(&watchdog_cond, &watchdog_lock, g_get_monotonic_time() + interval / 2);
+
+		if (!watchdog_running) {
+			break;
+		}
+
+		now = g_get_monotonic_time();
+
+		if (now - last_beat - interval <= threshold || stalled_operation) {
+			continue;
+		}
+
+		stalled_operation = g_atomic_pointer_get(&current_operation);
+	}
+
+	g_mutex_unlock(&watchdog_lock);
+
+	return NULL;
+}
+
+/**
+ * trash_watchdog_start:
+ *
+ * Starts the watchdog if `BUDGIE_TRASH_WATCHDOG` is set. Every call must
+ * be matched with a call to trash_watchdog_stop(), and the watchdog keeps
+ * running until the last one.
+ */
+void trash_watchdog_start(void) {
+	const gchar *value;
+	guint64 milliseconds;
+
+	if (watchdog_users++ > 0) {
+		return;
+	}
+
+	value = g_getenv("BUDGIE_TRASH_WATCHDOG");
+
+	if (!value || *value == '\0') {
+		return;
+	}
+
+	milliseconds = g_ascii_strtoull(value, NULL, 10);
+
+	if (milliseconds == 0) {
+		g_warning("Invalid watchdog threshold '%s', not starting the watchdog", value);
+		return;
+	}
+
+	threshold = (gint64) milliseconds * G_TIME_SPAN_MILLISECOND;
+	interval = MAX(threshold / 2, TRASH_WATCHDOG_MIN_INTERVAL);
+	operation_depth = 0;
+
+	g_mutex_lock(&watchdog_lock);
+	last_beat = g_get_monotonic_time();
+	stalled_operation = NULL;
+	n_stalls = 0;
+	watchdog_running = TRUE;
+	g_mutex_unlock(&watchdog_lock);
+
+	heartbeat_source_id = g_timeout_add((guint) (interval / G_TIME_SPAN_MILLISECOND), heartbeat_cb, NULL);
+	watchdog_thread = g_thread_new("trash-watchdog", watchdog_thread_func, NULL);
+
+	g_atomic_int_set(&watchdog_enabled, 1);
+}
+
+/**
+ * trash_watchdog_stop:
+ *
+ * Stops the watchdog when this is the last user. Any stalls that were
+ * recorded are logged first.
+ */
+void trash_watchdog_stop(void) {
+	g_autofree gchar *report = NULL;
+
+	g_return_if_fail(watchdog_users > 0);
+
+	if (--watchdog_users > 0 || !watchdog_thread) {
+		return;
+	}
+
+	g_atomic_int_set(&watchdog_enabled, 0);
+	g_atomic_pointer_set(&current_operation, NULL);
+
+	g_mutex_lock(&watchdog_lock);
+	watchdog_running = FALSE;
+	g_cond_signal(&watchdog_cond);
+	g_mutex_unlock(&watchdog_lock);
+
+	g_thread_join(watchdog_thread);
+	watchdog_thread = NULL;
+
+	g_source_remove(heartbeat_source_id);
+	heartbeat_source_id = 0;
+
+	report = trash_watchdog_dump();
+
+	if (report) {
+		g_message("%s", report);
+	}
+}
+
+/**
+ * trash_watchdog_enter:
+ * @operation: (transfer none): a static string naming the operation
+ *
+ * Marks the start of an operation on the main thread that might block it
+ * for a while. Operations can be nested; a stall is blamed on the
+ * innermost one.
+ */
+void trash_watchdog_enter(const gchar *operation) {
+	if (!g_atomic_int_get(&watchdog_enabled)) {
+		return;
+	}
+
+	if (operation_depth < TRASH_WATCHDOG_MAX_DEPTH) {
+		operation_stack[operation_depth] = operation;
+	}
+
+	operation_depth++;
+	g_atomic_pointer_set(&current_operation, (gpointer) operation);
+}
+
+/**
+ * trash_watchdog_leave:
+ *
+ * Marks the end of the operation started by the last call to
+ * trash_watchdog_enter().
+ */
+void trash_watchdog_leave(void) {
+	const gchar *operation = NULL;
+
+	if (!g_atomic_int_get(&watchdog_enabled) || operation_depth == 0) {
+		return;
+	}
+
+	operation_depth--;
+
+	if (operation_depth > 0) {
+		operation = operation_stack[MIN(operation_depth, TRASH_WATCHDOG_MAX_DEPTH) - 1];
+	}
+
+	g_atomic_pointer_set(&current_operation, (gpointer) operation);
+}
+
+static gint compare_stalls(gconstpointer a, gconstpointer b) {
+	const Stall *stall_a = a;
+	const Stall *stall_b = b;
+
+	return (stall_a->duration < stall_b->duration) - (stall_a->duration > stall_b->duration);
+}
+
+/**
+ * Copy the recorded stalls, longest first.
+ */
+static GArray *copy_stalls(void) {
+	GArray *copy;
+
+	copy = g_array_sized_new(FALSE, FALSE, sizeof(Stall), TRASH_WATCHDOG_MAX_STALLS);
+
+	g_mutex_lock(&watchdog_lock);
+	g_array_append_vals(copy, stalls, n_stalls);
+	g_mutex_unlock(&watchdog_lock);
+
+	g_array_sort(copy, compare_stalls);
+
+	return copy;
+}
+
+/**
+ * trash_watchdog_get_stalls:
+ *
+ * Gets the longest stalls recorded by the watchdog, longest first. Each
+ * one has the operation that was running, how long the main loop was
+ * blocked in microseconds, and when that was noticed in microseconds
+ * since the epoch.
+ *
+ * Returns: (transfer floating): a #GVariant of type `a(sxx)`
+ */
+GVariant *trash_watchdog_get_stalls(void) {
+	g_autoptr(GArray) copy = NULL;
+	GVariantBuilder builder;
+	Stall *stall;
+	guint i;
+
+	copy = copy_stalls();
+
+	g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sxx)"));
+
+	for (i = 0; i < copy->len; i++) {
+		stall = &g_array_index(copy, Stall, i);
+		g_variant_builder_add(&builder, "(sxx)", stall->operation, stall->duration, stall->wall_time);
+	}
+
+	return g_variant_builder_end(&builder);
+}
+
+/**
+ * trash_watchdog_dump:
+ *
+ * Formats the longest stalls recorded by the watchdog as text, for
+ * pasting into a bug report.
+ *
+ * Returns: (transfer full) (nullable): the stalls, or %NULL if there were none
+ */
+gchar *trash_watchdog_dump(void) {
+	g_autoptr(GArray) copy = NULL;
+	g_autoptr(GDateTime) when = NULL;
+	g_autofree gchar *formatted = NULL;
+	GString *report;
+	Stall *stall;
+	guint i;
+
+	copy = copy_stalls();
+
+	if (copy->len == 0) {
+		return NULL;
+	}
+
+	report = g_string_new("Longest main loop stalls:");
+
+	for (i = 0; i < copy->len; i++) {
+		stall = &g_array_index(copy, Stall, i);
+
+		g_clear_pointer(&when, g_date_time_unref);
+		g_clear_pointer(&formatted, g_free);
+
+		when = g_date_time_new_from_unix_local(stall->wall_time / G_USEC_PER_SEC);
+		formatted = g_date_time_format(when, "%F %T");
+
+		g_string_append_printf(report, "\n  %s  %8.1f ms  %s", formatted, (gdouble) stall->duration / G_TIME_SPAN_MILLISECOND, stall->operation);
+	}
+
+	return g_string_free(report, FALSE);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * The most stalls that are remembered. When there are more, the shortest
+ * ones are forgotten.
+ */
+#define TRASH_WATCHDOG_MAX_STALLS 16
+
+void trash_watchdog_start(void);
+
+void trash_watchdog_stop(void);
+
+void trash_watchdog_enter(const gchar *operation);
+
+void trash_watchdog_leave(void);
+
+GVariant *trash_watchdog_get_stalls(void);
+
+gchar *trash_watchdog_dump(void);
+
+G_END_DECLS
@@ -0,0 +1,306 @@
+/**
+ * Benchmark for opening the popover.
+ *
+ * A panel button and its popover are built the same way the applet builds
+ * them, against a synthetic trash bin written under a temporary
+ * `XDG_DATA_HOME`, and the popover is registered with a
+ * #BudgiePopoverManager as the panel would. The button is then clicked to
+ * open and close the popover over and over, opening it through the
+ * manager like the applet does, and each open is timed from the click
+ * until the popover's #GdkFrameClock has painted the first frame.
+ *
+ * Cold opens get a new popover each time, whose manager has just finished
+ * scanning, so every row is built on the open. Warm opens reuse a single
+ * popover. The 50th, 95th and 99th percentiles of both are printed as a
+ * line of JSON.
+ *
+ * This needs a display; run it under `xvfb-run` where there is none.
+ */
+
+#include "trash_bench_util.h"
+#include "trash_popover.h"
+#include "trash_test_bin.h"
+#include <budgie-desktop/popover-manager.h>
+#include <budgie-desktop/popover.h>
+#include <gtk/gtk.h>
+#include <stdlib.h>
+
+/* The schema and path of the instance settings on a real panel */
+#define BENCH_SETTINGS_SCHEMA "com.solus-project.budgie-trash-applet"
+#define BENCH_SETTINGS_PATH "/com/solus-project/budgie-panel/instance/budgie-trash-applet/bench/"
+
+/* How long to wait for a scan or a frame before giving up */
+#define BENCH_TIMEOUT_SECONDS 60
+
+/* meson treats this exit status as a skipped test */
+#define EXIT_SKIPPED 77
+
+typedef struct {
+	BudgiePopoverManager *manager;
+	GtkWidget *window;
+	GtkWidget *button;
+	GtkWidget *popover;
+	TrashPopover *body;
+
+	gint64 start;
+	gint64 latency;
+	gboolean timed_out;
+} Bench;
+
+static gboolean timeout_cb(gpointer user_data) {
+	Bench *bench = user_data;
+
+	bench->timed_out = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Run the main context until nothing is left to do right away.
+ */
+static void drain(void) {
+	while (g_main_context_iteration(NULL, FALSE)) {
+	}
+}
+
+/* The same as the applet's */
+static void toggle_popover(GtkButton *sender, Bench *bench) {
+	(void) sender;
+
+	if (gtk_widget_is_visible(bench->popover)) {
+		gtk_widget_hide(bench->popover);
+	} else {
+		budgie_popover_manager_show_popover(bench->manager, bench->button);
+	}
+}
+
+static void after_paint(GdkFrameClock *clock, Bench *bench) {
+	bench->latency = g_get_monotonic_time() - bench->start;
+
+	g_signal_handlers_disconnect_by_func(clock, after_paint, bench);
+}
+
+static gboolean scan_done(TrashManager *manager, guint items) {
+	TrashManagerCounters counters;
+
+	trash_manager_get_counters(manager, &counters);
+
+	return counters.items == items && counters.pending_queries == 0;
+}
+
+/**
+ * Build a new popover for the button and wait for its manager to find
+ * every item in the trash bin.
+ */
+static gboolean build_popover(Bench *bench, guint items) {
+	g_autoptr(GSettings) settings = NULL;
+	TrashManager *manager;
+	guint timeout_id;
+
+	if (bench->popover) {
+		budgie_popover_manager_unregister_popover(bench->manager, bench->button);
+		g_clear_pointer(&bench->popover, gtk_widget_destroy);
+	}
+
+	settings = g_settings_new_with_path(BENCH_SETTINGS_SCHEMA, BENCH_SETTINGS_PATH);
+	bench->popover = budgie_popover_new(bench->button);
+	bench->body = trash_popover_new(settings);
+	gtk_container_add(GTK_CONTAINER(bench->popover), GTK_WIDGET(bench->body));
+
+	// What the panel does when the applet asks for its popovers
+	budgie_popover_manager_register_popover(bench->manager, bench->button, BUDGIE_POPOVER(bench->popover));
+
+	manager = trash_popover_get_manager(bench->body);
+	bench->timed_out = FALSE;
+	timeout_id = g_timeout_add_seconds(BENCH_TIMEOUT_SECONDS, timeout_cb, bench);
+
+	while (!scan_done(manager, items) && !bench->timed_out) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	if (!bench->timed_out) {
+		g_source_remove(timeout_id);
+	}
+
+	drain();
+
+	return !bench->timed_out;
+}
+
+/**
+ * Click the button to open the popover, time it, and click again to
+ * close it.
+ *
+ * Returns: how long the open took in microseconds, or -1 if no frame
+ *   was painted
+ */
+static gint64 open_once(Bench *bench) {
+	GdkFrameClock *clock;
+	guint timeout_id;
+
+	bench->latency = -1;
+	bench->timed_out = FALSE;
+	bench->start = g_get_monotonic_time();
+
+	gtk_button_clicked(GTK_BUTTON(bench->button));
+
+	clock = gtk_widget_get_frame_clock(bench->popover);
+
+	if (!clock) {
+		return -1;
+	}
+
+	g_signal_connect(clock, "after-paint", G_CALLBACK(after_paint), bench);
+	timeout_id = g_timeout_add_seconds(BENCH_TIMEOUT_SECONDS, timeout_cb, bench);
+
+	while (bench->latency < 0 && !bench->timed_out) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	if (bench->timed_out) {
+		g_signal_handlers_disconnect_by_func(clock, after_paint, bench);
+	} else {
+		g_source_remove(timeout_id);
+	}
+
+	gtk_button_clicked(GTK_BUTTON(bench->button));
+	drain();
+
+	return bench->latency;
+}
+
+int main(int argc, char **argv) {
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GArray) cold = NULL;
+	g_autoptr(GArray) warm = NULL;
+	g_autofree gchar *data_home = NULL;
+	g_autofree gchar *cache_home = NULL;
+	g_autofree gchar *trash_path = NULL;
+	gint items = 1000;
+	gint cold_opens = 20;
+	gint warm_opens = 50;
+	gboolean success = FALSE;
+	gint64 latency;
+	Bench bench = {0};
+	gint i;
+
+	GOptionEntry entries[] = {
+		{"items", 'n', 0, G_OPTION_ARG_INT, &items, "How many items to put in the trash bin (default 1000)", "N"},
+		{"cold-opens", 'c', 0, G_OPTION_ARG_INT, &cold_opens, "How many times to open a new popover (default 20)", "N"},
+		{"warm-opens", 'w', 0, G_OPTION_ARG_INT, &warm_opens, "How many times to open the same popover (default 50)", "N"},
+		{NULL, 0, 0, 0, NULL, NULL, NULL},
+	};
+
+	context = g_option_context_new("- benchmark opening the popover");
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	if (items < 0 || cold_opens < 1 || warm_opens < 1) {
+		g_printerr("The number of items and opens must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	// Keep away from the real trash bin, history and settings. This has to
+	// happen before anything asks GLib for these directories.
+	data_home = g_dir_make_tmp("budgie-trash-bench-XXXXXX", &error);
+
+	if (!data_home) {
+		g_printerr("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	cache_home = g_build_filename(data_home, "cache", NULL);
+	trash_path = g_build_filename(data_home, "Trash", NULL);
+	g_setenv("XDG_DATA_HOME", data_home, TRUE);
+	g_setenv("XDG_CACHE_HOME", cache_home, TRUE);
+	g_setenv("BUDGIE_TRASH_BACKEND", "xdg", TRUE);
+	g_setenv("GSETTINGS_BACKEND", "memory", FALSE);
+	g_unsetenv("BUDGIE_TRASH_RECORD_EVENTS");
+
+	if (!gtk_init_check(&argc, &argv)) {
+		g_printerr("No display to open the popover on\n");
+		trash_test_bin_remove(data_home, NULL);
+		return EXIT_SKIPPED;
+	}
+
+	if (!trash_test_bin_write(trash_path, 0, (guint) items, &error)) {
+		g_printerr("%s\n", error->message);
+		goto out;
+	}
+
+	// Stand in for the panel
+	bench.manager = budgie_popover_manager_new();
+	bench.window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	bench.button = gtk_button_new_from_icon_name("user-trash-symbolic", GTK_ICON_SIZE_MENU);
+	g_signal_connect(bench.button, "clicked", G_CALLBACK(toggle_popover), &bench);
+	gtk_container_add(GTK_CONTAINER(bench.window), bench.button);
+	gtk_widget_show_all(bench.window);
+	drain();
+
+	cold = g_array_new(FALSE, FALSE, sizeof(gint64));
+	warm = g_array_new(FALSE, FALSE, sizeof(gint64));
+
+	for (i = 0; i < cold_opens; i++) {
+		if (!build_popover(&bench, (guint) items)) {
+			g_printerr("The trash bin was not scanned in time\n");
+			goto out;
+		}
+
+		latency = open_once(&bench);
+
+		if (latency < 0) {
+			g_printerr("The popover was not drawn\n");
+			goto out;
+		}
+
+		g_array_append_val(cold, latency);
+	}
+
+	for (i = 0; i < warm_opens; i++) {
+		latency = open_once(&bench);
+
+		if (latency < 0) {
+			g_printerr("The popover was not drawn\n");
+			goto out;
+		}
+
+		g_array_append_val(warm, latency);
+	}
+
+	trash_bench_sort_latencies(cold);
+	trash_bench_sort_latencies(warm);
+
+	g_print("{\"items\": %d, \"cold_opens\": %u, \"cold_p50_ms\": %.2f, \"cold_p95_ms\": %.2f, \"cold_p99_ms\": %.2f, \"warm_opens\": %u, \"warm_p50_ms\": %.2f, \"warm_p95_ms\": %.2f, \"warm_p99_ms\": %.2f}\n",
+		items,
+		cold->len,
+		trash_bench_percentile(cold, 0.50),
+		trash_bench_percentile(cold, 0.95),
+		trash_bench_percentile(cold, 0.99),
+		warm->len,
+		trash_bench_percentile(warm, 0.50),
+		trash_bench_percentile(warm, 0.95),
+		trash_bench_percentile(warm, 0.99));
+
+	success = TRUE;
+
+out:
+	if (bench.popover) {
+		budgie_popover_manager_unregister_popover(bench.manager, bench.button);
+		g_clear_pointer(&bench.popover, gtk_widget_destroy);
+	}
+
+	g_clear_pointer(&bench.window, gtk_widget_destroy);
+	g_clear_object(&bench.manager);
+	g_clear_error(&error);
+
+	if (!trash_test_bin_remove(data_home, &error)) {
+		g_printerr("%s\n", error->message);
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
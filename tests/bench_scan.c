@@ -0,0 +1,216 @@
+/**
+ * Benchmark for a full scan of the trash bin.
+ *
+ * A synthetic trash bin is grown through each of the given sizes, and at
+ * each size a new #TrashManager scans it from start to finish. By default
+ * the bin is written to disk under a temporary `XDG_DATA_HOME` and read
+ * with the xdg backend; `--backend=fake` keeps it in memory to measure the
+ * manager on its own.
+ *
+ * Each size is scanned in a child process of its own. The peak RSS is
+ * counted for the whole process and never goes down, so in one process
+ * every size would report the largest peak so far.
+ *
+ * Each scan is reported as a line of JSON, so that results can be
+ * compared between releases.
+ */
+
+#include "trash_backend_fake.h"
+#include "trash_backend_xdg.h"
+#include "trash_bench_util.h"
+#include "trash_manager.h"
+#include "trash_test_bin.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void scan_finished(TrashManager *manager, GMainLoop *loop) {
+	(void) manager;
+
+	g_main_loop_quit(loop);
+}
+
+static gboolean scan(TrashBackend *backend, TrashScanStats *stats) {
+	g_autoptr(GMainLoop) loop = NULL;
+	g_autoptr(TrashManager) manager = NULL;
+
+	loop = g_main_loop_new(NULL, FALSE);
+	manager = trash_manager_new_for_backend(backend);
+	g_signal_connect(manager, "scan-finished", G_CALLBACK(scan_finished), loop);
+
+	trash_manager_scan_items(manager);
+	g_main_loop_run(loop);
+
+	return trash_manager_get_scan_stats(manager, stats);
+}
+
+/**
+ * Scan a trash bin of @size items and print the results. The on-disk bin
+ * under `XDG_DATA_HOME` has to have been written already.
+ */
+static gboolean scan_size(FILE *output, gboolean use_fake, guint size) {
+	g_autoptr(TrashFakeBackend) fake = NULL;
+	g_autoptr(TrashBackend) backend = NULL;
+	TrashScanStats stats;
+
+	if (use_fake) {
+		fake = trash_fake_backend_new();
+		trash_test_bin_fill_fake(fake, 0, size);
+		backend = g_object_ref(TRASH_BACKEND(fake));
+	} else {
+		backend = TRASH_BACKEND(trash_xdg_backend_new());
+	}
+
+	if (!scan(backend, &stats)) {
+		g_printerr("The scan of %u items did not finish\n", size);
+		return FALSE;
+	}
+
+	fprintf(output, "{\"backend\": \"%s\", \"items\": %u, \"time_to_first_item_us\": %" G_GINT64_FORMAT ", \"time_to_complete_us\": %" G_GINT64_FORMAT ", \"items_per_second\": %.1f, \"peak_rss_kb\": %ld}\n",
+		use_fake ? "fake" : "xdg",
+		stats.items,
+		stats.time_to_first_item,
+		stats.time_to_complete,
+		stats.items_per_second,
+		stats.peak_rss);
+	fflush(output);
+
+	return TRUE;
+}
+
+/**
+ * Run scan_size() in a child process, so that nothing from one size is
+ * still counted for the next.
+ */
+static gboolean scan_size_in_child(FILE *output, gboolean use_fake, guint size) {
+	pid_t pid;
+	int status;
+
+	// Or the child would write out anything still buffered a second time
+	fflush(output);
+
+	pid = fork();
+
+	if (pid < 0) {
+		g_printerr("Unable to start a scan: %s\n", g_strerror(errno));
+		return FALSE;
+	}
+
+	if (pid == 0) {
+		_exit(scan_size(output, use_fake, size) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			g_printerr("Unable to wait for the scan: %s\n", g_strerror(errno));
+			return FALSE;
+		}
+	}
+
+	return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GArray) sizes = NULL;
+	g_autofree gchar *backend_name = NULL;
+	g_autofree gchar *sizes_text = NULL;
+	g_autofree gchar *output_path = NULL;
+	g_autofree gchar *data_home = NULL;
+	g_autofree gchar *trash_path = NULL;
+	FILE *output = stdout;
+	gboolean success = TRUE;
+	gboolean use_fake;
+	guint have = 0;
+	guint size;
+	guint i;
+
+	GOptionEntry entries[] = {
+		{"backend", 'b', 0, G_OPTION_ARG_STRING, &backend_name, "Where the trash bin lives: xdg (on disk, the default) or fake (in memory)", "NAME"},
+		{"sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_text, "Comma-separated numbers of items to scan (default 1000,10000,100000,1000000)", "SIZES"},
+		{"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path, "Append the results to this file instead of printing them", "FILE"},
+		{NULL, 0, 0, 0, NULL, NULL, NULL},
+	};
+
+	context = g_option_context_new("- benchmark scanning a synthetic trash bin");
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	use_fake = g_strcmp0(backend_name, "fake") == 0;
+
+	if (backend_name && !use_fake && g_strcmp0(backend_name, "xdg") != 0) {
+		g_printerr("Unknown backend '%s'\n", backend_name);
+		return EXIT_FAILURE;
+	}
+
+	sizes = trash_bench_parse_sizes(sizes_text ? sizes_text : "1000,10000,100000,1000000", &error);
+
+	if (!sizes) {
+		g_printerr("Invalid sizes: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	if (output_path) {
+		output = fopen(output_path, "a");
+
+		if (!output) {
+			g_printerr("Unable to open '%s'\n", output_path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Don't record the benchmark
+	g_unsetenv("BUDGIE_TRASH_RECORD_EVENTS");
+
+	if (!use_fake) {
+		data_home = g_dir_make_tmp("budgie-trash-bench-XXXXXX", &error);
+
+		if (!data_home) {
+			g_printerr("%s\n", error->message);
+			return EXIT_FAILURE;
+		}
+
+		// Must be set before anything asks GLib for the data directory
+		g_setenv("XDG_DATA_HOME", data_home, TRUE);
+		trash_path = g_build_filename(data_home, "Trash", NULL);
+	}
+
+	// Nothing here may start a thread before the children are forked
+	for (i = 0; i < sizes->len; i++) {
+		size = g_array_index(sizes, guint, i);
+
+		if (!use_fake) {
+			if (size > have && !trash_test_bin_write(trash_path, have, size, &error)) {
+				g_printerr("%s\n", error->message);
+				success = FALSE;
+				break;
+			}
+
+			have = MAX(have, size);
+		}
+
+		if (!scan_size_in_child(output, use_fake, size)) {
+			success = FALSE;
+			break;
+		}
+	}
+
+	if (output != stdout) {
+		fclose(output);
+	}
+
+	g_clear_error(&error);
+
+	if (data_home && !trash_test_bin_remove(data_home, &error)) {
+		g_printerr("%s\n", error->message);
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
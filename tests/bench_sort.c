@@ -0,0 +1,243 @@
+/**
+ * Benchmark for sorting the trash list.
+ *
+ * Synthetic items are given rows, which are added to a #GtkListBox in a
+ * shuffled order and sorted in every sort mode the popover offers. The
+ * sort function calls the #TrashItemRow compare functions the same way
+ * the popover's does, so the time includes getting from each row to its
+ * item. This is repeated for each locale, since names are collated
+ * differently in each; locales that aren't installed are skipped.
+ *
+ * Each sort is reported as a line of JSON with the number of comparisons
+ * per second, the total time, and how many allocations a compare makes.
+ *
+ * The rows are widgets, so this needs a display; run it under `xvfb-run`
+ * where there is none.
+ */
+
+#include "trash_alloc_counter.h"
+#include "trash_bench_util.h"
+#include "trash_item_row.h"
+#include "trash_test_bin.h"
+#include <gtk/gtk.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Shuffle the same way every run, so that runs can be compared */
+#define BENCH_SEED 0x7a5b
+
+/* meson treats this exit status as a skipped test */
+#define EXIT_SKIPPED 77
+
+typedef struct {
+	const gchar *name;
+	gint (*compare)(TrashItemRow *self, TrashItemRow *other);
+	gboolean reversed;
+} SortMode;
+
+/* In the order of TrashSortMode, named as in the settings schema */
+static const SortMode sort_modes[] = {
+	{"type", trash_item_row_collate_by_type, FALSE},
+	{"a-z", trash_item_row_collate_by_name, FALSE},
+	{"z-a", trash_item_row_collate_by_name, TRUE},
+	{"date-ascending", trash_item_row_collate_by_date, FALSE},
+	{"date-descending", trash_item_row_collate_by_date, TRUE},
+};
+
+typedef struct {
+	const SortMode *mode;
+	guint64 comparisons;
+} SortRun;
+
+static gint compare_rows(GtkListBoxRow *row1, GtkListBoxRow *row2, gpointer user_data) {
+	SortRun *run = user_data;
+	TrashItemRow *a = TRASH_ITEM_ROW(row1);
+	TrashItemRow *b = TRASH_ITEM_ROW(row2);
+
+	run->comparisons++;
+
+	return run->mode->reversed ? run->mode->compare(b, a) : run->mode->compare(a, b);
+}
+
+/**
+ * Make a shuffled copy of the first @count rows.
+ */
+static GPtrArray *shuffled(GPtrArray *rows, guint count) {
+	g_autoptr(GRand) rand = NULL;
+	GPtrArray *copy;
+	gpointer swap;
+	guint i, j;
+
+	rand = g_rand_new_with_seed(BENCH_SEED);
+	copy = g_ptr_array_sized_new(count);
+
+	for (i = 0; i < count; i++) {
+		g_ptr_array_add(copy, g_ptr_array_index(rows, i));
+	}
+
+	for (i = count; i > 1; i--) {
+		j = (guint) g_rand_int_range(rand, 0, (gint32) i);
+		swap = copy->pdata[i - 1];
+		copy->pdata[i - 1] = copy->pdata[j];
+		copy->pdata[j] = swap;
+	}
+
+	return copy;
+}
+
+/**
+ * Count the allocations made by comparing every row with the next one,
+ * outside of the sort so that the list box's own buffers don't count.
+ */
+static gdouble allocations_per_compare(GPtrArray *rows, const SortMode *mode) {
+	TrashAllocCounts before, after;
+	SortRun run = {mode, 0};
+	volatile gint result = 0;
+	guint i;
+
+	if (rows->len < 2) {
+		return 0;
+	}
+
+	trash_alloc_counter_get(&before);
+
+	for (i = 0; i + 1 < rows->len; i++) {
+		result += compare_rows(rows->pdata[i + 1], rows->pdata[i], &run);
+	}
+
+	trash_alloc_counter_get(&after);
+	(void) result;
+
+	return (gdouble) (after.allocations - before.allocations) / run.comparisons;
+}
+
+static void bench_sort(FILE *output, const gchar *locale, GPtrArray *rows, guint count, const SortMode *mode) {
+	g_autoptr(GPtrArray) copy = NULL;
+	SortRun run = {mode, 0};
+	GtkWidget *list_box;
+	gint64 start, elapsed;
+	guint i;
+
+	copy = shuffled(rows, count);
+
+	// Add the rows unsorted, so that setting the sort function sorts them
+	// all at once like invalidating the sort in the popover does
+	list_box = g_object_ref_sink(gtk_list_box_new());
+
+	for (i = 0; i < copy->len; i++) {
+		gtk_container_add(GTK_CONTAINER(list_box), g_ptr_array_index(copy, i));
+	}
+
+	start = g_get_monotonic_time();
+	gtk_list_box_set_sort_func(GTK_LIST_BOX(list_box), compare_rows, &run, NULL);
+	elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+	fprintf(output, "{\"locale\": \"%s\", \"sort_mode\": \"%s\", \"items\": %u, \"comparisons\": %" G_GUINT64_FORMAT ", \"time_us\": %" G_GINT64_FORMAT ", \"comparisons_per_second\": %.1f, \"allocations_per_compare\": %.3f}\n",
+		locale,
+		mode->name,
+		count,
+		run.comparisons,
+		elapsed,
+		(gdouble) run.comparisons * G_USEC_PER_SEC / elapsed,
+		allocations_per_compare(copy, mode));
+	fflush(output);
+
+	// Keep the rows for the next sort
+	gtk_list_box_set_sort_func(GTK_LIST_BOX(list_box), NULL, NULL, NULL);
+
+	for (i = 0; i < copy->len; i++) {
+		gtk_container_remove(GTK_CONTAINER(list_box), g_ptr_array_index(copy, i));
+	}
+
+	gtk_widget_destroy(list_box);
+	g_object_unref(list_box);
+}
+
+int main(int argc, char **argv) {
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GArray) sizes = NULL;
+	g_auto(GStrv) locales = NULL;
+	g_autofree gchar *sizes_text = NULL;
+	g_autofree gchar *locales_text = NULL;
+	g_autofree gchar *output_path = NULL;
+	g_autoptr(TrashFakeBackend) backend = NULL;
+	FILE *output = stdout;
+	guint largest;
+	guint i, j, k;
+
+	GOptionEntry entries[] = {
+		{"sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_text, "Comma-separated numbers of items to sort (default 10000,100000)", "SIZES"},
+		{"locales", 'l', 0, G_OPTION_ARG_STRING, &locales_text, "Comma-separated locales to sort in (default C,en_US.UTF-8,zh_CN.UTF-8,ja_JP.UTF-8)", "LOCALES"},
+		{"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_path, "Append the results to this file instead of printing them", "FILE"},
+		{NULL, 0, 0, 0, NULL, NULL, NULL},
+	};
+
+	context = g_option_context_new("- benchmark sorting trashed items");
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	// Every row is a handful of widgets, so a million won't fit in memory
+	sizes = trash_bench_parse_sizes(sizes_text ? sizes_text : "10000,100000", &error);
+
+	if (!sizes) {
+		g_printerr("Invalid sizes: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	if (!gtk_init_check(&argc, &argv)) {
+		g_printerr("No display to make the rows on\n");
+		return EXIT_SKIPPED;
+	}
+
+	if (output_path) {
+		output = fopen(output_path, "a");
+
+		if (!output) {
+			g_printerr("Unable to open '%s'\n", output_path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	locales = g_strsplit(locales_text ? locales_text : "C,en_US.UTF-8,zh_CN.UTF-8,ja_JP.UTF-8", ",", -1);
+	largest = g_array_index(sizes, guint, sizes->len - 1);
+
+	// The rows only need a backend to act on their item
+	backend = trash_fake_backend_new();
+
+	for (i = 0; locales[i]; i++) {
+		g_autoptr(GPtrArray) rows = NULL;
+		g_autoptr(TrashInfo) info = NULL;
+
+		if (!setlocale(LC_ALL, locales[i])) {
+			g_printerr("Skipping the %s locale, as it is not installed\n", locales[i]);
+			continue;
+		}
+
+		// The collation keys depend on the locale, so make the items again
+		rows = g_ptr_array_new_full(largest, g_object_unref);
+
+		for (j = 0; j < largest; j++) {
+			g_clear_object(&info);
+			info = trash_test_bin_make_info(j);
+			g_ptr_array_add(rows, g_object_ref_sink(trash_item_row_new(info, TRASH_BACKEND(backend))));
+		}
+
+		for (j = 0; j < sizes->len; j++) {
+			for (k = 0; k < G_N_ELEMENTS(sort_modes); k++) {
+				bench_sort(output, locales[i], rows, g_array_index(sizes, guint, j), &sort_modes[k]);
+			}
+		}
+	}
+
+	if (output != stdout) {
+		fclose(output);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+/**
+ * Memory budget tests.
+ *
+ * Synthetic items are loaded through a #TrashManager, and through a
+ * #TrashPopover where there is a display, while an interposed malloc
+ * counts every block. The bytes and allocations each item costs, and the
+ * bytes left behind by each add and remove, are checked against the
+ * budget in `alloc-budget.ini`. Raise a budget only together with the
+ * change that needs it.
+ */
+
+#include "trash_alloc_counter.h"
+#include "trash_backend_fake.h"
+#include "trash_manager.h"
+#include "trash_popover.h"
+#include "trash_test_bin.h"
+#include <gtk/gtk.h>
+
+/* How many items to load to measure the cost of one */
+#define MANAGER_ITEMS 10000
+#define POPOVER_ITEMS 1000
+
+/* Loaded first, so that what every list needs once is left out */
+#define POPOVER_BASE_ITEMS 100
+
+/* How many add and remove cycles to run, after warming up with a few, on
+ * a bin of how many items */
+#define CHURN_ITEMS 100
+#define CHURN_WARMUP_CYCLES 50
+#define CHURN_CYCLES 1000
+
+/* How long to wait for the manager to catch up before failing a test */
+#define WAIT_TIMEOUT_SECONDS 60
+
+/* The schema and path of the instance settings on a real panel */
+#define SETTINGS_SCHEMA "com.solus-project.budgie-trash-applet"
+#define SETTINGS_PATH "/com/solus-project/budgie-panel/instance/budgie-trash-applet/test/"
+
+static GKeyFile *budget;
+
+static gint64 get_budget(const gchar *group, const gchar *key) {
+	g_autoptr(GError) error = NULL;
+	gint64 value;
+
+	value = g_key_file_get_int64(budget, group, key, &error);
+	g_assert_no_error(error);
+
+	return value;
+}
+
+static gboolean timeout_cb(gpointer user_data) {
+	gboolean *timed_out = user_data;
+
+	*timed_out = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Run the main context until @manager knows about @items items and has
+ * no lookups left, failing the test if it takes too long.
+ */
+static void wait_for_items(TrashManager *manager, guint items) {
+	TrashManagerCounters counters;
+	gboolean timed_out = FALSE;
+	guint timeout_id;
+
+	timeout_id = g_timeout_add_seconds(WAIT_TIMEOUT_SECONDS, timeout_cb, &timed_out);
+
+	for (;;) {
+		trash_manager_get_counters(manager, &counters);
+
+		if ((counters.items == items && counters.pending_queries == 0) || timed_out) {
+			break;
+		}
+
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	if (!timed_out) {
+		g_source_remove(timeout_id);
+	}
+
+	g_assert_false(timed_out);
+
+	// Let go of anything that finished with the last lookup
+	while (g_main_context_iteration(NULL, FALSE)) {
+	}
+}
+
+static void test_manager_per_item(void) {
+	g_autoptr(TrashFakeBackend) backend = NULL;
+	g_autoptr(TrashManager) manager = NULL;
+	TrashAllocCounts before, after;
+	gint64 bytes_per_item;
+	gint64 allocations_per_item;
+
+	backend = trash_fake_backend_new();
+	trash_test_bin_fill_fake(backend, 0, MANAGER_ITEMS);
+
+	trash_alloc_counter_get(&before);
+
+	manager = trash_manager_new_for_backend(TRASH_BACKEND(backend));
+	trash_manager_scan_items(manager);
+	wait_for_items(manager, MANAGER_ITEMS);
+
+	trash_alloc_counter_get(&after);
+
+	bytes_per_item = (after.live_bytes - before.live_bytes) / MANAGER_ITEMS;
+	allocations_per_item = ((gint64) (after.allocations - after.frees) - (gint64) (before.allocations - before.frees)) / MANAGER_ITEMS;
+
+	g_test_message("The manager keeps %" G_GINT64_FORMAT " bytes in %" G_GINT64_FORMAT " blocks per item", bytes_per_item, allocations_per_item);
+
+	g_assert_cmpint(bytes_per_item, <=, get_budget("manager", "bytes-per-item"));
+	g_assert_cmpint(allocations_per_item, <=, get_budget("manager", "allocations-per-item"));
+}
+
+static void churn(TrashFakeBackend *backend, TrashManager *manager, guint first, guint cycles, guint items) {
+	g_autofree gchar *name = NULL;
+	guint i;
+
+	for (i = first; i < first + cycles; i++) {
+		g_free(name);
+		name = g_strdup_printf("churn-%u.txt", i);
+
+		trash_fake_backend_add_item(backend, name, "/home/user/churn.txt", 1024, FALSE, 1600000000 + i);
+		wait_for_items(manager, items + 1);
+
+		g_assert_true(trash_fake_backend_remove_item(backend, name));
+		wait_for_items(manager, items);
+	}
+}
+
+static void test_manager_churn(void) {
+	g_autoptr(TrashFakeBackend) backend = NULL;
+	g_autoptr(TrashManager) manager = NULL;
+	TrashAllocCounts before, after;
+	gint64 leaked_per_cycle;
+
+	backend = trash_fake_backend_new();
+	trash_test_bin_fill_fake(backend, 0, CHURN_ITEMS);
+
+	manager = trash_manager_new_for_backend(TRASH_BACKEND(backend));
+	trash_manager_scan_items(manager);
+	wait_for_items(manager, CHURN_ITEMS);
+
+	churn(backend, manager, 0, CHURN_WARMUP_CYCLES, CHURN_ITEMS);
+
+	trash_alloc_counter_get(&before);
+	churn(backend, manager, CHURN_WARMUP_CYCLES, CHURN_CYCLES, CHURN_ITEMS);
+	trash_alloc_counter_get(&after);
+
+	leaked_per_cycle = (after.live_bytes - before.live_bytes) / CHURN_CYCLES;
+
+	g_test_message("%" G_GINT64_FORMAT " bytes were left behind per add and remove", leaked_per_cycle);
+
+	g_assert_cmpint(leaked_per_cycle, <=, get_budget("manager", "leaked-bytes-per-cycle"));
+}
+
+/**
+ * Show a popover for a trash bin with @items items, and measure how much
+ * more memory is in use while it is shown than before it was built.
+ */
+static gint64 popover_live_bytes(guint items) {
+	g_autoptr(GSettings) settings = NULL;
+	TrashAllocCounts before, after;
+	TrashPopover *popover;
+	GtkWidget *window;
+
+	trash_alloc_counter_get(&before);
+
+	settings = g_settings_new_with_path(SETTINGS_SCHEMA, SETTINGS_PATH);
+	popover = trash_popover_new(settings);
+	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(popover));
+
+	wait_for_items(trash_popover_get_manager(popover), items);
+
+	// The rows are built when the popover is mapped
+	gtk_widget_show(window);
+	wait_for_items(trash_popover_get_manager(popover), items);
+
+	trash_alloc_counter_get(&after);
+
+	gtk_widget_destroy(window);
+
+	while (g_main_context_iteration(NULL, FALSE)) {
+	}
+
+	return after.live_bytes - before.live_bytes;
+}
+
+static void test_popover_per_item(void) {
+	g_autoptr(GSettingsSchema) schema = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *trash_path = NULL;
+	gint64 base_bytes, bytes_per_item;
+
+	if (!gtk_init_check(NULL, NULL)) {
+		g_test_skip("No display to show the popover on");
+		return;
+	}
+
+	schema = g_settings_schema_source_lookup(g_settings_schema_source_get_default(), SETTINGS_SCHEMA, TRUE);
+
+	if (!schema) {
+		g_test_skip("The settings schema is not compiled");
+		return;
+	}
+
+	// The popover makes its own manager, so point it at a bin on disk
+	g_setenv("BUDGIE_TRASH_BACKEND", "xdg", TRUE);
+	trash_path = g_build_filename(g_get_user_data_dir(), "Trash", NULL);
+
+	trash_test_bin_write(trash_path, 0, POPOVER_BASE_ITEMS, &error);
+	g_assert_no_error(error);
+
+	// Once to load themes and fonts, and again for a list of the same size
+	popover_live_bytes(POPOVER_BASE_ITEMS);
+	base_bytes = popover_live_bytes(POPOVER_BASE_ITEMS);
+
+	trash_test_bin_write(trash_path, POPOVER_BASE_ITEMS, POPOVER_BASE_ITEMS + POPOVER_ITEMS, &error);
+	g_assert_no_error(error);
+
+	bytes_per_item = (popover_live_bytes(POPOVER_BASE_ITEMS + POPOVER_ITEMS) - base_bytes) / POPOVER_ITEMS;
+
+	g_test_message("The popover keeps %" G_GINT64_FORMAT " bytes per item", bytes_per_item);
+
+	g_assert_cmpint(bytes_per_item, <=, get_budget("popover", "bytes-per-item"));
+}
+
+int main(int argc, char **argv) {
+	g_autofree gchar *budget_path = NULL;
+	g_autoptr(GError) error = NULL;
+	gint result;
+
+	g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+	// Don't record the test runs, or keep settings from them
+	g_unsetenv("BUDGIE_TRASH_RECORD_EVENTS");
+	g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+
+	budget_path = g_test_build_filename(G_TEST_DIST, "alloc-budget.ini", NULL);
+	budget = g_key_file_new();
+
+	if (!g_key_file_load_from_file(budget, budget_path, G_KEY_FILE_NONE, &error)) {
+		g_printerr("Unable to load the budget from '%s': %s\n", budget_path, error->message);
+		return 1;
+	}
+
+	g_test_add_func("/alloc/manager/per-item", test_manager_per_item);
+	g_test_add_func("/alloc/manager/churn", test_manager_churn);
+	g_test_add_func("/alloc/popover/per-item", test_popover_per_item);
+
+	result = g_test_run();
+
+	g_key_file_unref(budget);
+
+	return result;
+}
@@ -0,0 +1,165 @@
+/**
+ * Tests for #TrashGvfsBackend.
+ *
+ * Items are written straight into the user's trash bin under a temporary
+ * `XDG_DATA_HOME`, where the backend watches them with inotify. The names
+ * it reports have to match the `trash:///` names that gvfs lists the same
+ * items by, or the manager would know them twice.
+ */
+
+#include "trash_backend_gvfs.h"
+
+/* How long to wait for events before failing a test */
+#define WAIT_TIMEOUT_SECONDS 5
+
+typedef struct {
+	TrashGvfsBackend *backend;
+	gchar *trash_path;
+
+	GHashTable *added;
+	GHashTable *removed;
+} Fixture;
+
+static void item_added(TrashBackend *backend, const gchar *name, Fixture *fixture) {
+	(void) backend;
+
+	g_hash_table_add(fixture->added, g_strdup(name));
+}
+
+static void item_removed(TrashBackend *backend, const gchar *name, Fixture *fixture) {
+	(void) backend;
+
+	g_hash_table_add(fixture->removed, g_strdup(name));
+}
+
+static gboolean timeout_cb(gpointer user_data) {
+	gboolean *timed_out = user_data;
+
+	*timed_out = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Run the main context until @set has @name in it, failing the test if it
+ * doesn't within a few seconds.
+ */
+static void wait_for_name(GHashTable *set, const gchar *name) {
+	gboolean timed_out = FALSE;
+	guint timeout_id;
+
+	timeout_id = g_timeout_add_seconds(WAIT_TIMEOUT_SECONDS, timeout_cb, &timed_out);
+
+	while (!g_hash_table_contains(set, name) && !timed_out) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	if (!timed_out) {
+		g_source_remove(timeout_id);
+	}
+
+	g_assert_false(timed_out);
+}
+
+/**
+ * Trash an item called @file_name the way GIO would, writing its info
+ * file first.
+ */
+static void write_item(Fixture *fixture, const gchar *file_name) {
+	g_autofree gchar *info_name = NULL;
+	g_autofree gchar *info_path = NULL;
+	g_autofree gchar *file_path = NULL;
+	g_autoptr(GError) error = NULL;
+
+	info_name = g_strconcat(file_name, ".trashinfo", NULL);
+	info_path = g_build_filename(fixture->trash_path, "info", info_name, NULL);
+	file_path = g_build_filename(fixture->trash_path, "files", file_name, NULL);
+
+	g_file_set_contents(info_path, "[Trash Info]\nPath=/home/user/test.txt\nDeletionDate=2020-09-13T12:26:40\n", -1, &error);
+	g_assert_no_error(error);
+
+	g_file_set_contents(file_path, "", -1, &error);
+	g_assert_no_error(error);
+}
+
+static void fixture_set_up(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+	fixture->trash_path = g_build_filename(g_get_user_data_dir(), "Trash", NULL);
+	fixture->added = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	fixture->removed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	// Creates the trash directories, so that they can be written to
+	fixture->backend = trash_gvfs_backend_new();
+	g_signal_connect(fixture->backend, "item-added", G_CALLBACK(item_added), fixture);
+	g_signal_connect(fixture->backend, "item-removed", G_CALLBACK(item_removed), fixture);
+}
+
+static void fixture_tear_down(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+	g_clear_object(&fixture->backend);
+	g_hash_table_unref(fixture->removed);
+	g_hash_table_unref(fixture->added);
+	g_free(fixture->trash_path);
+}
+
+static void test_escaped_names(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+#ifndef HAVE_INOTIFY
+	g_test_skip("The user's trash bin is only watched directly with inotify");
+	return;
+#endif
+
+	write_item(fixture, "plain.txt");
+	write_item(fixture, "\\backslash.txt");
+	write_item(fixture, "`backtick.txt");
+
+	wait_for_name(fixture->added, "plain.txt");
+	wait_for_name(fixture->added, "`\\backslash.txt");
+	wait_for_name(fixture->added, "``backtick.txt");
+
+	// Never by their names on disk, which gvfs doesn't list them by
+	g_assert_cmpuint(g_hash_table_size(fixture->added), ==, 3);
+}
+
+static void test_delete_escaped(Fixture *fixture, gconstpointer user_data) {
+	g_autofree gchar *info_path = NULL;
+	g_autofree gchar *file_path = NULL;
+	g_autoptr(GError) error = NULL;
+
+	(void) user_data;
+
+#ifndef HAVE_INOTIFY
+	g_test_skip("The user's trash bin is only watched directly with inotify");
+	return;
+#endif
+
+	write_item(fixture, "`backtick.txt");
+	wait_for_name(fixture->added, "``backtick.txt");
+
+	g_assert_true(trash_backend_delete_item(TRASH_BACKEND(fixture->backend), "``backtick.txt", NULL, NULL, &error));
+	g_assert_no_error(error);
+
+	info_path = g_build_filename(fixture->trash_path, "info", "`backtick.txt.trashinfo", NULL);
+	file_path = g_build_filename(fixture->trash_path, "files", "`backtick.txt", NULL);
+	g_assert_false(g_file_test(info_path, G_FILE_TEST_EXISTS));
+	g_assert_false(g_file_test(file_path, G_FILE_TEST_EXISTS));
+
+	// The removal has to match the name the item was added by
+	wait_for_name(fixture->removed, "``backtick.txt");
+	g_assert_cmpuint(g_hash_table_size(fixture->removed), ==, 1);
+}
+
+int main(int argc, char **argv) {
+	g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+	// Keep gvfs out of it, the user's own trash bin doesn't need it
+	g_setenv("GIO_USE_VFS", "local", TRUE);
+
+	g_test_add("/gvfs-backend/escaped-names", Fixture, NULL, fixture_set_up, test_escaped_names, fixture_tear_down);
+	g_test_add("/gvfs-backend/delete-escaped", Fixture, NULL, fixture_set_up, test_delete_escaped, fixture_tear_down);
+
+	return g_test_run();
+}
@@ -0,0 +1,314 @@
+/**
+ * Tests for #TrashManager, driven by a #TrashFakeBackend.
+ *
+ * Every test starts from a manager that has finished scanning a small fake
+ * trash bin, then changes the bin and waits for the manager to catch up,
+ * either from the events the backend emits or by resyncing or reconciling
+ * after events were dropped.
+ */
+
+#include "trash_backend_fake.h"
+#include "trash_manager.h"
+#include <string.h>
+
+/* How long to wait for the manager to catch up before failing a test */
+#define WAIT_TIMEOUT_SECONDS 5
+
+typedef struct {
+	TrashFakeBackend *backend;
+	TrashManager *manager;
+
+	GPtrArray *added;
+	GPtrArray *removed;
+	guint scans;
+} Fixture;
+
+typedef gboolean (*Predicate)(Fixture *fixture);
+
+static void trash_added(TrashManager *manager, TrashInfo *info, Fixture *fixture) {
+	(void) manager;
+
+	g_ptr_array_add(fixture->added, g_strdup(trash_info_peek_name(info)));
+}
+
+static void trash_removed(TrashManager *manager, const gchar *uri, Fixture *fixture) {
+	(void) manager;
+
+	g_ptr_array_add(fixture->removed, g_strdup(uri));
+}
+
+static void scan_finished(TrashManager *manager, Fixture *fixture) {
+	(void) manager;
+
+	fixture->scans++;
+}
+
+static gboolean timeout_cb(gpointer user_data) {
+	gboolean *timed_out = user_data;
+
+	*timed_out = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Run the main context until @predicate holds, failing the test if it
+ * doesn't within a few seconds.
+ */
+static void wait_until(Fixture *fixture, Predicate predicate) {
+	gboolean timed_out = FALSE;
+	guint timeout_id;
+
+	timeout_id = g_timeout_add_seconds(WAIT_TIMEOUT_SECONDS, timeout_cb, &timed_out);
+
+	while (!predicate(fixture) && !timed_out) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	if (!timed_out) {
+		g_source_remove(timeout_id);
+	}
+
+	g_assert_false(timed_out);
+}
+
+static gboolean scanned(Fixture *fixture) {
+	return fixture->scans > 0;
+}
+
+static gboolean settled(Fixture *fixture) {
+	TrashManagerCounters counters;
+
+	trash_manager_get_counters(fixture->manager, &counters);
+
+	return counters.pending_queries == 0 && counters.items == trash_fake_backend_get_item_count(fixture->backend);
+}
+
+typedef struct {
+	const gchar *name;
+	TrashInfo *info;
+} Lookup;
+
+static void lookup_cb(gpointer data, gpointer user_data) {
+	Lookup *lookup = user_data;
+
+	if (g_strcmp0(trash_info_peek_name(data), lookup->name) == 0) {
+		lookup->info = data;
+	}
+}
+
+/**
+ * Find the item the manager knows by @name, if any.
+ */
+static TrashInfo *lookup_item(Fixture *fixture, const gchar *name) {
+	Lookup lookup = {name, NULL};
+
+	trash_manager_foreach_item(fixture->manager, lookup_cb, &lookup);
+
+	return lookup.info;
+}
+
+static gboolean has_item(Fixture *fixture, const gchar *name) {
+	return lookup_item(fixture, name) != NULL;
+}
+
+static void fixture_set_up(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+	fixture->backend = trash_fake_backend_new();
+	fixture->added = g_ptr_array_new_with_free_func(g_free);
+	fixture->removed = g_ptr_array_new_with_free_func(g_free);
+
+	trash_fake_backend_add_item(fixture->backend, "a.txt", "/home/user/a.txt", 100, FALSE, 1600000000);
+	trash_fake_backend_add_item(fixture->backend, "b.txt", "/home/user/b.txt", 200, FALSE, 1600000100);
+	trash_fake_backend_add_item(fixture->backend, "c", "/home/user/c", 4096, TRUE, 1600000200);
+
+	fixture->manager = trash_manager_new_for_backend(TRASH_BACKEND(fixture->backend));
+	g_signal_connect(fixture->manager, "trash-added", G_CALLBACK(trash_added), fixture);
+	g_signal_connect(fixture->manager, "trash-removed", G_CALLBACK(trash_removed), fixture);
+	g_signal_connect(fixture->manager, "scan-finished", G_CALLBACK(scan_finished), fixture);
+
+	trash_manager_scan_items(fixture->manager);
+	wait_until(fixture, scanned);
+	wait_until(fixture, settled);
+
+	g_ptr_array_set_size(fixture->added, 0);
+	g_ptr_array_set_size(fixture->removed, 0);
+}
+
+static void fixture_tear_down(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+	g_clear_object(&fixture->manager);
+	g_clear_object(&fixture->backend);
+	g_clear_pointer(&fixture->added, g_ptr_array_unref);
+	g_clear_pointer(&fixture->removed, g_ptr_array_unref);
+}
+
+static void test_scan(Fixture *fixture, gconstpointer user_data) {
+	TrashManagerCounters counters;
+	TrashScanStats stats;
+
+	(void) user_data;
+
+	g_assert_cmpint(trash_manager_get_item_count(fixture->manager), ==, 3);
+
+	trash_manager_get_counters(fixture->manager, &counters);
+	g_assert_cmpuint(counters.total_bytes, ==, 100 + 200 + 4096);
+
+	g_assert_true(trash_manager_get_scan_stats(fixture->manager, &stats));
+	g_assert_cmpuint(stats.items, ==, 3);
+	g_assert_cmpint(stats.time_to_first_item, >=, 0);
+	g_assert_cmpint(stats.time_to_complete, >=, stats.time_to_first_item);
+}
+
+static void test_add(Fixture *fixture, gconstpointer user_data) {
+	TrashManagerCounters counters;
+
+	(void) user_data;
+
+	trash_fake_backend_add_item(fixture->backend, "d.txt", "/home/user/d.txt", 50, FALSE, 1600000300);
+	wait_until(fixture, settled);
+
+	g_assert_cmpint(trash_manager_get_item_count(fixture->manager), ==, 4);
+	g_assert_cmpuint(fixture->added->len, ==, 1);
+	g_assert_cmpstr(g_ptr_array_index(fixture->added, 0), ==, "d.txt");
+
+	trash_manager_get_counters(fixture->manager, &counters);
+	g_assert_cmpuint(counters.total_bytes, ==, 100 + 200 + 4096 + 50);
+}
+
+static void test_remove(Fixture *fixture, gconstpointer user_data) {
+	TrashManagerCounters counters;
+
+	(void) user_data;
+
+	g_assert_true(trash_fake_backend_remove_item(fixture->backend, "b.txt"));
+	wait_until(fixture, settled);
+
+	g_assert_cmpint(trash_manager_get_item_count(fixture->manager), ==, 2);
+	g_assert_cmpuint(fixture->removed->len, ==, 1);
+	g_assert_cmpstr(g_ptr_array_index(fixture->removed, 0), ==, "trash:///b.txt");
+
+	trash_manager_get_counters(fixture->manager, &counters);
+	g_assert_cmpuint(counters.total_bytes, ==, 100 + 4096);
+}
+
+static void test_add_then_remove(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+	// Removed again before the manager had a chance to look it up
+	trash_fake_backend_add_item(fixture->backend, "e.txt", "/home/user/e.txt", 10, FALSE, 1600000400);
+	g_assert_true(trash_fake_backend_remove_item(fixture->backend, "e.txt"));
+	wait_until(fixture, settled);
+
+	g_assert_cmpint(trash_manager_get_item_count(fixture->manager), ==, 3);
+	g_assert_false(has_item(fixture, "e.txt"));
+}
+
+static gboolean replaced(Fixture *fixture) {
+	return settled(fixture) && fixture->added->len > 0;
+}
+
+static void test_replace(Fixture *fixture, gconstpointer user_data) {
+	gint64 modified_time;
+
+	(void) user_data;
+
+	modified_time = trash_info_get_modified_time(lookup_item(fixture, "a.txt"));
+
+	trash_fake_backend_touch_item(fixture->backend, "a.txt");
+	wait_until(fixture, replaced);
+
+	g_assert_cmpint(trash_manager_get_item_count(fixture->manager), ==, 3);
+	g_assert_cmpuint(fixture->removed->len, ==, 1);
+	g_assert_cmpstr(g_ptr_array_index(fixture->removed, 0), ==, "trash:///a.txt");
+	g_assert_cmpuint(fixture->added->len, ==, 1);
+	g_assert_cmpstr(g_ptr_array_index(fixture->added, 0), ==, "a.txt");
+	g_assert_cmpint(trash_info_get_modified_time(lookup_item(fixture, "a.txt")), >, modified_time);
+}
+
+/**
+ * Change the bin without telling the manager, returning the modified time
+ * of the item that was replaced.
+ */
+static gint64 drift(Fixture *fixture) {
+	gint64 modified_time;
+
+	modified_time = trash_info_get_modified_time(lookup_item(fixture, "c"));
+
+	trash_fake_backend_set_emit_events(fixture->backend, FALSE);
+	trash_fake_backend_add_item(fixture->backend, "d.txt", "/home/user/d.txt", 50, FALSE, 1600000300);
+	trash_fake_backend_add_item(fixture->backend, "e.txt", "/home/user/e.txt", 60, FALSE, 1600000400);
+	g_assert_true(trash_fake_backend_remove_item(fixture->backend, "b.txt"));
+	trash_fake_backend_touch_item(fixture->backend, "c");
+	trash_fake_backend_set_emit_events(fixture->backend, TRUE);
+
+	return modified_time;
+}
+
+static gboolean caught_up(Fixture *fixture) {
+	return settled(fixture) && has_item(fixture, "d.txt") && has_item(fixture, "e.txt") && !has_item(fixture, "b.txt");
+}
+
+static void assert_caught_up(Fixture *fixture, gint64 modified_time) {
+	TrashManagerCounters counters;
+	TrashInfo *info;
+
+	g_assert_cmpint(trash_manager_get_item_count(fixture->manager), ==, 4);
+
+	// The replaced item was looked up again
+	info = lookup_item(fixture, "c");
+	g_assert_nonnull(info);
+	g_assert_cmpint(trash_info_get_modified_time(info), >, modified_time);
+
+	trash_manager_get_counters(fixture->manager, &counters);
+	g_assert_cmpuint(counters.total_bytes, ==, 100 + 4096 + 50 + 60);
+	g_assert_cmpuint(counters.pending_queries, ==, 0);
+}
+
+static void test_resync(Fixture *fixture, gconstpointer user_data) {
+	gint64 modified_time;
+
+	(void) user_data;
+
+	modified_time = drift(fixture);
+
+	// Nothing was heard about the changes yet
+	g_assert_cmpint(trash_manager_get_item_count(fixture->manager), ==, 3);
+	g_assert_true(has_item(fixture, "b.txt"));
+
+	trash_fake_backend_overflow(fixture->backend);
+	wait_until(fixture, caught_up);
+
+	assert_caught_up(fixture, modified_time);
+}
+
+static void test_reconcile(Fixture *fixture, gconstpointer user_data) {
+	gint64 modified_time;
+
+	(void) user_data;
+
+	modified_time = drift(fixture);
+	trash_manager_reconcile(fixture->manager);
+	wait_until(fixture, caught_up);
+
+	assert_caught_up(fixture, modified_time);
+}
+
+int main(int argc, char **argv) {
+	g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+	// Don't record the test runs
+	g_unsetenv("BUDGIE_TRASH_RECORD_EVENTS");
+
+	g_test_add("/manager/scan", Fixture, NULL, fixture_set_up, test_scan, fixture_tear_down);
+	g_test_add("/manager/add", Fixture, NULL, fixture_set_up, test_add, fixture_tear_down);
+	g_test_add("/manager/remove", Fixture, NULL, fixture_set_up, test_remove, fixture_tear_down);
+	g_test_add("/manager/add-then-remove", Fixture, NULL, fixture_set_up, test_add_then_remove, fixture_tear_down);
+	g_test_add("/manager/replace", Fixture, NULL, fixture_set_up, test_replace, fixture_tear_down);
+	g_test_add("/manager/resync", Fixture, NULL, fixture_set_up, test_resync, fixture_tear_down);
+	g_test_add("/manager/reconcile", Fixture, NULL, fixture_set_up, test_reconcile, fixture_tear_down);
+
+	return g_test_run();
+}
@@ -0,0 +1,209 @@
+/**
+ * Tests for #TrashPurgeScheduler, driven by a #TrashFakeBackend.
+ *
+ * Every test fills a fake trash bin, sets a retention policy, and waits for
+ * the scheduler to purge down to it. The items that are left show whether
+ * the right ones were picked.
+ */
+
+#include "trash_backend_fake.h"
+#include "trash_manager.h"
+#include "trash_purge_scheduler.h"
+#include "trash_settings_keys.h"
+
+/* How long to wait for a purge before failing a test; a pass only starts
+ * a few seconds after the items come in */
+#define WAIT_TIMEOUT_SECONDS 30
+
+/* How long to keep going once the expected items are gone, to catch any
+ * that are purged on top of them */
+#define SETTLE_MILLISECONDS 1500
+
+/* The schema and path of the instance settings on a real panel */
+#define SETTINGS_SCHEMA "com.solus-project.budgie-trash-applet"
+#define SETTINGS_PATH "/com/solus-project/budgie-panel/instance/budgie-trash-applet/test/"
+
+#define GIGABYTE ((goffset) 1000 * 1000 * 1000)
+#define DAY (24 * 60 * 60)
+
+typedef struct {
+	TrashFakeBackend *backend;
+	TrashManager *manager;
+	GSettings *settings;
+	TrashPurgeScheduler *scheduler;
+} Fixture;
+
+static gboolean timeout_cb(gpointer user_data) {
+	gboolean *timed_out = user_data;
+
+	*timed_out = TRUE;
+
+	return G_SOURCE_REMOVE;
+}
+
+static gchar *item_name(guint rank) {
+	return g_strdup_printf("item-%u.txt", rank);
+}
+
+/**
+ * Put an item of @size bytes in the trash bin, trashed @age seconds ago.
+ * Items are named after @rank, so that tests can check for them.
+ */
+static void add_item(Fixture *fixture, guint rank, goffset size, gint64 age) {
+	g_autofree gchar *name = NULL;
+
+	name = item_name(rank);
+
+	trash_fake_backend_add_item(fixture->backend, name, "/home/user/item.txt", size, FALSE, g_get_real_time() / G_USEC_PER_SEC - age);
+}
+
+static gboolean has_item(Fixture *fixture, guint rank) {
+	g_autofree gchar *name = NULL;
+
+	name = item_name(rank);
+
+	return trash_fake_backend_has_item(fixture->backend, name);
+}
+
+/**
+ * Start purging the trash bin, with the retention policy already set.
+ */
+static void start(Fixture *fixture) {
+	fixture->manager = trash_manager_new_for_backend(TRASH_BACKEND(fixture->backend));
+	fixture->scheduler = trash_purge_scheduler_new(fixture->manager, fixture->settings);
+
+	trash_manager_scan_items(fixture->manager);
+}
+
+/**
+ * Run the main context until @count items are left in the trash bin, and
+ * then a little longer, failing the test if it takes too long or more
+ * items are purged.
+ */
+static void wait_for_count(Fixture *fixture, guint count) {
+	gboolean timed_out = FALSE;
+	gboolean settled = FALSE;
+	guint timeout_id;
+
+	timeout_id = g_timeout_add_seconds(WAIT_TIMEOUT_SECONDS, timeout_cb, &timed_out);
+
+	while (trash_fake_backend_get_item_count(fixture->backend) > count && !timed_out) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	if (!timed_out) {
+		g_source_remove(timeout_id);
+	}
+
+	g_assert_false(timed_out);
+
+	g_timeout_add(SETTLE_MILLISECONDS, timeout_cb, &settled);
+
+	while (!settled) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	g_assert_cmpuint(trash_fake_backend_get_item_count(fixture->backend), ==, count);
+}
+
+static void fixture_set_up(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+	fixture->backend = trash_fake_backend_new();
+	fixture->settings = g_settings_new_with_path(SETTINGS_SCHEMA, SETTINGS_PATH);
+}
+
+static void fixture_tear_down(Fixture *fixture, gconstpointer user_data) {
+	(void) user_data;
+
+	g_clear_object(&fixture->scheduler);
+	g_clear_object(&fixture->manager);
+	g_clear_object(&fixture->settings);
+	g_clear_object(&fixture->backend);
+}
+
+static void test_size_oldest_first(Fixture *fixture, gconstpointer user_data) {
+	// Added out of order, so that the heap has to sort them
+	static const guint ranks[] = {7, 2, 9, 0, 5, 3, 8, 1, 6, 4};
+	guint i;
+
+	(void) user_data;
+
+	g_settings_set_uint(fixture->settings, TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE, 5);
+
+	for (i = 0; i < G_N_ELEMENTS(ranks); i++) {
+		add_item(fixture, ranks[i], GIGABYTE, (gint64) (G_N_ELEMENTS(ranks) - ranks[i]) * 60);
+	}
+
+	start(fixture);
+	wait_for_count(fixture, 5);
+
+	for (i = 0; i < G_N_ELEMENTS(ranks); i++) {
+		g_assert_cmpint(has_item(fixture, i), ==, i >= 5);
+	}
+}
+
+static void test_age(Fixture *fixture, gconstpointer user_data) {
+	guint i;
+
+	(void) user_data;
+
+	g_settings_set_uint(fixture->settings, TRASH_SETTINGS_KEY_RETENTION_DAYS, 30);
+
+	for (i = 0; i < 6; i++) {
+		add_item(fixture, i, 1024, i < 3 ? 60 * DAY : DAY);
+	}
+
+	start(fixture);
+	wait_for_count(fixture, 3);
+
+	for (i = 0; i < 6; i++) {
+		g_assert_cmpint(has_item(fixture, i), ==, i >= 3);
+	}
+}
+
+static void test_failure(Fixture *fixture, gconstpointer user_data) {
+	g_autofree gchar *locked = NULL;
+	guint i;
+
+	(void) user_data;
+
+	g_settings_set_uint(fixture->settings, TRASH_SETTINGS_KEY_RETENTION_MAX_SIZE, 2);
+
+	for (i = 0; i < 4; i++) {
+		add_item(fixture, i, GIGABYTE, (gint64) (4 - i) * 60);
+	}
+
+	locked = item_name(0);
+	trash_fake_backend_set_item_locked(fixture->backend, locked, TRUE);
+
+	g_test_expect_message(G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "*Unable to purge*");
+
+	start(fixture);
+
+	// The oldest can't be purged, and the next one goes as planned. The
+	// locked item frees nothing, so no newer item is purged to make up
+	// for it.
+	wait_for_count(fixture, 3);
+
+	g_test_assert_expected_messages();
+
+	g_assert_true(has_item(fixture, 0));
+	g_assert_false(has_item(fixture, 1));
+	g_assert_true(has_item(fixture, 2));
+	g_assert_true(has_item(fixture, 3));
+}
+
+int main(int argc, char **argv) {
+	g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+	// Don't record the test runs, or keep settings from them
+	g_unsetenv("BUDGIE_TRASH_RECORD_EVENTS");
+	g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+
+	g_test_add("/purge-scheduler/size-oldest-first", Fixture, NULL, fixture_set_up, test_size_oldest_first, fixture_tear_down);
+	g_test_add("/purge-scheduler/age", Fixture, NULL, fixture_set_up, test_age, fixture_tear_down);
+	g_test_add("/purge-scheduler/failure", Fixture, NULL, fixture_set_up, test_failure, fixture_tear_down);
+
+	return g_test_run();
+}
@@ -0,0 +1,88 @@
+/**
+ * Tests for #TrashXdgBackend, against a trash bin written under a
+ * temporary `XDG_DATA_HOME`.
+ */
+
+#include "trash_backend_xdg.h"
+#include "trash_manager.h"
+
+static void enumerate_cb(GObject *source, GAsyncResult *result, gpointer user_data) {
+	GFileEnumerator **enumerator = user_data;
+	g_autoptr(GError) error = NULL;
+
+	*enumerator = trash_backend_enumerate_finish(TRASH_BACKEND(source), result, &error);
+	g_assert_no_error(error);
+}
+
+/**
+ * List the trash bin with only @attributes, and collect the item names.
+ */
+static GHashTable *list_names(TrashBackend *backend, const gchar *attributes) {
+	g_autoptr(GFileEnumerator) enumerator = NULL;
+	g_autoptr(GError) error = NULL;
+	GHashTable *names;
+	GFileInfo *info;
+
+	trash_backend_enumerate_async(backend, attributes, G_PRIORITY_DEFAULT, NULL, enumerate_cb, &enumerator);
+
+	while (!enumerator) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+
+	names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	while ((info = g_file_enumerator_next_file(enumerator, NULL, &error))) {
+		g_hash_table_add(names, g_strdup(g_file_info_get_name(info)));
+		g_object_unref(info);
+	}
+
+	g_assert_no_error(error);
+
+	return names;
+}
+
+static void write_file(const gchar *path, const gchar *contents) {
+	g_autoptr(GError) error = NULL;
+
+	g_file_set_contents(path, contents, -1, &error);
+	g_assert_no_error(error);
+}
+
+static void test_snapshot_skips_orphans(void) {
+	g_autoptr(TrashXdgBackend) backend = NULL;
+	g_autoptr(GHashTable) scanned = NULL;
+	g_autoptr(GHashTable) snapshot = NULL;
+	g_autofree gchar *trash_path = NULL;
+	g_autofree gchar *path = NULL;
+
+	trash_path = g_build_filename(g_get_user_data_dir(), "Trash", NULL);
+	backend = trash_xdg_backend_new();
+
+	path = g_build_filename(trash_path, "info", "kept.txt.trashinfo", NULL);
+	write_file(path, "[Trash Info]\nPath=/home/user/kept.txt\nDeletionDate=2020-09-13T12:26:40\n");
+	g_free(path);
+	path = g_build_filename(trash_path, "files", "kept.txt", NULL);
+	write_file(path, "");
+	g_free(path);
+
+	// Left over from a crash halfway through trashing something
+	path = g_build_filename(trash_path, "files", "orphan.txt", NULL);
+	write_file(path, "");
+
+	scanned = list_names(TRASH_BACKEND(backend), TRASH_FILE_ATTRIBUTES);
+	snapshot = list_names(TRASH_BACKEND(backend), TRASH_SNAPSHOT_ATTRIBUTES);
+
+	// Otherwise every reconcile would find the orphan missing from the items
+	g_assert_cmpuint(g_hash_table_size(scanned), ==, 1);
+	g_assert_cmpuint(g_hash_table_size(snapshot), ==, 1);
+	g_assert_true(g_hash_table_contains(scanned, "kept.txt"));
+	g_assert_true(g_hash_table_contains(snapshot, "kept.txt"));
+}
+
+int main(int argc, char **argv) {
+	g_test_init(&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+	g_test_add_func("/xdg-backend/snapshot-skips-orphans", test_snapshot_skips_orphans);
+
+	return g_test_run();
+}
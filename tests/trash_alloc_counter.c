@@ -0,0 +1,122 @@
+/**
+ * A malloc counter for the tests and benchmarks.
+ *
+ * Linking this into an executable replaces malloc() and friends with
+ * versions that hand the work to glibc's own allocator and count every
+ * block that comes and goes. Bytes are counted with malloc_usable_size(),
+ * so a block counts the same when it is freed as when it was allocated.
+ *
+ * This only works with glibc, and not together with a sanitizer that
+ * replaces malloc itself.
+ */
+
+#include "trash_alloc_counter.h"
+#include <errno.h>
+#include <malloc.h>
+#include <stddef.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static guint64 allocations;
+static guint64 frees;
+static gint64 live_bytes;
+
+static void count_allocation(void *ptr) {
+	if (!ptr) {
+		return;
+	}
+
+	__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&live_bytes, (gint64) malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+static void count_free(void *ptr) {
+	if (!ptr) {
+		return;
+	}
+
+	__atomic_add_fetch(&frees, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&live_bytes, (gint64) malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size) {
+	void *ptr = __libc_malloc(size);
+
+	count_allocation(ptr);
+
+	return ptr;
+}
+
+void *calloc(size_t count, size_t size) {
+	void *ptr = __libc_calloc(count, size);
+
+	count_allocation(ptr);
+
+	return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+	void *new_ptr;
+	gint64 old_size;
+
+	old_size = ptr ? (gint64) malloc_usable_size(ptr) : 0;
+	new_ptr = __libc_realloc(ptr, size);
+
+	// A failed realloc leaves the old block alone
+	if (!new_ptr && size > 0) {
+		return NULL;
+	}
+
+	if (ptr) {
+		__atomic_add_fetch(&frees, 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&live_bytes, old_size, __ATOMIC_RELAXED);
+	}
+
+	count_allocation(new_ptr);
+
+	return new_ptr;
+}
+
+void *memalign(size_t alignment, size_t size) {
+	void *ptr = __libc_memalign(alignment, size);
+
+	count_allocation(ptr);
+
+	return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	return memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+	if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+		return EINVAL;
+	}
+
+	*ptr = memalign(alignment, size);
+
+	return *ptr || size == 0 ? 0 : ENOMEM;
+}
+
+void free(void *ptr) {
+	count_free(ptr);
+	__libc_free(ptr);
+}
+
+/**
+ * trash_alloc_counter_get:
+ * @counts: (out caller-allocates): where to store the totals
+ *
+ * Gets the totals counted since the program started. Take the difference
+ * between two calls to see what happened in between.
+ */
+void trash_alloc_counter_get(TrashAllocCounts *counts) {
+	counts->allocations = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+	counts->frees = __atomic_load_n(&frees, __ATOMIC_RELAXED);
+	counts->live_bytes = __atomic_load_n(&live_bytes, __ATOMIC_RELAXED);
+}
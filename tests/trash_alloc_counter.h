@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * TrashAllocCounts:
+ * @allocations: how many blocks were allocated so far
+ * @frees: how many blocks were freed so far
+ * @live_bytes: how many bytes are allocated right now
+ *
+ * Totals kept by the malloc counter linked into a test.
+ */
+typedef struct {
+	guint64 allocations;
+	guint64 frees;
+	gint64 live_bytes;
+} TrashAllocCounts;
+
+void trash_alloc_counter_get(TrashAllocCounts *counts);
+
+G_END_DECLS
@@ -0,0 +1,97 @@
+/**
+ * Helpers shared by the benchmarks and budgie-trash-replay, for reading
+ * their arguments and summing up what they measured.
+ */
+
+#include "trash_bench_util.h"
+
+static gint compare_sizes(gconstpointer a, gconstpointer b) {
+	guint size_a = *(const guint *) a;
+	guint size_b = *(const guint *) b;
+
+	return size_a < size_b ? -1 : size_a > size_b;
+}
+
+/**
+ * trash_bench_parse_sizes:
+ * @text: comma-separated numbers, e.g. `1000,10000`
+ * @error: return location for a #GError
+ *
+ * Parses a list of sizes from the command line. Each size must be at
+ * least one.
+ *
+ * Returns: (transfer full) (element-type guint) (nullable): the sizes
+ *   from smallest to largest, so that the data for each can be grown from
+ *   the one before, or %NULL on error
+ */
+GArray *trash_bench_parse_sizes(const gchar *text, GError **error) {
+	g_auto(GStrv) parts = NULL;
+	g_autoptr(GArray) sizes = NULL;
+	guint64 value;
+	guint size;
+	guint i;
+
+	g_return_val_if_fail(text != NULL, NULL);
+
+	parts = g_strsplit(text, ",", -1);
+	sizes = g_array_new(FALSE, FALSE, sizeof(guint));
+
+	for (i = 0; parts[i]; i++) {
+		if (!g_ascii_string_to_unsigned(g_strstrip(parts[i]), 10, 1, G_MAXUINT, &value, error)) {
+			return NULL;
+		}
+
+		size = (guint) value;
+		g_array_append_val(sizes, size);
+	}
+
+	g_array_sort(sizes, compare_sizes);
+
+	return g_steal_pointer(&sizes);
+}
+
+static gint compare_latency(gconstpointer a, gconstpointer b) {
+	gint64 latency_a = *(const gint64 *) a;
+	gint64 latency_b = *(const gint64 *) b;
+
+	return latency_a < latency_b ? -1 : latency_a > latency_b;
+}
+
+/**
+ * trash_bench_sort_latencies:
+ * @latencies: (element-type gint64): latencies in microseconds
+ *
+ * Sorts @latencies from shortest to longest, ready for
+ * trash_bench_percentile().
+ */
+void trash_bench_sort_latencies(GArray *latencies) {
+	g_return_if_fail(latencies != NULL);
+
+	g_array_sort(latencies, compare_latency);
+}
+
+/**
+ * trash_bench_percentile:
+ * @sorted: (element-type gint64): latencies in microseconds, sorted with
+ *   trash_bench_sort_latencies()
+ * @p: the percentile as a fraction, from 0 to 1
+ *
+ * Finds a percentile of @sorted by the nearest-rank method, so that it is
+ * always one of the latencies that was measured.
+ *
+ * Returns: the latency at @p in milliseconds, or 0 if @sorted is empty
+ */
+gdouble trash_bench_percentile(GArray *sorted, gdouble p) {
+	guint index;
+
+	g_return_val_if_fail(sorted != NULL, 0);
+
+	if (sorted->len == 0) {
+		return 0;
+	}
+
+	index = (guint) (p * sorted->len + 0.999999);
+	index = CLAMP(index, 1, sorted->len) - 1;
+
+	return (gdouble) g_array_index(sorted, gint64, index) / G_TIME_SPAN_MILLISECOND;
+}
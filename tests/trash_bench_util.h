@@ -0,0 +1,13 @@
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+GArray *trash_bench_parse_sizes(const gchar *text, GError **error);
+
+void trash_bench_sort_latencies(GArray *latencies);
+
+gdouble trash_bench_percentile(GArray *sorted, gdouble p);
+
+G_END_DECLS
@@ -0,0 +1,266 @@
+/**
+ * Synthetic trash bins for the tests and benchmarks.
+ *
+ * Every item is generated from its index, so a bin can be grown a range at
+ * a time and the same items can be put in a #TrashFakeBackend or written to
+ * disk following the FreeDesktop.org trash specification. One in three
+ * items has a long UTF-8 name, and one in ten is a deep directory instead
+ * of a file.
+ */
+
+#include "trash_test_bin.h"
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+
+/* How deep the trashed directories go */
+#define TRASH_TEST_BIN_DEPTH 8
+
+/* When the first item was trashed, and how far apart the items are */
+#define TRASH_TEST_BIN_EPOCH 1600000000
+#define TRASH_TEST_BIN_INTERVAL 37
+
+static gboolean is_directory(guint index) {
+	return index % 10 == 0;
+}
+
+static gint64 deletion_time(guint index) {
+	return TRASH_TEST_BIN_EPOCH + (gint64) index * TRASH_TEST_BIN_INTERVAL;
+}
+
+static goffset item_size(guint index) {
+	return is_directory(index) ? 4096 : 1024 + index % 4096;
+}
+
+static gchar *restore_path(guint index, const gchar *name) {
+	return g_strdup_printf("/home/user/Documents/project-%u/%s", index % 97, name);
+}
+
+/**
+ * trash_test_bin_item_name:
+ * @index: the index of the item
+ *
+ * Gets the name of an item in a synthetic trash bin. Names are unique,
+ * and stay well under the 255 byte limit of most file systems even with
+ * the `.trashinfo` suffix.
+ *
+ * Returns: (transfer full): the name of the item
+ */
+gchar *trash_test_bin_item_name(guint index) {
+	if (is_directory(index)) {
+		return g_strdup_printf("folder-%07u", index);
+	}
+
+	if (index % 3 == 0) {
+		return g_strdup_printf("Überraschung – 長いファイル名のテスト – Ωμέγα – résumé %07u (copie finale).odt", index);
+	}
+
+	return g_strdup_printf("file-%07u.txt", index);
+}
+
+static gboolean write_file(const gchar *path, const gchar *contents, GError **error) {
+	FILE *file;
+
+	file = fopen(path, "w");
+
+	if (!file) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "Unable to create '%s': %s", path, g_strerror(errno));
+		return FALSE;
+	}
+
+	fputs(contents, file);
+
+	if (fclose(file) != 0) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "Unable to write '%s': %s", path, g_strerror(errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean write_item(const gchar *files_path, const gchar *info_path, guint index, GError **error) {
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *item_path = NULL;
+	g_autofree gchar *file_path = NULL;
+	g_autofree gchar *info_name = NULL;
+	g_autofree gchar *info_file = NULL;
+	g_autofree gchar *origin = NULL;
+	g_autofree gchar *escaped = NULL;
+	g_autofree gchar *date = NULL;
+	g_autofree gchar *contents = NULL;
+	g_autoptr(GDateTime) when = NULL;
+	g_autoptr(GString) deep_path = NULL;
+	guint depth;
+
+	name = trash_test_bin_item_name(index);
+	item_path = g_build_filename(files_path, name, NULL);
+
+	if (is_directory(index)) {
+		deep_path = g_string_new(item_path);
+
+		for (depth = 1; depth <= TRASH_TEST_BIN_DEPTH; depth++) {
+			g_string_append_printf(deep_path, G_DIR_SEPARATOR_S "level-%u", depth);
+		}
+
+		if (g_mkdir_with_parents(deep_path->str, 0700) != 0) {
+			g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "Unable to create '%s': %s", deep_path->str, g_strerror(errno));
+			return FALSE;
+		}
+
+		file_path = g_build_filename(deep_path->str, "notes.txt", NULL);
+	} else {
+		file_path = g_strdup(item_path);
+	}
+
+	// Empty files take no space on disk beyond their inode
+	if (!write_file(file_path, "", error)) {
+		return FALSE;
+	}
+
+	origin = restore_path(index, name);
+	escaped = g_uri_escape_string(origin, "/", FALSE);
+	when = g_date_time_new_from_unix_local(deletion_time(index));
+	date = g_date_time_format(when, "%Y-%m-%dT%H:%M:%S");
+	info_name = g_strconcat(name, ".trashinfo", NULL);
+	info_file = g_build_filename(info_path, info_name, NULL);
+
+	contents = g_strdup_printf("[Trash Info]\nPath=%s\nDeletionDate=%s\n", escaped, date);
+
+	return write_file(info_file, contents, error);
+}
+
+/**
+ * trash_test_bin_write:
+ * @trash_path: the trash bin directory, such as `$XDG_DATA_HOME/Trash`
+ * @from: the index of the first item to write
+ * @to: the index after the last item to write
+ * @error: return location for a #GError
+ *
+ * Writes items @from up to @to to a trash bin on disk, creating its
+ * `files` and `info` directories if needed.
+ *
+ * Returns: %TRUE if every item was written
+ */
+gboolean trash_test_bin_write(const gchar *trash_path, guint from, guint to, GError **error) {
+	g_autofree gchar *files_path = NULL;
+	g_autofree gchar *info_path = NULL;
+	guint i;
+
+	files_path = g_build_filename(trash_path, "files", NULL);
+	info_path = g_build_filename(trash_path, "info", NULL);
+
+	if (g_mkdir_with_parents(files_path, 0700) != 0 || g_mkdir_with_parents(info_path, 0700) != 0) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "Unable to create a trash bin in '%s': %s", trash_path, g_strerror(errno));
+		return FALSE;
+	}
+
+	for (i = from; i < to; i++) {
+		if (!write_item(files_path, info_path, i, error)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * trash_test_bin_make_info:
+ * @index: the index of the item
+ *
+ * Creates the #TrashInfo for an item in a synthetic trash bin directly,
+ * as if a backend had listed it. Names are collated for the locale that
+ * is set at the time.
+ *
+ * Returns: (transfer full): a new #TrashInfo
+ */
+TrashInfo *trash_test_bin_make_info(guint index) {
+	g_autoptr(GFileInfo) info = NULL;
+	g_autoptr(GIcon) icon = NULL;
+	g_autoptr(GDateTime) when = NULL;
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *origin = NULL;
+	g_autofree gchar *date = NULL;
+	g_autofree gchar *uri = NULL;
+
+	name = trash_test_bin_item_name(index);
+	origin = restore_path(index, name);
+	icon = g_themed_icon_new(is_directory(index) ? "folder" : "text-x-generic");
+	when = g_date_time_new_from_unix_local(deletion_time(index));
+	date = g_date_time_format(when, "%Y-%m-%dT%H:%M:%S");
+	uri = g_strdup_printf("trash:///%s", name);
+
+	info = g_file_info_new();
+	g_file_info_set_name(info, name);
+	g_file_info_set_display_name(info, name);
+	g_file_info_set_icon(info, icon);
+	g_file_info_set_size(info, item_size(index));
+	g_file_info_set_file_type(info, is_directory(index) ? G_FILE_TYPE_DIRECTORY : G_FILE_TYPE_REGULAR);
+	g_file_info_set_attribute_string(info, G_FILE_ATTRIBUTE_TRASH_DELETION_DATE, date);
+	g_file_info_set_attribute_byte_string(info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH, origin);
+
+	return trash_info_new(info, uri);
+}
+
+/**
+ * trash_test_bin_fill_fake:
+ * @backend: a #TrashFakeBackend
+ * @from: the index of the first item to add
+ * @to: the index after the last item to add
+ *
+ * Adds items @from up to @to to a fake trash bin. Events are emitted for
+ * them unless they are turned off on @backend.
+ */
+void trash_test_bin_fill_fake(TrashFakeBackend *backend, guint from, guint to) {
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *origin = NULL;
+	guint i;
+
+	for (i = from; i < to; i++) {
+		g_free(name);
+		g_free(origin);
+		name = trash_test_bin_item_name(i);
+		origin = restore_path(i, name);
+
+		trash_fake_backend_add_item(backend, name, origin, item_size(i), is_directory(i), deletion_time(i));
+	}
+}
+
+/**
+ * trash_test_bin_remove:
+ * @path: the directory to remove
+ * @error: return location for a #GError
+ *
+ * Removes a directory and everything in it, without following symlinks.
+ *
+ * Returns: %TRUE if everything was removed
+ */
+gboolean trash_test_bin_remove(const gchar *path, GError **error) {
+	g_autoptr(GDir) dir = NULL;
+	const gchar *name;
+
+	dir = g_dir_open(path, 0, error);
+
+	if (!dir) {
+		return FALSE;
+	}
+
+	while ((name = g_dir_read_name(dir))) {
+		g_autofree gchar *child = g_build_filename(path, name, NULL);
+
+		if (g_file_test(child, G_FILE_TEST_IS_DIR) && !g_file_test(child, G_FILE_TEST_IS_SYMLINK)) {
+			if (!trash_test_bin_remove(child, error)) {
+				return FALSE;
+			}
+		} else if (g_unlink(child) != 0) {
+			g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "Unable to remove '%s': %s", child, g_strerror(errno));
+			return FALSE;
+		}
+	}
+
+	if (g_rmdir(path) != 0) {
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(errno), "Unable to remove '%s': %s", path, g_strerror(errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "trash_backend_fake.h"
+#include "trash_info.h"
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gchar *trash_test_bin_item_name(guint index);
+
+gboolean trash_test_bin_write(const gchar *trash_path, guint from, guint to, GError **error);
+
+TrashInfo *trash_test_bin_make_info(guint index);
+
+void trash_test_bin_fill_fake(TrashFakeBackend *backend, guint from, guint to);
+
+gboolean trash_test_bin_remove(const gchar *path, GError **error);
+
+G_END_DECLS
@@ -0,0 +1,270 @@
+/**
+ * budgie-trash-replay: feeds a recorded event trace into a #TrashManager.
+ *
+ * The events in the trace are replayed through a #TrashFakeBackend at
+ * their original pace, or faster with `--speed`. For every add and remove
+ * the time until the manager applies it is measured, along with the peak
+ * number of items waiting on their file info.
+ */
+
+#include "trash_backend_fake.h"
+#include "trash_bench_util.h"
+#include "trash_event_trace.h"
+#include "trash_manager.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+	GMainLoop *loop;
+	TrashManager *manager;
+	TrashFakeBackend *backend;
+
+	GPtrArray *events;
+	/* For each add, the info that was looked up for it, if any */
+	GPtrArray *add_infos;
+	guint next;
+	gdouble speed;
+	gint64 start;
+
+	GHashTable *injected;
+	GArray *latencies;
+	guint peak_pending;
+	guint max_backlog;
+} Replay;
+
+static void replay_next(Replay *replay);
+
+static void note_applied(Replay *replay, const gchar *name) {
+	gpointer value;
+	gint64 latency;
+
+	if (!g_hash_table_lookup_extended(replay->injected, name, NULL, &value)) {
+		return;
+	}
+
+	latency = g_get_monotonic_time() - *(gint64 *) value;
+	g_array_append_val(replay->latencies, latency);
+	g_hash_table_remove(replay->injected, name);
+}
+
+static void trash_added(TrashManager *manager, TrashInfo *info, Replay *replay) {
+	(void) manager;
+
+	note_applied(replay, trash_info_peek_name(info));
+}
+
+static void trash_removed(TrashManager *manager, const gchar *uri, Replay *replay) {
+	(void) manager;
+
+	// The manager reports removals by URI
+	if (g_str_has_prefix(uri, "trash:///")) {
+		note_applied(replay, uri + strlen("trash:///"));
+	}
+}
+
+static void inject(Replay *replay, guint index) {
+	TrashEvent *event = g_ptr_array_index(replay->events, index);
+	TrashEvent *info;
+	TrashManagerCounters counters;
+	gint64 *now;
+
+	now = g_new(gint64, 1);
+	*now = g_get_monotonic_time();
+
+	switch (event->type) {
+		case TRASH_EVENT_ADDED:
+			g_hash_table_replace(replay->injected, g_strdup(event->name), now);
+			info = g_ptr_array_index(replay->add_infos, index);
+
+			if (info) {
+				trash_fake_backend_add_item(replay->backend, info->name, info->restore_path ? info->restore_path : "", (goffset) info->size, info->is_directory, info->deletion_time);
+			} else {
+				// The item was gone again before the recording manager could look it up
+				trash_fake_backend_add_item(replay->backend, event->name, "", 0, FALSE, 0);
+			}
+			break;
+		case TRASH_EVENT_REMOVED:
+			g_hash_table_replace(replay->injected, g_strdup(event->name), now);
+
+			if (!trash_fake_backend_remove_item(replay->backend, event->name)) {
+				trash_backend_emit_item_removed(TRASH_BACKEND(replay->backend), event->name);
+			}
+			break;
+		case TRASH_EVENT_RESYNC:
+			g_free(now);
+			trash_fake_backend_overflow(replay->backend);
+			break;
+		case TRASH_EVENT_INFO:
+		default:
+			g_free(now);
+			break;
+	}
+
+	trash_manager_get_counters(replay->manager, &counters);
+	replay->peak_pending = MAX(replay->peak_pending, counters.pending_queries);
+	replay->max_backlog = MAX(replay->max_backlog, g_hash_table_size(replay->injected));
+}
+
+static gboolean wait_for_idle_cb(gpointer user_data) {
+	Replay *replay = user_data;
+	TrashManagerCounters counters;
+
+	trash_manager_get_counters(replay->manager, &counters);
+
+	if (counters.pending_queries > 0) {
+		return G_SOURCE_CONTINUE;
+	}
+
+	g_main_loop_quit(replay->loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean replay_next_cb(gpointer user_data) {
+	replay_next(user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * Inject every event that is due, then sleep until the next one.
+ */
+static void replay_next(Replay *replay) {
+	TrashEvent *event;
+	gint64 elapsed, due;
+
+	elapsed = g_get_monotonic_time() - replay->start;
+
+	while (replay->next < replay->events->len) {
+		event = g_ptr_array_index(replay->events, replay->next);
+		due = replay->speed > 0 ? (gint64) (event->time / replay->speed) : 0;
+
+		if (due > elapsed) {
+			g_timeout_add((guint) MAX((due - elapsed) / G_TIME_SPAN_MILLISECOND, 1), replay_next_cb, replay);
+			return;
+		}
+
+		inject(replay, replay->next);
+		replay->next++;
+	}
+
+	g_timeout_add(10, wait_for_idle_cb, replay);
+}
+
+/**
+ * Match every add with the first info recorded after it for the same
+ * name, unless the item was removed in between. A name can be trashed
+ * more than once, with different info each time.
+ */
+static GPtrArray *match_infos(GPtrArray *events) {
+	g_autoptr(GHashTable) next_info = NULL;
+	GPtrArray *add_infos;
+	TrashEvent *event;
+	guint i;
+
+	add_infos = g_ptr_array_new();
+	g_ptr_array_set_size(add_infos, (gint) events->len);
+	next_info = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (i = events->len; i-- > 0;) {
+		event = g_ptr_array_index(events, i);
+
+		if (!event->name) {
+			continue;
+		}
+
+		switch (event->type) {
+			case TRASH_EVENT_INFO:
+				g_hash_table_replace(next_info, event->name, event);
+				break;
+			case TRASH_EVENT_ADDED:
+				add_infos->pdata[i] = g_hash_table_lookup(next_info, event->name);
+				break;
+			case TRASH_EVENT_REMOVED:
+				g_hash_table_remove(next_info, event->name);
+				break;
+			default:
+				break;
+		}
+	}
+
+	return add_infos;
+}
+
+int main(int argc, char **argv) {
+	g_autoptr(GOptionContext) context = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) events = NULL;
+	TrashManagerCounters counters;
+	gdouble speed = 1.0;
+	gint64 elapsed;
+	Replay replay = {0};
+
+	GOptionEntry entries[] = {
+		{"speed", 's', 0, G_OPTION_ARG_DOUBLE, &speed, "Replay this many times faster than recorded, or 0 for as fast as possible", "FACTOR"},
+		{NULL, 0, 0, 0, NULL, NULL, NULL},
+	};
+
+	context = g_option_context_new("TRACE - replay a recorded trash event trace");
+	g_option_context_add_main_entries(context, entries, NULL);
+
+	if (!g_option_context_parse(context, &argc, &argv, &error)) {
+		g_printerr("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	if (argc != 2) {
+		g_printerr("Usage: %s [--speed=FACTOR] TRACE\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	events = trash_event_trace_load(argv[1], &error);
+
+	if (!events) {
+		g_printerr("%s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	// Don't record the replay over the trace we're reading
+	g_unsetenv("BUDGIE_TRASH_RECORD_EVENTS");
+
+	replay.loop = g_main_loop_new(NULL, FALSE);
+	replay.backend = trash_fake_backend_new();
+	replay.manager = trash_manager_new_for_backend(TRASH_BACKEND(replay.backend));
+	replay.events = events;
+	replay.add_infos = match_infos(events);
+	replay.injected = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	replay.latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+	replay.speed = speed;
+
+	g_signal_connect(replay.manager, "trash-added", G_CALLBACK(trash_added), &replay);
+	g_signal_connect(replay.manager, "trash-removed", G_CALLBACK(trash_removed), &replay);
+
+	replay.start = g_get_monotonic_time();
+	replay_next(&replay);
+	g_main_loop_run(replay.loop);
+
+	elapsed = g_get_monotonic_time() - replay.start;
+	trash_manager_get_counters(replay.manager, &counters);
+	trash_bench_sort_latencies(replay.latencies);
+
+	g_print("Replayed %u records in %.1f ms\n", events->len, (gdouble) elapsed / G_TIME_SPAN_MILLISECOND);
+	g_print("Events processed: %" G_GUINT64_FORMAT ", coalesced: %" G_GUINT64_FORMAT "\n", counters.events_processed, counters.events_coalesced);
+	g_print("Apply latency over %u changes: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+		replay.latencies->len,
+		trash_bench_percentile(replay.latencies, 0.50),
+		trash_bench_percentile(replay.latencies, 0.95),
+		trash_bench_percentile(replay.latencies, 0.99),
+		trash_bench_percentile(replay.latencies, 1.0));
+	g_print("Peak pending lookups: %u, peak unapplied changes: %u\n", replay.peak_pending, replay.max_backlog);
+	g_print("Items at the end: %u\n", counters.items);
+
+	g_array_unref(replay.latencies);
+	g_hash_table_unref(replay.injected);
+	g_ptr_array_unref(replay.add_infos);
+	g_object_unref(replay.manager);
+	g_object_unref(replay.backend);
+	g_main_loop_unref(replay.loop);
+
+	return EXIT_SUCCESS;
+}